@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace benchmarks {
+
+class State {
+    uint64_t iterations_;
+    uint64_t bytes_processed_ = 0;
+    std::chrono::steady_clock::duration paused_time_{};
+    std::chrono::steady_clock::time_point pause_begin_{};
+    std::map<std::string, double> counters_;
+
+    friend class Runner;
+
+public:
+    explicit State(uint64_t iterations) noexcept : iterations_(iterations) {}
+
+    /// Number of times the measured operation has to be repeated
+    [[nodiscard]] uint64_t iterations() const noexcept { return iterations_; }
+
+    /// Total number of bytes processed in all iterations, used to report the
+    /// throughput
+    void set_bytes_processed(uint64_t bytes) noexcept { bytes_processed_ = bytes; }
+
+    /// Reports an additional value (e.g. a latency percentile) along with the
+    /// measured time
+    void set_counter(std::string name, double value) {
+        counters_[std::move(name)] = value;
+    }
+
+    /// Excludes the time between pause_timing() and resume_timing() from the
+    /// measurement, e.g. to exclude the setup
+    void pause_timing() noexcept { pause_begin_ = std::chrono::steady_clock::now(); }
+
+    void resume_timing() noexcept {
+        paused_time_ += std::chrono::steady_clock::now() - pause_begin_;
+    }
+};
+
+using BenchmarkFn = void (*)(State&);
+
+struct Registrar {
+    Registrar(const char* name, BenchmarkFn func);
+};
+
+/// Prevents the compiler from optimizing away computation of @p value
+template <class T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory"); // NOLINT(hicpp-no-assembler)
+}
+
+} // namespace benchmarks
+
+/**
+ * @brief Defines and registers a benchmark
+ * @details Usage:
+ *   BENCHMARK(group, name) {
+ *       for (uint64_t i = 0; i < state.iterations(); ++i) {
+ *           // measured operation
+ *       }
+ *   }
+ */
+#define BENCHMARK(group, name)                                                          \
+    static void benchmark_##group##_##name(::benchmarks::State& state);                 \
+    static const ::benchmarks::Registrar benchmark_registrar_##group##_##name{          \
+        #group "." #name, benchmark_##group##_##name};                                  \
+    static void benchmark_##group##_##name(::benchmarks::State& state)
@@ -0,0 +1,114 @@
+#include "../../src/job_server/jobs_queue.hh"
+#include "../benchmark.hh"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+using job_server::JobsQueue;
+using Lane = JobsQueue::Lane;
+
+namespace {
+
+constexpr uint64_t JOBS = 10'000;
+constexpr uint64_t PROBLEMS = 300;
+constexpr uint64_t OWNERS = 500;
+
+struct QueuedJob {
+    uint64_t problem_id;
+    uint64_t owner;
+    int64_t cost_ms;
+};
+
+// Pseudo-random submissions: a few problems get most of them, like during a
+// contest
+std::vector<QueuedJob> generate_jobs() {
+    std::mt19937 gen{42}; // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<QueuedJob> res;
+    for (uint64_t i = 0; i < JOBS; ++i) {
+        auto problem_id = (gen() % 4 == 0 ? gen() % PROBLEMS : gen() % 5) + 1;
+        res.push_back({problem_id, gen() % OWNERS + 1, static_cast<int64_t>(gen() % 5000)});
+    }
+    return res;
+}
+
+void add_judge_jobs(JobsQueue& jq, const std::vector<QueuedJob>& jobs) {
+    uint64_t jid = 0;
+    for (auto const& job : jobs) {
+        jq.add_judge_job(++jid, 0, job.problem_id, false, Lane::JUDGE, job.owner, job.cost_ms);
+    }
+}
+
+} // namespace
+
+// Queues JOBS judge jobs as syncing with the database does
+BENCHMARK(jobs_queue, add_judge_jobs_10k) {
+    static const auto jobs = generate_jobs();
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        state.pause_timing();
+        auto jq = std::make_unique<JobsQueue>();
+        state.resume_timing();
+
+        add_judge_jobs(*jq, jobs);
+
+        state.pause_timing();
+        jq.reset(); // destroying the queue is not measured
+        state.resume_timing();
+    }
+}
+
+// Passes all the queued judge jobs to workers as sync_and_assign_jobs() does
+BENCHMARK(jobs_queue, drain_judge_jobs_10k) {
+    static const auto jobs = generate_jobs();
+    uint64_t passed = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        state.pause_timing();
+        auto jq = std::make_unique<JobsQueue>();
+        add_judge_jobs(*jq, jobs);
+        state.resume_timing();
+
+        for (;;) {
+            auto job = jq->best_judge_job();
+            if (not job.ok()) {
+                break;
+            }
+            job.was_passed();
+            ++passed;
+        }
+
+        state.pause_timing();
+        jq.reset();
+        state.resume_timing();
+    }
+    benchmarks::do_not_optimize(passed);
+}
+
+// Problem management jobs lock their problems, so the judge jobs of the
+// problem are moved to the locked problems and back when it is unlocked
+BENCHMARK(jobs_queue, lock_and_unlock_problem_with_judge_jobs) {
+    static const auto jobs = generate_jobs();
+    JobsQueue jq;
+    add_judge_jobs(jq, jobs);
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        auto problem_id = i % PROBLEMS + 1;
+        jq.lock_problem(problem_id);
+        jq.unlock_problem(problem_id);
+    }
+}
+
+// Looks for a job with a warm worker among the first problems of the queue
+// (as done to avoid reloading problem packages)
+BENCHMARK(jobs_queue, best_judge_job_within_window) {
+    static const auto jobs = generate_jobs();
+    JobsQueue jq;
+    add_judge_jobs(jq, jobs);
+    uint64_t found = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        auto job = jq.best_judge_job_within_window(16, [&](uint64_t problem_id) {
+            return problem_id == i % PROBLEMS + 1;
+        });
+        found += job.ok();
+    }
+    benchmarks::do_not_optimize(found);
+}
@@ -0,0 +1,127 @@
+#include "../../src/job_server/workers_pool.hh"
+#include "../benchmark.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using job_server::WorkersPool;
+using std::vector;
+
+namespace {
+
+constexpr size_t WORKERS = 64;
+
+int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()
+    )
+        .count();
+}
+
+// Workers are detached threads, so the pool lives until the end of the program
+class Pool {
+    std::atomic<uint64_t> handled_jobs_{0};
+    std::atomic<int64_t> pass_time_ns_{0};
+    std::mutex latencies_mtx_;
+    vector<int64_t> latencies_ns_;
+    WorkersPool wp_{
+        [this](WorkersPool::NextJob /*unused*/) {
+            auto latency = now_ns() - pass_time_ns_.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lock(latencies_mtx_);
+                latencies_ns_.emplace_back(latency);
+            }
+            handled_jobs_.fetch_add(1, std::memory_order_release);
+        },
+        nullptr,
+        nullptr,
+    };
+
+public:
+    Pool() {
+        wp_.set_slots_no(WORKERS);
+        for (size_t i = 0; i < WORKERS; ++i) {
+            wp_.spawn_worker();
+        }
+    }
+
+    static Pool& get() {
+        static auto& pool = *new Pool; // NOLINT(cppcoreguidelines-owning-memory)
+        return pool;
+    }
+
+    /// Passes a job as soon as some worker is idle
+    void pass_job(uint64_t job_id) {
+        pass_time_ns_.store(now_ns(), std::memory_order_release);
+        while (not wp_.pass_job(job_id)) {
+            std::this_thread::yield();
+            pass_time_ns_.store(now_ns(), std::memory_order_release);
+        }
+    }
+
+    void wait_for_handled_jobs(uint64_t num) {
+        while (handled_jobs_.load(std::memory_order_acquire) < num) {
+            std::this_thread::yield();
+        }
+    }
+
+    uint64_t handled_jobs() const noexcept { return handled_jobs_.load(); }
+
+    vector<int64_t> take_latencies() {
+        std::lock_guard<std::mutex> lock(latencies_mtx_);
+        return std::move(latencies_ns_);
+    }
+};
+
+void report_latency_percentiles(benchmarks::State& state, vector<int64_t> latencies) {
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return static_cast<double>(latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+    };
+    state.set_counter("dispatch_p50_ns", percentile(0.5));
+    state.set_counter("dispatch_p99_ns", percentile(0.99));
+    state.set_counter("dispatch_max_ns", percentile(1));
+}
+
+} // namespace
+
+// One job at a time: measures the time from pass_job() to the job being
+// handled by a worker woken up from the idle state
+BENCHMARK(workers_pool, dispatch_latency_64_workers) {
+    auto& pool = Pool::get();
+    state.pause_timing();
+    auto handled = pool.handled_jobs();
+    pool.wait_for_handled_jobs(handled);
+    (void)pool.take_latencies();
+    state.resume_timing();
+
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        pool.pass_job(i);
+        pool.wait_for_handled_jobs(++handled);
+    }
+    report_latency_percentiles(state, pool.take_latencies());
+}
+
+// Bursts of as many jobs as there are workers: measures the throughput of
+// dispatching
+BENCHMARK(workers_pool, dispatch_burst_64_workers) {
+    auto& pool = Pool::get();
+    auto handled = pool.handled_jobs();
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        for (size_t j = 0; j < WORKERS; ++j) {
+            pool.pass_job(j);
+        }
+        handled += WORKERS;
+        pool.wait_for_handled_jobs(handled);
+    }
+    (void)pool.take_latencies();
+    state.set_counter("jobs_per_iteration", WORKERS);
+}
@@ -0,0 +1,190 @@
+#include "benchmark.hh"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace benchmarks {
+
+namespace {
+
+struct Benchmark {
+    const char* name;
+    BenchmarkFn func;
+};
+
+vector<Benchmark>& registered_benchmarks() {
+    static vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+} // namespace
+
+Registrar::Registrar(const char* name, BenchmarkFn func) {
+    registered_benchmarks().push_back({name, func});
+}
+
+class Runner {
+    std::chrono::nanoseconds min_time_;
+    uint64_t repetitions_;
+
+    static std::chrono::nanoseconds run_once(BenchmarkFn func, State& state) {
+        auto beg = std::chrono::steady_clock::now();
+        func(state);
+        auto end = std::chrono::steady_clock::now();
+        return end - beg - state.paused_time_;
+    }
+
+    static void print_json_string(const char* str) {
+        putchar('"');
+        for (; *str; ++str) {
+            if (*str == '"' or *str == '\\') {
+                putchar('\\');
+            }
+            putchar(*str);
+        }
+        putchar('"');
+    }
+
+public:
+    Runner(std::chrono::nanoseconds min_time, uint64_t repetitions)
+    : min_time_(min_time)
+    , repetitions_(std::max<uint64_t>(repetitions, 1)) {}
+
+    /// Runs @p bench with increasing number of iterations until the run lasts
+    /// at least min_time_, then repeats the run repetitions_ - 1 times and
+    /// prints the median result as one line of JSON
+    void run(const Benchmark& bench) {
+        uint64_t iterations = 1;
+        for (;;) {
+            State state{iterations};
+            auto time = run_once(bench.func, state);
+            if (time >= min_time_ or iterations >= (uint64_t{1} << 40)) {
+                vector<std::chrono::nanoseconds> times = {time};
+                for (uint64_t rep = 1; rep < repetitions_; ++rep) {
+                    state = State{iterations};
+                    times.emplace_back(run_once(bench.func, state));
+                }
+                std::sort(times.begin(), times.end());
+                report(bench, state, times);
+                return;
+            }
+            // Aim at 1.5 * min_time_, but grow at most 10 times at once
+            auto time_ns = std::max<int64_t>(time.count(), 1);
+            auto target = static_cast<double>(min_time_.count()) * 1.5 /
+                static_cast<double>(time_ns) * static_cast<double>(iterations);
+            iterations = static_cast<uint64_t>(
+                std::clamp(target, static_cast<double>(iterations + 1), iterations * 10.0)
+            );
+        }
+    }
+
+    // @p sorted_times are the times of all the repetitions
+    static void report(
+        const Benchmark& bench,
+        const State& state,
+        const vector<std::chrono::nanoseconds>& sorted_times
+    ) {
+        auto ns = static_cast<double>(sorted_times[sorted_times.size() / 2].count());
+        printf("{\"name\":");
+        print_json_string(bench.name);
+        printf(
+            ",\"iterations\":%" PRIu64 ",\"ns_per_iteration\":%.3f",
+            state.iterations_,
+            ns / static_cast<double>(state.iterations_)
+        );
+        if (state.bytes_processed_ > 0) {
+            printf(
+                ",\"mb_per_s\":%.3f",
+                static_cast<double>(state.bytes_processed_) / ns * 1e9 / (1 << 20)
+            );
+        }
+        if (sorted_times.size() > 1) {
+            // Relative difference between the slowest and the fastest repetition
+            printf(
+                ",\"repetitions\":%zu,\"spread_percent\":%.1f",
+                sorted_times.size(),
+                static_cast<double>((sorted_times.back() - sorted_times.front()).count()) / ns *
+                    100
+            );
+        }
+        for (const auto& [name, value] : state.counters_) {
+            putchar(',');
+            print_json_string(name.c_str());
+            printf(":%.3f", value);
+        }
+        printf("}\n");
+        fflush(stdout);
+    }
+};
+
+} // namespace benchmarks
+
+static void print_help(const char* program_name) {
+    printf(
+        "Usage: %s [options] [filter...]\n"
+        "Runs benchmarks whose names contain any of the filters (all if no filter is given)\n"
+        "and prints the results as JSON, one benchmark per line.\n"
+        "Options:\n"
+        "  --list            list benchmarks and exit\n"
+        "  --min-time <sec>  minimum time of measurement of each benchmark (default: 0.5)\n"
+        "  --repetitions <n> number of measurements of each benchmark, the median one is\n"
+        "                    reported (default: 1)\n",
+        program_name
+    );
+}
+
+int main(int argc, char** argv) {
+    double min_time_sec = 0.5;
+    uint64_t repetitions = 1;
+    bool list_only = false;
+    vector<string> filters;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--list") == 0) {
+            list_only = true;
+        } else if (strcmp(argv[i], "--min-time") == 0 and i + 1 < argc) {
+            min_time_sec = strtod(argv[++i], nullptr);
+        } else if (strcmp(argv[i], "--repetitions") == 0 and i + 1 < argc) {
+            repetitions = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-h") == 0 or strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_help(argv[0]);
+            return 1;
+        } else {
+            filters.emplace_back(argv[i]);
+        }
+    }
+
+    auto benchmarks = benchmarks::registered_benchmarks();
+    std::sort(benchmarks.begin(), benchmarks.end(), [](const auto& a, const auto& b) {
+        return strcmp(a.name, b.name) < 0;
+    });
+
+    benchmarks::Runner runner{
+        std::chrono::nanoseconds{static_cast<int64_t>(min_time_sec * 1e9)}, repetitions
+    };
+    for (const auto& bench : benchmarks) {
+        bool selected = filters.empty() or
+            std::any_of(filters.begin(), filters.end(), [&](const string& filter) {
+                return strstr(bench.name, filter.c_str()) != nullptr;
+            });
+        if (not selected) {
+            continue;
+        }
+        if (list_only) {
+            printf("%s\n", bench.name);
+        } else {
+            runner.run(bench);
+        }
+    }
+    return 0;
+}
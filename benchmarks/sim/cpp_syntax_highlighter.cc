@@ -0,0 +1,89 @@
+#include "../benchmark.hh"
+
+#include <cstdint>
+#include <random>
+#include <sim/cpp_syntax_highlighter.hh>
+#include <simlib/concat_tostr.hh>
+#include <string>
+
+using std::string;
+
+namespace {
+
+constexpr size_t SOURCE_SIZE = 1 << 20;
+
+// Generates a pseudo-random source of a typical solution of size at least
+// SOURCE_SIZE
+string generate_code() {
+    std::mt19937 gen{42}; // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    string res = "#include <bits/stdc++.h>\n\nusing namespace std;\n\n";
+    for (uint64_t fn = 0; res.size() < SOURCE_SIZE; ++fn) {
+        auto n = gen() % 1000000;
+        back_insert(
+            res,
+            "// Computes something interesting, see: https://example.com/", fn,
+            "\nstatic long long solve_", fn,
+            "(const vector<int>& values, int limit) {\n"
+            "    /* Sum of values not greater than limit */\n"
+            "    long long result = 0;\n"
+            "    for (size_t i = 0; i < values.size(); ++i) {\n"
+            "        if (values[i] <= limit && values[i] % ", n % 97 + 2, " != 0) {\n"
+            "            result += static_cast<long long>(values[i]) * ", n, "LL;\n"
+            "        } else {\n"
+            "            result ^= 0x", n % 65521, " + 1.5e-3 * i;\n"
+            "        }\n"
+            "    }\n"
+            "    printf(\"%lld\\n\", result);\n"
+            "    return result == 0 ? '\\0' : result;\n"
+            "}\n\n"
+        );
+    }
+    return res;
+}
+
+// Generates a source consisting mostly of comments and literals of size at
+// least SOURCE_SIZE
+string generate_comments_and_literals() {
+    string res;
+    for (uint64_t i = 0; res.size() < SOURCE_SIZE; ++i) {
+        back_insert(
+            res,
+            "/*\n * Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod\n"
+            " * tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam.\n"
+            " */\n"
+            "const char* text_", i, " = \"quis nostrud exercitation ullamco laboris nisi ut "
+            "aliquip ex ea commodo consequat\\t\\x41\\n\";\n"
+            "// Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore\n"
+        );
+    }
+    return res;
+}
+
+void run_benchmark(benchmarks::State& state, const string& source) {
+    sim::CppSyntaxHighlighter csh;
+    size_t output_size = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        auto res = csh(source);
+        benchmarks::do_not_optimize(res.data());
+        output_size = res.size();
+    }
+    state.set_bytes_processed(state.iterations() * source.size());
+    // The size of the HTML matters as much as the speed, because it is sent to
+    // the users
+    state.set_counter(
+        "output_bytes_per_input_byte",
+        static_cast<double>(output_size) / static_cast<double>(source.size())
+    );
+}
+
+} // namespace
+
+BENCHMARK(cpp_syntax_highlighter, code_1mb) {
+    static const string source = generate_code();
+    run_benchmark(state, source);
+}
+
+BENCHMARK(cpp_syntax_highlighter, comments_and_literals_1mb) {
+    static const string source = generate_comments_and_literals();
+    run_benchmark(state, source);
+}
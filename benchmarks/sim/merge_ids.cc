@@ -0,0 +1,88 @@
+#include "../benchmark.hh"
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <sim/merging/merge_ids.h>
+#include <sim/sql_fields/datetime.hh>
+#include <simlib/time.hh>
+#include <vector>
+
+using sim::merging::IdCreatedAt;
+using sim::sql_fields::Datetime;
+
+namespace {
+
+constexpr uint64_t IDS = 100'000;
+
+// Ids of a table from which every tenth record was deleted
+class VectorIdIterator : public sim::merging::IdIterator {
+    uint64_t min_id_;
+    std::vector<Datetime> created_at_; // indexed by id - min_id_
+    uint64_t next_id_ = 0;
+
+public:
+    // Records are created every @p interval seconds starting at @p first_created_at
+    VectorIdIterator(uint64_t min_id, uint64_t ids_num, time_t first_created_at, time_t interval)
+    : min_id_{min_id} {
+        for (uint64_t i = 0; i < ids_num; ++i) {
+            created_at_.emplace_back(
+                mysql_date(first_created_at + static_cast<time_t>(i) * interval)
+            );
+        }
+    }
+
+    void rewind() noexcept { next_id_ = min_id_ + created_at_.size(); }
+
+    [[nodiscard]] uint64_t min_id() override { return min_id_; }
+
+    [[nodiscard]] uint64_t max_id_plus_one() override { return min_id_ + created_at_.size(); }
+
+    [[nodiscard]] std::optional<IdCreatedAt> next_id_desc() override {
+        do {
+            if (next_id_ == min_id_) {
+                return std::nullopt;
+            }
+            --next_id_;
+        } while (next_id_ % 10 == 0);
+        return IdCreatedAt{next_id_, created_at_[next_id_ - min_id_]};
+    }
+
+    [[nodiscard]] std::optional<Datetime> created_at_upper_bound_of_id(uint64_t id) override {
+        if (id < min_id_ or id >= max_id_plus_one()) {
+            return std::nullopt;
+        }
+        return created_at_[id - min_id_];
+    }
+};
+
+} // namespace
+
+// Merges the ids of two tables of IDS records each, created in the same period
+BENCHMARK(merge_ids, interleaved_100k) {
+    static VectorIdIterator current{1, IDS, 1'600'000'000, 2};
+    static VectorIdIterator other{1, IDS, 1'600'000'001, 2};
+    uint64_t max_new_id = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        current.rewind();
+        other.rewind();
+        auto merged = sim::merging::merge_ids(current, other);
+        max_new_id = merged.max_new_id_plus_one();
+    }
+    benchmarks::do_not_optimize(max_new_id);
+}
+
+// Merges the ids of a table of records created after all the records of the
+// other table
+BENCHMARK(merge_ids, disjoint_100k) {
+    static VectorIdIterator current{1, IDS, 1'600'000'000, 1};
+    static VectorIdIterator other{1, IDS, 1'700'000'000, 1};
+    uint64_t max_new_id = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        current.rewind();
+        other.rewind();
+        auto merged = sim::merging::merge_ids(current, other);
+        max_new_id = merged.max_new_id_plus_one();
+    }
+    benchmarks::do_not_optimize(max_new_id);
+}
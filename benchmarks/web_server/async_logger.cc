@@ -0,0 +1,105 @@
+#include "../../src/web_server/server/async_logger.hh"
+#include "../benchmark.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <simlib/logger.hh>
+#include <unistd.h>
+#include <vector>
+
+using std::vector;
+using web_server::server::AsyncLogger;
+
+namespace {
+
+int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()
+    )
+        .count();
+}
+
+// Temporary log file, removed at destruction
+class LogFile {
+    char path_[32] = "/tmp/sim-benchmark-log.XXXXXX";
+    int fd_;
+
+public:
+    LogFile() : fd_{mkostemp(path_, O_APPEND | O_CLOEXEC)} {
+        if (fd_ < 0) {
+            std::abort();
+        }
+    }
+
+    LogFile(const LogFile&) = delete;
+    LogFile(LogFile&&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+    LogFile& operator=(LogFile&&) = delete;
+
+    ~LogFile() {
+        (void)close(fd_);
+        (void)unlink(path_);
+    }
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+};
+
+// Logs the same lines as a web server worker does while handling a request
+template <class Log>
+void log_request(Log& log, uint64_t i) {
+    log("Connection accepted: ", 140245339940608ULL, " form ", "192.168.1.17");
+    log("/api/submissions/u", i, "/tF");
+    log("Response generated in ", "0.", i % 1000, " ms.");
+    log("Closing...");
+    log("Closed");
+}
+
+template <class Log>
+void run_benchmark(benchmarks::State& state, Log& log) {
+    vector<int64_t> latencies;
+    latencies.reserve(state.iterations());
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        auto beg = now_ns();
+        log_request(log, i);
+        latencies.emplace_back(now_ns() - beg);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return static_cast<double>(latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+    };
+    state.set_counter("request_logging_p50_ns", percentile(0.5));
+    state.set_counter("request_logging_p99_ns", percentile(0.99));
+    state.set_counter("request_logging_max_ns", percentile(1));
+}
+
+} // namespace
+
+BENCHMARK(web_server_logging, stdlog_request) {
+    LogFile file;
+    FILE* stream = fdopen(dup(file.fd()), "a");
+    if (stream == nullptr) {
+        std::abort();
+    }
+    {
+        Logger log{stream};
+        run_benchmark(state, log);
+    }
+    (void)fclose(stream);
+}
+
+BENCHMARK(web_server_logging, async_logger_request) {
+    LogFile file;
+    AsyncLogger log{file.fd()};
+    run_benchmark(state, log);
+    // Writing the rest belongs to the measurement
+    log.flush();
+    // Lines are dropped if they are logged faster than they are written. The
+    // dropped lines are lost request logs, so the latency is comparable with
+    // stdlog_request only if none were dropped.
+    state.set_counter("dropped_lines", static_cast<double>(log.dropped_lines()));
+}
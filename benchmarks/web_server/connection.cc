@@ -0,0 +1,160 @@
+#include "../../src/web_server/server/connection.hh"
+#include "../benchmark.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <simlib/concat_tostr.hh>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using std::string;
+using web_server::server::Connection;
+
+namespace {
+
+// Request of a page by a browser
+const string browser_get_request = "GET /api/submissions/u1/tF HTTP/1.1\r\n"
+                                   "Host: sim.example.com\r\n"
+                                   "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) "
+                                   "Gecko/20100101 Firefox/115.0\r\n"
+                                   "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+                                   "image/avif,image/webp,*/*;q=0.8\r\n"
+                                   "Accept-Language: en-US,en;q=0.5\r\n"
+                                   "Accept-Encoding: gzip, deflate, br\r\n"
+                                   "Referer: https://sim.example.com/s\r\n"
+                                   "Connection: keep-alive\r\n"
+                                   "Cookie: session=0123456789abcdefghijklmnopqrstuv; "
+                                   "csrf_token=ABCDEFGHIJKLMNOPQRSTUVWXYZ012345\r\n"
+                                   "Upgrade-Insecure-Requests: 1\r\n"
+                                   "Sec-Fetch-Dest: document\r\n"
+                                   "Sec-Fetch-Mode: navigate\r\n"
+                                   "Sec-Fetch-Site: same-origin\r\n"
+                                   "\r\n";
+
+string post_urlencoded_request() {
+    string body = "csrf_token=ABCDEFGHIJKLMNOPQRSTUVWXYZ012345&username=jan_kowalski"
+                  "&first_name=Jan&last_name=Kowalski%20Nowak&email=jan%40example.com"
+                  "&password=correct+horse+battery+staple"
+                  "&password_repeated=correct+horse+battery+staple";
+    return concat_tostr(
+        "POST /api/user/add HTTP/1.1\r\n"
+        "Host: sim.example.com\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "Cookie: session=0123456789abcdefghijklmnopqrstuv\r\n"
+        "Content-Length: ",
+        body.size(),
+        "\r\n\r\n",
+        body
+    );
+}
+
+// Submission of a solution with a source file of size @p file_size
+string post_multipart_request(size_t file_size) {
+    const string boundary = "---------------------------735323031399963166993862150";
+    string file;
+    while (file.size() < file_size) {
+        file += "    for (int i = 0; i < n; ++i) { sum += a[i] * b[i]; } // line\n";
+    }
+    file.resize(file_size);
+
+    string body;
+    auto add_field = [&](StringView name, StringView value) {
+        back_insert(
+            body,
+            "--",
+            boundary,
+            "\r\nContent-Disposition: form-data; name=\"",
+            name,
+            "\"\r\n\r\n",
+            value,
+            "\r\n"
+        );
+    };
+    add_field("csrf_token", "ABCDEFGHIJKLMNOPQRSTUVWXYZ012345");
+    add_field("problem_round_id", "17");
+    add_field("language", "cpp17");
+    add_field("code", "");
+    back_insert(
+        body,
+        "--",
+        boundary,
+        "\r\nContent-Disposition: form-data; name=\"solution\"; filename=\"sol.cpp\"\r\n"
+        "Content-Type: text/x-c++src\r\n\r\n",
+        file,
+        "\r\n--",
+        boundary,
+        "--\r\n"
+    );
+    return concat_tostr(
+        "POST /api/submission/add/p17 HTTP/1.1\r\n"
+        "Host: sim.example.com\r\n"
+        "Content-Type: multipart/form-data; boundary=",
+        boundary,
+        "\r\nCookie: session=0123456789abcdefghijklmnopqrstuv\r\n"
+        "Content-Length: ",
+        body.size(),
+        "\r\n\r\n",
+        body
+    );
+}
+
+// Parses state.iterations() copies of @p request sent through a socket by
+// another thread, as one keep-alive connection
+void run_benchmark(benchmarks::State& state, const string& request) {
+    state.pause_timing();
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds)) {
+        std::abort();
+    }
+    auto conn = std::make_unique<Connection>(fds[0]);
+    std::thread writer{[&, iterations = state.iterations()] {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (size_t pos = 0; pos < request.size();) {
+                auto written = write(fds[1], request.data() + pos, request.size() - pos);
+                if (written < 0) {
+                    std::abort();
+                }
+                pos += static_cast<size_t>(written);
+            }
+        }
+    }};
+    state.resume_timing();
+
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        auto req = conn->get_request();
+        if (conn->state() != Connection::OK) {
+            std::abort();
+        }
+        benchmarks::do_not_optimize(req.target.data());
+    }
+
+    state.pause_timing();
+    writer.join();
+    (void)close(fds[0]);
+    (void)close(fds[1]);
+    state.resume_timing();
+    state.set_bytes_processed(state.iterations() * request.size());
+}
+
+} // namespace
+
+BENCHMARK(connection, get_request) { run_benchmark(state, browser_get_request); }
+
+BENCHMARK(connection, post_urlencoded) {
+    static const string request = post_urlencoded_request();
+    run_benchmark(state, request);
+}
+
+// Uploaded files are written to temporary files, so it measures the disk as well
+BENCHMARK(connection, post_multipart_64kb_file) {
+    static const string request = post_multipart_request(64 << 10);
+    run_benchmark(state, request);
+}
+
+BENCHMARK(connection, post_multipart_1mb_file) {
+    static const string request = post_multipart_request(1 << 20);
+    run_benchmark(state, request);
+}
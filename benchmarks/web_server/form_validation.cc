@@ -0,0 +1,81 @@
+#include "../../src/web_server/http/form_fields.hh"
+#include "../../src/web_server/http/form_validation.hh"
+#include "../benchmark.hh"
+
+#include <cstdint>
+#include <sim/users/user.hh>
+#include <simlib/string_view.hh>
+#include <string>
+
+using sim::users::User;
+using web_server::http::ApiParam;
+using web_server::http::FormFields;
+
+namespace {
+
+// The same parameters as in users/api.cc
+namespace params {
+
+constexpr ApiParam type{&User::type, "type", "Type"};
+constexpr ApiParam username{&User::username, "username", "Username"};
+constexpr ApiParam first_name{&User::first_name, "first_name", "First name"};
+constexpr ApiParam last_name{&User::last_name, "last_name", "Last name"};
+constexpr ApiParam email{&User::email, "email", "Email"};
+constexpr ApiParam<CStringView> password{"password", "Password"};
+constexpr ApiParam<CStringView> password_repeated{"password_repeated", "Password (repeat)"};
+
+} // namespace params
+
+// Validates the form as adding a user does
+bool validate_add_user(const FormFields& form_fields) {
+    VALIDATE(form_fields, [](auto&& /*errors*/) { return false; },
+        (type, params::type, REQUIRED_ENUM_CAPS(
+            (ADMIN, true)
+            (TEACHER, true)
+            (NORMAL, true)
+        ))
+        (username, params::username, REQUIRED)
+        (first_name, params::first_name, REQUIRED)
+        (last_name, params::last_name, REQUIRED)
+        (email, params::email, REQUIRED)
+        (password, allow_blank(params::password), REQUIRED)
+        (password_repeated, allow_blank(params::password_repeated), REQUIRED)
+    );
+    benchmarks::do_not_optimize(type);
+    return password == password_repeated;
+}
+
+void run_benchmark(benchmarks::State& state, const FormFields& form_fields, bool expected_res) {
+    uint64_t mismatches = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        mismatches += (validate_add_user(form_fields) != expected_res);
+    }
+    if (mismatches > 0) {
+        state.set_counter("unexpected_results", static_cast<double>(mismatches));
+    }
+}
+
+} // namespace
+
+BENCHMARK(form_validation, add_user_valid) {
+    FormFields ff;
+    ff.add_field("type", "normal");
+    ff.add_field("username", "jan_kowalski");
+    ff.add_field("first_name", "Jan");
+    ff.add_field("last_name", "Kowalski");
+    ff.add_field("email", "jan.kowalski@example.com");
+    ff.add_field("password", "correct horse battery staple");
+    ff.add_field("password_repeated", "correct horse battery staple");
+    run_benchmark(state, ff, true);
+}
+
+// Most of the fields are invalid or missing, so many errors are reported
+BENCHMARK(form_validation, add_user_invalid) {
+    FormFields ff;
+    ff.add_field("type", "superuser");
+    ff.add_field("username", "jan kowalski");
+    ff.add_field("first_name", std::string(1000, 'J'));
+    ff.add_field("last_name", "");
+    ff.add_field("password", "correct horse battery staple");
+    run_benchmark(state, ff, false);
+}
@@ -0,0 +1,194 @@
+#include "../benchmark.hh"
+
+#include <cstdint>
+#include <simlib/concat_tostr.hh>
+#include <simlib/json_str/json_str.hh>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Number of rows in a response to a query about the next part of a list (see
+// NEXT_QUERY_LIMIT in users/api.cc)
+constexpr size_t ROWS = 200;
+
+struct UserRow {
+    uint64_t id;
+    int type;
+    string username;
+    string first_name;
+    string last_name;
+    string email;
+};
+
+struct ProblemRow {
+    uint64_t id;
+    int type;
+    string name;
+    string label;
+    uint64_t owner_id;
+    string owner_username;
+    string owner_first_name;
+    string owner_last_name;
+    string created_at;
+    string updated_at;
+    int final_submission_full_status;
+    vector<string> public_tags;
+    vector<string> hidden_tags;
+};
+
+vector<UserRow> generate_users() {
+    vector<UserRow> res;
+    for (uint64_t i = 1; i <= ROWS; ++i) {
+        res.push_back(
+            {i,
+             static_cast<int>(i % 3),
+             concat_tostr("user_", i),
+             concat_tostr("Name ", i),
+             "Surname with \"quotes\"",
+             concat_tostr("user_", i, "@example.com")}
+        );
+    }
+    return res;
+}
+
+vector<ProblemRow> generate_problems() {
+    vector<ProblemRow> res;
+    for (uint64_t i = 1; i <= ROWS; ++i) {
+        res.push_back(
+            {i,
+             static_cast<int>(i % 3),
+             concat_tostr("Problem ", i, " with a longer name"),
+             concat_tostr('p', i),
+             i % 7 + 1,
+             "teacher",
+             "Jan",
+             "Kowalski",
+             "2023-01-15 12:34:56",
+             "2023-02-20 08:00:00",
+             static_cast<int>(i % 5),
+             {"dp", "graphs"},
+             {"easy"}}
+        );
+    }
+    return res;
+}
+
+// Builds the same object as UserInfo::append_to() in users/api.cc
+void append_user(json_str::ObjectBuilder& obj, const UserRow& u) {
+    obj.prop("id", u.id);
+    obj.prop("type", u.type);
+    obj.prop("username", u.username);
+    obj.prop("first_name", u.first_name);
+    obj.prop("last_name", u.last_name);
+    obj.prop("email", u.email);
+    obj.prop_obj("capabilities", [&](auto& obj) {
+        for (const char* cap :
+             {"view",
+              "edit",
+              "edit_username",
+              "edit_first_name",
+              "edit_last_name",
+              "edit_email",
+              "change_password",
+              "change_password_without_old_password",
+              "change_type",
+              "make_admin",
+              "make_teacher",
+              "make_normal",
+              "delete",
+              "merge_into_another_user",
+              "merge_someone_into_this_user"})
+        {
+            obj.prop(cap, u.id % 2 == 0);
+        }
+    });
+}
+
+// Builds the same object as ProblemInfo::append_to() in problems/api.cc
+void append_problem(json_str::ObjectBuilder& obj, const ProblemRow& p) {
+    obj.prop("id", p.id);
+    obj.prop("type", p.type);
+    obj.prop("name", p.name);
+    obj.prop("label", p.label);
+    obj.prop_obj("owner", [&](auto& obj) {
+        obj.prop("id", p.owner_id);
+        obj.prop("username", p.owner_username);
+        obj.prop("first_name", p.owner_first_name);
+        obj.prop("last_name", p.owner_last_name);
+    });
+    obj.prop("created_at", p.created_at);
+    obj.prop("updated_at", p.updated_at);
+    obj.prop("final_submission_full_status", p.final_submission_full_status);
+    obj.prop_obj("tags", [&](auto& obj) {
+        obj.prop_arr("public", [&](auto& arr) {
+            for (auto& tag_name : p.public_tags) {
+                arr.val(tag_name);
+            }
+        });
+        obj.prop_arr("hidden", [&](auto& arr) {
+            for (auto& tag_name : p.hidden_tags) {
+                arr.val(tag_name);
+            }
+        });
+    });
+    obj.prop_obj("capabilities", [&](auto& obj) {
+        for (const char* cap :
+             {"view",
+              "view_statement",
+              "view_public_tags",
+              "view_hidden_tags",
+              "view_solutions",
+              "view_simfile",
+              "view_owner",
+              "view_creation_time",
+              "view_update_time",
+              "view_final_submission_full_status",
+              "download",
+              "create_submission",
+              "edit",
+              "reupload",
+              "rejudge_all_submissions",
+              "reset_time_limits",
+              "delete",
+              "merge_into_another_problem",
+              "merge_other_problem_into_this_problem"})
+        {
+            obj.prop(cap, p.id % 2 == 0);
+        }
+    });
+}
+
+template <class Row, class AppendFunc>
+void run_benchmark(benchmarks::State& state, const vector<Row>& rows, AppendFunc&& append_row) {
+    size_t output_size = 0;
+    for (uint64_t i = 0; i < state.iterations(); ++i) {
+        json_str::Object obj;
+        obj.prop("may_be_more", true);
+        obj.prop_arr("list", [&](auto& arr) {
+            for (auto const& row : rows) {
+                arr.val_obj([&](auto& obj) { append_row(obj, row); });
+            }
+        });
+        auto str = std::move(obj).into_str();
+        benchmarks::do_not_optimize(str.data());
+        output_size = str.size();
+    }
+    state.set_bytes_processed(state.iterations() * output_size);
+    state.set_counter("output_bytes", static_cast<double>(output_size));
+}
+
+} // namespace
+
+BENCHMARK(json_str, users_list_200) {
+    static const auto users = generate_users();
+    run_benchmark(state, users, append_user);
+}
+
+BENCHMARK(json_str, problems_list_200) {
+    static const auto problems = generate_problems();
+    run_benchmark(state, problems, append_problem);
+}
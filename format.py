@@ -18,6 +18,7 @@ def sim_sources(srcdir):
         for path in filter_subdirs(
             srcdir,
             [
+                'benchmarks/',
                 'include/',
                 'src/',
                 'test/',
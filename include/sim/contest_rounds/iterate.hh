@@ -10,7 +10,7 @@ enum class IterateIdKind { CONTEST, CONTEST_ROUND, CONTEST_PROBLEM };
 
 template <class T, class Func>
 void iterate(
-    ::mysql::Connection& mysql,
+    mysql::Connection& mysql,
     IterateIdKind id_kind,
     T&& id,
     contests::Permissions contest_perms,
@@ -2,9 +2,9 @@
 
 #include <optional>
 #include <sim/contest_users/contest_user.hh>
+#include <sim/mysql/mysql.hh>
 #include <sim/users/user.hh>
 #include <simlib/macros/enum_operator_macros.hh>
-#include <simlib/mysql/mysql.hh>
 
 namespace sim::contests {
 
@@ -32,7 +32,7 @@ Permissions get_permissions(
 
 template <class T, class U = uint64_t>
 std::optional<Permissions>
-get_permissions(::mysql::Connection& mysql, T&& contest_id, std::optional<U> user_id) {
+get_permissions(mysql::Connection& mysql, T&& contest_id, std::optional<U> user_id) {
     STACK_UNWINDING_MARK;
 
     uint8_t is_public = false;
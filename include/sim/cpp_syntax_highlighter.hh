@@ -1,14 +1,18 @@
 #pragma once
 
-#include <simlib/aho_corasick.hh>
+#include <cstdint>
+#include <simlib/string_view.hh>
+#include <string>
 
 namespace sim {
 
 class CppSyntaxHighlighter {
-    AhoCorasick aho;
-
 public:
-    CppSyntaxHighlighter();
+    // Has to be incremented on every change of the output, as the outputs are
+    // cached by the version
+    static constexpr uint32_t VERSION = 3;
+
+    CppSyntaxHighlighter() = default;
 
     CppSyntaxHighlighter(const CppSyntaxHighlighter&) = default;
     CppSyntaxHighlighter(CppSyntaxHighlighter&&) = default;
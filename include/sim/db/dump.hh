@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <sim/mysql/mysql.hh>
+#include <simlib/file_path.hh>
+#include <simlib/string_view.hh>
+#include <string>
+
+namespace sim::db {
+
+/**
+ * Dump of the database contents made by the backup. It is a directory of
+ * gzip-compressed files of SQL statements, one statement per line:
+ *   - schema.sql.gz (re)creates the tables,
+ *   - <table>/<first id>.sql.gz inserts the rows of the table with ids in
+ *     [first id, first id + DUMP_CHUNK_IDS). Tables with a primary key other
+ *     than an integer `id` are dumped whole to <table>/0.sql.gz.
+ * File checksums holds the row count and the checksum of every chunk, so the
+ * next dump rewrites only the chunks whose rows changed. The checksums are
+ * computed by the database server. File update_times holds the times of the
+ * last change of the tables as reported by the server; chunks of a table
+ * whose update time and definition did not change are not checksummed again.
+ * The server does not persist these times (e.g. they are unknown after its
+ * restart), so then all rows of the table are read.
+ */
+constexpr CStringView dump_dir = "dump/";
+
+constexpr uint64_t DUMP_CHUNK_IDS = 10'000;
+
+// Appends @p str as an SQL string literal
+void append_sql_string_literal(std::string& sql, StringView str);
+
+// Appends @p bytes as an SQL hexadecimal literal
+void append_sql_hex_literal(std::string& sql, StringView bytes);
+
+struct DumpOptions {
+    size_t threads = 4;
+    // Rewrite also the chunks that did not change since the previous dump
+    bool rewrite_unchanged = false;
+};
+
+struct DumpStats {
+    uint64_t chunks = 0;
+    uint64_t unchanged_tables = 0; // Tables whose chunks were not checksummed
+    uint64_t written_chunks = 0;
+    uint64_t written_rows = 0;
+    uint64_t removed_chunks = 0;
+};
+
+// Dumps the database of @p db_config_path (see make_conn_with_credential_file())
+// into @p dir. Chunks are dumped in parallel by options.threads connections
+// that see the same consistent snapshot of the database.
+DumpStats dump(FilePath db_config_path, StringView dir, const DumpOptions& options);
+
+// Loads the dump from @p dir, replacing the dumped tables
+void load_dump(mysql::Connection& mysql, StringView dir);
+
+} // namespace sim::db
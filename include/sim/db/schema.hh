@@ -1,7 +1,7 @@
 #pragma once
 
+#include <sim/mysql/mysql.hh>
 #include <simlib/concat_tostr.hh>
-#include <simlib/mysql/mysql.hh>
 #include <string>
 #include <vector>
 
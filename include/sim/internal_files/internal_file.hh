@@ -1,10 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <optional>
 #include <sim/primary_key.hh>
 #include <sim/sql_fields/datetime.hh>
 #include <simlib/concat.hh>
+#include <simlib/file_path.hh>
 #include <simlib/string_view.hh>
+#include <string>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
 
 namespace sim::internal_files {
 
@@ -17,8 +24,97 @@ struct InternalFile {
 
 constexpr CStringView dir = "internal_files/";
 
-inline auto path_of(decltype(InternalFile::id) id) { return concat<64>(dir, id); }
+// Internal files are spread over two levels of 256 subdirectories, so that no
+// directory gets too large. Subdirectories are named after the two lowest bytes
+// of the id, e.g. the file with id 0x123456 is stored as 56/34/1193046.
+inline auto relative_path_of(decltype(InternalFile::id) id) {
+    constexpr char digits[] = "0123456789abcdef";
+    const char shard[] = {
+        digits[(id >> 4) & 15],
+        digits[id & 15],
+        '/',
+        digits[(id >> 12) & 15],
+        digits[(id >> 8) & 15],
+        '/',
+    };
+    return concat<32>(StringView{shard, sizeof(shard)}, id);
+}
+
+inline auto path_of(decltype(InternalFile::id) id) { return concat<64>(dir, relative_path_of(id)); }
 
 inline auto path_of(const InternalFile& internal_file) { return path_of(internal_file.id); }
 
+// Returns the path of the internal file @p id from before the internal files
+// were sharded, i.e. directly in dir. sim-upgrader moves such files to their
+// path_of().
+inline auto unsharded_path_of(decltype(InternalFile::id) id) { return concat<64>(dir, id); }
+
+// Creates the missing parent directories of @p path (they are not created in
+// advance, to not waste space on empty directories)
+void create_parent_dirs_of(StringView path);
+
+// Returns path_of(@p id) creating its parent directories if needed. It has to
+// be used instead of path_of() to create a new internal file.
+decltype(path_of(0)) path_of_new_file(decltype(InternalFile::id) id);
+
+/**
+ * Internal files with identical contents share storage. Every stored content
+ * (blob) has a name derived from the hash of the contents in blobs_dir and all
+ * internal files with this content are hard links to it. So the number of
+ * references to a blob is its link count minus one and a blob with link count
+ * one is unreferenced. Internal files must not be modified in place - a new
+ * version has to be written to another file and renamed over the old one.
+ */
+constexpr CStringView blobs_dir = "internal_files/blobs/";
+
+// Returns path in blobs_dir of the blob named @p hash (blobs are sharded like
+// the internal files, by the first two bytes of the hash)
+std::string blob_path_of_hash(StringView hash);
+
+// Returns path in blobs_dir of the blob with the contents of the file @p path
+std::string blob_path_of_contents(FilePath path);
+
+// Makes the internal file @p id a link to the blob with the same contents,
+// creating the blob if it does not exist. Returns whether the blob existed i.e.
+// whether the space taken by the file was reclaimed. The file has to be
+// complete.
+bool deduplicate(decltype(InternalFile::id) id);
+
+// Removes the internal file @p id and its blob if the file was the last
+// reference to the blob. Does nothing if the file does not exist.
+void remove(decltype(InternalFile::id) id);
+
+// Files found in dir by scan_dir()
+struct DirScan {
+    // Ids of the files stored under their path_of(), sorted
+    std::vector<decltype(InternalFile::id)> file_ids;
+    // Files derived from internal files (e.g. extracted statements) named
+    // <path_of(id)>.<suffix>, sorted by id
+    std::vector<std::pair<decltype(InternalFile::id), std::string>> derived_files;
+    // Files stored under their unsharded_path_of(), i.e. not migrated by
+    // sim-upgrader yet. They are never treated as orphaned.
+    std::vector<std::string> unsharded_files;
+    // Paths of the files that cannot belong to any internal file
+    std::vector<std::string> other_files;
+};
+
+// Scans dir (without blobs_dir) using getdents64(). Only the ids of the files
+// stored under their path_of() are kept, not their paths, so that scanning
+// millions of files takes little memory.
+DirScan scan_dir();
+
+// Returns the sorted paths of the files of @p scan that belong to no internal
+// file. @p next_file_id has to return the ids of all internal files in
+// increasing order and then std::nullopt, e.g. from an id-ordered cursor.
+std::vector<std::string> orphaned_files(
+    const DirScan& scan,
+    const std::function<std::optional<decltype(InternalFile::id)>()>& next_file_id
+);
+
+// Calls @p callback with the path and the status of every blob in blobs_dir,
+// which is walked using getdents64(). Does nothing if blobs_dir does not exist.
+void for_each_blob(
+    const std::function<void(const std::string& path, const struct stat64& st)>& callback
+);
+
 } // namespace sim::internal_files
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <simlib/file_path.hh>
+#include <simlib/string_view.hh>
+#include <string>
+#include <vector>
+
+namespace sim::jobs {
+
+// File in which the job server publishes its metrics (the web server shows
+// them to the admins)
+constexpr CStringView job_server_metrics_file = ".job-server.metrics";
+
+struct JobServerMetrics {
+    struct Queue {
+        uint64_t jobs = 0; // including the jobs of the locked problems
+        uint64_t locked_problems = 0;
+
+        bool operator==(const Queue& other) const noexcept {
+            return jobs == other.jobs and locked_problems == other.locked_problems;
+        }
+    };
+
+    // Summary of recently measured durations [ms]
+    struct Durations {
+        uint64_t count = 0;
+        int64_t p50 = 0;
+        int64_t p90 = 0;
+        int64_t p99 = 0;
+        int64_t max = 0;
+
+        static Durations of(std::vector<int64_t> durations_ms);
+
+        bool operator==(const Durations& other) const noexcept {
+            return count == other.count and p50 == other.p50 and p90 == other.p90 and
+                p99 == other.p99 and max == other.max;
+        }
+    };
+
+    // Queue name (e.g. "judge_jobs") => its state
+    std::map<std::string, Queue, std::less<>> queues;
+    // Queue name => time from noticing a job to passing it to a worker
+    std::map<std::string, Durations, std::less<>> queue_wait_ms;
+    // Stage of judging (e.g. "solution_compilation") => its duration
+    std::map<std::string, Durations, std::less<>> judge_stage_ms;
+    std::chrono::system_clock::time_point saved_at;
+
+    // Text format: one of the following per line:
+    //   queue <name> <jobs> <locked problems>
+    //   wait <queue name> <count> <p50> <p90> <p99> <max>
+    //   stage <name> <count> <p50> <p90> <p99> <max>
+    [[nodiscard]] std::string dump() const;
+
+    // Malformed lines are ignored
+    static JobServerMetrics parse(StringView str);
+
+    // Replaces the file atomically
+    void save(FilePath path) const;
+
+    // Returns empty metrics if the file does not exist
+    static JobServerMetrics load(FilePath path);
+};
+
+} // namespace sim::jobs
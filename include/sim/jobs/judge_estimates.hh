@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <simlib/file_path.hh>
+#include <simlib/string_view.hh>
+#include <string>
+
+namespace sim::jobs {
+
+// File in which the job server publishes its estimates of the judge jobs (the
+// web server shows them to the admins)
+constexpr CStringView judge_estimates_file = ".job-server.judge-estimates";
+
+struct JudgeEstimates {
+    // Problem id => estimated time of judging a submission [ms]
+    std::map<uint64_t, int64_t> problem_judge_time_ms;
+    // Id of a queued judge job => estimated time until it is done [ms], counted
+    // from saved_at
+    std::map<uint64_t, int64_t> job_eta_ms;
+    std::chrono::system_clock::time_point saved_at;
+
+    // Text format: one "problem <id> <ms>" or "job <id> <ms>" per line
+    [[nodiscard]] std::string dump() const;
+
+    // Malformed lines are ignored
+    static JudgeEstimates parse(StringView str);
+
+    // Replaces the file atomically
+    void save(FilePath path) const;
+
+    // Returns empty estimates if the file does not exist
+    static JudgeEstimates load(FilePath path);
+};
+
+} // namespace sim::jobs
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <netinet/in.h>
+#include <simlib/file_descriptor.hh>
+#include <simlib/sim/judge_worker.hh>
+#include <simlib/string_view.hh>
+#include <stdexcept>
+#include <string>
+
+/**
+ * Protocol between the job server and judge nodes i.e. daemons that judge
+ * submissions on other machines (or on the same one).
+ *
+ * A judge node opens one TCP connection to the job server per judge slot it
+ * offers and starts with HELLO. The job server treats each such connection as a
+ * judge worker: it sends JUDGE and waits until the judge node finishes the job
+ * with one of COMPILATION_FAILED, JUDGE_ERROR or JUDGING_DONE. In the meantime
+ * the judge node may send any number of LOG and JUDGE_REPORT messages and
+ * FETCH_FILE requests (each answered with FILE_CHUNK) to download the problem
+ * package if it does not have it cached.
+ *
+ * Every message is framed as: payload size (uint32), type (uint8), payload.
+ * Payload fields are encoded with sim::jobs::append_dumped().
+ */
+namespace sim::judge_node {
+
+// Has to be bumped on every incompatible change of the protocol
+constexpr uint32_t PROTOCOL_VERSION = 2;
+
+// Maximum size of the data in a FILE_CHUNK message
+constexpr uint64_t FILE_CHUNK_MAX_SIZE = 1 << 20;
+
+// Maximum size of a message payload (larger messages are treated as an error)
+constexpr uint32_t MESSAGE_MAX_SIZE = 64 << 20;
+
+enum class MessageType : uint8_t {
+    // node -> server: protocol version (uint32), token, node name
+    HELLO = 1,
+    // server -> node: job id (uint64), package file id (uint64), solution
+    // language (uint8, sim::SolutionLanguage), solution source
+    JUDGE = 2,
+    // node -> server: file id (uint64), offset (uint64)
+    FETCH_FILE = 3,
+    // server -> node: file size (uint64), data (at most FILE_CHUNK_MAX_SIZE
+    // bytes read at the requested offset)
+    FILE_CHUNK = 4,
+    // node -> server: line to append to the job log
+    LOG = 5,
+    // node -> server: stage (uint8, CompilationStage), compilation errors
+    COMPILATION_FAILED = 6,
+    // node -> server: final (bool), partial (bool), dumped JudgeReport
+    JUDGE_REPORT = 7,
+    // node -> server: error description
+    JUDGE_ERROR = 8,
+    // node -> server: no payload
+    JUDGING_DONE = 9,
+};
+
+enum class CompilationStage : uint8_t {
+    SOLUTION = 0,
+    CHECKER = 1,
+};
+
+struct Message {
+    MessageType type;
+    std::string payload;
+};
+
+// Thrown if the connection broke or the peer closed it
+class ConnectionLost : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+class Connection {
+    FileDescriptor fd_;
+
+public:
+    explicit Connection(FileDescriptor fd) noexcept : fd_(std::move(fd)) {}
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+
+    // Sets (or with 0 disables) the timeout of receive()
+    void set_receive_timeout(std::chrono::milliseconds timeout);
+
+    // Makes the connection break within about a minute after the peer's
+    // machine stops responding, even if nothing is being sent
+    void enable_keepalive();
+
+    // Throws ConnectionLost if the connection broke
+    void send(MessageType type, StringView payload);
+
+    // Blocks until the whole message is received. Throws ConnectionLost if the
+    // connection broke or the peer closed it.
+    Message receive();
+
+    // Checks without blocking whether the peer closed the connection (or it
+    // broke). Unread messages do not count as the closure.
+    bool is_closed();
+};
+
+// Appends @p jr to @p buff: its groups and tests in the form the reports are
+// stored in (see sim::submissions::dump_report()) followed by its judge log
+void append_dumped(std::string& buff, const JudgeReport& jr);
+
+// Inverse of append_dumped(), consumes the dumped report from @p dumped_str
+JudgeReport extract_dumped_judge_report(StringView& dumped_str);
+
+// Parses address in one of formats (ADDR can be any address which inet_aton(3)
+// will accept): ADDR:PORT, *:PORT (all addresses on port PORT)
+sockaddr_in parse_address(StringView address);
+
+// Returns a listening TCP socket bound to @p address (see parse_address())
+FileDescriptor listen_on(StringView address, int backlog);
+
+// Returns a TCP socket connected to @p address (see parse_address())
+FileDescriptor connect_to(StringView address);
+
+} // namespace sim::judge_node
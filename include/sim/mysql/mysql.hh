@@ -1,7 +1,11 @@
 #pragma once
 
+#include <sim/mysql/tracing.hh>
 #include <simlib/file_path.hh>
 #include <simlib/mysql/mysql.hh>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 namespace sim::mysql {
 
@@ -9,9 +13,142 @@ template <class T>
 using Optional = ::mysql::Optional<T>;
 
 using Result = ::mysql::Result;
-using Statement = ::mysql::Statement;
 using Transaction = ::mysql::Transaction;
-using Connection = ::mysql::Connection;
+
+namespace detail {
+
+template <class T, class = void>
+struct HasDataAndSizeMember : std::false_type {};
+
+template <class T>
+struct HasDataAndSizeMember<
+    T,
+    std::enable_if_t<std::is_integral_v<decltype(std::declval<const T&>().size)>,
+                     std::void_t<decltype(std::declval<const T&>().data())>>>
+: std::true_type {};
+
+template <class T>
+void append_sql_text(std::string& sql, const T& arg) {
+    if constexpr (std::is_same_v<T, char>) {
+        sql += arg;
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        sql += '?';
+    } else if constexpr (std::is_convertible_v<const T&, StringView>) {
+        StringView str = arg;
+        sql.append(str.data(), str.size());
+    } else if constexpr (HasDataAndSizeMember<T>::value) { // e.g. InplaceBuff
+        sql.append(arg.data(), arg.size);
+    } else {
+        sql += "..."; // e.g. an SQL builder
+    }
+}
+
+// Returns the SQL of the query built of @p args, as far as it is known
+template <class... Args>
+std::string sql_text(const Args&... args) {
+    std::string sql;
+    (append_sql_text(sql, args), ...);
+    return sql;
+}
+
+} // namespace detail
+
+/**
+ * ::mysql::Statement whose executions are traced (see tracing.hh)
+ */
+class Statement : public ::mysql::Statement {
+    std::string sql_; // set only if tracing is enabled
+
+public:
+    Statement() = default;
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    Statement(::mysql::Statement&& stmt, std::string sql = {}) noexcept
+    : ::mysql::Statement{std::move(stmt)}
+    , sql_{std::move(sql)} {}
+
+    template <class... Args>
+    decltype(auto) bind_and_execute(Args&&... args) {
+        return tracing::traced(
+            tracing::Kind::QUERY,
+            [&]() -> const std::string& { return sql_; },
+            [&]() -> decltype(auto) {
+                return ::mysql::Statement::bind_and_execute(std::forward<Args>(args)...);
+            }
+        );
+    }
+
+    template <class... Args>
+    decltype(auto) execute(Args&&... args) {
+        return tracing::traced(
+            tracing::Kind::QUERY,
+            [&]() -> const std::string& { return sql_; },
+            [&]() -> decltype(auto) {
+                return ::mysql::Statement::execute(std::forward<Args>(args)...);
+            }
+        );
+    }
+};
+
+/**
+ * ::mysql::Connection whose queries are traced (see tracing.hh). Connections
+ * and statements that are used through the ::mysql types are not traced.
+ */
+class Connection : public ::mysql::Connection {
+public:
+    Connection() = default;
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    Connection(::mysql::Connection&& conn) noexcept : ::mysql::Connection{std::move(conn)} {}
+
+    template <class... Args>
+    Statement prepare(Args&&... args) {
+        if (not tracing::is_enabled()) {
+            return ::mysql::Connection::prepare(std::forward<Args>(args)...);
+        }
+        auto sql = detail::sql_text(args...);
+        auto stmt = tracing::traced(
+            tracing::Kind::PREPARE,
+            [&]() -> const std::string& { return sql; },
+            [&] { return ::mysql::Connection::prepare(std::forward<Args>(args)...); }
+        );
+        return {std::move(stmt), std::move(sql)};
+    }
+
+    template <class... Args>
+    Statement prepare_bind_and_execute(Args&&... args) {
+        return tracing::traced(
+            tracing::Kind::QUERY,
+            [&] { return detail::sql_text(args...); },
+            [&] {
+                using Base = ::mysql::Connection;
+                return Base::prepare_bind_and_execute(std::forward<Args>(args)...);
+            }
+        );
+    }
+
+    template <class... Args>
+    decltype(auto) query(Args&&... args) {
+        return tracing::traced(
+            tracing::Kind::QUERY,
+            [&] { return detail::sql_text(args...); },
+            [&]() -> decltype(auto) {
+                return ::mysql::Connection::query(std::forward<Args>(args)...);
+            }
+        );
+    }
+
+    template <class... Args>
+    decltype(auto) update(Args&&... args) {
+        return tracing::traced(
+            tracing::Kind::QUERY,
+            [&] { return detail::sql_text(args...); },
+            [&]() -> decltype(auto) {
+                return ::mysql::Connection::update(std::forward<Args>(args)...);
+            }
+        );
+    }
+};
 
 /**
  * @brief Creates Connection using file @p filename
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <simlib/string_view.hh>
+#include <string>
+#include <vector>
+
+/**
+ * Tracing of the SQL queries run by a thread while it handles a request or
+ * processes a job: the queries are counted and timed, and the normalized SQL of
+ * the slow ones is captured.
+ *
+ * sim::mysql::Connection and sim::mysql::Statement record their queries here.
+ * Tracing is disabled by default, then the only cost of a query is one branch.
+ */
+namespace sim::mysql::tracing {
+
+// Number of the slow queries captured per trace, the rest is only counted
+constexpr size_t MAX_SLOW_QUERIES = 8;
+
+struct SlowQuery {
+    std::string sql; // normalized
+    std::chrono::nanoseconds duration;
+};
+
+struct Trace {
+    uint64_t queries = 0;
+    uint64_t prepares = 0; // preparations of statements, timed like queries
+    std::chrono::nanoseconds duration{0}; // total
+    std::vector<SlowQuery> slow_queries;
+    uint64_t uncaptured_slow_queries = 0;
+};
+
+enum class Kind : uint8_t {
+    QUERY,
+    PREPARE,
+};
+
+namespace detail {
+
+inline std::atomic<bool> enabled{false};
+
+void record(Kind kind, std::chrono::nanoseconds duration) noexcept;
+
+// Returns true if the query is slow and its SQL should be captured
+bool is_slow(std::chrono::nanoseconds duration) noexcept;
+
+void record_slow(Kind kind, std::chrono::nanoseconds duration, StringView sql) noexcept;
+
+} // namespace detail
+
+// Enables tracing in the whole process. Queries that take at least
+// @p slow_query_threshold are captured. Has to be called before any thread
+// starts to trace.
+void enable(std::chrono::nanoseconds slow_query_threshold) noexcept;
+
+inline bool is_enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+
+// Starts a new trace of the calling thread, discarding the previous one
+void begin() noexcept;
+
+// Returns the current trace of the calling thread
+const Trace& current() noexcept;
+
+// Returns the current trace of the calling thread as one line, e.g.
+// "sql: 3 queries, 1 prepare, 12.345 ms, slow: [10.000 ms] SELECT a FROM t WHERE id=?"
+std::string summary();
+
+// Replaces the literals (numbers and strings) with '?' and collapses the
+// whitespace, so that the queries differing only in the data look the same
+std::string normalize_sql(StringView sql);
+
+/**
+ * Records the query run in its scope, @p sql_func (returning the SQL) is called
+ * only if the query is slow.
+ */
+template <class SqlFunc>
+class ScopedQuery {
+    Kind kind_;
+    const SqlFunc& sql_func_;
+    std::chrono::steady_clock::time_point beg_ = std::chrono::steady_clock::now();
+
+public:
+    ScopedQuery(Kind kind, const SqlFunc& sql_func) noexcept : kind_{kind}, sql_func_{sql_func} {}
+
+    ScopedQuery(const ScopedQuery&) = delete;
+    ScopedQuery(ScopedQuery&&) = delete;
+    ScopedQuery& operator=(const ScopedQuery&) = delete;
+    ScopedQuery& operator=(ScopedQuery&&) = delete;
+
+    ~ScopedQuery() {
+        auto duration = std::chrono::steady_clock::now() - beg_;
+        if (not detail::is_slow(duration)) {
+            detail::record(kind_, duration);
+            return;
+        }
+        try {
+            detail::record_slow(kind_, duration, sql_func_());
+        } catch (...) {
+            detail::record(kind_, duration); // The SQL is not worth failing the query
+        }
+    }
+};
+
+// Calls @p func that runs a query and returns its result. If tracing is
+// enabled, the query is recorded.
+template <class SqlFunc, class Func>
+decltype(auto) traced(Kind kind, const SqlFunc& sql_func, Func&& func) {
+    if (not is_enabled()) {
+        return func();
+    }
+    ScopedQuery<SqlFunc> query{kind, sql_func};
+    return func();
+}
+
+} // namespace sim::mysql::tracing
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <simlib/file_path.hh>
+#include <string>
+
+namespace sim::problems {
+
+// Changes of the problem package entries: entry path => new contents of the
+// entry (it is added if it does not exist) or std::nullopt to remove the entry
+using PackageChanges = std::map<std::string, std::optional<std::string>>;
+
+// Fraction of the package (without its central directory) above which the
+// unreferenced data is removed by rewriting the package
+constexpr double MAX_UNREFERENCED_DATA_FRACTION = 0.25;
+
+enum class PackageCopyMode {
+    // Reuse the unchanged entries in place (see below)
+    REUSE_ENTRIES,
+    // Rewrite the whole package with libzip. Use it for untrusted packages (e.g.
+    // uploaded by users), as reusing the entries in place would keep all of
+    // their bytes, including the data that no entry references.
+    REWRITE,
+};
+
+/**
+ * @brief Writes to @p dest_path the zip package @p src_path with @p changes
+ *   applied
+ * @details In the REUSE_ENTRIES mode the unchanged entries are not rewritten:
+ *   the part of the package before its central directory is cloned (or copied
+ *   in the kernel if the filesystem cannot clone), then the new entries and a
+ *   new central directory are appended. So the time depends on the size of
+ *   the changes, not of the package. The replaced and removed entries remain in
+ *   the file as unreferenced data, so once it would take more than
+ *   MAX_UNREFERENCED_DATA_FRACTION of the package, the package is rewritten
+ *   with libzip instead. The same happens if the package layout is unusual
+ *   (e.g. spans multiple disks).
+ */
+void copy_package_with_changes(
+    FilePath src_path,
+    FilePath dest_path,
+    const PackageChanges& changes,
+    PackageCopyMode mode = PackageCopyMode::REUSE_ENTRIES
+);
+
+} // namespace sim::problems
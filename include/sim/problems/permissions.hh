@@ -1,9 +1,9 @@
 #pragma once
 
+#include <sim/mysql/mysql.hh>
 #include <sim/problems/problem.hh>
 #include <sim/users/user.hh>
 #include <simlib/macros/enum_operator_macros.hh>
-#include <simlib/mysql/mysql.hh>
 
 namespace sim::problems {
 
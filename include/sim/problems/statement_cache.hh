@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <sim/internal_files/internal_file.hh>
+#include <simlib/string_view.hh>
+
+namespace sim::problems {
+
+// Path of the statement extracted from the problem package @p problem_file_id,
+// it is kept next to the package. Packages are never modified, so the
+// extracted statement is valid as long as the package exists.
+inline auto extracted_statement_path_of(uint64_t problem_file_id) {
+    return concat<64>(internal_files::path_of(problem_file_id), ".statement");
+}
+
+// Returns extracted_statement_path_of(@p problem_file_id), extracting the
+// statement @p statement (path from Simfile) from the package first if it is
+// not extracted yet. Safe to call concurrently, also from different processes.
+decltype(extracted_statement_path_of(0))
+extract_statement(uint64_t problem_file_id, StringView statement);
+
+// Removes the extracted statement of the problem package @p problem_file_id
+// (if it exists)
+void remove_extracted_statement(uint64_t problem_file_id) noexcept;
+
+} // namespace sim::problems
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <sim/submissions/submission.hh>
+#include <simlib/string_view.hh>
+#include <string>
+
+/**
+ * Planning of the submissions list queries (the submissions API).
+ *
+ * The submissions table has an index for every combination of the list filters,
+ * but with the joins needed to render the list MySQL often fails to pick the
+ * right one. So the list is selected in two steps: first the ids of the page
+ * are selected from the submissions table alone using the index returned by
+ * list_index(), then the rows of the page are joined with the other tables.
+ *
+ * The next pages are selected using a cursor, which is an opaque token bound to
+ * the filter it was issued for.
+ */
+namespace sim::submissions {
+
+struct ListFilter {
+    enum class Scope : uint8_t {
+        NONE,
+        PROBLEM,
+        CONTEST_PROBLEM,
+        CONTEST_ROUND,
+        CONTEST,
+    };
+
+    // Which kind of the final submissions is selected
+    enum class Finals : uint8_t {
+        NONE,
+        PROBLEM,
+        CONTEST,
+        PROBLEM_OR_CONTEST,
+    };
+
+    std::optional<uint64_t> owner;
+    Scope scope = Scope::NONE;
+    uint64_t scope_id = 0; // Meaningful only if scope != Scope::NONE
+    std::optional<Submission::Type> type;
+    Finals finals = Finals::NONE; // Mutually exclusive with type
+};
+
+// Returns the name of the submissions table index that selecting ids of the
+// submissions matching @p filter in descending order should use or
+// std::nullopt if the primary key is the best choice
+std::optional<StringView> list_index(const ListFilter& filter) noexcept;
+
+// Returns the cursor of the list page ending with the submission @p last_id
+std::string encode_list_cursor(const ListFilter& filter, uint64_t last_id);
+
+// Returns the id of the last submission of the page the @p cursor was issued for
+// or std::nullopt if @p cursor is invalid or was issued for a different filter
+std::optional<uint64_t> decode_list_cursor(const ListFilter& filter, StringView cursor) noexcept;
+
+} // namespace sim::submissions
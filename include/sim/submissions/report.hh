@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <simlib/sim/judge_worker.hh>
+#include <simlib/string_view.hh>
+#include <string>
+#include <variant>
+
+/**
+ * Reports stored in submissions.initial_report and submissions.final_report.
+ *
+ * A report is stored in a compact binary form and rendered to HTML (or JSON)
+ * only when it is viewed. The binary form is a header followed by a sequence of
+ * records, each describing one group or one test. A record of a group or a test
+ * that has already occurred overrides the previous one, so partial reports are
+ * stored by appending the records of the changed tests to the stored report.
+ *
+ * Reports stored by older versions of Sim are HTML, they are rendered as is.
+ */
+namespace sim::submissions {
+
+// Returns the stored form of @p jr
+std::string dump_report(const JudgeReport& jr);
+
+// Returns records that appended to dump_report(@p prev) give the stored form
+// of @p curr (equivalent to dump_report(@p curr)), or std::nullopt if @p curr
+// has different groups or tests than @p prev
+std::optional<std::string> dump_report_update(const JudgeReport& prev, const JudgeReport& curr);
+
+// Returns the stored form of a report of a failed compilation
+std::string dump_compilation_errors(StringView compilation_errors);
+
+struct CompilationErrors {
+    std::string errors;
+};
+
+struct LegacyHtmlReport {
+    StringView html;
+};
+
+// Empty @p stored_report yields a JudgeReport without groups
+std::variant<JudgeReport, CompilationErrors, LegacyHtmlReport>
+parse_report(StringView stored_report);
+
+std::string report_to_html(StringView stored_report);
+
+// Returns "null" for an empty report
+std::string report_to_json(StringView stored_report);
+
+} // namespace sim::submissions
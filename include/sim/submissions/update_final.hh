@@ -2,7 +2,7 @@
 
 #include <cstdint>
 #include <optional>
-#include <simlib/mysql/mysql.hh>
+#include <sim/mysql/mysql.hh>
 
 namespace sim::submissions {
 
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+
+# Load test of a local Sim instance: seeds it with synthetic users, a contest
+# with problems and submissions, then replays a mix of the typical contest
+# traffic at a given rate and reports the latency percentiles of every route.
+#
+# To test the web server by itself, set js_stub_judge_ms in sim.conf, so that
+# the job server does not judge the submissions.
+
+from requests import Request, Session
+import argparse
+import random
+import threading
+import time
+
+class SimClient:
+	def __init__(self, host):
+		self.host = host
+		self.ses = Session()
+
+	def csrf_token(self):
+		return self.ses.cookies.get_dict().get('csrf_token', '')
+
+	# New API: the CSRF token is passed in the header
+	def post(self, url, data):
+		req = Request('POST', self.host + url, data=data, headers={'x-csrf-token': self.csrf_token()})
+		return self.ses.send(self.ses.prepare_request(req))
+
+	# Old API: the CSRF token is passed as a form field
+	def old_api_post(self, url, data={}, files=None):
+		req = Request('POST', self.host + url, data={**data, 'csrf_token': self.csrf_token()}, files=files)
+		return self.ses.send(self.ses.prepare_request(req))
+
+	def get(self, url):
+		return self.ses.send(self.ses.prepare_request(Request('GET', self.host + url)))
+
+	def sign_in(self, username, password):
+		self.ses.cookies.clear()
+		return self.post('/api/sign_in', {
+			'username': username,
+			'password': password,
+			'remember_for_a_month': 'false',
+		})
+
+def checked(resp):
+	if resp.status_code != 200:
+		raise RuntimeError('{} {} -> {}: {}'.format(resp.request.method, resp.request.url, resp.status_code, resp.text))
+	return resp
+
+def wait_for_job(admin, job_id):
+	while True:
+		job_info = checked(admin.old_api_post('/api/jobs/={}'.format(job_id))).json()
+		# The first element describes the columns
+		job = dict(zip([c if isinstance(c, str) else c['name'] for c in job_info[0]['columns']], job_info[1]))
+		status = job['status'][1]
+		if status in ('Done', 'Failed', 'Canceled'):
+			break
+		time.sleep(0.1)
+	if status != 'Done':
+		raise RuntimeError('Job {} finished with status: {}'.format(job_id, status))
+	return job
+
+def seed(args):
+	admin = SimClient(args.host)
+	checked(admin.sign_in(args.user, args.password))
+	prefix = args.prefix
+
+	print('Adding {} problems...'.format(args.problems))
+	problem_ids = []
+	for i in range(args.problems):
+		job_id = checked(admin.old_api_post('/api/problem/add', data={
+			'name': '{} problem {}'.format(prefix, i),
+			'label': 'p{}'.format(i),
+			'type': 'PRI',
+			'mem_limit': '',
+			'global_time_limit': '',
+		}, files=[('package', ('package.zip', open(args.package, 'rb'), 'application/zip'))])).text
+		problem_ids.append(wait_for_job(admin, job_id)['info']['problem'])
+
+	print('Adding the contest...')
+	contest_id = checked(admin.old_api_post('/api/contest/create', {'name': prefix, 'public': 'on'})).text
+	round_id = checked(admin.old_api_post('/api/contest/c{}/create_round'.format(contest_id), {
+		'name': 'Round 1',
+		'begins': '-inf',
+		'ends': '+inf',
+		'full_results': '+inf',
+		'ranking_expo': '-inf',
+	})).text
+	contest_problems = []
+	for problem_id in problem_ids:
+		contest_problem_id = checked(admin.old_api_post('/api/contest/r{}/attach_problem'.format(round_id), {
+			'problem_id': problem_id,
+			'name': '',
+			'method_of_choosing_final_submission': 'latest_compiling',
+			'score_revealing': 'none',
+		})).text
+		contest_problems.append((problem_id, contest_problem_id))
+
+	print('Adding {} users...'.format(args.users))
+	users = []
+	for i in range(args.users):
+		username = '{}_{}'.format(prefix, i)
+		user_id = checked(admin.post('/api/users/add', {
+			'type': 'normal',
+			'username': username,
+			'first_name': 'Load',
+			'last_name': 'Test {}'.format(i),
+			'email': '{}@example.com'.format(username),
+			'password': username,
+			'password_repeated': username,
+		})).text
+		users.append((username, user_id))
+
+	return contest_id, contest_problems, users
+
+class Stats:
+	def __init__(self):
+		self.lock = threading.Lock()
+		self.latencies = {} # route -> list of seconds
+		self.errors = {} # route -> number of failed requests
+
+	def record(self, route, latency, ok):
+		with self.lock:
+			self.latencies.setdefault(route, []).append(latency)
+			if not ok:
+				self.errors[route] = self.errors.get(route, 0) + 1
+
+	def print_report(self, duration):
+		def percentile(sorted_vals, p):
+			return sorted_vals[min(len(sorted_vals) - 1, int(len(sorted_vals) * p / 100))]
+
+		print('{:<12} {:>8} {:>8} {:>8} {:>9} {:>9} {:>9} {:>9}'.format(
+			'route', 'requests', 'errors', 'req/s', 'p50 ms', 'p90 ms', 'p99 ms', 'max ms'))
+		for route in sorted(self.latencies):
+			vals = sorted(self.latencies[route])
+			print('{:<12} {:>8} {:>8} {:>8.1f} {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f}'.format(
+				route,
+				len(vals),
+				self.errors.get(route, 0),
+				len(vals) / duration,
+				percentile(vals, 50) * 1000,
+				percentile(vals, 90) * 1000,
+				percentile(vals, 99) * 1000,
+				vals[-1] * 1000,
+			))
+
+# A simulated contestant, every request is done in its own session
+class Contestant:
+	def __init__(self, host, username, user_id):
+		self.host = host
+		self.username = username
+		self.user_id = user_id
+		self.lock = threading.Lock()
+		self.client = SimClient(host)
+		checked(self.client.sign_in(username, username))
+
+	def sign_in(self, env):
+		return SimClient(self.host).sign_in(self.username, self.username)
+
+	def statement(self, env):
+		_, contest_problem_id = random.choice(env['contest_problems'])
+		return self.client.get('/api/download/statement/contest/p{}'.format(contest_problem_id))
+
+	def submit(self, env):
+		problem_id, contest_problem_id = random.choice(env['contest_problems'])
+		return self.client.old_api_post(
+			'/api/submission/add/p{}/cp{}'.format(problem_id, contest_problem_id),
+			{'language': env['language'], 'code': env['solution']},
+			files=[('solution', ('', b'', 'application/octet-stream'))])
+
+	def ranking(self, env):
+		return self.client.old_api_post('/api/contest/c{}/ranking'.format(env['contest_id']))
+
+	def submissions(self, env):
+		return self.client.old_api_post('/api/submissions/C{}/u{}'.format(env['contest_id'], self.user_id))
+
+ROUTES = ('sign_in', 'statement', 'submit', 'ranking', 'submissions')
+
+def parse_mix(mix_str):
+	mix = {}
+	for elem in mix_str.split(','):
+		route, _, weight = elem.partition('=')
+		if route not in ROUTES:
+			raise ValueError('Unknown route in --mix: {}'.format(route))
+		mix[route] = float(weight)
+	return mix
+
+def replay(args, env, contestants, stats):
+	mix = parse_mix(args.mix)
+	routes = list(mix.keys())
+	weights = list(mix.values())
+	total_requests = int(args.rate * args.duration)
+	next_request = [0]
+	counter_lock = threading.Lock()
+	start = time.monotonic()
+
+	# Requests are scheduled at fixed times, so a slow server does not lower
+	# the offered load (as long as there are enough threads)
+	def worker():
+		while True:
+			with counter_lock:
+				k = next_request[0]
+				next_request[0] += 1
+			if k >= total_requests:
+				return
+			delay = start + k / args.rate - time.monotonic()
+			if delay > 0:
+				time.sleep(delay)
+
+			route = random.choices(routes, weights)[0]
+			contestant = random.choice(contestants)
+			# A session cannot be used by two requests at once
+			with contestant.lock:
+				beg = time.monotonic()
+				try:
+					ok = getattr(contestant, route)(env).status_code == 200
+				except Exception:
+					ok = False
+				stats.record(route, time.monotonic() - beg, ok)
+
+	threads = [threading.Thread(target=worker) for _ in range(args.threads)]
+	for t in threads:
+		t.start()
+	for t in threads:
+		t.join()
+	return time.monotonic() - start
+
+def main():
+	parser = argparse.ArgumentParser(description='Load test of a Sim instance.')
+	parser.add_argument('host', help='address of the Sim server, e.g. http://127.0.0.1:8080')
+	parser.add_argument('package_path', help='path to zipped problem package with a complete Simfile (it is added without judging the model solution)')
+	parser.add_argument('-u', '--user', help='admin used to seed the instance (default: sim)', default='sim')
+	parser.add_argument('-p', '--password', help='password of the admin (default: sim)', default='sim')
+	parser.add_argument('--users', help='number of contestants to add (default: 50)', type=int, default=50)
+	parser.add_argument('--problems', help='number of problems to add (default: 3)', type=int, default=3)
+	parser.add_argument('--seed-submissions', help='submissions added by every contestant before the test (default: 2)', type=int, default=2)
+	parser.add_argument('-r', '--rate', help='requests per second (default: 20)', type=float, default=20)
+	parser.add_argument('-d', '--duration', help='duration of the test in seconds (default: 60)', type=float, default=60)
+	parser.add_argument('-t', '--threads', help='maximum number of concurrent requests (default: 32)', type=int, default=32)
+	parser.add_argument('--mix', help='weights of the routes (default: %(default)s)', default='sign_in=1,statement=3,submit=1,ranking=4,submissions=2')
+	parser.add_argument('--solution', help='source file of submissions (default: a trivial C++ program)')
+	parser.add_argument('--language', help='language of submissions (default: cpp17)', default='cpp17')
+	args = parser.parse_args()
+	args.package = args.package_path
+	args.prefix = 'loadtest{}'.format(int(time.time()))
+	parse_mix(args.mix) # validate before seeding
+
+	contest_id, contest_problems, users = seed(args)
+	env = {
+		'contest_id': contest_id,
+		'contest_problems': contest_problems,
+		'language': args.language,
+		'solution': open(args.solution).read() if args.solution else 'int main() { return 0; }\n',
+	}
+
+	print('Signing in {} contestants...'.format(len(users)))
+	contestants = [Contestant(args.host, username, user_id) for username, user_id in users]
+
+	print('Adding {} submissions...'.format(len(contestants) * args.seed_submissions))
+	for contestant in contestants:
+		for _ in range(args.seed_submissions):
+			checked(contestant.submit(env))
+
+	print('Replaying {} requests/s for {} s...'.format(args.rate, args.duration))
+	stats = Stats()
+	duration = replay(args, env, contestants, stats)
+	stats.print_report(duration)
+
+if __name__ == '__main__':
+	main()
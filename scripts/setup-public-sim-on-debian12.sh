@@ -54,7 +54,7 @@ trap '/bin/echo -e "${exit_message}"' EXIT
 apt update
 
 /bin/echo -e '\033[1;32m==>\033[0;1m Install required packages\033[m'
-apt install sudo git g++ fpc mariadb-server libmariadb-dev libseccomp-dev libzip-dev libssl-dev libcap-dev rustc pkgconf expect meson -y
+apt install sudo git g++ fpc mariadb-server libmariadb-dev libseccomp-dev libzip-dev zlib1g-dev libssl-dev libcap-dev rustc pkgconf expect meson -y
 
 /bin/echo -e '\033[1;32m==>\033[0;1m Prepare database and database user\033[m'
 expect -c 'spawn mysql_secure_installation; send "\ry\rn\ry\ry\ry\ry\r"; interact'
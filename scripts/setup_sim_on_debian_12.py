@@ -94,7 +94,7 @@ def setup_sim():
     user_cmd(f"test -e '{args.sim_path}/' || git clone --recursive https://github.com/varqox/sim --branch develop '{args.sim_path}'")
 
     print('\033[1;32m==>\033[0;1m Build sim\033[m')
-    apt_install('meson pkgconf g++ libmariadb-dev libseccomp-dev libcap-dev libzip-dev libssl-dev rustc fpc clang')
+    apt_install('meson pkgconf g++ libmariadb-dev libseccomp-dev libcap-dev libzip-dev zlib1g-dev libssl-dev rustc fpc clang')
     user_cmd(f"cd '{args.sim_path}' && meson setup build/ -Dbuildtype=release")
     user_cmd(f"cd '{args.sim_path}' && meson configure build/ --prefix \"$(pwd)/sim\"")
     user_cmd(f"cd '{args.sim_path}' && meson compile -C build/")
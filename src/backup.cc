@@ -1,13 +1,21 @@
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <optional>
+#include <sim/db/dump.hh>
+#include <sim/internal_files/internal_file.hh>
 #include <sim/jobs/job.hh>
 #include <sim/mysql/mysql.hh>
 #include <simlib/concat_tostr.hh>
+#include <simlib/file_contents.hh>
 #include <simlib/file_info.hh>
 #include <simlib/file_manip.hh>
+#include <simlib/humanize.hh>
 #include <simlib/path.hh>
 #include <simlib/process.hh>
-#include <simlib/sim/problem_package.hh>
 #include <simlib/spawner.hh>
+#include <simlib/string_compare.hh>
+#include <simlib/string_transform.hh>
 #include <simlib/time.hh>
 #include <simlib/working_directory.hh>
 
@@ -23,44 +31,220 @@ static void help(const char* program_name) {
 
     printf("Usage: %s [options]\n", program_name);
     puts("Make a backup of solutions and database contents");
+    puts("");
+    puts("Options:");
+    puts("  --dry-run       Only report the orphaned and temporary internal files that would be");
+    puts("                  deleted, without deleting anything or making the backup");
+    puts("  --full          Rewrite the whole database dump and rescan all internal files");
+    puts("                  instead of only what changed since the last backup");
+    puts("  --threads <n>   Number of threads dumping the database (default: 4)");
 }
 
-int main2(int argc, char** argv) {
-    if (argc != 1) {
-        help(argc > 0 ? argv[0] : nullptr);
-        return 1;
+static void run_command(const vector<string>& args) {
+    auto es = Spawner::run(args[0], args);
+    if (es.si.code != CLD_EXITED or es.si.status != 0) {
+        errlog(args[0], " failed: ", es.message);
+        exit(1);
     }
+}
 
-    chdir_relative_to_executable_dirpath("..");
+// Deduplicates internal files stored without deduplication (e.g. before it was
+// introduced), removes unreferenced blobs and reports the space saved
+static void deduplicate_internal_files(const vector<uint64_t>& file_ids) {
+    using std::chrono::system_clock;
+    using namespace std::chrono_literals;
 
-#define MYSQL_CNF ".mysql.cnf"
-    FileRemover mysql_cnf_guard;
+    uint64_t newly_saved_bytes = 0;
+    for (auto file_id : file_ids) {
+        struct stat64 st = {};
+        if (stat64(sim::internal_files::path_of(file_id).to_cstr().data(), &st)) {
+            if (errno == ENOENT) {
+                continue;
+            }
+            THROW("stat64()", errmsg());
+        }
+        if (st.st_nlink == 1 and sim::internal_files::deduplicate(file_id)) {
+            newly_saved_bytes += st.st_size;
+        }
+    }
 
-    // Get connection
-    auto conn = sim::mysql::make_conn_with_credential_file(".db.config");
+    uint64_t blobs = 0;
+    uint64_t references = 0;
+    uint64_t saved_bytes = 0;
+    sim::internal_files::for_each_blob([&](const string& blob_path, const struct stat64& st) {
+        if (st.st_nlink == 1) {
+            // The change time is updated on unlinking the last reference
+            if (system_clock::now() - system_clock::from_time_t(st.st_ctim.tv_sec) > 2h) {
+                stdlog("Deleting unreferenced blob: ", blob_path);
+                (void)unlink(blob_path.c_str());
+            }
+            return;
+        }
 
-    FileDescriptor fd{MYSQL_CNF, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_0600};
-    if (fd == -1) {
-        errlog("Failed to open file `" MYSQL_CNF "`: open()", errmsg());
-        return 1;
-    }
+        ++blobs;
+        references += st.st_nlink - 1;
+        saved_bytes += static_cast<uint64_t>(st.st_size) * (st.st_nlink - 2);
+    });
 
-    mysql_cnf_guard.reset(MYSQL_CNF);
-    write_all_throw(
-        fd,
-        from_unsafe{concat(
-            "[client]\nuser=\"", conn.impl()->user, "\"\npassword=\"", conn.impl()->passwd, "\"\n"
-        )}
+    stdlog(
+        "Internal files deduplication: ",
+        references,
+        " files share ",
+        blobs,
+        " blobs, space saved: ",
+        humanize_file_size(saved_bytes),
+        " (",
+        humanize_file_size(newly_saved_bytes),
+        " in this run)"
     );
+}
 
-    auto run_command = [](vector<string> args) {
-        auto es = Spawner::run(args[0], args);
+// Stages the internal files added and removed since the last backup, without
+// scanning the internal files directory. Internal files are never modified in
+// place, so the other staged files are up to date.
+static void stage_added_and_removed_internal_files(vector<uint64_t> file_ids) {
+    STACK_UNWINDING_MARK;
+
+    constexpr CStringView tracked_files_list = ".git/backup_tracked_internal_files";
+    constexpr CStringView added_files_list = ".git/backup_added_internal_files";
+    constexpr CStringView removed_files_list = ".git/backup_removed_internal_files";
+    FileRemover tracked_files_list_remover;
+    FileRemover added_files_list_remover;
+    FileRemover removed_files_list_remover;
+    {
+        FileDescriptor fd{tracked_files_list, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_0600};
+        if (fd == -1) {
+            THROW("open(", tracked_files_list, ')', errmsg());
+        }
+        tracked_files_list_remover.reset(tracked_files_list);
+        auto es = Spawner::run(
+            "git",
+            {"git", "ls-files", "-z", "--", sim::internal_files::dir.to_string()},
+            {STDIN_FILENO, fd, STDERR_FILENO}
+        );
         if (es.si.code != CLD_EXITED or es.si.status != 0) {
-            errlog(args[0], " failed: ", es.message);
-            exit(1);
+            THROW("git ls-files failed: ", es.message);
         }
-    };
+    }
 
+    std::sort(file_ids.begin(), file_ids.end());
+    vector<uint64_t> tracked_file_ids;
+    string removed_files;
+    {
+        auto tracked_files = get_file_contents(tracked_files_list);
+        StringView str = tracked_files;
+        while (not str.empty()) {
+            auto path = str.substring(0, std::min(str.find('\0'), str.size()));
+            str.remove_prefix(std::min(path.size() + 1, str.size()));
+            // Other files (e.g. left by older versions of the backup) are left intact
+            auto file_id = str2num<uint64_t>(path.substring(path.rfind('/') + 1));
+            if (not file_id) {
+                continue;
+            }
+            auto file_path = sim::internal_files::path_of(*file_id);
+            if (path != StringView{file_path}) {
+                // Files from before sharding were migrated by sim-upgrader
+                // (migrate_internal_files_to_sharded_layout() in src/sim_upgrader.cc)
+                if (path == StringView{sim::internal_files::unsharded_path_of(*file_id)}) {
+                    back_insert(removed_files, path, '\0');
+                }
+                continue;
+            }
+            if (std::binary_search(file_ids.begin(), file_ids.end(), *file_id)) {
+                tracked_file_ids.emplace_back(*file_id);
+            } else {
+                back_insert(removed_files, path, '\0');
+            }
+        }
+    }
+    std::sort(tracked_file_ids.begin(), tracked_file_ids.end());
+
+    string added_files;
+    size_t added_files_num = 0;
+    for (auto file_id : file_ids) {
+        if (std::binary_search(tracked_file_ids.begin(), tracked_file_ids.end(), file_id)) {
+            continue;
+        }
+        auto path = sim::internal_files::path_of(file_id);
+        if (access(path, F_OK) == 0) {
+            back_insert(added_files, path, '\0');
+            ++added_files_num;
+        }
+    }
+    auto removed_files_num = std::count(removed_files.begin(), removed_files.end(), '\0');
+    stdlog(
+        "Internal files since the last backup: ",
+        added_files_num,
+        " added, ",
+        removed_files_num,
+        " removed"
+    );
+
+    if (not added_files.empty()) {
+        put_file_contents(added_files_list, added_files);
+        added_files_list_remover.reset(added_files_list);
+        run_command({
+            "git",
+            "add",
+            "--verbose",
+            concat_tostr("--pathspec-from-file=", added_files_list),
+            "--pathspec-file-nul",
+        });
+    }
+    if (not removed_files.empty()) {
+        put_file_contents(removed_files_list, removed_files);
+        removed_files_list_remover.reset(removed_files_list);
+        run_command({
+            "git",
+            "rm",
+            "--cached",
+            "--quiet",
+            "--ignore-unmatch",
+            concat_tostr("--pathspec-from-file=", removed_files_list),
+            "--pathspec-file-nul",
+        });
+    }
+}
+
+int main2(int argc, char** argv) {
+    bool full = false;
+    bool dry_run = false;
+    sim::db::DumpOptions dump_options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dry-run") == 0) {
+            dry_run = true;
+        } else if (strcmp(argv[i], "--full") == 0) {
+            full = true;
+            dump_options.rewrite_unchanged = true;
+        } else if (strcmp(argv[i], "--threads") == 0 and i + 1 < argc and
+                   str2num<size_t>(argv[i + 1]).value_or(0) > 0)
+        {
+            dump_options.threads = *str2num<size_t>(argv[++i]);
+        } else {
+            help(argv[0]);
+            return 1;
+        }
+    }
+
+    chdir_relative_to_executable_dirpath("..");
+
+    // Get connection
+    auto conn = sim::mysql::make_conn_with_credential_file(".db.config");
+
+    // Files that are not migrated yet would be taken for orphaned files. They
+    // are migrated by sim-upgrader (run by manage start), not here, as the
+    // running (older) Sim may still use them.
+    auto scan = sim::internal_files::scan_dir();
+    if (not scan.unsharded_files.empty()) {
+        errlog(
+            "Internal files are stored in the unsharded layout (e.g. ",
+            scan.unsharded_files.front(),
+            "), run sim-upgrader (e.g. via manage start) before making a backup"
+        );
+        return 1;
+    }
+
+    std::vector<uint64_t> file_ids;
     // Remove temporary internal files that were not removed (e.g. a problem
     // adding job was canceled between the first and second stage while it was
     // pending)
@@ -84,61 +268,95 @@ int main2(int argc, char** argv) {
             if (access(file_path, F_OK) == 0 and
                 system_clock::now() - get_modification_time(file_path) > 2h)
             {
+                if (dry_run) {
+                    stdlog("Would delete the temporary file of a job: ", file_path);
+                    continue;
+                }
                 deleter.bind_and_execute(tmp_file_id);
-                (void)unlink(file_path);
+                sim::internal_files::remove(tmp_file_id);
             }
         }
 
-        // Remove internal files that do not have an entry in internal_files
-        sim::PackageContents fc;
-        fc.load_from_directory(sim::internal_files::dir);
-        std::set<std::string, std::less<>> orphaned_files;
-        fc.for_each_with_prefix("", [&](StringView file) {
-            orphaned_files.emplace(file.to_string());
-        });
-
-        stmt = conn.prepare("SELECT id FROM internal_files");
+        // Remove internal files that do not have an entry in internal_files:
+        // the ids found in the directory are merged with the ids from the
+        // database, both sorted
+        stmt = conn.prepare("SELECT id FROM internal_files ORDER BY id");
         stmt.bind_and_execute();
-        InplaceBuff<32> file_id;
+        uint64_t file_id = 0;
         stmt.res_bind_all(file_id);
-        while (stmt.next()) {
-            orphaned_files.erase(orphaned_files.find(file_id));
-        }
+        auto orphaned_files =
+            sim::internal_files::orphaned_files(scan, [&]() -> std::optional<uint64_t> {
+                if (not stmt.next()) {
+                    return std::nullopt;
+                }
+                file_ids.emplace_back(file_id);
+                return file_id;
+            });
+        scan = {}; // Free memory
 
         // Remove orphaned files that are older than 2h (not to delete files
         // that are just created but not committed)
+        uint64_t orphaned_files_size = 0;
+        size_t deleted_files = 0;
         for (const std::string& file : orphaned_files) {
             struct stat64 st = {};
-            auto file_path = concat(sim::internal_files::dir, file);
-            if (stat64(file_path.to_cstr().data(), &st)) {
+            if (stat64(file.c_str(), &st)) {
                 if (errno == ENOENT) {
-                    break;
+                    continue;
                 }
 
                 THROW("stat64", errmsg());
             }
+            orphaned_files_size += st.st_size;
 
-            if (system_clock::now() - get_modification_time(st) > 2h) {
-                stdlog("Deleting: ", file);
-                (void)unlink(file_path);
+            // Change time, as the modification time of a deduplicated file is
+            // the modification time of the first file with its contents
+            if (system_clock::now() - system_clock::from_time_t(st.st_ctim.tv_sec) > 2h) {
+                ++deleted_files;
+                if (dry_run) {
+                    stdlog("Would delete: ", file, " (", humanize_file_size(st.st_size), ')');
+                } else {
+                    stdlog("Deleting: ", file);
+                    (void)unlink(file.c_str());
+                }
+            } else if (dry_run) {
+                stdlog("Would keep (younger than 2h): ", file);
             }
         }
+        stdlog(
+            "Orphaned internal files: ",
+            orphaned_files.size(),
+            " (",
+            humanize_file_size(orphaned_files_size),
+            "), ",
+            (dry_run ? "would delete " : "deleted "),
+            deleted_files
+        );
 
         transaction.commit();
     }
 
-    run_command({
-        "mysqldump",
-        concat_tostr("--defaults-file=", MYSQL_CNF),
-        "--result-file=dump.sql",
-        "--single-transaction",
-        conn.impl()->db,
-    });
-
-    if (chmod("dump.sql", S_0600)) {
-        THROW("chmod()", errmsg());
+    if (dry_run) {
+        return 0;
     }
 
+    deduplicate_internal_files(file_ids);
+
+    auto dump_stats = sim::db::dump(".db.config", sim::db::dump_dir, dump_options);
+    stdlog(
+        "Database dump: ",
+        dump_stats.written_chunks,
+        " of ",
+        dump_stats.chunks,
+        " chunks written (",
+        dump_stats.written_rows,
+        " rows), ",
+        dump_stats.removed_chunks,
+        " chunks removed, ",
+        dump_stats.unchanged_tables,
+        " unchanged tables skipped"
+    );
+
     run_command({"git", "init", "--initial-branch", "main"});
     run_command({"git", "config", "user.name", "bin/backup"});
     run_command({"git", "config", "user.email", ""});
@@ -161,9 +379,29 @@ int main2(int argc, char** argv) {
     // Run automatic git gc more fequently
     run_command({"git", "config", "gc.auto", "500"});
 
-    run_command({"git", "add", "--verbose", "dump.sql"});
+    // The dump replaced dump.sql made by mysqldump
+    if (access("dump.sql", F_OK) == 0) {
+        run_command({"git", "rm", "--cached", "--quiet", "--ignore-unmatch", "dump.sql"});
+        (void)unlink("dump.sql");
+    }
+    run_command({"git", "add", "--all", "--verbose", sim::db::dump_dir.to_string()});
     run_command({"git", "add", "--verbose", "bin/", "manage"});
-    run_command({"git", "add", "--verbose", "internal_files/"});
+    if (full) {
+        // Blobs have the same contents as the internal files linking to them, they are recreated
+        // on restoring the backup by the next backup run. Extracted statements are recreated on
+        // demand.
+        run_command({
+            "git",
+            "add",
+            "--all",
+            "--verbose",
+            "internal_files/",
+            ":(exclude)internal_files/blobs/",
+            ":(exclude,glob)internal_files/**/*.statement",
+        });
+    } else {
+        stage_added_and_removed_internal_files(file_ids);
+    }
     run_command({"git", "add", "--verbose", "logs/"});
     run_command({"git", "add", "--verbose", "sim.conf", ".db.config"});
     run_command({"git", "add", "--verbose", "static/"});
@@ -0,0 +1,279 @@
+#include "generator.hh"
+#include "hot_queries.hh"
+#include "query_plan.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <sim/db/schema.hh>
+#include <sim/mysql/mysql.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/file_contents.hh>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+struct CmdOptions {
+    bool drop_tables = false;
+    db_bench::GeneratorOptions generator;
+    size_t repetitions = 10;
+    std::optional<string> baseline_path;
+    std::optional<string> save_path;
+};
+
+// A query is slower if its median time grew by both of these
+constexpr double SLOWDOWN_FACTOR = 2;
+constexpr int64_t SLOWDOWN_MIN_US = 1000;
+
+} // namespace
+
+static void print_help(const char* program_name) {
+    if (not program_name) {
+        program_name = "db-bench";
+    }
+
+    errlog.label(false);
+    errlog(
+        "Usage: ",
+        program_name,
+        " [options] <command> <db_config>\n"
+        "  Where db_config is a path to the .db.config file of a scratch database (NOT the "
+        "database of a working Sim)\n"
+        "\n"
+        "Commands:\n"
+        "  generate              Create the tables of Sim and fill them with synthetic data\n"
+        "  run                   Run EXPLAIN and time every hot query of Sim\n"
+        "\n"
+        "Options:\n"
+        "  -h, --help            Display this information\n"
+        "  --drop-tables         generate: drop the existing tables first\n"
+        "  --seed <n>            generate: seed of the pseudo-random generator (default: 42)\n"
+        "  --users <n>           generate: number of users (default: 100000)\n"
+        "  --problems <n>        generate: number of problems (default: 10000)\n"
+        "  --contests <n>        generate: number of contests (default: 3000)\n"
+        "  --submissions <n>     generate: number of submissions (default: 5000000)\n"
+        "  --repetitions <n>     run: how many times to run each query (default: 10)\n"
+        "  --baseline <file>     run: report the regressions of the plans and the times "
+        "compared to the results saved in file\n"
+        "  --save <file>         run: save the results to file"
+    );
+}
+
+static CmdOptions parse_cmd_options(int& argc, char** argv) {
+    STACK_UNWINDING_MARK;
+
+    int new_argc = 1;
+    CmdOptions cmd_options;
+    auto& gen_opts = cmd_options.generator;
+    auto next_num_arg = [&](int& i) -> uint64_t {
+        auto num = (i + 1 < argc ? str2num<uint64_t>(argv[i + 1]) : std::nullopt);
+        if (not num) {
+            (void)fprintf(stderr, "Option '%s' requires a non-negative integer\n", argv[i]);
+            _exit(1);
+        }
+        ++i;
+        return *num;
+    };
+    auto next_path_arg = [&](int& i) -> string {
+        if (i + 1 >= argc) {
+            (void)fprintf(stderr, "Option '%s' requires a file path\n", argv[i]);
+            _exit(1);
+        }
+        return argv[++i];
+    };
+    for (int i = 1; i < argc; ++i) {
+
+        if (argv[i][0] == '-') {
+            if (0 == strcmp(argv[i], "-h") or 0 == strcmp(argv[i], "--help")) { // Help
+                print_help(argv[0]); // argv[0] is valid (argc > 1)
+                _exit(0);
+
+            } else if (0 == strcmp(argv[i], "--drop-tables")) {
+                cmd_options.drop_tables = true;
+            } else if (0 == strcmp(argv[i], "--seed")) {
+                gen_opts.seed = next_num_arg(i);
+            } else if (0 == strcmp(argv[i], "--users")) {
+                gen_opts.users = next_num_arg(i);
+            } else if (0 == strcmp(argv[i], "--problems")) {
+                gen_opts.problems = next_num_arg(i);
+            } else if (0 == strcmp(argv[i], "--contests")) {
+                gen_opts.contests = next_num_arg(i);
+            } else if (0 == strcmp(argv[i], "--submissions")) {
+                gen_opts.submissions = next_num_arg(i);
+            } else if (0 == strcmp(argv[i], "--repetitions")) {
+                cmd_options.repetitions = std::max<uint64_t>(next_num_arg(i), 1);
+            } else if (0 == strcmp(argv[i], "--baseline")) {
+                cmd_options.baseline_path = next_path_arg(i);
+            } else if (0 == strcmp(argv[i], "--save")) {
+                cmd_options.save_path = next_path_arg(i);
+
+            } else { // Unknown
+                (void)fprintf(stderr, "Unknown option: '%s'\n", argv[i]);
+                _exit(1);
+            }
+
+        } else {
+            argv[new_argc++] = argv[i];
+        }
+    }
+
+    argc = new_argc;
+    return cmd_options;
+}
+
+static int generate(sim::mysql::Connection& mysql, const CmdOptions& cmd_options) {
+    STACK_UNWINDING_MARK;
+
+    auto table_names = sim::db::get_all_table_names(mysql);
+    if (not table_names.empty()) {
+        if (not cmd_options.drop_tables) {
+            errlog("The database is not empty, use --drop-tables to drop its tables");
+            return 1;
+        }
+        stdlog("Dropping the tables...");
+        mysql.update("SET foreign_key_checks=0");
+        for (auto const& table_name : table_names) {
+            mysql.update("DROP TABLE `", table_name, '`');
+        }
+        mysql.update("SET foreign_key_checks=1");
+    }
+
+    stdlog("Creating the tables...");
+    for (const auto& table_schema : sim::db::schema.table_schemas) {
+        mysql.update(table_schema.create_table_sql);
+    }
+
+    db_bench::generate(mysql, cmd_options.generator);
+    stdlog("Done.");
+    return 0;
+}
+
+static db_bench::QueryPlan explain(sim::mysql::Connection& mysql, StringView sql) {
+    STACK_UNWINDING_MARK;
+
+    enum ColumnIdx { TABLE = 2, TYPE = 3, KEY = 5, ROWS = 8 };
+    db_bench::QueryPlan plan;
+    auto res = mysql.query("EXPLAIN ", sql);
+    while (res.next()) {
+        auto column = [&](ColumnIdx idx) {
+            return (res.is_null(idx) ? string{} : res[idx].to_string());
+        };
+        plan.steps.push_back({
+            .table = column(TABLE),
+            .access_type = column(TYPE),
+            .key = column(KEY),
+            .rows = (res.is_null(ROWS) ? 0 : str2num<uint64_t>(res[ROWS]).value_or(0)),
+        });
+    }
+    return plan;
+}
+
+// Returns the median time of running the query [us]
+static int64_t time_query(sim::mysql::Connection& mysql, StringView sql, size_t repetitions) {
+    STACK_UNWINDING_MARK;
+
+    auto run = [&] {
+        auto beg = std::chrono::steady_clock::now();
+        auto res = mysql.query(sql);
+        while (res.next()) {
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - beg
+        )
+            .count();
+    };
+    run(); // Warm up the buffer pool
+    vector<int64_t> times;
+    for (size_t i = 0; i < repetitions; ++i) {
+        times.emplace_back(run());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+static int run(sim::mysql::Connection& mysql, const CmdOptions& cmd_options) {
+    STACK_UNWINDING_MARK;
+
+    db_bench::QueryResults baseline;
+    if (cmd_options.baseline_path) {
+        baseline = db_bench::parse_results(get_file_contents(*cmd_options.baseline_path));
+    }
+
+    db_bench::QueryResults results;
+    size_t regressions_num = 0;
+    for (auto const& query : db_bench::hot_queries(mysql)) {
+        auto& result = results[query.name];
+        result.plan = explain(mysql, query.sql);
+        result.median_us = time_query(mysql, query.sql, cmd_options.repetitions);
+        stdlog(query.name, ": ", result.median_us, " us, plan: ", result.plan.dump());
+
+        if (not cmd_options.baseline_path) {
+            continue;
+        }
+        auto it = baseline.find(query.name);
+        if (it == baseline.end()) {
+            stdlog("  not in the baseline");
+            continue;
+        }
+        auto regressions = db_bench::plan_regressions(it->second.plan, result.plan);
+        auto baseline_us = it->second.median_us;
+        if (result.median_us > baseline_us * SLOWDOWN_FACTOR and
+            result.median_us > baseline_us + SLOWDOWN_MIN_US)
+        {
+            regressions.emplace_back(
+                concat_tostr("time: ", baseline_us, " us -> ", result.median_us, " us")
+            );
+        }
+        for (auto const& regression : regressions) {
+            stdlog("  \033[1;31mREGRESSION\033[m ", regression);
+        }
+        regressions_num += regressions.size();
+    }
+
+    if (cmd_options.save_path) {
+        put_file_contents(*cmd_options.save_path, db_bench::dump_results(results));
+    }
+    if (cmd_options.baseline_path) {
+        stdlog("Regressions: ", regressions_num);
+    }
+    return regressions_num > 0 ? 1 : 0;
+}
+
+static int true_main(int argc, char** argv) {
+    STACK_UNWINDING_MARK;
+
+    stdlog.use(stdout);
+    stdlog.label(false);
+    errlog.use(stderr);
+
+    CmdOptions cmd_options = parse_cmd_options(argc, argv);
+    if (argc != 3) {
+        print_help(argv[0]);
+        return 1;
+    }
+
+    StringView command = argv[1];
+    auto mysql = sim::mysql::make_conn_with_credential_file(argv[2]);
+    if (command == "generate") {
+        return generate(mysql, cmd_options);
+    }
+    if (command == "run") {
+        return run(mysql, cmd_options);
+    }
+    print_help(argv[0]);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    try {
+        return true_main(argc, argv);
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e);
+        return 1;
+    }
+}
@@ -0,0 +1,613 @@
+#include "generator.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <ctime>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sim/contest_problems/contest_problem.hh>
+#include <sim/contest_users/contest_user.hh>
+#include <sim/jobs/job.hh>
+#include <sim/problems/problem.hh>
+#include <sim/submissions/submission.hh>
+#include <sim/users/user.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/time.hh>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using sim::contest_problems::ContestProblem;
+using sim::contest_users::ContestUser;
+using sim::jobs::Job;
+using sim::problems::Problem;
+using sim::submissions::Submission;
+using sim::users::User;
+using std::optional;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Submissions are spread over this period that ends at the time of generation
+constexpr time_t HISTORY_DURATION = 5 * 365 * 24 * 3600;
+// Judge jobs of the most recent submissions are left pending
+constexpr uint64_t PENDING_JOBS = 1000;
+constexpr uint64_t MAX_CONTEST_PARTICIPANTS = 10'000;
+
+string sql_str(StringView str) { return concat_tostr('\'', str, '\''); }
+
+string sql_date(time_t t) { return concat_tostr('\'', mysql_date(t), '\''); }
+
+template <class T>
+string sql_opt(const optional<T>& x) {
+    return x ? concat_tostr(*x) : "NULL";
+}
+
+// Multi-row INSERT of the rows added one by one
+class BatchInsert {
+    sim::mysql::Connection& mysql_;
+    string prefix_;
+    string query_;
+    size_t rows_ = 0;
+
+    static constexpr size_t MAX_ROWS = 1000;
+
+public:
+    BatchInsert(sim::mysql::Connection& mysql, StringView table, StringView columns)
+    : mysql_{mysql}
+    , prefix_{concat_tostr("INSERT INTO ", table, " (", columns, ") VALUES ")} {}
+
+    // @p values have to be SQL literals, e.g. 42, 'abc' or NULL
+    template <class... Args>
+    void add_row(Args&&... values) {
+        back_insert(query_, (rows_ == 0 ? StringView{prefix_} : StringView{","}), '(');
+        bool first = true;
+        ((back_insert(query_, (first ? "" : ","), std::forward<Args>(values)), first = false),
+         ...);
+        query_ += ')';
+        if (++rows_ == MAX_ROWS) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (rows_ > 0) {
+            mysql_.update(query_);
+            query_.clear();
+            rows_ = 0;
+        }
+    }
+};
+
+// Draws ranks 0, 1, ..., n - 1; rank r with the probability proportional to
+// 1 / (r + 1)^exponent
+class ZipfDistribution {
+    vector<double> cdf_;
+
+public:
+    ZipfDistribution(size_t n, double exponent) {
+        double sum = 0;
+        for (size_t r = 0; r < n; ++r) {
+            sum += 1 / std::pow(static_cast<double>(r + 1), exponent);
+            cdf_.emplace_back(sum);
+        }
+    }
+
+    template <class Gen>
+    size_t operator()(Gen& gen) {
+        auto x = std::uniform_real_distribution<double>{0, cdf_.back()}(gen);
+        auto it = std::upper_bound(cdf_.begin(), cdf_.end(), x);
+        return std::min(static_cast<size_t>(it - cdf_.begin()), cdf_.size() - 1);
+    }
+};
+
+struct ContestProblemData {
+    uint64_t id;
+    uint64_t round_id;
+    uint64_t contest_id;
+    uint64_t problem_id;
+    bool latest_compiling; // Otherwise the final submission has the highest score
+};
+
+struct ContestData {
+    size_t first_contest_problem; // Index in the contest problems
+    size_t contest_problems_num;
+    vector<uint64_t> participants;
+};
+
+// Everything generated before the submissions
+struct Dataset {
+    time_t now = time(nullptr);
+    vector<uint64_t> teachers;
+    vector<ContestProblemData> contest_problems;
+    vector<ContestData> contests; // contests[i] has id i + 1
+    vector<uint64_t> problems_by_popularity;
+    vector<uint64_t> contests_by_popularity;
+};
+
+template <class Gen>
+bool with_probability(Gen& gen, double p) {
+    return std::bernoulli_distribution{p}(gen);
+}
+
+template <class Gen, class Container>
+const auto& random_elem(Gen& gen, const Container& elems) {
+    return elems[std::uniform_int_distribution<size_t>{0, elems.size() - 1}(gen)];
+}
+
+template <class Gen>
+vector<uint64_t> random_permutation_of_ids(Gen& gen, uint64_t n) {
+    vector<uint64_t> res(n);
+    std::iota(res.begin(), res.end(), 1);
+    std::shuffle(res.begin(), res.end(), gen);
+    return res;
+}
+
+// Time of creation of the @p i-th of @p n objects created uniformly over the history
+time_t created_at(const Dataset& ds, uint64_t i, uint64_t n) {
+    return ds.now - HISTORY_DURATION +
+        static_cast<time_t>(static_cast<double>(i) / static_cast<double>(n) * HISTORY_DURATION);
+}
+
+
+void generate_users(
+    sim::mysql::Connection& mysql, Dataset& ds, std::mt19937_64& gen, uint64_t users
+) {
+    STACK_UNWINDING_MARK;
+
+    stdlog("Generating ", users, " users...");
+    string salt(decltype(User::password_salt)::max_len, '0');
+    string hash(decltype(User::password_hash)::max_len, '0');
+    BatchInsert insert{
+        mysql,
+        "users",
+        "id, created_at, type, username, first_name, last_name, email, password_salt, "
+        "password_hash"
+    };
+    for (uint64_t id = 1; id <= users; ++id) {
+        auto type = User::Type::NORMAL;
+        if (id == 1) {
+            type = User::Type::ADMIN;
+        } else if (with_probability(gen, 0.02)) {
+            type = User::Type::TEACHER;
+            ds.teachers.emplace_back(id);
+        }
+        insert.add_row(
+            id,
+            sql_date(created_at(ds, id, users)),
+            EnumVal(type).to_int(),
+            sql_str(id == 1 ? string{"sim"} : concat_tostr("user", id)),
+            sql_str(concat_tostr("First", id)),
+            sql_str(concat_tostr("Last", id)),
+            sql_str(concat_tostr("user", id, "@example.com")),
+            sql_str(salt),
+            sql_str(hash)
+        );
+    }
+    insert.flush();
+    if (ds.teachers.empty()) {
+        ds.teachers.emplace_back(1);
+    }
+}
+
+// Problem i uses the internal file i
+void generate_problems(
+    sim::mysql::Connection& mysql, Dataset& ds, std::mt19937_64& gen, uint64_t problems
+) {
+    STACK_UNWINDING_MARK;
+
+    stdlog("Generating ", problems, " problems...");
+    BatchInsert insert_files{mysql, "internal_files", "id, created_at"};
+    BatchInsert insert{
+        mysql,
+        "problems",
+        "id, created_at, file_id, type, name, label, simfile, owner_id, updated_at"
+    };
+    for (uint64_t id = 1; id <= problems; ++id) {
+        auto date = sql_date(created_at(ds, id, problems));
+        insert_files.add_row(id, date);
+        auto type = Problem::Type::CONTEST_ONLY;
+        if (with_probability(gen, 0.3)) {
+            type = Problem::Type::PUBLIC;
+        } else if (with_probability(gen, 0.3)) {
+            type = Problem::Type::PRIVATE;
+        }
+        insert.add_row(
+            id,
+            date,
+            id,
+            EnumVal(type).to_int(),
+            sql_str(concat_tostr("Problem ", id)),
+            sql_str(concat_tostr('P', id)),
+            "''",
+            random_elem(gen, ds.teachers),
+            date
+        );
+    }
+    insert_files.flush();
+    insert.flush();
+    ds.problems_by_popularity = random_permutation_of_ids(gen, problems);
+}
+
+void generate_contests(
+    sim::mysql::Connection& mysql,
+    Dataset& ds,
+    std::mt19937_64& gen,
+    uint64_t contests,
+    uint64_t users
+) {
+    STACK_UNWINDING_MARK;
+
+    stdlog("Generating ", contests, " contests...");
+    ds.contests_by_popularity = random_permutation_of_ids(gen, contests);
+    vector<size_t> contest_rank(contests);
+    for (size_t rank = 0; rank < contests; ++rank) {
+        contest_rank[ds.contests_by_popularity[rank] - 1] = rank;
+    }
+
+    ZipfDistribution problem_zipf{ds.problems_by_popularity.size(), 1};
+    ZipfDistribution user_zipf{users - 1, 0.8};
+    BatchInsert insert_contests{mysql, "contests", "id, created_at, name, is_public"};
+    BatchInsert insert_rounds{
+        mysql,
+        "contest_rounds",
+        "id, created_at, contest_id, name, item, begins, ends, full_results, ranking_exposure"
+    };
+    BatchInsert insert_problems{
+        mysql,
+        "contest_problems",
+        "id, created_at, contest_round_id, contest_id, problem_id, name, item, "
+        "method_of_choosing_final_submission, score_revealing"
+    };
+    BatchInsert insert_users{mysql, "contest_users", "user_id, contest_id, mode"};
+    uint64_t round_id = 0;
+    for (uint64_t id = 1; id <= contests; ++id) {
+        auto contest_created_at = created_at(ds, id, contests);
+        insert_contests.add_row(
+            id,
+            sql_date(contest_created_at),
+            sql_str(concat_tostr("Contest ", id)),
+            static_cast<int>(with_probability(gen, 0.3))
+        );
+
+        auto& contest = ds.contests.emplace_back();
+        contest.first_contest_problem = ds.contest_problems.size();
+        auto rounds = std::uniform_int_distribution<uint64_t>{1, 5}(gen);
+        for (uint64_t item = 0; item < rounds; ++item) {
+            auto begins = contest_created_at + static_cast<time_t>(item) * 7 * 24 * 3600;
+            auto ends = begins + 5 * 3600;
+            insert_rounds.add_row(
+                ++round_id,
+                sql_date(contest_created_at),
+                id,
+                sql_str(concat_tostr("Round ", item + 1)),
+                item,
+                sql_date(begins),
+                sql_date(ends),
+                sql_date(ends),
+                sql_date(begins)
+            );
+
+            auto round_problems = std::uniform_int_distribution<uint64_t>{1, 6}(gen);
+            for (uint64_t cp_item = 0; cp_item < round_problems; ++cp_item) {
+                auto& cp = ds.contest_problems.emplace_back(ContestProblemData{
+                    .id = ds.contest_problems.size() + 1,
+                    .round_id = round_id,
+                    .contest_id = id,
+                    .problem_id = ds.problems_by_popularity[problem_zipf(gen)],
+                    .latest_compiling = with_probability(gen, 0.8),
+                });
+                using MOCFS = ContestProblem::MethodOfChoosingFinalSubmission;
+                insert_problems.add_row(
+                    cp.id,
+                    sql_date(contest_created_at),
+                    round_id,
+                    id,
+                    cp.problem_id,
+                    sql_str(concat_tostr("Problem ", cp_item + 1)),
+                    cp_item,
+                    EnumVal(cp.latest_compiling ? MOCFS::LATEST_COMPILING : MOCFS::HIGHEST_SCORE)
+                        .to_int(),
+                    EnumVal(ContestProblem::ScoreRevealing::NONE).to_int()
+                );
+            }
+        }
+        contest.contest_problems_num = ds.contest_problems.size() - contest.first_contest_problem;
+
+        // The most popular contests have the most participants, the most
+        // active users participate in the most contests
+        auto participants_num = std::min(
+            {MAX_CONTEST_PARTICIPANTS,
+             (users - ds.teachers.size()) / 2,
+             5 + (users - 1) / 4 / (contest_rank[id - 1] + 1)}
+        );
+        auto owner = random_elem(gen, ds.teachers);
+        std::unordered_set<uint64_t> participants;
+        while (participants.size() < participants_num) {
+            auto user_id = (with_probability(gen, 0.5)
+                                ? user_zipf(gen) + 2
+                                : std::uniform_int_distribution<uint64_t>{2, users}(gen));
+            if (user_id != owner) {
+                participants.emplace(user_id);
+            }
+        }
+        contest.participants.assign(participants.begin(), participants.end());
+        std::sort(contest.participants.begin(), contest.participants.end());
+        insert_users.add_row(owner, id, EnumVal(ContestUser::Mode::OWNER).to_int());
+        for (auto user_id : contest.participants) {
+            insert_users.add_row(user_id, id, EnumVal(ContestUser::Mode::CONTESTANT).to_int());
+        }
+    }
+    insert_contests.flush();
+    insert_rounds.flush();
+    insert_problems.flush();
+    insert_users.flush();
+}
+
+struct SubmissionData {
+    uint64_t id;
+    time_t created_at;
+    optional<uint64_t> owner;
+    uint64_t problem_id;
+    const ContestProblemData* contest_problem; // nullptr if sent outside contests
+    Submission::Type type;
+    Submission::Language language;
+    Submission::Status initial_status;
+    Submission::Status full_status;
+    optional<int64_t> score;
+
+    [[nodiscard]] bool is_final_candidate() const noexcept {
+        return type == Submission::Type::NORMAL and score.has_value();
+    }
+};
+
+// Generates the same submissions every time it is constructed with the same
+// arguments
+class SubmissionsGenerator {
+    const Dataset& ds_;
+    uint64_t submissions_;
+    uint64_t users_;
+    std::mt19937_64 gen_;
+    ZipfDistribution contest_zipf_;
+    ZipfDistribution problem_zipf_;
+    ZipfDistribution user_zipf_;
+    uint64_t next_id_ = 1;
+
+public:
+    SubmissionsGenerator(const Dataset& ds, uint64_t seed, uint64_t submissions, uint64_t users)
+    : ds_{ds}
+    , submissions_{submissions}
+    , users_{users}
+    , gen_{seed}
+    , contest_zipf_{ds.contests.size(), 1.1}
+    , problem_zipf_{ds.problems_by_popularity.size(), 1}
+    , user_zipf_{users - 1, 1} {}
+
+    optional<SubmissionData> next() {
+        using ST = Submission::Status;
+        if (next_id_ > submissions_) {
+            return std::nullopt;
+        }
+        SubmissionData s = {};
+        s.id = next_id_++;
+        s.created_at = created_at(ds_, s.id, submissions_);
+        s.type = Submission::Type::NORMAL;
+        s.contest_problem = nullptr;
+        if (not ds_.contests.empty() and with_probability(gen_, 0.75)) {
+            auto contest_id = ds_.contests_by_popularity[contest_zipf_(gen_)];
+            auto& contest = ds_.contests[contest_id - 1];
+            s.owner = random_elem(gen_, contest.participants);
+            s.contest_problem = &ds_.contest_problems
+                                     [contest.first_contest_problem +
+                                      std::uniform_int_distribution<size_t>{
+                                          0, contest.contest_problems_num - 1}(gen_)];
+            s.problem_id = s.contest_problem->problem_id;
+            if (with_probability(gen_, 0.02)) {
+                s.type = Submission::Type::IGNORED;
+            }
+        } else {
+            s.problem_id = ds_.problems_by_popularity[problem_zipf_(gen_)];
+            if (with_probability(gen_, 0.01)) {
+                s.type = Submission::Type::PROBLEM_SOLUTION; // Sent by the job server
+            } else {
+                s.owner = user_zipf_(gen_) + 2;
+            }
+        }
+        s.language = with_probability(gen_, 0.8) ? Submission::Language::CPP17
+                                                 : Submission::Language::C11;
+
+        if (with_probability(gen_, 0.1)) {
+            s.initial_status = s.full_status = ST::COMPILATION_ERROR;
+            return s;
+        }
+        constexpr std::array failures = {ST::WA, ST::TLE, ST::MLE, ST::RTE};
+        s.score = with_probability(gen_, 0.3)
+            ? 100
+            : std::uniform_int_distribution<int64_t>{0, 99}(gen_);
+        s.initial_status = with_probability(gen_, 0.85) ? ST::OK : random_elem(gen_, failures);
+        s.full_status = (*s.score == 100 ? ST::OK : random_elem(gen_, failures));
+        if (s.initial_status != ST::OK) {
+            s.full_status = s.initial_status;
+        }
+        return s;
+    }
+};
+
+// Final submissions are chosen like in sim/submissions/update_final.cc, except
+// that the initial final submissions are the same as the final ones
+class FinalSubmissions {
+    struct Best {
+        uint64_t id;
+        int64_t score;
+        Submission::Status full_status;
+    };
+
+    std::unordered_map<uint64_t, Best> problem_finals_; // (owner, problem) => final
+    std::unordered_map<uint64_t, Best> contest_finals_; // (owner, contest problem) => final
+
+    static uint64_t key(uint64_t owner, uint64_t id) noexcept { return owner << 32 | id; }
+
+    // The highest score, then the best status, then the latest
+    static void choose_best(Best& best, const SubmissionData& s) {
+        auto score = s.score.value();
+        if (score > best.score or (score == best.score and s.full_status <= best.full_status)) {
+            best = {s.id, score, s.full_status};
+        }
+    }
+
+public:
+    // Submissions have to be added in the order of ids
+    void add(const SubmissionData& s) {
+        if (not s.is_final_candidate() or not s.owner) {
+            return;
+        }
+        constexpr Best no_final = {0, -1, Submission::Status::PENDING};
+        choose_best(
+            problem_finals_.try_emplace(key(*s.owner, s.problem_id), no_final).first->second, s
+        );
+        if (s.contest_problem) {
+            auto& best =
+                contest_finals_.try_emplace(key(*s.owner, s.contest_problem->id), no_final)
+                    .first->second;
+            if (s.contest_problem->latest_compiling) {
+                best = {s.id, *s.score, s.full_status};
+            } else {
+                choose_best(best, s);
+            }
+        }
+    }
+
+    [[nodiscard]] bool is_problem_final(const SubmissionData& s) const {
+        auto it = (s.owner ? problem_finals_.find(key(*s.owner, s.problem_id))
+                           : problem_finals_.end());
+        return it != problem_finals_.end() and it->second.id == s.id;
+    }
+
+    [[nodiscard]] bool is_contest_final(const SubmissionData& s) const {
+        auto it = (s.owner and s.contest_problem
+                       ? contest_finals_.find(key(*s.owner, s.contest_problem->id))
+                       : contest_finals_.end());
+        return it != contest_finals_.end() and it->second.id == s.id;
+    }
+};
+
+// Submission i uses the internal file problems + i, the judge job i judged it
+void generate_submissions(
+    sim::mysql::Connection& mysql,
+    const Dataset& ds,
+    const db_bench::GeneratorOptions& options
+) {
+    STACK_UNWINDING_MARK;
+
+    stdlog("Choosing the final submissions...");
+    auto seed = options.seed + 1;
+    FinalSubmissions finals;
+    {
+        SubmissionsGenerator subs{ds, seed, options.submissions, options.users};
+        while (auto s = subs.next()) {
+            finals.add(*s);
+        }
+    }
+
+    stdlog("Generating ", options.submissions, " submissions and their jobs...");
+    BatchInsert insert_files{mysql, "internal_files", "id, created_at"};
+    BatchInsert insert{
+        mysql,
+        "submissions",
+        "id, created_at, file_id, owner, problem_id, contest_problem_id, contest_round_id, "
+        "contest_id, type, language, final_candidate, problem_final, contest_final, "
+        "contest_initial_final, initial_status, full_status, score, last_judgment, "
+        "initial_report, final_report"
+    };
+    BatchInsert insert_jobs{
+        mysql,
+        "jobs",
+        "id, created_at, file_id, tmp_file_id, creator, type, priority, status, aux_id, info, "
+        "data"
+    };
+    SubmissionsGenerator subs{ds, seed, options.submissions, options.users};
+    while (auto s = subs.next()) {
+        auto date = sql_date(s->created_at);
+        auto file_id = options.problems + s->id;
+        insert_files.add_row(file_id, date);
+        auto* cp = s->contest_problem;
+        bool contest_final = finals.is_contest_final(*s);
+        insert.add_row(
+            s->id,
+            date,
+            file_id,
+            sql_opt(s->owner),
+            s->problem_id,
+            (cp ? concat_tostr(cp->id) : "NULL"),
+            (cp ? concat_tostr(cp->round_id) : "NULL"),
+            (cp ? concat_tostr(cp->contest_id) : "NULL"),
+            EnumVal(s->type).to_int(),
+            EnumVal(s->language).to_int(),
+            static_cast<int>(s->is_final_candidate()),
+            static_cast<int>(finals.is_problem_final(*s)),
+            static_cast<int>(contest_final),
+            static_cast<int>(contest_final),
+            EnumVal(s->initial_status).to_int(),
+            EnumVal(s->full_status).to_int(),
+            sql_opt(s->score),
+            date,
+            "''",
+            "''"
+        );
+        auto job_status =
+            (s->id + PENDING_JOBS > options.submissions ? Job::Status::PENDING : Job::Status::DONE);
+        insert_jobs.add_row(
+            s->id,
+            date,
+            "NULL",
+            "NULL",
+            sql_opt(s->owner),
+            EnumVal(Job::Type::JUDGE_SUBMISSION).to_int(),
+            static_cast<int>(sim::jobs::default_priority(Job::Type::JUDGE_SUBMISSION)),
+            EnumVal(job_status).to_int(),
+            s->id,
+            "''",
+            "''"
+        );
+        if (s->id % 500'000 == 0) {
+            stdlog("  ", s->id, " / ", options.submissions);
+        }
+    }
+    insert_files.flush();
+    insert.flush();
+    insert_jobs.flush();
+}
+
+} // namespace
+
+namespace db_bench {
+
+void generate(sim::mysql::Connection& mysql, const GeneratorOptions& options) {
+    STACK_UNWINDING_MARK;
+
+    if (options.users < 100 or options.problems < 1) {
+        THROW("There have to be at least 100 users and 1 problem");
+    }
+    mysql.update("SET foreign_key_checks=0, unique_checks=0");
+
+    Dataset ds;
+    std::mt19937_64 gen{options.seed};
+    generate_users(mysql, ds, gen, options.users);
+    generate_problems(mysql, ds, gen, options.problems);
+    generate_contests(mysql, ds, gen, options.contests, options.users);
+    generate_submissions(mysql, ds, options);
+
+    mysql.update("SET foreign_key_checks=1, unique_checks=1");
+    stdlog("Updating the index statistics...");
+    auto res = mysql.query("ANALYZE TABLE users, problems, contests, contest_rounds, "
+                           "contest_problems, contest_users, submissions, jobs");
+    while (res.next()) {
+    }
+}
+
+} // namespace db_bench
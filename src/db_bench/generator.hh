@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <sim/mysql/mysql.hh>
+
+namespace db_bench {
+
+struct GeneratorOptions {
+    uint64_t seed = 42;
+    uint64_t users = 100'000;
+    uint64_t problems = 10'000;
+    uint64_t contests = 3'000;
+    uint64_t submissions = 5'000'000;
+};
+
+// Fills the empty tables of Sim with synthetic data. The data is skewed like in
+// production: a few users, contests and problems get most of the submissions
+// and most of the submissions are sent in contests. The same options produce
+// the same data, only the dates depend on the time of generation.
+void generate(sim::mysql::Connection& mysql, const GeneratorOptions& options);
+
+} // namespace db_bench
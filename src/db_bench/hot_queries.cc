@@ -0,0 +1,331 @@
+#include "hot_queries.hh"
+
+#include <optional>
+#include <sim/contest_users/contest_user.hh>
+#include <sim/jobs/job.hh>
+#include <sim/submissions/list_query.hh>
+#include <sim/submissions/submission.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/macros/throw.hh>
+
+using sim::contest_users::ContestUser;
+using sim::jobs::Job;
+using sim::submissions::ListFilter;
+using sim::submissions::Submission;
+using std::optional;
+using std::string;
+using std::vector;
+
+namespace {
+
+// API_FIRST_QUERY_ROWS_LIMIT in web_server/old/sim.hh
+constexpr unsigned LIST_ROWS_LIMIT = 50;
+
+// Returns the first column of the first row of the result of the query or
+// std::nullopt if there is no such row
+template <class... Args>
+optional<uint64_t> select_id(sim::mysql::Connection& mysql, Args&&... sql) {
+    auto res = mysql.query(std::forward<Args>(sql)...);
+    if (not res.next() or res.is_null(0)) {
+        return std::nullopt;
+    }
+    return str2num<uint64_t>(res[0]);
+}
+
+// Selecting ids of a page of the submissions list (see api_submissions() in
+// web_server/old/submissions_api.cc). The page after the one ending with
+// @p last_id is selected if it is set (the cursor of the next page).
+string submissions_list_ids_sql(
+    const ListFilter& filter, StringView qwhere, optional<uint64_t> last_id = std::nullopt
+) {
+    string index_hint;
+    if (auto index = sim::submissions::list_index(filter)) {
+        index_hint = concat_tostr(" FORCE INDEX(`", *index, "`)");
+    }
+    return concat_tostr(
+        "SELECT s.id FROM submissions s",
+        index_hint,
+        " WHERE TRUE",
+        qwhere,
+        (last_id ? concat_tostr(" AND s.id<", *last_id) : ""),
+        " ORDER BY s.id DESC LIMIT ",
+        LIST_ROWS_LIMIT
+    );
+}
+
+} // namespace
+
+namespace db_bench {
+
+vector<HotQuery> hot_queries(sim::mysql::Connection& mysql) {
+    STACK_UNWINDING_MARK;
+
+    // The busiest objects have the most rows to examine
+    auto contest_id = select_id(
+        mysql,
+        "SELECT contest_id FROM submissions WHERE contest_id IS NOT NULL "
+        "GROUP BY contest_id ORDER BY COUNT(*) DESC LIMIT 1"
+    );
+    if (not contest_id) {
+        THROW("There are no contest submissions in the database");
+    }
+    auto contest_problem_id = select_id(
+        mysql,
+        "SELECT contest_problem_id FROM submissions WHERE contest_id=",
+        *contest_id,
+        " GROUP BY contest_problem_id ORDER BY COUNT(*) DESC LIMIT 1"
+    );
+    auto contestant_id = select_id(
+        mysql,
+        "SELECT owner FROM submissions WHERE contest_problem_id=",
+        contest_problem_id.value(),
+        " AND owner IS NOT NULL GROUP BY owner ORDER BY COUNT(*) DESC LIMIT 1"
+    );
+    auto user_id = select_id(
+        mysql,
+        "SELECT owner FROM submissions WHERE owner IS NOT NULL "
+        "GROUP BY owner ORDER BY COUNT(*) DESC LIMIT 1"
+    );
+    auto user_problem_id = select_id(
+        mysql,
+        "SELECT problem_id FROM submissions WHERE owner=",
+        user_id.value(),
+        " GROUP BY problem_id ORDER BY COUNT(*) DESC LIMIT 1"
+    );
+    auto problem_id = select_id(
+        mysql,
+        "SELECT problem_id FROM submissions GROUP BY problem_id ORDER BY COUNT(*) DESC LIMIT 1"
+    );
+    stdlog(
+        "Parameters: contest ",
+        *contest_id,
+        ", contest problem ",
+        *contest_problem_id,
+        ", contestant ",
+        contestant_id.value(),
+        ", user ",
+        *user_id,
+        " (with problem ",
+        user_problem_id.value(),
+        "), problem ",
+        problem_id.value()
+    );
+
+    vector<HotQuery> res;
+
+    // sim/submissions/update_final.cc
+    res.push_back(
+        {"update_final.problem_final_score",
+         concat_tostr(
+             "SELECT score FROM submissions USE INDEX(final3) "
+             "WHERE final_candidate=1 AND owner=",
+             *user_id,
+             " AND problem_id=",
+             *user_problem_id,
+             " ORDER BY score DESC LIMIT 1"
+         )}
+    );
+    res.push_back(
+        {"update_final.problem_final_id",
+         concat_tostr(
+             "SELECT id FROM submissions USE INDEX(final3) "
+             "WHERE final_candidate=1 AND owner=",
+             *user_id,
+             " AND problem_id=",
+             *user_problem_id,
+             " AND score=100 AND full_status=",
+             EnumVal(Submission::Status::OK).to_int(),
+             " ORDER BY id DESC LIMIT 1"
+         )}
+    );
+    res.push_back(
+        {"update_final.contest_final_latest_compiling",
+         concat_tostr(
+             "SELECT id FROM submissions USE INDEX(final1) WHERE owner=",
+             *contestant_id,
+             " AND contest_problem_id=",
+             *contest_problem_id,
+             " AND final_candidate=1 ORDER BY id DESC LIMIT 1"
+         )}
+    );
+    res.push_back(
+        {"update_final.contest_final_highest_score",
+         concat_tostr(
+             "SELECT score FROM submissions USE INDEX(final2) "
+             "WHERE final_candidate=1 AND owner=",
+             *contestant_id,
+             " AND contest_problem_id=",
+             *contest_problem_id,
+             " ORDER BY score DESC LIMIT 1"
+         )}
+    );
+
+    // api_submissions() in web_server/old/submissions_api.cc
+    res.push_back({"submissions_list.all", submissions_list_ids_sql({}, "")});
+    res.push_back(
+        {"submissions_list.user",
+         submissions_list_ids_sql({.owner = *user_id}, concat_tostr(" AND s.owner=", *user_id))}
+    );
+    res.push_back(
+        {"submissions_list.problem",
+         submissions_list_ids_sql(
+             {.scope = ListFilter::Scope::PROBLEM, .scope_id = *problem_id},
+             concat_tostr(" AND s.problem_id=", *problem_id)
+         )}
+    );
+    ListFilter contest_filter = {.scope = ListFilter::Scope::CONTEST, .scope_id = *contest_id};
+    auto contest_list_ids_sql =
+        submissions_list_ids_sql(contest_filter, concat_tostr(" AND s.contest_id=", *contest_id));
+    res.push_back({"submissions_list.contest", contest_list_ids_sql});
+    res.push_back(
+        {"submissions_list.contest_finals",
+         submissions_list_ids_sql(
+             {.scope = ListFilter::Scope::CONTEST,
+              .scope_id = *contest_id,
+              .finals = ListFilter::Finals::CONTEST},
+             concat_tostr(" AND s.contest_id=", *contest_id, " AND s.contest_final=1")
+         )}
+    );
+    res.push_back(
+        {"submissions_list.contestant_in_contest",
+         submissions_list_ids_sql(
+             {.owner = *contestant_id,
+              .scope = ListFilter::Scope::CONTEST,
+              .scope_id = *contest_id},
+             concat_tostr(" AND s.owner=", *contestant_id, " AND s.contest_id=", *contest_id)
+         )}
+    );
+
+    // The next pages, with the cursor in the middle of the submissions, so
+    // the index has to be entered in the middle too
+    auto last_id = select_id(mysql, "SELECT (MIN(id) + MAX(id)) DIV 2 FROM submissions");
+    res.push_back(
+        {"submissions_list.user_cursor",
+         submissions_list_ids_sql(
+             {.owner = *user_id}, concat_tostr(" AND s.owner=", *user_id), last_id.value()
+         )}
+    );
+    res.push_back(
+        {"submissions_list.problem_cursor",
+         submissions_list_ids_sql(
+             {.scope = ListFilter::Scope::PROBLEM, .scope_id = *problem_id},
+             concat_tostr(" AND s.problem_id=", *problem_id),
+             *last_id
+         )}
+    );
+    res.push_back(
+        {"submissions_list.contest_cursor",
+         submissions_list_ids_sql(
+             contest_filter, concat_tostr(" AND s.contest_id=", *contest_id), *last_id
+         )}
+    );
+    res.push_back(
+        {"submissions_list.type_cursor",
+         submissions_list_ids_sql(
+             {.type = Submission::Type::IGNORED},
+             concat_tostr(" AND s.type=", EnumVal(Submission::Type::IGNORED).to_int()),
+             *last_id
+         )}
+    );
+
+    string page_ids;
+    {
+        auto ids_res = mysql.query(contest_list_ids_sql);
+        while (ids_res.next()) {
+            back_insert(page_ids, (page_ids.empty() ? "" : ","), ids_res[0]);
+        }
+    }
+    res.push_back(
+        {"submissions_list.page",
+         concat_tostr(
+             "SELECT s.id, s.type, s.language, s.owner, cu.mode, p.owner_id,"
+             " u.username, u.first_name, u.last_name, s.problem_id,"
+             " p.name, s.contest_problem_id, cp.name,"
+             " cp.method_of_choosing_final_submission, cp.score_revealing,"
+             " s.contest_round_id, r.name, r.full_results, r.ends,"
+             " s.contest_id, c.name, s.created_at, s.problem_final,"
+             " s.contest_final, s.contest_initial_final,"
+             " s.initial_status, s.full_status, s.score"
+             " FROM submissions s "
+             "LEFT JOIN users u ON u.id=s.owner "
+             "STRAIGHT_JOIN problems p ON p.id=s.problem_id "
+             "LEFT JOIN contest_problems cp ON cp.id=s.contest_problem_id "
+             "LEFT JOIN contest_rounds r ON r.id=s.contest_round_id "
+             "LEFT JOIN contests c ON c.id=s.contest_id "
+             "LEFT JOIN contest_users cu ON cu.contest_id=s.contest_id AND cu.user_id=1"
+             " WHERE s.id IN (",
+             page_ids,
+             ") ORDER BY s.id DESC"
+         )}
+    );
+
+    // api_contest_ranking() in web_server/old/contests_api.cc
+    res.push_back(
+        {"contest_ranking.users",
+         concat_tostr(
+             "SELECT u.id, u.first_name, u.last_name FROM submissions s JOIN "
+             "users u ON s.owner=u.id WHERE s.contest_id=",
+             *contest_id,
+             " AND s.contest_final=1 GROUP BY (u.id) ORDER BY u.id"
+         )}
+    );
+    res.push_back(
+        {"contest_ranking.submissions",
+         concat_tostr(
+             "SELECT cr.id, cr.full_results, cp.id, cp.score_revealing, sf.owner,"
+             " sf.id, sf.full_status, sf.score, si.id, si.initial_status "
+             "FROM submissions sf "
+             "JOIN submissions si ON si.owner=sf.owner"
+             " AND si.contest_problem_id=sf.contest_problem_id"
+             " AND si.contest_initial_final=1 "
+             "JOIN contest_rounds cr ON cr.id=sf.contest_round_id "
+             "JOIN contest_problems cp ON cp.id=sf.contest_problem_id "
+             "WHERE sf.contest_id=",
+             *contest_id,
+             " AND sf.contest_final=1 ORDER BY sf.owner"
+         )}
+    );
+
+    // api_contest_users() in web_server/old/contest_users_api.cc
+    res.push_back(
+        {"contest_users.list",
+         concat_tostr(
+             "SELECT cu.user_id, u.username, u.first_name, u.last_name, cu.mode "
+             "FROM contest_users cu STRAIGHT_JOIN users u ON u.id=cu.user_id "
+             "WHERE 1=1 AND cu.mode=",
+             EnumVal(ContestUser::Mode::CONTESTANT).to_int(),
+             " AND cu.contest_id=",
+             *contest_id,
+             " ORDER BY cu.user_id DESC LIMIT ",
+             LIST_ROWS_LIMIT
+         )}
+    );
+
+    // api_problem_attaching_contest_problems() in web_server/old/problems_api.cc
+    res.push_back(
+        {"problem.attaching_contest_problems",
+         concat_tostr(
+             "SELECT c.id, c.name, r.id, r.name, p.id, p.name "
+             "FROM contest_problems p "
+             "STRAIGHT_JOIN contests c ON c.id=p.contest_id "
+             "STRAIGHT_JOIN contest_rounds r ON r.id=p.contest_round_id "
+             "WHERE p.problem_id=",
+             *problem_id,
+             " ORDER BY p.id DESC LIMIT ",
+             LIST_ROWS_LIMIT
+         )}
+    );
+
+    // sync_jobs_queue_with_db() in job_server/main.cc
+    res.push_back(
+        {"job_server.pending_jobs",
+         concat_tostr(
+             "SELECT id, type, creator, priority, aux_id, info FROM jobs WHERE status=",
+             EnumVal(Job::Status::PENDING).to_int(),
+             " ORDER BY priority DESC, id ASC LIMIT 4"
+         )}
+    );
+    return res;
+}
+
+} // namespace db_bench
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <sim/mysql/mysql.hh>
+#include <string>
+#include <vector>
+
+namespace db_bench {
+
+struct HotQuery {
+    std::string name;
+    std::string sql;
+};
+
+// Returns the queries of Sim that are run the most often or depend the most on
+// the choice of the index. Their parameters are the busiest user, contest,
+// problem etc. found in the database. The queries have to be kept in sync with
+// the code they are copied from.
+std::vector<HotQuery> hot_queries(sim::mysql::Connection& mysql);
+
+} // namespace db_bench
@@ -0,0 +1,166 @@
+#include "query_plan.hh"
+
+#include <algorithm>
+#include <array>
+#include <simlib/concat_tostr.hh>
+#include <simlib/macros/stack_unwinding.hh>
+#include <simlib/string_transform.hh>
+
+using std::optional;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Extracts the prefix up to the first @p c and the @p c itself
+StringView extract_field(StringView& s, char c) {
+    auto pos = std::min(s.find(c), s.size());
+    auto field = s.substring(0, pos);
+    s.remove_prefix(std::min(pos + 1, s.size()));
+    return field;
+}
+
+// Access types of MariaDB from the best to the worst
+constexpr std::array<StringView, 12> access_types_by_cost = {
+    "system",
+    "const",
+    "eq_ref",
+    "ref",
+    "fulltext",
+    "ref_or_null",
+    "index_merge",
+    "unique_subquery",
+    "index_subquery",
+    "range",
+    "index",
+    "ALL",
+};
+
+optional<size_t> access_type_cost(StringView access_type) noexcept {
+    auto it = std::find(access_types_by_cost.begin(), access_types_by_cost.end(), access_type);
+    if (it == access_types_by_cost.end()) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(it - access_types_by_cost.begin());
+}
+
+// Estimates below it are too imprecise to compare
+constexpr uint64_t ROWS_ESTIMATE_MIN = 100;
+constexpr uint64_t ROWS_ESTIMATE_GROWTH_FACTOR = 10;
+
+} // namespace
+
+namespace db_bench {
+
+string QueryPlan::dump() const {
+    STACK_UNWINDING_MARK;
+
+    string res;
+    for (auto const& step : steps) {
+        if (not res.empty()) {
+            res += ';';
+        }
+        back_insert(res, step.table, ':', step.access_type, ':', step.key, ':', step.rows);
+    }
+    return res;
+}
+
+optional<QueryPlan> QueryPlan::parse(StringView str) {
+    STACK_UNWINDING_MARK;
+
+    QueryPlan res;
+    while (not str.empty()) {
+        auto step_str = extract_field(str, ';');
+        auto table = extract_field(step_str, ':');
+        auto access_type = extract_field(step_str, ':');
+        auto key = extract_field(step_str, ':');
+        auto rows = str2num<uint64_t>(step_str);
+        if (table.empty() or not rows) {
+            return std::nullopt;
+        }
+        res.steps.push_back({table.to_string(), access_type.to_string(), key.to_string(), *rows});
+    }
+    return res;
+}
+
+vector<string> plan_regressions(const QueryPlan& baseline, const QueryPlan& plan) {
+    STACK_UNWINDING_MARK;
+
+    auto tables = [](const QueryPlan& p) {
+        string res;
+        for (auto const& step : p.steps) {
+            back_insert(res, (res.empty() ? "" : ","), step.table);
+        }
+        return res;
+    };
+    if (tables(baseline) != tables(plan)) {
+        return {concat_tostr("join order changed: ", tables(baseline), " -> ", tables(plan))};
+    }
+
+    vector<string> res;
+    for (size_t i = 0; i < plan.steps.size(); ++i) {
+        auto const& old_step = baseline.steps[i];
+        auto const& new_step = plan.steps[i];
+        if (new_step.key != old_step.key) {
+            res.emplace_back(concat_tostr(
+                new_step.table,
+                ": index changed: ",
+                (old_step.key.empty() ? "none" : old_step.key),
+                " -> ",
+                (new_step.key.empty() ? "none" : new_step.key)
+            ));
+        }
+        auto old_cost = access_type_cost(old_step.access_type);
+        auto new_cost = access_type_cost(new_step.access_type);
+        if (old_cost and new_cost and *new_cost > *old_cost) {
+            res.emplace_back(concat_tostr(
+                new_step.table,
+                ": access type changed: ",
+                old_step.access_type,
+                " -> ",
+                new_step.access_type
+            ));
+        }
+        auto max_expected_rows =
+            std::max(old_step.rows, ROWS_ESTIMATE_MIN) * ROWS_ESTIMATE_GROWTH_FACTOR;
+        if (new_step.rows > max_expected_rows) {
+            res.emplace_back(concat_tostr(
+                new_step.table,
+                ": estimated rows grew: ",
+                old_step.rows,
+                " -> ",
+                new_step.rows
+            ));
+        }
+    }
+    return res;
+}
+
+string dump_results(const QueryResults& results) {
+    STACK_UNWINDING_MARK;
+
+    string res;
+    for (auto const& [name, result] : results) {
+        back_insert(res, name, ' ', result.median_us, ' ', result.plan.dump(), '\n');
+    }
+    return res;
+}
+
+QueryResults parse_results(StringView str) {
+    STACK_UNWINDING_MARK;
+
+    QueryResults res;
+    while (not str.empty()) {
+        auto line = extract_field(str, '\n');
+        auto name = extract_field(line, ' ');
+        auto median_us = str2num<int64_t>(extract_field(line, ' '));
+        auto plan = QueryPlan::parse(line);
+        if (name.empty() or not median_us or not plan) {
+            continue;
+        }
+        res[name.to_string()] = {std::move(*plan), *median_us};
+    }
+    return res;
+}
+
+} // namespace db_bench
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <simlib/string_view.hh>
+#include <string>
+#include <vector>
+
+namespace db_bench {
+
+// One row of the EXPLAIN output
+struct PlanStep {
+    std::string table;
+    std::string access_type; // e.g. "ref", "range", "ALL"
+    std::string key; // Empty if no index is used
+    uint64_t rows; // Estimated number of the examined rows
+};
+
+struct QueryPlan {
+    std::vector<PlanStep> steps; // In the join order
+
+    // Format: "<table>:<access_type>:<key>:<rows>" for every step, separated by ';'
+    [[nodiscard]] std::string dump() const;
+
+    // Returns std::nullopt if @p str is malformed
+    static std::optional<QueryPlan> parse(StringView str);
+};
+
+// Returns the descriptions of the changes of @p plan compared to @p baseline
+// that may make the query slower: a changed join order, a different index, a
+// worse access type or many more estimated rows
+std::vector<std::string> plan_regressions(const QueryPlan& baseline, const QueryPlan& plan);
+
+struct QueryResult {
+    QueryPlan plan;
+    int64_t median_us;
+};
+
+// Query name => result of the query
+using QueryResults = std::map<std::string, QueryResult>;
+
+// Text format: one "<query name> <median_us> <dumped plan>" per line
+std::string dump_results(const QueryResults& results);
+
+// Malformed lines are ignored
+QueryResults parse_results(StringView str);
+
+} // namespace db_bench
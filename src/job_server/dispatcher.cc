@@ -134,6 +134,9 @@ void job_dispatcher(
                 .bind_and_execute(EnumVal(Job::Status::FAILED), job_handler->get_log(), job_id);
         }
 
+    } catch (const sim::judge_node::ConnectionLost&) {
+        // The worker dies and the job gets restarted
+        throw;
     } catch (const std::exception& e) {
         ERRLOG_CATCH(e);
         auto transaction = mysql.start_transaction();
@@ -1,6 +1,10 @@
 #include "add_or_reupload_problem__judge_main_solution_base.hh"
 
+#include <cstdio>
 #include <sim/internal_files/internal_file.hh>
+#include <sim/problems/package_update.hh>
+#include <simlib/errmsg.hh>
+#include <simlib/file_remover.hh>
 #include <simlib/sim/problem_package.hh>
 
 namespace job_server::job_handlers {
@@ -15,13 +19,19 @@ void AddOrReuploadProblemJudgeModelSolutionBase::run() {
     }
 
     // Put the Simfile in the package
-    ZipFile zip(package_path);
-    zip.file_add(
-        concat(sim::zip_package_main_dir(zip), "Simfile"),
-        zip.source_buffer(new_simfile_),
-        ZIP_FL_OVERWRITE
+    auto simfile_path = [&] {
+        ZipFile zip(package_path, ZIP_RDONLY);
+        return concat_tostr(sim::zip_package_main_dir(zip), "Simfile");
+    }();
+    auto new_package_path = concat_tostr(package_path, ".new");
+    FileRemover new_package_remover(new_package_path);
+    sim::problems::copy_package_with_changes(
+        package_path, new_package_path, {{std::move(simfile_path), new_simfile_}}
     );
-    zip.close();
+    if (rename(new_package_path.c_str(), package_path.to_cstr().data())) {
+        THROW("rename()", errmsg());
+    }
+    new_package_remover.cancel();
 
     bool canceled = false;
     job_done(canceled);
@@ -4,6 +4,7 @@
 #include <sim/jobs/job.hh>
 #include <sim/judging_config.hh>
 #include <sim/problems/problem.hh>
+#include <sim/problems/statement_cache.hh>
 #include <sim/submissions/submission.hh>
 #include <simlib/libzip.hh>
 #include <simlib/sim/problem_package.hh>
@@ -100,28 +101,18 @@ void AddOrReuploadProblemBase::build_package() {
     // Update job record
     mysql.prepare("UPDATE jobs SET tmp_file_id=? WHERE id=?")
         .bind_and_execute(tmp_file_id_.value(), job_id_);
-    auto tmp_package = sim::internal_files::path_of(tmp_file_id_.value());
-    // Copy source_package to tmp_package, substituting Simfile in the fly
-    {
-        ZipFile src_zip(source_package, ZIP_RDONLY);
-        simfile_str_ = cr.simfile.dump();
-        auto simfile_path = concat(cr.pkg_main_dir, "Simfile");
-
-        package_file_remover_.reset(tmp_package);
-        ZipFile dest_zip(tmp_package, ZIP_CREATE | ZIP_TRUNCATE);
-
-        auto eno = src_zip.entries_no();
-        for (decltype(eno) i = 0; i < eno; ++i) {
-            auto entry_name = src_zip.get_name(i);
-            if (entry_name == simfile_path) {
-                dest_zip.file_add(simfile_path, dest_zip.source_buffer(simfile_str_));
-            } else {
-                dest_zip.file_add(entry_name, dest_zip.source_zip(src_zip, i));
-            }
-        }
-
-        dest_zip.close(); // Write all data to the dest_zip
-    }
+    auto tmp_package = sim::internal_files::path_of_new_file(tmp_file_id_.value());
+    // Copy source_package to tmp_package, substituting Simfile in the fly. The
+    // source package is uploaded by the user, so it is rewritten rather than
+    // reused, leaving out whatever data no entry references.
+    simfile_str_ = cr.simfile.dump();
+    package_file_remover_.reset(tmp_package);
+    sim::problems::copy_package_with_changes(
+        source_package,
+        tmp_package,
+        {{concat_tostr(cr.pkg_main_dir, "Simfile"), simfile_str_}},
+        sim::problems::PackageCopyMode::REWRITE
+    );
 
     switch (cr.status) {
     case sim::Conver::Status::COMPLETE: need_main_solution_judge_report_ = false; return;
@@ -260,6 +251,18 @@ void AddOrReuploadProblemBase::replace_problem_in_db() {
 
     open_package();
 
+    {
+        auto stmt = mysql.prepare("SELECT file_id FROM problems WHERE id=?");
+        stmt.bind_and_execute(problem_id_.value());
+        uint64_t old_file_id = 0;
+        stmt.res_bind_all(old_file_id);
+        if (stmt.next()) {
+            // The old package is deleted later, but its statement will not be
+            // viewed anymore
+            sim::problems::remove_extracted_statement(old_file_id);
+        }
+    }
+
     // Add job to delete old problem file
     mysql
         .prepare("INSERT INTO jobs(file_id, creator, type, priority, status,"
@@ -353,9 +356,11 @@ void AddOrReuploadProblemBase::submit_solutions() {
         // Save the submission source code
         zip_.extract_to_file(
             zip_.get_index(concat(main_dir_, solution)),
-            sim::internal_files::path_of(file_id),
+            sim::internal_files::path_of_new_file(file_id),
             S_0600
         );
+        // Reuploading a problem submits the same solutions again
+        sim::internal_files::deduplicate(file_id);
     }
 
     // Add jobs to judge the solutions
@@ -1,6 +1,9 @@
 #include "../main.hh"
 #include "change_problem_statement.hh"
 
+#include <sim/problems/package_update.hh>
+#include <sim/problems/statement_cache.hh>
+#include <simlib/file_contents.hh>
 #include <simlib/macros/wont_throw.hh>
 #include <simlib/path.hh>
 #include <simlib/sim/problem_package.hh>
@@ -36,7 +39,7 @@ void ChangeProblemStatement::run() {
     mysql.prepare("INSERT INTO internal_files (created_at) VALUES(?)")
         .bind_and_execute(mysql_date());
     uint64_t new_file_id = mysql.insert_id();
-    auto new_pkg_path = sim::internal_files::path_of(new_file_id);
+    auto new_pkg_path = sim::internal_files::path_of_new_file(new_file_id);
 
     // Replace old statement with new statement
 
@@ -59,25 +62,17 @@ void ChangeProblemStatement::run() {
     simfile.statement = info_.new_statement_path;
     auto simfile_str = simfile.dump();
 
-    FileRemover new_pkg_remover(new_pkg_path);
-    ZipFile dest_zip(new_pkg_path, ZIP_CREATE | ZIP_TRUNCATE);
-
-    auto eno = src_zip.entries_no();
-    for (decltype(eno) i = 0; i < eno; ++i) {
-        auto entry_name = src_zip.get_name(i);
-        if (entry_name == simfile_path) {
-            dest_zip.file_add(simfile_path, dest_zip.source_buffer(simfile_str));
-        } else if (entry_name != old_statement_path) {
-            dest_zip.file_add(entry_name, dest_zip.source_zip(src_zip, i));
-        }
-    }
+    src_zip.close();
 
-    // Add new statement file entry
-    dest_zip.file_add(
-        new_statement_path, dest_zip.source_file(sim::internal_files::path_of(job_file_id_))
-    );
+    sim::problems::PackageChanges changes;
+    changes[old_statement_path.to_string()] = std::nullopt;
+    // Overrides the removal if the paths are equal
+    changes[new_statement_path.to_string()] =
+        get_file_contents(sim::internal_files::path_of(job_file_id_));
+    changes[simfile_path.to_string()] = simfile_str;
 
-    dest_zip.close(); // Write all data to the dest_zip
+    FileRemover new_pkg_remover(new_pkg_path);
+    sim::problems::copy_package_with_changes(pkg_path, new_pkg_path, changes);
 
     const auto current_date = mysql_date();
     // Add job to delete old problem file
@@ -104,6 +99,7 @@ void ChangeProblemStatement::run() {
 
     transaction.commit();
     new_pkg_remover.cancel();
+    sim::problems::remove_extracted_statement(problem_file_id);
 }
 
 } // namespace job_server::job_handlers
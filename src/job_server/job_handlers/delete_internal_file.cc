@@ -2,6 +2,7 @@
 #include "delete_internal_file.hh"
 
 #include <sim/internal_files/internal_file.hh>
+#include <sim/problems/statement_cache.hh>
 
 namespace job_server::job_handlers {
 
@@ -9,7 +10,8 @@ void DeleteInternalFile::run() {
     STACK_UNWINDING_MARK;
 
     job_log("Internal file ID: ", internal_file_id_);
-    (void)unlink(sim::internal_files::path_of(internal_file_id_));
+    sim::internal_files::remove(internal_file_id_);
+    sim::problems::remove_extracted_statement(internal_file_id_);
 
     auto transaction = mysql.start_transaction();
     // The internal_file may already be deleted
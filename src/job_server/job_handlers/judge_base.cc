@@ -1,3 +1,4 @@
+#include "../metrics.hh"
 #include "judge_base.hh"
 
 #include <optional>
@@ -8,14 +9,27 @@
 
 using sim::submissions::Submission;
 
+namespace {
+
+struct ThreadJudgeWorker {
+    sim::JudgeWorker jworker{{
+        .checker_time_limit = sim::CHECKER_TIME_LIMIT,
+        .checker_memory_limit_in_bytes = sim::CHECKER_MEMORY_LIMIT,
+        .score_cut_lambda = sim::SCORE_CUT_LAMBDA,
+    }};
+    // Set iff jworker holds the unmodified package with this file id
+    std::optional<uint64_t> loaded_package_file_id;
+    bool checker_is_compiled = false;
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+thread_local ThreadJudgeWorker thread_judge_worker;
+
+} // namespace
+
 namespace job_server::job_handlers {
 
-JudgeBase::JudgeBase()
-: jworker_{{
-      .checker_time_limit = sim::CHECKER_TIME_LIMIT,
-      .checker_memory_limit_in_bytes = sim::CHECKER_MEMORY_LIMIT,
-      .score_cut_lambda = sim::SCORE_CUT_LAMBDA,
-  }} {}
+JudgeBase::JudgeBase() : jworker_{thread_judge_worker.jworker} {}
 
 sim::SolutionLanguage JudgeBase::to_sol_lang(Submission::Language lang) {
     STACK_UNWINDING_MARK;
@@ -33,128 +47,6 @@ sim::SolutionLanguage JudgeBase::to_sol_lang(Submission::Language lang) {
     THROW("Invalid Language: ", (int)EnumVal(lang).to_int());
 }
 
-InplaceBuff<65536> JudgeBase::construct_report(const sim::JudgeReport& jr, bool /*final*/) {
-    STACK_UNWINDING_MARK;
-
-    using sim::JudgeReport;
-
-    InplaceBuff<65536> report;
-    if (jr.groups.empty()) {
-        return report;
-    }
-
-    // clang-format off
-    report.append("<table class=\"table\">"
-                      "<thead>"
-                          "<tr>"
-                              "<th class=\"test\">Test</th>"
-                              "<th class=\"result\">Result</th>"
-                              "<th class=\"time\">Time [s]</th>"
-                              "<th class=\"memory\">Memory [KiB]</th>"
-                              "<th class=\"points\">Score</th>"
-                          "</tr>"
-                      "</thead>"
-                      "<tbody>");
-    // clang-format on
-
-    auto append_normal_columns = [&](const JudgeReport::Test& test) {
-        STACK_UNWINDING_MARK;
-
-        auto as_td_string = [](JudgeReport::Test::Status s) {
-            switch (s) {
-            case JudgeReport::Test::OK: return "<td class=\"status green\">OK</td>";
-            case JudgeReport::Test::WA: return "<td class=\"status red\">Wrong answer</td>";
-            case JudgeReport::Test::TLE:
-                return "<td class=\"status yellow\">Time limit exceeded</td>";
-            case JudgeReport::Test::MLE:
-                return "<td class=\"status yellow\">Memory limit exceeded</td>";
-            case JudgeReport::Test::OLE:
-                return "<td class=\"status yellow\">Output size limit exceeded</td>";
-            case JudgeReport::Test::RTE:
-                return "<td class=\"status intense-red\">Runtime error</td>";
-            case JudgeReport::Test::CHECKER_ERROR:
-                return "<td class=\"status blue\">Checker error</td>";
-            case JudgeReport::Test::SKIPPED: return "<td class=\"status\">Pending</td>";
-            }
-
-            throw_assert(false); // We shouldn't get here
-        };
-
-        report.append("<td>", html_escape(test.name), "</td>", as_td_string(test.status), "<td>");
-
-        if (test.status == JudgeReport::Test::SKIPPED) {
-            report.append('?');
-        } else {
-            report.append(to_string(floor_to_10ms(test.runtime), false));
-        }
-
-        report.append(" / ", to_string(floor_to_10ms(test.time_limit), false), "</td><td>");
-
-        if (test.status == JudgeReport::Test::SKIPPED) {
-            report.append('?');
-        } else {
-            report.append(test.memory_consumed >> 10);
-        }
-
-        report.append(" / ", test.memory_limit >> 10, "</td>");
-    };
-
-    bool there_are_comments = false;
-    for (auto&& group : jr.groups) {
-        throw_assert(!group.tests.empty());
-        // First row
-        report.append("<tr>");
-        append_normal_columns(group.tests[0]);
-        report.append(
-            R"(<td class="groupscore" rowspan=")",
-            group.tests.size(),
-            "\">",
-            group.score,
-            " / ",
-            group.max_score,
-            "</td></tr>"
-        );
-        // Other rows
-        std::for_each(
-            group.tests.begin() + 1,
-            group.tests.end(),
-            [&](const JudgeReport::Test& test) {
-                report.append("<tr>");
-                append_normal_columns(test);
-                report.append("</tr>");
-            }
-        );
-
-        for (auto&& test : group.tests) {
-            there_are_comments |= !test.comment.empty();
-        }
-    }
-
-    report.append("</tbody></table>");
-
-    // Tests comments
-    if (there_are_comments) {
-        report.append("<ul class=\"tests-comments\">");
-        for (auto&& group : jr.groups) {
-            for (auto&& test : group.tests) {
-                if (!test.comment.empty()) {
-                    report.append(
-                        "<li><span class=\"test-id\">",
-                        html_escape(test.name),
-                        "</span>",
-                        html_escape(test.comment),
-                        "</li>"
-                    );
-                }
-            }
-        }
-
-        report.append("</ul>");
-    }
-
-    return report;
-}
-
 Submission::Status JudgeBase::calc_status(const sim::JudgeReport& jr) {
     STACK_UNWINDING_MARK;
     using sim::JudgeReport;
@@ -187,16 +79,31 @@ Submission::Status JudgeBase::calc_status(const sim::JudgeReport& jr) {
     return Submission::Status::OK;
 }
 
-void JudgeBase::load_problem_package(FilePath problem_pkg_path) {
+void JudgeBase::load_problem_package(
+    FilePath problem_pkg_path, std::optional<uint64_t> package_file_id
+) {
     STACK_UNWINDING_MARK;
     if (failed()) {
         return;
     }
 
-    auto tmplog = job_log("Loading problem package...");
+    auto& tjw = thread_judge_worker;
+    if (package_file_id.has_value() and tjw.loaded_package_file_id == package_file_id) {
+        job_log("Problem package is already loaded (warm start)");
+        return;
+    }
+
+    tjw.loaded_package_file_id = std::nullopt;
+    tjw.checker_is_compiled = false;
+
+    auto tmplog = job_log("Loading problem package (cold start)...");
     tmplog.flush_no_nl();
-    jworker_.load_package(problem_pkg_path, std::nullopt);
+    {
+        metrics::JudgeStageTimer timer{metrics::JudgeStage::PACKAGE_LOAD};
+        jworker_.load_package(problem_pkg_path, std::nullopt);
+    }
     tmplog(" done.");
+    tjw.loaded_package_file_id = package_file_id;
 }
 
 template <class MethodPtr>
@@ -211,6 +118,7 @@ std::optional<std::string> JudgeBase::compile_solution_impl(
     auto tmplog = job_log("Compiling solution...");
     tmplog.flush_no_nl();
 
+    metrics::JudgeStageTimer timer{metrics::JudgeStage::SOLUTION_COMPILATION};
     std::string compilation_errors;
     if ((jworker_.*compile_method)(
             solution_path,
@@ -252,9 +160,16 @@ std::optional<std::string> JudgeBase::compile_checker() {
         return std::nullopt;
     }
 
+    auto& tjw = thread_judge_worker;
+    if (tjw.checker_is_compiled) {
+        job_log("Checker is already compiled");
+        return std::nullopt;
+    }
+
     auto tmplog = job_log("Compiling checker...");
     tmplog.flush_no_nl();
 
+    metrics::JudgeStageTimer timer{metrics::JudgeStage::CHECKER_COMPILATION};
     std::string compilation_errors;
     if (jworker_.compile_checker(
             sim::SOLUTION_COMPILATION_TIME_LIMIT,
@@ -268,6 +183,7 @@ std::optional<std::string> JudgeBase::compile_checker() {
     }
 
     tmplog(" done.");
+    tjw.checker_is_compiled = tjw.loaded_package_file_id.has_value();
     return std::nullopt;
 }
 
@@ -9,19 +9,24 @@ namespace job_server::job_handlers {
 
 class JudgeBase : virtual public JobHandler {
 protected:
-    sim::JudgeWorker jworker_;
+    // JudgeWorker of the current thread; it is reused by the consecutive jobs,
+    // so that the loaded package and the compiled checker may be reused too
+    sim::JudgeWorker& jworker_;
 
     JudgeBase();
 
     static sim::SolutionLanguage to_sol_lang(sim::submissions::Submission::Language lang);
 
-    // Creates an xml report from JudgeReport
-    static InplaceBuff<65536> construct_report(const sim::JudgeReport& jr, bool final);
-
     // Returns OK or the first encountered error status
     static sim::submissions::Submission::Status calc_status(const sim::JudgeReport& jr);
 
-    void load_problem_package(FilePath problem_pkg_path);
+    // If @p package_file_id is set and the package is already loaded by
+    // jworker_ (warm start) loading is skipped. Otherwise, the package is loaded
+    // (cold start) and if @p package_file_id is not set it will not be reused.
+    // Pass std::nullopt if jworker_.simfile() is going to be modified.
+    void load_problem_package(
+        FilePath problem_pkg_path, std::optional<uint64_t> package_file_id = std::nullopt
+    );
 
 private:
     // Iff compilation failed, compilation errors are returned
@@ -38,6 +43,7 @@ protected:
     std::optional<std::string>
     compile_solution_from_problem_package(FilePath solution_path, sim::SolutionLanguage lang);
 
+    // Does nothing if the checker of the reused package is already compiled
     std::optional<std::string> compile_checker();
 };
 
@@ -1,13 +1,143 @@
 #include "../main.hh"
+#include "../metrics.hh"
 #include "judge_or_rejudge.hh"
 
+#include <sim/internal_files/internal_file.hh>
+#include <sim/jobs/utils.hh>
+#include <sim/judge_node/protocol.hh>
+#include <sim/submissions/report.hh>
 #include <sim/submissions/submission.hh>
 #include <sim/submissions/update_final.hh>
-
+#include <simlib/call_in_destructor.hh>
+#include <simlib/file_contents.hh>
+#include <simlib/file_descriptor.hh>
+#include <sys/stat.h>
+#include <thread>
+
+using sim::jobs::append_dumped;
+using sim::jobs::extract_dumped_int;
+using sim::jobs::extract_dumped_string;
+using sim::judge_node::CompilationStage;
+using sim::judge_node::MessageType;
 using sim::submissions::Submission;
 
+namespace {
+
+// Returns the payload of the FILE_CHUNK message with the part of the file
+// @p path that begins at @p offset
+std::string file_chunk(FilePath path, uint64_t offset) {
+    STACK_UNWINDING_MARK;
+
+    FileDescriptor fd{path, O_RDONLY | O_CLOEXEC};
+    if (not fd.is_open()) {
+        THROW("open()", errmsg());
+    }
+    struct stat64 st = {};
+    if (fstat64(fd, &st)) {
+        THROW("fstat()", errmsg());
+    }
+
+    auto file_size = static_cast<uint64_t>(st.st_size);
+    offset = std::min(offset, file_size);
+    auto len = std::min(file_size - offset, sim::judge_node::FILE_CHUNK_MAX_SIZE);
+
+    std::string chunk;
+    append_dumped(chunk, file_size);
+    auto data_pos = chunk.size();
+    chunk.resize(data_pos + len);
+    for (uint64_t pos = 0; pos < len;) {
+        auto rc = pread64(fd, chunk.data() + data_pos + pos, len - pos, offset + pos);
+        if (rc < 0 and errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            THROW("pread()", errmsg());
+        }
+        pos += static_cast<uint64_t>(rc);
+    }
+    return chunk;
+}
+
+// New contents of a report column of a submission
+struct ReportUpdate {
+    std::string data;
+    bool is_appended;
+
+    // @p report replaces the stored one
+    static ReportUpdate replace(std::string report) { return {std::move(report), false}; }
+
+    // @p records are appended to the stored report (see sim/submissions/report.hh)
+    static ReportUpdate append(std::string records) { return {std::move(records), true}; }
+
+    // The stored report is left unchanged
+    static ReportUpdate keep() { return {"", true}; }
+
+    [[nodiscard]] std::string assignment_sql(StringView column) const {
+        return (is_appended ? concat_tostr(column, "=CONCAT(", column, ", ?)")
+                            : concat_tostr(column, "=?"));
+    }
+};
+
+} // namespace
+
 namespace job_server::job_handlers {
 
+void JudgeOrRejudge::log_judge_reports_problems(
+    uint64_t problem_id, const sim::JudgeReport& initial_jrep, const sim::JudgeReport& final_jrep
+) {
+    STACK_UNWINDING_MARK;
+
+    // Log checker errors
+    for (auto&& rep : {initial_jrep, final_jrep}) {
+        for (auto&& group : rep.groups) {
+            for (auto&& test : group.tests) {
+                if (test.status == sim::JudgeReport::Test::CHECKER_ERROR) {
+                    errlog(
+                        "Checker error: submission ",
+                        submission_id_,
+                        " (problem id: ",
+                        problem_id,
+                        ") test `",
+                        test.name,
+                        '`'
+                    );
+                }
+            }
+        }
+    }
+
+    // Log syscall problems (to errlog)
+    for (auto&& rep : {initial_jrep, final_jrep}) {
+        for (auto&& group : rep.groups) {
+            for (auto&& test : group.tests) {
+                if (has_one_of_prefixes(
+                        test.comment,
+                        "Runtime error (Error: ",
+                        "Runtime error (failed to get syscall",
+                        "Runtime error (forbidden syscall"
+                    ))
+                {
+                    errlog(
+                        "Submission ",
+                        submission_id_,
+                        " (problem ",
+                        problem_id,
+                        "): ",
+                        test.name,
+                        " -> ",
+                        test.comment
+                    );
+                }
+            }
+        }
+    }
+}
+
+void JudgeOrRejudge::record_judging_time() {
+    STACK_UNWINDING_MARK;
+    judge_cost_estimator.record(problem_id_, std::chrono::steady_clock::now() - judging_began_at_);
+}
+
 void JudgeOrRejudge::run() {
     STACK_UNWINDING_MARK;
 
@@ -58,15 +188,24 @@ void JudgeOrRejudge::run() {
     }
 
     std::string judging_began = mysql_date();
+    problem_id_ = problem_id;
+    judging_began_at_ = std::chrono::steady_clock::now();
 
     job_log("Judging submission ", submission_id_, " (problem: ", problem_id, ')');
-    load_problem_package(sim::internal_files::path_of(problem_file_id));
 
+    // Judging stages do not include the time of updating the database
+    std::chrono::nanoseconds db_update_time{0};
     auto update_submission = [&](decltype(Submission::initial_status) initial_status,
                                  decltype(Submission::full_status) full_status,
                                  std::optional<int64_t> score,
-                                 auto&& initial_report,
-                                 auto&& final_report) {
+                                 const ReportUpdate& initial_report,
+                                 const ReportUpdate& final_report) {
+        auto beg = std::chrono::steady_clock::now();
+        CallInDtor record_db_update_time{[&] {
+            auto duration = std::chrono::steady_clock::now() - beg;
+            db_update_time += duration;
+            metrics::record_judge_stage(metrics::JudgeStage::DB_UPDATE, duration);
+        }};
         {
             auto transaction = mysql.start_transaction();
             sim::submissions::update_final_lock(mysql, sowner, problem_id);
@@ -82,11 +221,15 @@ void JudgeOrRejudge::run() {
             }
 
             // Update submission
-            stmt = mysql.prepare("UPDATE submissions "
-                                 "SET final_candidate=?, initial_status=?,"
-                                 " full_status=?, score=?, last_judgment=?,"
-                                 " initial_report=?, final_report=? "
-                                 "WHERE id=?");
+            stmt = mysql.prepare(
+                "UPDATE submissions "
+                "SET final_candidate=?, initial_status=?,"
+                " full_status=?, score=?, last_judgment=?, ",
+                initial_report.assignment_sql("initial_report"),
+                ", ",
+                final_report.assignment_sql("final_report"),
+                " WHERE id=?"
+            );
 
             if (is_fatal(full_status)) {
                 stmt.bind_and_execute(
@@ -95,8 +238,8 @@ void JudgeOrRejudge::run() {
                     full_status,
                     nullptr,
                     judging_began,
-                    initial_report,
-                    final_report,
+                    initial_report.data,
+                    final_report.data,
                     submission_id_
                 );
             } else {
@@ -106,8 +249,8 @@ void JudgeOrRejudge::run() {
                     full_status,
                     score,
                     judging_began,
-                    initial_report,
-                    final_report,
+                    initial_report.data,
+                    final_report.data,
                     submission_id_
                 );
             }
@@ -118,54 +261,26 @@ void JudgeOrRejudge::run() {
         }
     };
 
-    auto compilation_errors =
-        compile_solution(sim::internal_files::path_of(submission_file_id), to_sol_lang(lang));
-    if (compilation_errors.has_value()) {
-        update_submission(
-            Submission::Status::COMPILATION_ERROR,
-            Submission::Status::COMPILATION_ERROR,
-            std::nullopt,
-            concat(
-                "<pre class=\"compilation-errors\">",
-                html_escape(compilation_errors.value()),
-                "</pre>"
-            ),
-            ""
-        );
-
-        return job_done();
-    }
-
-    // Compile checker
-    compilation_errors = compile_checker();
-    if (compilation_errors.has_value()) {
-        errlog(
-            "Job ",
-            job_id_,
-            " (submission ",
-            submission_id_,
-            ", problem ",
-            problem_id,
-            "): Checker compilation failed"
-        );
-        update_submission(
-            Submission::Status::CHECKER_COMPILATION_ERROR,
-            Submission::Status::CHECKER_COMPILATION_ERROR,
-            std::nullopt,
-            "",
-            ""
-        );
-
-        return job_done();
-    }
-
     auto send_judge_report = [&,
                               initial_status = Submission::Status::OK,
-                              initial_report = InplaceBuff<1 << 16>(),
-                              initial_score = static_cast<int64_t>(0)](
+                              initial_score = static_cast<int64_t>(0),
+                              stored_initial_jrep = std::optional<sim::JudgeReport>(),
+                              stored_final_jrep = std::optional<sim::JudgeReport>()](
                                  const sim::JudgeReport& jreport, bool final, bool partial
                              ) mutable {
-        auto rep = construct_report(jreport, final);
+        // Partial reports are appended to the stored one, the complete report
+        // replaces it (in the compacted form)
+        auto& stored_jrep = (final ? stored_final_jrep : stored_initial_jrep);
+        std::optional<std::string> appended_records;
+        if (partial and stored_jrep) {
+            appended_records = sim::submissions::dump_report_update(*stored_jrep, jreport);
+        }
+        auto rep =
+            (appended_records ? ReportUpdate::append(std::move(*appended_records))
+                              : ReportUpdate::replace(sim::submissions::dump_report(jreport)));
+        stored_jrep.emplace();
+        stored_jrep->groups = jreport.groups;
+
         auto status = calc_status(jreport);
         // Count score
         int64_t score = 0;
@@ -195,10 +310,11 @@ void JudgeOrRejudge::run() {
         }
 
         if (not final) {
-            initial_report = rep;
             initial_status = status;
             initial_score = score;
-            return update_submission(status, Submission::Status::PENDING, std::nullopt, rep, "");
+            return update_submission(
+                status, Submission::Status::PENDING, std::nullopt, rep, ReportUpdate::replace("")
+            );
         }
 
         // Final
@@ -209,82 +325,190 @@ void JudgeOrRejudge::run() {
             status = initial_status;
         }
 
-        update_submission(initial_status, status, score, initial_report, rep);
+        update_submission(initial_status, status, score, ReportUpdate::keep(), rep);
     };
 
-    try {
-        // Judge
-        sim::VerboseJudgeLogger logger(true);
+    auto judge_error = [&](StringView error_description) {
+        job_log("Judge error.");
+        job_log("Caught exception -> ", error_description);
+
+        update_submission(
+            Submission::Status::JUDGE_ERROR,
+            Submission::Status::JUDGE_ERROR,
+            std::nullopt,
+            ReportUpdate::replace(""),
+            ReportUpdate::replace("")
+        );
+    };
 
-        sim::JudgeReport initial_jrep =
-            jworker_.judge(false, logger, [&](const sim::JudgeReport& partial) {
-                send_judge_report(partial, false, true);
-            });
-        send_judge_report(initial_jrep, false, false);
-
-        sim::JudgeReport final_jrep =
-            jworker_.judge(true, logger, [&](const sim::JudgeReport& partial) {
-                send_judge_report(partial, true, true);
-            });
-        send_judge_report(final_jrep, true, false);
-
-        // Log checker errors
-        for (auto&& rep : {initial_jrep, final_jrep}) {
-            for (auto&& group : rep.groups) {
-                for (auto&& test : group.tests) {
-                    if (test.status == sim::JudgeReport::Test::CHECKER_ERROR) {
-                        errlog(
-                            "Checker error: submission ",
-                            submission_id_,
-                            " (problem id: ",
-                            problem_id,
-                            ") test `",
-                            test.name,
-                            '`'
-                        );
-                    }
+    auto solution_compilation_failed = [&](StringView compilation_errors) {
+        update_submission(
+            Submission::Status::COMPILATION_ERROR,
+            Submission::Status::COMPILATION_ERROR,
+            std::nullopt,
+            ReportUpdate::replace(sim::submissions::dump_compilation_errors(compilation_errors)),
+            ReportUpdate::replace("")
+        );
+    };
+
+    auto checker_compilation_failed = [&] {
+        errlog(
+            "Job ",
+            job_id_,
+            " (submission ",
+            submission_id_,
+            ", problem ",
+            problem_id,
+            "): Checker compilation failed"
+        );
+        update_submission(
+            Submission::Status::CHECKER_COMPILATION_ERROR,
+            Submission::Status::CHECKER_COMPILATION_ERROR,
+            std::nullopt,
+            ReportUpdate::replace(""),
+            ReportUpdate::replace("")
+        );
+    };
+
+    if (stub_judge_time) {
+        // Only the load of the database matches the real judging
+        job_log("Stub judge: the submission is not judged");
+        std::this_thread::sleep_for(*stub_judge_time);
+        update_submission(
+            Submission::Status::OK,
+            Submission::Status::OK,
+            0,
+            ReportUpdate::replace(""),
+            ReportUpdate::replace("")
+        );
+        return job_done();
+    }
+
+    if (judge_node) {
+        // The judge node does the judging, the job server only serves the
+        // problem package and records the results
+        job_log("Judging on the judge node ", judge_node->name);
+        auto& conn = judge_node->conn;
+        std::string judge_msg;
+        append_dumped(judge_msg, job_id_);
+        append_dumped(judge_msg, problem_file_id);
+        append_dumped(judge_msg, static_cast<uint8_t>(to_sol_lang(lang)));
+        append_dumped(
+            judge_msg, get_file_contents(sim::internal_files::path_of(submission_file_id))
+        );
+        conn.send(MessageType::JUDGE, judge_msg);
+
+        std::optional<sim::JudgeReport> initial_jrep;
+        std::optional<sim::JudgeReport> final_jrep;
+        for (;;) {
+            auto msg = conn.receive();
+            StringView data = msg.payload;
+            switch (msg.type) {
+            case MessageType::FETCH_FILE: {
+                auto file_id = extract_dumped_int<uint64_t>(data);
+                auto offset = extract_dumped_int<uint64_t>(data);
+                if (file_id != problem_file_id) {
+                    throw sim::judge_node::ConnectionLost(concat_tostr(
+                        "Judge node requested file ", file_id, " that is unrelated to the job"
+                    ));
                 }
+                conn.send(
+                    MessageType::FILE_CHUNK,
+                    file_chunk(sim::internal_files::path_of(file_id), offset)
+                );
+                continue;
             }
-        }
-
-        // Log syscall problems (to errlog)
-        for (auto&& rep : {initial_jrep, final_jrep}) {
-            for (auto&& group : rep.groups) {
-                for (auto&& test : group.tests) {
-                    if (has_one_of_prefixes(
-                            test.comment,
-                            "Runtime error (Error: ",
-                            "Runtime error (failed to get syscall",
-                            "Runtime error (forbidden syscall"
-                        ))
-                    {
-                        errlog(
-                            "Submission ",
-                            submission_id_,
-                            " (problem ",
-                            problem_id,
-                            "): ",
-                            test.name,
-                            " -> ",
-                            test.comment
-                        );
-                    }
+            case MessageType::LOG: job_log(data); continue;
+            case MessageType::COMPILATION_FAILED: {
+                auto stage = static_cast<CompilationStage>(extract_dumped_int<uint8_t>(data));
+                if (stage == CompilationStage::SOLUTION) {
+                    solution_compilation_failed(extract_dumped_string(data));
+                } else {
+                    checker_compilation_failed();
+                }
+                return job_done();
+            }
+            case MessageType::JUDGE_REPORT: {
+                auto final = extract_dumped_int<uint8_t>(data) != 0;
+                auto partial = extract_dumped_int<uint8_t>(data) != 0;
+                auto jrep = sim::judge_node::extract_dumped_judge_report(data);
+                send_judge_report(jrep, final, partial);
+                if (not partial) {
+                    (final ? final_jrep : initial_jrep) = std::move(jrep);
                 }
+                continue;
+            }
+            case MessageType::JUDGE_ERROR: {
+                errlog("Judge node ", judge_node->name, ": judge error: ", data);
+                judge_error(data);
+                return job_done();
             }
+            case MessageType::JUDGING_DONE: {
+                if (not initial_jrep or not final_jrep) {
+                    throw sim::judge_node::ConnectionLost(
+                        "Judge node finished judging without sending the judge reports"
+                    );
+                }
+                log_judge_reports_problems(problem_id, *initial_jrep, *final_jrep);
+                record_judging_time();
+                return job_done();
+            }
+            case MessageType::HELLO:
+            case MessageType::JUDGE:
+            case MessageType::FILE_CHUNK: break;
+            }
+            // The connection cannot be trusted any more
+            throw sim::judge_node::ConnectionLost(concat_tostr(
+                "Unexpected message from the judge node: ", static_cast<int>(msg.type)
+            ));
         }
+    }
 
+    load_problem_package(sim::internal_files::path_of(problem_file_id), problem_file_id);
+
+    auto compilation_errors =
+        compile_solution(sim::internal_files::path_of(submission_file_id), to_sol_lang(lang));
+    if (compilation_errors.has_value()) {
+        solution_compilation_failed(compilation_errors.value());
         return job_done();
+    }
 
-    } catch (const std::exception& e) {
-        ERRLOG_CATCH(e);
+    // Compile checker
+    compilation_errors = compile_checker();
+    if (compilation_errors.has_value()) {
+        checker_compilation_failed();
+        return job_done();
+    }
 
-        job_log("Judge error.");
-        job_log("Caught exception -> ", e.what());
+    try {
+        // Judge
+        sim::VerboseJudgeLogger logger(true);
 
-        update_submission(
-            Submission::Status::JUDGE_ERROR, Submission::Status::JUDGE_ERROR, std::nullopt, "", ""
-        );
+        auto judge = [&](bool final) {
+            auto beg = std::chrono::steady_clock::now();
+            auto db_update_time_before = db_update_time;
+            sim::JudgeReport jrep =
+                jworker_.judge(final, logger, [&](const sim::JudgeReport& partial) {
+                    send_judge_report(partial, final, true);
+                });
+            metrics::record_judge_stage(
+                (final ? metrics::JudgeStage::FINAL_JUDGING : metrics::JudgeStage::INITIAL_JUDGING),
+                std::chrono::steady_clock::now() - beg - (db_update_time - db_update_time_before)
+            );
+            send_judge_report(jrep, final, false);
+            return jrep;
+        };
+
+        sim::JudgeReport initial_jrep = judge(false);
+        sim::JudgeReport final_jrep = judge(true);
+
+        log_judge_reports_problems(problem_id, initial_jrep, final_jrep);
+        record_judging_time();
+        return job_done();
 
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e);
+        judge_error(e.what());
         return job_done();
     }
 }
@@ -2,12 +2,28 @@
 
 #include "judge_base.hh"
 
+#include <chrono>
+
 namespace job_server::job_handlers {
 
 class JudgeOrRejudge final : public JudgeBase {
 private:
     const uint64_t submission_id_;
     const StringView job_creation_time_;
+    // Set once the judging begins
+    uint64_t problem_id_ = 0;
+    std::chrono::steady_clock::time_point judging_began_at_;
+
+    // Logs checker errors and syscall problems (to errlog)
+    void log_judge_reports_problems(
+        uint64_t problem_id,
+        const sim::JudgeReport& initial_jrep,
+        const sim::JudgeReport& final_jrep
+    );
+
+    // Records the judging time in judge_cost_estimator. Only complete
+    // judgings are recorded, as the others take less time than usual.
+    void record_judging_time();
 
 public:
     JudgeOrRejudge(uint64_t job_id, uint64_t submission_id, StringView job_creation_time)
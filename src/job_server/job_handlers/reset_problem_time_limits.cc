@@ -2,6 +2,8 @@
 #include "reset_problem_time_limits.hh"
 
 #include <sim/jobs/job.hh>
+#include <sim/problems/package_update.hh>
+#include <sim/problems/statement_cache.hh>
 #include <simlib/sim/problem_package.hh>
 
 using sim::internal_files::path_of;
@@ -33,27 +35,19 @@ void ResetProblemTimeLimits::run() {
     mysql.prepare("INSERT INTO internal_files (created_at) VALUES(?)")
         .bind_and_execute(mysql_date());
     uint64_t new_file_id = mysql.insert_id();
-    auto new_pkg_path = sim::internal_files::path_of(new_file_id);
+    auto new_pkg_path = sim::internal_files::path_of_new_file(new_file_id);
 
     // Save Simfile to new package file
 
-    ZipFile src_zip(pkg_path, ZIP_RDONLY);
-    auto simfile_path = concat(sim::zip_package_main_dir(src_zip), "Simfile");
+    auto simfile_path = [&] {
+        ZipFile zip(pkg_path, ZIP_RDONLY);
+        return concat_tostr(sim::zip_package_main_dir(zip), "Simfile");
+    }();
 
     FileRemover new_pkg_remover(new_pkg_path);
-    ZipFile dest_zip(new_pkg_path, ZIP_CREATE | ZIP_TRUNCATE);
-
-    auto eno = src_zip.entries_no();
-    for (decltype(eno) i = 0; i < eno; ++i) {
-        auto entry_name = src_zip.get_name(i);
-        if (entry_name == simfile_path) {
-            dest_zip.file_add(simfile_path, dest_zip.source_buffer(new_simfile_));
-        } else {
-            dest_zip.file_add(entry_name, dest_zip.source_zip(src_zip, i));
-        }
-    }
-
-    dest_zip.close(); // Write all data to the dest_zip
+    sim::problems::copy_package_with_changes(
+        pkg_path, new_pkg_path, {{std::move(simfile_path), new_simfile_}}
+    );
 
     const auto current_date = mysql_date();
     // Add job to delete old problem file
@@ -80,6 +74,7 @@ void ResetProblemTimeLimits::run() {
 
     transaction.commit();
     new_pkg_remover.cancel();
+    sim::problems::remove_extracted_statement(problem_file_id);
 }
 
 } // namespace job_server::job_handlers
@@ -0,0 +1,658 @@
+#pragma once
+
+#include "metrics.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <sim/jobs/job_server_metrics.hh>
+#include <simlib/logger.hh>
+#include <simlib/macros/stack_unwinding.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/throw_assert.hh>
+#include <vector>
+
+#if 0
+#define DEBUG_JOB_SERVER(...) __VA_ARGS__
+#else
+#define DEBUG_JOB_SERVER(...)
+#endif
+
+namespace job_server {
+
+/**
+ * @brief Queues of the jobs noticed by the job server, that are waiting for a
+ *   worker. Not thread-safe, it is used only by the job server's main thread.
+ * @details There are three queues: judge jobs, problem management jobs and
+ *   other jobs. Jobs of the first two belong to problems; jobs of a locked
+ *   problem wait until the problem is unlocked.
+ */
+class JobsQueue {
+public:
+    // Time after which a waiting judge job is moved up by one priority level
+    static constexpr int64_t AGING_MS = 5 * 60'000;
+
+    // Judge jobs are divided into lanes; fairness is maintained within each
+    // lane separately and wait times are reported per lane
+    enum class Lane : uint8_t {
+        NONE, // not a judge job
+        JUDGE,
+        REJUDGE,
+        MODEL_SOLUTION,
+    };
+
+    struct Job {
+        uint64_t id{};
+        uint priority{};
+        bool locks_problem = false;
+        // Among the jobs of the same priority, the lower, the earlier the job
+        // is run. Only judge jobs have it set, for other jobs it is 0, so they
+        // are ordered by priority and id.
+        int64_t fair_key = 0;
+        Lane lane = Lane::NONE;
+        int64_t noticed_at_ms = 0; // steady clock
+        int64_t cost_ms = 0; // estimated judging time (judge jobs only)
+        // Set on the judge jobs that have waited for AGING_MS (see age_judge_jobs())
+        bool aged = false;
+
+        // Priority level the job is queued at
+        [[nodiscard]] uint queue_priority() const noexcept { return priority + aged; }
+
+        bool operator<(const Job& x) const {
+            if (queue_priority() != x.queue_priority()) {
+                return queue_priority() > x.queue_priority();
+            }
+            return (fair_key == x.fair_key ? id < x.id : fair_key < x.fair_key);
+        }
+
+        bool operator==(const Job& x) const {
+            return (
+                id == x.id and priority == x.priority and fair_key == x.fair_key and
+                aged == x.aged
+            );
+        }
+
+        static constexpr Job least() noexcept { return {UINT64_MAX, 0, false, INT64_MAX}; }
+    };
+
+private:
+    struct ProblemJobs {
+        uint64_t problem_id{};
+        std::set<Job> jobs;
+    };
+
+    struct ProblemInfo {
+        Job its_best_job;
+        uint locks_no = 0;
+    };
+
+    struct {
+        // Strong assumption: any job must belong to AT MOST one problem
+        std::map<uint64_t, ProblemInfo> problem_info;
+        std::map<Job, ProblemJobs> queue; // (best problem's job => all jobs of the problem)
+        std::map<int64_t, ProblemJobs> locked_problems; // (problem_id  => (locks, problem's jobs))
+    } judge_jobs,
+        problem_management_jobs; // (judge jobs - they need judge machines)
+
+    std::set<Job> other_jobs;
+
+    /**
+     * Fairness of judge jobs: each job gets a virtual finish time. A job starts
+     * (virtually) when it is noticed, but not before the previous job of the
+     * same owner in the same lane finishes, and takes its estimated judging
+     * time (see JudgeCostEstimator) multiplied by the lane's weight. Jobs are
+     * ordered by the virtual finish, so an owner that queued many jobs at once
+     * is served in a round-robin manner with the others instead of blocking
+     * them, and of the jobs noticed at about the same time the cheap ones go
+     * first (which lowers the mean waiting time). The order by the virtual
+     * finish applies only within a priority level: a job of a higher priority
+     * goes before the jobs of lower priorities. A judge job that has waited for
+     * AGING_MS is moved up by one priority level (once), so that a steady
+     * stream of higher priority jobs cannot starve it, but jobs two or more
+     * levels higher still go first.
+     */
+    struct LaneInfo {
+        const char* queue_name; // under which the wait times are recorded
+        int64_t cost_weight;
+        std::map<uint64_t, int64_t> owner_virtual_finish_ms; // owner => time
+        uint64_t waits_since_report = 0;
+    };
+
+    // Indexed by Lane
+    std::array<LaneInfo, 4> lanes{{
+        {"", 0, {}},
+        {"judge_jobs.judge", 1, {}},
+        // Rejudges are mostly mass rejudges of one admin, they are weighted more,
+        // so the admin's next rejudges lag further behind other jobs
+        {"judge_jobs.rejudge", 4, {}},
+        {"judge_jobs.model_solution", 1, {}},
+    }};
+    int64_t last_wait_times_report_ms = steady_now_ms();
+
+    // Judge jobs that are not aged yet, in the order of noticing:
+    // (noticed_at_ms, job id) => (job, problem id)
+    std::map<std::pair<int64_t, uint64_t>, std::pair<Job, uint64_t>> unaged_judge_jobs;
+
+    static int64_t steady_now_ms() noexcept {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()
+        )
+            .count();
+    }
+
+    Job make_judge_job(
+        uint64_t jid, uint priority, bool locks_problem, Lane lane, uint64_t owner, int64_t cost_ms
+    ) {
+        auto now = steady_now_ms();
+        auto& li = lanes[static_cast<size_t>(lane)];
+        // Owners whose jobs virtually finished are not needed anymore
+        if (li.owner_virtual_finish_ms.size() > 4096) {
+            for (auto it = li.owner_virtual_finish_ms.begin();
+                 it != li.owner_virtual_finish_ms.end();)
+            {
+                it = (it->second <= now ? li.owner_virtual_finish_ms.erase(it) : std::next(it));
+            }
+        }
+
+        auto& owner_finish = li.owner_virtual_finish_ms[owner];
+        owner_finish = std::max(now, owner_finish) + cost_ms * li.cost_weight;
+        return {
+            jid,
+            priority,
+            locks_problem,
+            owner_finish,
+            lane,
+            now,
+            cost_ms,
+        };
+    }
+
+    static void record_queue_wait(StringView queue_name, const Job& job) noexcept {
+        try {
+            metrics::record_queue_wait(
+                queue_name, std::chrono::milliseconds{steady_now_ms() - job.noticed_at_ms}
+            );
+        } catch (const std::exception& e) {
+            ERRLOG_CATCH(e); // Metrics are not worth failing the job
+        }
+    }
+
+    // Judge jobs' wait times are recorded also per lane
+    void record_lane_wait(const Job& job) noexcept {
+        if (job.lane == Lane::NONE) {
+            return;
+        }
+        auto& li = lanes[static_cast<size_t>(job.lane)];
+        record_queue_wait(li.queue_name, job);
+        ++li.waits_since_report;
+    }
+
+    // Adds @p curr_job of the problem @p problem_id to @p job_category
+    void queue_job(decltype(judge_jobs)& job_category, Job curr_job, uint64_t problem_id) {
+        auto it = job_category.problem_info.find(problem_id);
+        if (it != job_category.problem_info.end()) {
+            ProblemInfo& pinfo = it->second;
+            Job best_job = pinfo.its_best_job;
+            // Get the problem's jobs (the problem may be locked)
+            auto& pjobs =
+                (pinfo.locks_no > 0 ? job_category.locked_problems[problem_id]
+                                    : job_category.queue[best_job]);
+            // Ensure field 'problem_id' is set properly (in case of element
+            // creation this line is necessary)
+            pjobs.problem_id = problem_id;
+            // Add job to queue
+            pjobs.jobs.emplace(curr_job);
+            // Alter the problem's best job
+            if (curr_job < best_job) {
+                pinfo.its_best_job = curr_job;
+                // Update queue (rekey ProblemJobs)
+                if (pinfo.locks_no == 0) {
+                    auto nh = job_category.queue.extract(best_job);
+                    nh.key() = curr_job;
+                    job_category.queue.insert(std::move(nh));
+                }
+            }
+
+        } else {
+            job_category.problem_info[problem_id] = {curr_job, 0};
+            // Add job to the queue (first one to this problem)
+            auto& pjobs = job_category.queue[curr_job];
+            pjobs.problem_id = problem_id;
+            pjobs.jobs.emplace(curr_job);
+        }
+    }
+
+    // Removes @p job of the problem @p problem_id from @p job_category. Returns
+    // false if there is no such problem.
+    bool dequeue_job(decltype(judge_jobs)& job_category, const Job& job, uint64_t problem_id) {
+        auto it = job_category.problem_info.find(problem_id);
+        if (it == job_category.problem_info.end()) {
+            return false; // There is no such problem
+        }
+
+        auto& pinfo = it->second;
+        Job best_job = pinfo.its_best_job;
+        auto& pjobs =
+            (pinfo.locks_no > 0 ? job_category.locked_problems[problem_id]
+                                : job_category.queue[best_job]);
+
+        if (not pjobs.jobs.erase(job)) {
+            THROW("Job erasion did not take place since the erased job was "
+                  "not found");
+        }
+
+        if (pjobs.jobs.empty()) {
+            // That was the last job of it's problem
+            if (pinfo.locks_no == 0) {
+                job_category.queue.erase(best_job);
+                job_category.problem_info.erase(problem_id);
+            } else { // Problem is locked
+                job_category.locked_problems.erase(problem_id);
+                pinfo.its_best_job = Job::least();
+            }
+
+        } else {
+            // The best job of the extracted job's problem changed
+            Job new_best = *pjobs.jobs.begin();
+            pinfo.its_best_job = new_best;
+            // Update queue (rekey ProblemJobs)
+            if (pinfo.locks_no == 0) {
+                auto nh = job_category.queue.extract(best_job);
+                nh.key() = new_best;
+                job_category.queue.insert(std::move(nh));
+            }
+        }
+        return true;
+    }
+
+public:
+    // Logs percentiles of the recent queue wait times of judge jobs (per lane)
+    void report_wait_times() {
+        STACK_UNWINDING_MARK;
+        last_wait_times_report_ms = steady_now_ms();
+
+        sim::jobs::JobServerMetrics m;
+        metrics::collect_durations(m);
+        for (auto& li : lanes) {
+            if (li.waits_since_report == 0) {
+                continue;
+            }
+            li.waits_since_report = 0;
+            auto it = m.queue_wait_ms.find(li.queue_name);
+            if (it == m.queue_wait_ms.end()) {
+                continue;
+            }
+            auto const& waits = it->second;
+            stdlog(
+                "Queue wait times of the last ",
+                waits.count,
+                " jobs in ",
+                li.queue_name,
+                " [ms]: p50 = ",
+                waits.p50,
+                ", p90 = ",
+                waits.p90,
+                ", p99 = ",
+                waits.p99,
+                ", max = ",
+                waits.max
+            );
+        }
+    }
+
+    void report_wait_times_periodically() {
+        constexpr int64_t REPORT_INTERVAL_MS = 10 * 60'000;
+        if (steady_now_ms() - last_wait_times_report_ms >= REPORT_INTERVAL_MS) {
+            report_wait_times();
+        }
+    }
+
+    // Logs the contents of the queues (for debugging)
+    void dump_queues() const {
+        auto impl = [](auto&& job_category) {
+            if (!job_category.problem_info.empty()) {
+                stdlog("problem_info = {");
+                for (auto&& [prob_id, pinfo] : job_category.problem_info) {
+                    stdlog(
+                        "   ", prob_id, " => {", pinfo.its_best_job.id, ", ", pinfo.locks_no, "},"
+                    );
+                }
+                stdlog("}");
+            }
+
+            auto log_problem_jobs = [](auto&& logger, const ProblemJobs& pj) {
+                logger("{", pj.problem_id, ", {");
+                for (auto const& job : pj.jobs) {
+                    logger(job.id, " ");
+                }
+                logger("}}");
+            };
+
+            if (!job_category.queue.empty()) {
+                stdlog("queue = {");
+                for (auto&& [job, problem_jobs] : job_category.queue) {
+                    auto tmplog = stdlog("   ", job.id, " => ");
+                    log_problem_jobs(tmplog, problem_jobs);
+                    tmplog(',');
+                };
+                stdlog("}");
+            }
+
+            if (!job_category.locked_problems.empty()) {
+                stdlog("locked_problems = {");
+                for (auto&& [prob_id, prob_jobs] : job_category.locked_problems) {
+                    auto tmplog = stdlog("   ", prob_id, " => ");
+                    log_problem_jobs(tmplog, prob_jobs);
+                    tmplog(',');
+                };
+                stdlog("}");
+            }
+        };
+
+        stdlog("DEBUG: judge_jobs:");
+        impl(judge_jobs);
+        stdlog("DEBUG: problem_management_jobs:");
+        impl(problem_management_jobs);
+    }
+
+    void add_judge_job(
+        uint64_t jid,
+        uint priority,
+        uint64_t problem_id,
+        bool locks_problem,
+        Lane lane,
+        uint64_t owner,
+        int64_t cost_ms
+    ) {
+        STACK_UNWINDING_MARK;
+        auto job = make_judge_job(jid, priority, locks_problem, lane, owner, cost_ms);
+        queue_job(judge_jobs, job, problem_id);
+        unaged_judge_jobs.try_emplace({job.noticed_at_ms, job.id}, job, problem_id);
+    }
+
+    // Moves up by one priority level the judge jobs that were noticed at least
+    // AGING_MS before @p now_ms
+    void age_judge_jobs(int64_t now_ms = steady_now_ms()) {
+        STACK_UNWINDING_MARK;
+        while (not unaged_judge_jobs.empty()) {
+            auto it = unaged_judge_jobs.begin();
+            auto [job, problem_id] = it->second;
+            if (now_ms - job.noticed_at_ms < AGING_MS) {
+                return;
+            }
+            unaged_judge_jobs.erase(it);
+
+            throw_assert(dequeue_job(judge_jobs, job, problem_id));
+            job.aged = true;
+            queue_job(judge_jobs, job, problem_id);
+        }
+    }
+
+    void add_problem_management_job(uint64_t jid, uint priority, uint64_t problem_id) {
+        STACK_UNWINDING_MARK;
+        queue_job(
+            problem_management_jobs,
+            {jid, priority, true, 0, Lane::NONE, steady_now_ms()},
+            problem_id
+        );
+    }
+
+    void add_other_job(uint64_t jid, uint priority) {
+        STACK_UNWINDING_MARK;
+        other_jobs.insert({jid, priority, false, 0, Lane::NONE, steady_now_ms()});
+    }
+
+    void lock_problem(uint64_t pid) {
+        STACK_UNWINDING_MARK;
+        DEBUG_JOB_SERVER(stdlog("DEBUG: Locking problem ", pid, "...");)
+
+        auto lock_impl = [&pid](auto& job_category) {
+            auto it = job_category.problem_info.find(pid);
+            if (it == job_category.problem_info.end()) {
+                it = job_category.problem_info.try_emplace(pid, ProblemInfo{Job::least(), 0}).first;
+            }
+
+            auto& pinfo = it->second;
+            if (++pinfo.locks_no == 1) {
+                auto pj = job_category.queue.find(pinfo.its_best_job);
+                if (pj != job_category.queue.end()) {
+                    job_category.locked_problems.try_emplace(pid, std::move(pj->second));
+                    job_category.queue.erase(pj->first);
+                }
+            }
+        };
+
+        lock_impl(judge_jobs);
+        lock_impl(problem_management_jobs);
+
+        DEBUG_JOB_SERVER(stdlog(__FILE__ ":", __LINE__, ": ", __FUNCTION__, "()");)
+        DEBUG_JOB_SERVER(dump_queues();)
+    }
+
+    void unlock_problem(uint64_t pid) {
+        STACK_UNWINDING_MARK;
+        DEBUG_JOB_SERVER(stdlog("DEBUG: Unlocking problem ", pid, "...");)
+
+        auto unlock_impl = [&pid, this](auto& job_category) {
+            auto it = job_category.problem_info.find(pid);
+            if (it == job_category.problem_info.end()) {
+                dump_queues();
+                THROW("BUG: unlocking problem that is not locked!");
+            }
+
+            auto& pinfo = it->second;
+            if (--pinfo.locks_no == 0) {
+                auto pl = job_category.locked_problems.find(pid);
+                if (pl != job_category.locked_problems.end()) {
+                    job_category.queue.try_emplace(pinfo.its_best_job, std::move(pl->second));
+                    job_category.locked_problems.erase(pl->first);
+                } else {
+                    job_category.problem_info.erase(pid); /* There are no jobs
+                        that belong to this problem and it is lock-free now, so
+                        its records can be safely removed */
+                }
+            }
+        };
+
+        unlock_impl(judge_jobs);
+        unlock_impl(problem_management_jobs);
+
+        DEBUG_JOB_SERVER(stdlog(__FILE__ ":", __LINE__, ": ", __FUNCTION__, "()");)
+        DEBUG_JOB_SERVER(dump_queues();)
+    }
+
+    class JobHolder {
+        JobsQueue* jobs_queue;
+        decltype(judge_jobs)* job_category;
+
+    public:
+        Job job = Job::least(); // If is invalid it will be the last in comparison
+        uint64_t problem_id = 0;
+
+        JobHolder(JobsQueue& jq, decltype(judge_jobs)& jc) : jobs_queue(&jq), job_category(&jc) {}
+
+        JobHolder(JobsQueue& jq, decltype(judge_jobs)& jc, Job j, uint64_t pid)
+        : jobs_queue(&jq)
+        , job_category(&jc)
+        , job(j)
+        , problem_id(pid) {}
+
+        JobHolder(const JobHolder&) = delete;
+        JobHolder(JobHolder&&) = default;
+        JobHolder& operator=(const JobHolder&) = delete;
+        JobHolder& operator=(JobHolder&&) = default;
+        ~JobHolder() = default;
+
+        // NOLINTNEXTLINE(google-explicit-constructor)
+        operator Job() const noexcept { return job; }
+
+        [[nodiscard]] bool ok() const noexcept { return not(job == Job::least()); }
+
+        // Removes the job from queue and locks problem if locks_problem is true
+        void was_passed() const {
+            STACK_UNWINDING_MARK;
+
+            if (not jobs_queue->dequeue_job(*job_category, job, problem_id)) {
+                return; // There is no such problem
+            }
+            if (job_category == &jobs_queue->judge_jobs) {
+                jobs_queue->unaged_judge_jobs.erase({job.noticed_at_ms, job.id});
+            }
+
+            record_queue_wait(
+                (job_category == &jobs_queue->judge_jobs ? "judge_jobs"
+                                                         : "problem_management_jobs"),
+                job
+            );
+            jobs_queue->record_lane_wait(job);
+            if (job.locks_problem) {
+                jobs_queue->lock_problem(problem_id);
+            }
+        }
+    };
+
+private:
+    JobHolder best_job(decltype(judge_jobs)& job_category) {
+        if (job_category.queue.empty()) {
+            return {*this, job_category}; // No one left
+        }
+
+        auto it = job_category.queue.begin();
+        return {*this, job_category, it->first, it->second.problem_id};
+    }
+
+public:
+    // Ret val: id of the extracted job or -1 if none was found
+    JobHolder best_judge_job() {
+        STACK_UNWINDING_MARK;
+        return best_job(judge_jobs);
+    }
+
+    // Returns the best job of the first problem satisfying @p pred (called with
+    // the problem id) among the first @p window problems in the judge queue
+    // whose best jobs have the same priority as the best judge job. Only these
+    // problems count into the window. Returns an invalid holder if there is no
+    // such job.
+    template <class Pred>
+    JobHolder best_judge_job_within_window(size_t window, Pred&& pred) {
+        STACK_UNWINDING_MARK;
+        auto it = judge_jobs.queue.begin();
+        if (it == judge_jobs.queue.end()) {
+            return {*this, judge_jobs};
+        }
+
+        auto priority = it->first.queue_priority();
+        for (; window > 0 and it != judge_jobs.queue.end(); ++it) {
+            if (it->first.queue_priority() != priority) {
+                // The queue is ordered by priority first (see Job), so the
+                // remaining problems have lower priorities
+                break;
+            }
+            if (pred(it->second.problem_id)) {
+                return {*this, judge_jobs, it->first, it->second.problem_id};
+            }
+            --window;
+        }
+        return {*this, judge_jobs};
+    }
+
+    // Returns the first job satisfying @p pred among the best jobs of the
+    // problems in the judge queue. Returns an invalid holder if there is no
+    // such job.
+    template <class Pred>
+    JobHolder best_judge_job_satisfying(Pred&& pred) {
+        STACK_UNWINDING_MARK;
+        for (auto const& [job, pjobs] : judge_jobs.queue) {
+            if (pred(job)) {
+                return {*this, judge_jobs, job, pjobs.problem_id};
+            }
+        }
+        return {*this, judge_jobs};
+    }
+
+    // Returns the queued judge jobs (including the ones of the locked problems)
+    // in the order they are going to be run
+    [[nodiscard]] std::vector<Job> queued_judge_jobs() const {
+        STACK_UNWINDING_MARK;
+        std::vector<Job> res;
+        for (auto const& [best_job, pjobs] : judge_jobs.queue) {
+            res.insert(res.end(), pjobs.jobs.begin(), pjobs.jobs.end());
+        }
+        for (auto const& [problem_id, pjobs] : judge_jobs.locked_problems) {
+            res.insert(res.end(), pjobs.jobs.begin(), pjobs.jobs.end());
+        }
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+
+    // Fills in the queues of @p m
+    void collect_queue_metrics(sim::jobs::JobServerMetrics& m) const {
+        STACK_UNWINDING_MARK;
+        auto collect = [&m](StringView name, const auto& job_category) {
+            auto& queue = m.queues[name.to_string()];
+            for (auto const& [best_job, pjobs] : job_category.queue) {
+                queue.jobs += pjobs.jobs.size();
+            }
+            for (auto const& [problem_id, pjobs] : job_category.locked_problems) {
+                queue.jobs += pjobs.jobs.size();
+            }
+            for (auto const& [problem_id, pinfo] : job_category.problem_info) {
+                queue.locked_problems += (pinfo.locks_no > 0);
+            }
+        };
+        collect("judge_jobs", judge_jobs);
+        collect("problem_management_jobs", problem_management_jobs);
+        m.queues["other_jobs"].jobs = other_jobs.size();
+    }
+
+    // Ret val: id of the extracted job or -1 if none was found
+    JobHolder best_problem_job() {
+        STACK_UNWINDING_MARK;
+        return best_job(problem_management_jobs);
+    }
+
+    class OtherJobHolder {
+        decltype(other_jobs)* oj;
+
+    public:
+        Job job = Job::least(); // If is invalid it will be the last in comparison
+
+        // NOLINTNEXTLINE(google-explicit-constructor)
+        OtherJobHolder(decltype(other_jobs)& o) : oj(&o) {}
+
+        OtherJobHolder(decltype(other_jobs)& o, Job j) : oj(&o), job(j) {}
+
+        OtherJobHolder(const OtherJobHolder&) = delete;
+        OtherJobHolder(OtherJobHolder&&) = default;
+        OtherJobHolder& operator=(const OtherJobHolder&) = delete;
+        OtherJobHolder& operator=(OtherJobHolder&&) = default;
+        ~OtherJobHolder() = default;
+
+        // NOLINTNEXTLINE(google-explicit-constructor)
+        operator Job() const noexcept { return job; }
+
+        [[nodiscard]] bool ok() const noexcept { return not(job == Job::least()); }
+
+        // Removes the job from queue
+        void was_passed() const {
+            oj->erase(job);
+            record_queue_wait("other_jobs", job);
+        }
+    };
+
+    // Ret val: id of the extracted job or -1 if none was found
+    OtherJobHolder best_other_job() {
+        STACK_UNWINDING_MARK;
+        if (other_jobs.empty()) {
+            return {other_jobs}; // No one left
+        }
+
+        return {other_jobs, *other_jobs.begin()};
+    }
+};
+
+} // namespace job_server
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace job_server {
+
+/**
+ * @brief Running estimates of how long judging a submission to a problem takes
+ * @details Until judging of a problem is observed, its estimate is derived from
+ *   the problem's time limits (prior). Observed judging times are combined
+ *   with an exponentially weighted moving average, so the estimate follows
+ *   e.g. changes of the time limits. All methods are thread-safe.
+ */
+class JudgeCostEstimator {
+public:
+    // Estimate of problems that have neither observations nor prior
+    static constexpr int64_t DEFAULT_COST_MS = 1'000;
+    // Cost of compiling the solution and the checker, used in the prior
+    static constexpr int64_t COMPILATION_COST_MS = 1'000;
+    // Weight of a new observation in the estimate
+    static constexpr double SMOOTHING = 0.25;
+
+    // Typical solutions use a fraction of the time limits
+    static int64_t prior_from_time_limits(std::chrono::nanoseconds total_time_limit) noexcept {
+        return COMPILATION_COST_MS +
+            std::chrono::duration_cast<std::chrono::milliseconds>(total_time_limit).count() / 2;
+    }
+
+private:
+    struct Estimate {
+        double cost_ms;
+        bool is_observed;
+    };
+
+    mutable std::mutex mtx_;
+    std::map<uint64_t, Estimate> estimates_; // problem id => estimate
+
+public:
+    bool has_estimate(uint64_t problem_id) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return estimates_.count(problem_id) > 0;
+    }
+
+    // Does nothing if the problem already has an estimate
+    void set_prior(uint64_t problem_id, int64_t cost_ms) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        estimates_.try_emplace(problem_id, Estimate{static_cast<double>(cost_ms), false});
+    }
+
+    void record(uint64_t problem_id, std::chrono::nanoseconds judge_time) {
+        auto observed_ms = std::chrono::duration<double, std::milli>(judge_time).count();
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto [it, inserted] = estimates_.try_emplace(problem_id, Estimate{observed_ms, true});
+        auto& est = it->second;
+        if (inserted or not est.is_observed) {
+            // The first observation is more reliable than the prior
+            est = {observed_ms, true};
+        } else {
+            est.cost_ms += SMOOTHING * (observed_ms - est.cost_ms);
+        }
+    }
+
+    int64_t estimate_ms(uint64_t problem_id) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = estimates_.find(problem_id);
+        return (it == estimates_.end() ? DEFAULT_COST_MS
+                                       : static_cast<int64_t>(it->second.cost_ms + 0.5));
+    }
+
+    // Returns (problem id => estimate in milliseconds)
+    std::map<uint64_t, int64_t> all_estimates_ms() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::map<uint64_t, int64_t> res;
+        for (auto const& [problem_id, est] : estimates_) {
+            res.emplace_hint(res.end(), problem_id, static_cast<int64_t>(est.cost_ms + 0.5));
+        }
+        return res;
+    }
+};
+
+} // namespace job_server
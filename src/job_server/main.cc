@@ -1,35 +1,45 @@
 #include "dispatcher.hh"
+#include "jobs_queue.hh"
 #include "logs.hh"
+#include "main.hh"
+#include "metrics.hh"
 #include "notify_file.hh"
+#include "workers_pool.hh"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <climits>
 #include <cstdint>
-#include <future>
 #include <map>
+#include <memory>
+#include <netinet/tcp.h>
+#include <optional>
 #include <poll.h>
 #include <queue>
 #include <set>
 #include <sim/jobs/job.hh>
+#include <sim/jobs/job_server_metrics.hh>
+#include <sim/jobs/judge_estimates.hh>
 #include <sim/jobs/utils.hh>
+#include <sim/judge_node/protocol.hh>
 #include <sim/mysql/mysql.hh>
+#include <sim/mysql/tracing.hh>
 #include <sim/submissions/update_final.hh>
 #include <simlib/config_file.hh>
+#include <simlib/file_descriptor.hh>
 #include <simlib/file_info.hh>
 #include <simlib/file_manip.hh>
 #include <simlib/process.hh>
-#include <simlib/shared_function.hh>
+#include <simlib/sim/simfile.hh>
 #include <simlib/time.hh>
 #include <simlib/working_directory.hh>
 #include <sys/eventfd.h>
 #include <sys/inotify.h>
 #include <thread>
 #include <unistd.h>
-
-#if 0
-#define DEBUG_JOB_SERVER(...) __VA_ARGS__
-#else
-#define DEBUG_JOB_SERVER(...)
-#endif
+#include <vector>
 
 using std::array;
 using std::function;
@@ -40,403 +50,35 @@ using std::string;
 using std::thread;
 using std::vector;
 
+using job_server::JobsQueue;
+using job_server::WorkersPool;
+
 namespace job_server {
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
-thread_local mysql::Connection mysql;
-
-} // namespace job_server
-
-namespace {
-
-class JobsQueue {
-public:
-    struct Job {
-        uint64_t id{};
-        uint priority{};
-        bool locks_problem = false;
-
-        bool operator<(Job x) const {
-            return (priority == x.priority ? id < x.id : priority > x.priority);
-        }
-
-        bool operator==(Job x) const { return (id == x.id and priority == x.priority); }
-
-        static constexpr Job least() noexcept { return {UINT64_MAX, 0}; }
-    };
-
-private:
-    struct ProblemJobs {
-        uint64_t problem_id{};
-        std::set<Job> jobs;
-    };
-
-    struct ProblemInfo {
-        Job its_best_job;
-        uint locks_no = 0;
-    };
-
-    struct {
-        // Strong assumption: any job must belong to AT MOST one problem
-        std::map<uint64_t, ProblemInfo> problem_info;
-        std::map<Job, ProblemJobs> queue; // (best problem's job => all jobs of the problem)
-        std::map<int64_t, ProblemJobs> locked_problems; // (problem_id  => (locks, problem's jobs))
-    } judge_jobs,
-        problem_management_jobs; // (judge jobs - they need judge machines)
-
-    std::set<Job> other_jobs;
-
-    void dump_queues() const {
-        auto impl = [](auto&& job_category) {
-            if (!job_category.problem_info.empty()) {
-                stdlog("problem_info = {");
-                for (auto&& [prob_id, pinfo] : job_category.problem_info) {
-                    stdlog(
-                        "   ", prob_id, " => {", pinfo.its_best_job.id, ", ", pinfo.locks_no, "},"
-                    );
-                }
-                stdlog("}");
-            }
-
-            auto log_problem_jobs = [](auto&& logger, const ProblemJobs& pj) {
-                logger("{", pj.problem_id, ", {");
-                for (auto const& job : pj.jobs) {
-                    logger(job.id, " ");
-                }
-                logger("}}");
-            };
-
-            if (!job_category.queue.empty()) {
-                stdlog("queue = {");
-                for (auto&& [job, problem_jobs] : job_category.queue) {
-                    auto tmplog = stdlog("   ", job.id, " => ");
-                    log_problem_jobs(tmplog, problem_jobs);
-                    tmplog(',');
-                };
-                stdlog("}");
-            }
-
-            if (!job_category.locked_problems.empty()) {
-                stdlog("locked_problems = {");
-                for (auto&& [prob_id, prob_jobs] : job_category.locked_problems) {
-                    auto tmplog = stdlog("   ", prob_id, " => ");
-                    log_problem_jobs(tmplog, prob_jobs);
-                    tmplog(',');
-                };
-                stdlog("}");
-            }
-        };
-
-        stdlog("DEBUG: judge_jobs:");
-        impl(judge_jobs);
-        stdlog("DEBUG: problem_management_jobs:");
-        impl(problem_management_jobs);
-    }
-
-public:
-    void sync_with_db() {
-        STACK_UNWINDING_MARK;
-
-        uint64_t jid = 0;
-        EnumVal<sim::jobs::Job::Type> jtype{};
-        mysql::Optional<decltype(sim::jobs::Job::aux_id)::value_type> aux_id;
-        uint priority = 0;
-        InplaceBuff<512> info;
-        // Select jobs
-        auto stmt = job_server::mysql.prepare("SELECT id, type, priority, aux_id, info "
-                                              "FROM jobs "
-                                              "WHERE status=? "
-                                              "ORDER BY priority DESC, id ASC LIMIT 4");
-        stmt.res_bind_all(jid, jtype, priority, aux_id, info);
-        // Sets job's status to NOTICED_PENDING
-        auto mark_stmt = job_server::mysql.prepare("UPDATE jobs SET status=? WHERE id=?");
-        // Add jobs to internal queue
-        using JT = sim::jobs::Job::Type;
-        for (;;) {
-            stmt.bind_and_execute(EnumVal(sim::jobs::Job::Status::PENDING));
-            if (not stmt.next()) {
-                break;
-            }
-
-            do {
-                DEBUG_JOB_SERVER(stdlog("DEBUG: Fetched from DB: job ", jid);)
-                auto queue_job =
-                    [&jid, &priority](auto& job_category, uint64_t problem_id, bool locks_problem) {
-                        auto it = job_category.problem_info.find(problem_id);
-                        Job curr_job{jid, priority, locks_problem};
-                        if (it != job_category.problem_info.end()) {
-                            ProblemInfo& pinfo = it->second;
-                            Job best_job = pinfo.its_best_job;
-                            // Get the problem's jobs (the problem may be locked)
-                            auto& pjobs =
-                                (pinfo.locks_no > 0 ? job_category.locked_problems[problem_id]
-                                                    : job_category.queue[best_job]);
-                            // Ensure field 'problem_id' is set properly (in case of
-                            // element creation this line is necessary)
-                            pjobs.problem_id = problem_id;
-                            // Add job to queue
-                            pjobs.jobs.emplace(curr_job);
-                            // Alter the problem's best job
-                            if (curr_job < best_job) {
-                                pinfo.its_best_job = curr_job;
-                                // Update queue (rekey ProblemJobs)
-                                if (pinfo.locks_no == 0) {
-                                    auto nh = job_category.queue.extract(best_job);
-                                    nh.key() = curr_job;
-                                    job_category.queue.insert(std::move(nh));
-                                }
-                            }
-
-                        } else {
-                            job_category.problem_info[problem_id] = {curr_job, 0};
-                            // Add job to the queue (first one to this problem)
-                            auto& pjobs = job_category.queue[curr_job];
-                            pjobs.problem_id = problem_id;
-                            pjobs.jobs.emplace(curr_job);
-                        }
-                    };
-
-                // Assign job to its category
-                switch (jtype) {
-                case JT::JUDGE_SUBMISSION:
-                case JT::REJUDGE_SUBMISSION: {
-                    auto opt =
-                        str2num<uint64_t>(from_unsafe{sim::jobs::extract_dumped_string(info)});
-                    if (not opt) {
-                        THROW("Corrupted job's info field");
-                    }
-
-                    queue_job(judge_jobs, opt.value(), false);
-                    break;
-                }
-
-                case JT::ADD_PROBLEM__JUDGE_MODEL_SOLUTION: queue_job(judge_jobs, 0, false); break;
-
-                case JT::REUPLOAD_PROBLEM__JUDGE_MODEL_SOLUTION:
-                    queue_job(judge_jobs, aux_id.value(), true);
-                    break;
-
-                // Problem job
-                case JT::REUPLOAD_PROBLEM:
-                case JT::EDIT_PROBLEM:
-                case JT::DELETE_PROBLEM:
-                case JT::MERGE_PROBLEMS:
-                case JT::CHANGE_PROBLEM_STATEMENT:
-                case JT::RESET_PROBLEM_TIME_LIMITS_USING_MODEL_SOLUTION:
-                    queue_job(problem_management_jobs, aux_id.value(), true);
-                    break;
-
-                // Other job (local jobs that don't have associated problem)
-                case JT::ADD_PROBLEM:
-                case JT::RESELECT_FINAL_SUBMISSIONS_IN_CONTEST_PROBLEM:
-                case JT::MERGE_USERS:
-                case JT::DELETE_USER:
-                case JT::DELETE_CONTEST:
-                case JT::DELETE_CONTEST_ROUND:
-                case JT::DELETE_CONTEST_PROBLEM:
-                case JT::DELETE_FILE: other_jobs.insert({jid, priority, false}); break;
-                }
-                mark_stmt.bind_and_execute(EnumVal(sim::jobs::Job::Status::NOTICED_PENDING), jid);
-            } while (stmt.next());
-        }
-
-        DEBUG_JOB_SERVER(stdlog(__FILE__ ":", __LINE__, ": ", __FUNCTION__, "()");)
-        DEBUG_JOB_SERVER(dump_queues();)
-    }
-
-    void lock_problem(uint64_t pid) {
-        STACK_UNWINDING_MARK;
-        DEBUG_JOB_SERVER(stdlog("DEBUG: Locking problem ", pid, "...");)
-
-        auto lock_impl = [&pid](auto& job_category) {
-            auto it = job_category.problem_info.find(pid);
-            if (it == job_category.problem_info.end()) {
-                it = job_category.problem_info.try_emplace(pid, ProblemInfo{Job::least(), 0}).first;
-            }
-
-            auto& pinfo = it->second;
-            if (++pinfo.locks_no == 1) {
-                auto pj = job_category.queue.find(pinfo.its_best_job);
-                if (pj != job_category.queue.end()) {
-                    job_category.locked_problems.try_emplace(pid, std::move(pj->second));
-                    job_category.queue.erase(pj->first);
-                }
-            }
-        };
-
-        lock_impl(judge_jobs);
-        lock_impl(problem_management_jobs);
-
-        DEBUG_JOB_SERVER(stdlog(__FILE__ ":", __LINE__, ": ", __FUNCTION__, "()");)
-        DEBUG_JOB_SERVER(dump_queues();)
-    }
-
-    void unlock_problem(uint64_t pid) {
-        STACK_UNWINDING_MARK;
-        DEBUG_JOB_SERVER(stdlog("DEBUG: Unlocking problem ", pid, "...");)
-
-        auto unlock_impl = [&pid, this](auto& job_category) {
-            auto it = job_category.problem_info.find(pid);
-            if (it == job_category.problem_info.end()) {
-                dump_queues();
-                THROW("BUG: unlocking problem that is not locked!");
-            }
-
-            auto& pinfo = it->second;
-            if (--pinfo.locks_no == 0) {
-                auto pl = job_category.locked_problems.find(pid);
-                if (pl != job_category.locked_problems.end()) {
-                    job_category.queue.try_emplace(pinfo.its_best_job, std::move(pl->second));
-                    job_category.locked_problems.erase(pl->first);
-                } else {
-                    job_category.problem_info.erase(pid); /* There are no jobs
-                        that belong to this problem and it is lock-free now, so
-                        its records can be safely removed */
-                }
-            }
-        };
-
-        unlock_impl(judge_jobs);
-        unlock_impl(problem_management_jobs);
-
-        DEBUG_JOB_SERVER(stdlog(__FILE__ ":", __LINE__, ": ", __FUNCTION__, "()");)
-        DEBUG_JOB_SERVER(dump_queues();)
-    }
-
-    class JobHolder {
-        JobsQueue* jobs_queue;
-        decltype(judge_jobs)* job_category;
-
-    public:
-        Job job = Job::least(); // If is invalid it will be the last in comparison
-        uint64_t problem_id = 0;
-
-        JobHolder(JobsQueue& jq, decltype(judge_jobs)& jc) : jobs_queue(&jq), job_category(&jc) {}
-
-        JobHolder(JobsQueue& jq, decltype(judge_jobs)& jc, Job j, uint64_t pid)
-        : jobs_queue(&jq)
-        , job_category(&jc)
-        , job(j)
-        , problem_id(pid) {}
-
-        JobHolder(const JobHolder&) = delete;
-        JobHolder(JobHolder&&) = default;
-        JobHolder& operator=(const JobHolder&) = delete;
-        JobHolder& operator=(JobHolder&&) = default;
-        ~JobHolder() = default;
-
-        // NOLINTNEXTLINE(google-explicit-constructor)
-        operator Job() const noexcept { return job; }
-
-        [[nodiscard]] bool ok() const noexcept { return not(job == Job::least()); }
-
-        // Removes the job from queue and locks problem if locks_problem is true
-        void was_passed() const {
-            STACK_UNWINDING_MARK;
-
-            auto it = job_category->problem_info.find(problem_id);
-            if (it == job_category->problem_info.end()) {
-                return; // There is no such problem
-            }
-
-            auto& pinfo = it->second;
-            Job best_job = pinfo.its_best_job;
-            auto& pjobs =
-                (pinfo.locks_no > 0 ? job_category->locked_problems[problem_id]
-                                    : job_category->queue[best_job]);
+thread_local sim::mysql::Connection mysql;
 
-            if (not pjobs.jobs.erase(job)) {
-                THROW("Job erasion did not take place since the erased job was "
-                      "not found");
-            }
-
-            if (pjobs.jobs.empty()) {
-                // That was the last job of it's problem
-                if (pinfo.locks_no == 0) {
-                    job_category->queue.erase(best_job);
-                    job_category->problem_info.erase(problem_id);
-                } else { // Problem is locked
-                    job_category->locked_problems.erase(problem_id);
-                    pinfo.its_best_job = Job::least();
-                }
-
-            } else {
-                // The best job of the extracted job's problem changed
-                Job new_best = *pjobs.jobs.begin();
-                pinfo.its_best_job = new_best;
-                // Update queue (rekey ProblemJobs)
-                if (pinfo.locks_no == 0) {
-                    auto nh = job_category->queue.extract(best_job);
-                    nh.key() = new_best;
-                    job_category->queue.insert(std::move(nh));
-                }
-            }
-
-            if (job.locks_problem) {
-                jobs_queue->lock_problem(problem_id);
-            }
-        }
-    };
-
-private:
-    JobHolder best_job(decltype(judge_jobs)& job_category) {
-        if (job_category.queue.empty()) {
-            return {*this, job_category}; // No one left
-        }
-
-        auto it = job_category.queue.begin();
-        return {*this, job_category, it->first, it->second.problem_id};
-    }
-
-public:
-    // Ret val: id of the extracted job or -1 if none was found
-    JobHolder best_judge_job() {
-        STACK_UNWINDING_MARK;
-        return best_job(judge_jobs);
-    }
-
-    // Ret val: id of the extracted job or -1 if none was found
-    JobHolder best_problem_job() {
-        STACK_UNWINDING_MARK;
-        return best_job(problem_management_jobs);
-    }
-
-    class OtherJobHolder {
-        decltype(other_jobs)* oj;
-
-    public:
-        Job job = Job::least(); // If is invalid it will be the last in comparison
-
-        // NOLINTNEXTLINE(google-explicit-constructor)
-        OtherJobHolder(decltype(other_jobs)& o) : oj(&o) {}
-
-        OtherJobHolder(decltype(other_jobs)& o, Job j) : oj(&o), job(j) {}
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+thread_local std::shared_ptr<JudgeNode> judge_node;
 
-        OtherJobHolder(const OtherJobHolder&) = delete;
-        OtherJobHolder(OtherJobHolder&&) = default;
-        OtherJobHolder& operator=(const OtherJobHolder&) = delete;
-        OtherJobHolder& operator=(OtherJobHolder&&) = default;
-        ~OtherJobHolder() = default;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+JudgeCostEstimator judge_cost_estimator;
 
-        // NOLINTNEXTLINE(google-explicit-constructor)
-        operator Job() const noexcept { return job; }
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::optional<std::chrono::milliseconds> stub_judge_time;
 
-        [[nodiscard]] bool ok() const noexcept { return not(job == Job::least()); }
+} // namespace job_server
 
-        // Removes the job from queue
-        void was_passed() const { oj->erase(job); }
-    };
+namespace {
 
-    // Ret val: id of the extracted job or -1 if none was found
-    OtherJobHolder best_other_job() {
-        STACK_UNWINDING_MARK;
-        if (other_jobs.empty()) {
-            return {other_jobs}; // No one left
-        }
+int64_t steady_now_ms() noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()
+    )
+        .count();
+}
 
-        return {other_jobs, *other_jobs.begin()};
-    }
-} jobs_queue; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+JobsQueue jobs_queue; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 
 class EventsQueue {
     mutex events_lock;
@@ -504,168 +146,6 @@ public:
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 EventsQueue EventsQueue::events_queue;
 
-class WorkersPool {
-public:
-    struct NextJob {
-        uint64_t id;
-        int64_t problem_id; // negative indicates that no problem is associated
-                            // with the job
-        bool locked_its_problem;
-    };
-
-    struct WorkerInfo {
-        NextJob next_job{0, -1, false};
-        std::promise<void> next_job_signalizer;
-        std::future<void> next_job_waiter = next_job_signalizer.get_future();
-        bool is_idle = false;
-    };
-
-private:
-    mutex mtx_;
-    vector<thread::id> idle_workers;
-    map<thread::id, WorkerInfo> workers; // AVLDict cannot be used as addresses must not change
-
-    function<void(NextJob)> job_handler_;
-    function<void()> worker_becomes_idle_callback_;
-    function<void(WorkerInfo)> worker_dies_callback_;
-
-    class Worker {
-        WorkersPool& wp_;
-
-    public:
-        explicit Worker(WorkersPool& wp) : wp_(wp) {
-            STACK_UNWINDING_MARK;
-            auto tid = std::this_thread::get_id();
-            lock_guard<mutex> lock(wp_.mtx_);
-            wp_.workers.emplace(tid, WorkerInfo{});
-        }
-
-        Worker(const Worker&) = delete;
-        Worker(Worker&&) = delete;
-        Worker& operator=(const Worker&) = delete;
-        Worker& operator=(Worker&&) = delete;
-
-        ~Worker() {
-            STACK_UNWINDING_MARK;
-            lock_guard<mutex> lock(wp_.mtx_);
-            // Remove the worker from workers map and move out its info
-            auto tid = std::this_thread::get_id();
-            auto it = wp_.workers.find(tid);
-            auto wi = std::move(it->second);
-            wp_.workers.erase(it);
-            // Remove it from idle workers
-            if (wi.is_idle) {
-                for (auto k = wp_.idle_workers.begin(); k != wp_.idle_workers.end(); ++k) {
-                    if (*k == tid) {
-                        wp_.idle_workers.erase(k);
-                        break;
-                    }
-                }
-            }
-
-            if (wp_.worker_dies_callback_) {
-                EventsQueue::register_event(shared_function([&callback = wp_.worker_dies_callback_,
-                                                             winfo = std::move(wi)]() mutable {
-                    callback(std::move(winfo));
-                }));
-            }
-        }
-
-        NextJob wait_for_next_job_id() {
-            STACK_UNWINDING_MARK;
-            auto tid = std::this_thread::get_id();
-            WorkerInfo* wi = nullptr;
-            // Mark as idle
-            {
-                lock_guard<mutex> lock(wp_.mtx_);
-                wi = &wp_.workers[tid];
-                throw_assert(not wi->is_idle);
-                wi->is_idle = true;
-                wp_.idle_workers.emplace_back(tid);
-            }
-
-            if (wp_.worker_becomes_idle_callback_) {
-                EventsQueue::register_event(wp_.worker_becomes_idle_callback_);
-            }
-
-            // Wait for a job to be assigned to us (current worker)
-            wi->next_job_waiter.wait();
-            // Rearm promise-future pair
-            lock_guard<mutex> lock(wp_.mtx_);
-            wi->next_job_signalizer = decltype(wi->next_job_signalizer)();
-            wi->next_job_waiter = wi->next_job_signalizer.get_future();
-
-            return wi->next_job;
-        }
-    };
-
-public:
-    /**
-     * @brief Construct a workers pool
-     *
-     * @param job_handler a function that will be called in a worker with a job
-     *   id to handle as the first argument
-     * @param idle_callback a function to call when a worker becomes idle
-     */
-    WorkersPool(
-        function<void(NextJob)> job_handler,
-        function<void()> idle_callback,
-        function<void(WorkerInfo)> dead_callback
-    )
-    : job_handler_(std::move(job_handler))
-    , worker_becomes_idle_callback_(std::move(idle_callback))
-    , worker_dies_callback_(std::move(dead_callback)) {
-        throw_assert(job_handler_);
-    }
-
-    void spawn_worker() {
-        STACK_UNWINDING_MARK;
-
-        std::thread foo([this] {
-            try {
-                thread_local Worker w(*this);
-                // Connect to databases
-                job_server::mysql = sim::mysql::make_conn_with_credential_file(".db.config");
-
-                for (;;) {
-                    job_handler_(w.wait_for_next_job_id());
-                }
-
-            } catch (const std::exception& e) {
-                ERRLOG_CATCH(e);
-                // Sleep for a while to prevent exception inundation
-                std::this_thread::sleep_for(std::chrono::seconds(3));
-                pthread_exit(nullptr);
-            }
-        });
-        foo.detach();
-    }
-
-    auto workers_no() {
-        lock_guard<mutex> lock(mtx_);
-        return workers.size();
-    }
-
-    bool pass_job(uint64_t job_id, int64_t problem_id = -1, bool locks_problem = false) {
-        STACK_UNWINDING_MARK;
-
-        lock_guard<mutex> lock(mtx_);
-        if (idle_workers.empty()) {
-            return false;
-        }
-
-        // Assign the job to an idle worker
-        auto tid = idle_workers.back();
-        idle_workers.pop_back();
-        auto& wi = workers[tid];
-        wi.is_idle = false;
-        wi.next_job = {job_id, problem_id, locks_problem};
-        wi.next_job_signalizer.set_value();
-
-        return true;
-    }
-};
-
 } // anonymous namespace
 
 static void spawn_worker(WorkersPool& wp) noexcept {
@@ -680,15 +160,22 @@ static void spawn_worker(WorkersPool& wp) noexcept {
     }
 }
 
+static void schedule_sync_and_assign_jobs();
+
 static void process_job(const WorkersPool::NextJob& job) {
     STACK_UNWINDING_MARK;
+    if (sim::mysql::tracing::is_enabled()) {
+        sim::mysql::tracing::begin();
+    }
 
     auto exit_procedures = [&job] {
-        EventsQueue::register_event([job] {
-            if (job.locked_its_problem) {
+        if (job.locked_its_problem) {
+            EventsQueue::register_event([job] {
                 jobs_queue.unlock_problem(job.problem_id);
-            }
-        });
+                // Jobs waiting for the problem to be unlocked may be assigned now
+                schedule_sync_and_assign_jobs();
+            });
+        }
     };
 
     EnumVal<sim::jobs::Job::Type> jtype{};
@@ -725,6 +212,9 @@ static void process_job(const WorkersPool::NextJob& job) {
     job_server::job_dispatcher(
         job.id, jtype, file_id, tmp_file_id, creat, aux_id, info, created_at
     );
+    if (sim::mysql::tracing::is_enabled()) {
+        stdlog("Job ", job.id, ": ", sim::mysql::tracing::summary());
+    }
 
     exit_procedures();
 }
@@ -749,6 +239,14 @@ static void process_local_job(const WorkersPool::NextJob& job) {
 static void process_judge_job(const WorkersPool::NextJob& job) {
     STACK_UNWINDING_MARK;
 
+    // The connection is checked before the job is passed, but it may break
+    // after that. Then the worker dies and the job is restarted.
+    if (job_server::judge_node and job_server::judge_node->conn.is_closed()) {
+        throw sim::judge_node::ConnectionLost(
+            concat_tostr("Judge node ", job_server::judge_node->name, " disconnected")
+        );
+    }
+
     stdlog(
         pthread_self(),
         " got judge job {id:",
@@ -765,46 +263,434 @@ static void process_judge_job(const WorkersPool::NextJob& job) {
 
 static void sync_and_assign_jobs();
 
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+static std::atomic<bool> sync_and_assign_jobs_is_scheduled{false};
+
+// Many workers may become idle at once, so the requests to assign jobs are
+// coalesced into one event
+static void schedule_sync_and_assign_jobs() {
+    if (not sync_and_assign_jobs_is_scheduled.exchange(true)) {
+        EventsQueue::register_event([] {
+            sync_and_assign_jobs_is_scheduled = false;
+            sync_and_assign_jobs();
+        });
+    }
+}
+
+static void connect_worker_to_db() {
+    job_server::mysql = sim::mysql::make_conn_with_credential_file(".db.config");
+}
+
+// Called in the main thread
+static void handle_dead_worker(WorkersPool& wp, const WorkersPool::WorkerInfo& winfo) {
+    STACK_UNWINDING_MARK;
+
+    // Job has to be reset and cleanup to be done
+    if (not winfo.is_idle) {
+        if (winfo.next_job.locked_its_problem) {
+            jobs_queue.unlock_problem(winfo.next_job.problem_id);
+        }
+
+        sim::jobs::restart_job(
+            job_server::mysql, from_unsafe{to_string(winfo.next_job.id)}, false
+        );
+    }
+
+    // Transient workers serve judge nodes that will connect again by themselves
+    if (not winfo.is_transient) {
+        spawn_worker(wp);
+    }
+}
+
 static WorkersPool // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
-    local_workers(process_local_job, sync_and_assign_jobs, [](WorkersPool::WorkerInfo winfo) {
-        STACK_UNWINDING_MARK;
+    local_workers(
+        process_local_job,
+        schedule_sync_and_assign_jobs,
+        [](WorkersPool::WorkerInfo winfo) {
+            EventsQueue::register_event([winfo] { handle_dead_worker(local_workers, winfo); });
+        },
+        connect_worker_to_db
+    );
 
-        // Job has to be reset and cleanup to be done
-        if (not winfo.is_idle) {
-            if (winfo.next_job.locked_its_problem) {
-                jobs_queue.unlock_problem(winfo.next_job.problem_id);
-            }
+static WorkersPool // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+    judge_workers(
+        process_judge_job,
+        schedule_sync_and_assign_jobs,
+        [](WorkersPool::WorkerInfo winfo) {
+            EventsQueue::register_event([winfo] { handle_dead_worker(judge_workers, winfo); });
+        },
+        connect_worker_to_db
+    );
 
-            sim::jobs::restart_job(
-                job_server::mysql, from_unsafe{to_string(winfo.next_job.id)}, false
+// Compares in time that does not depend on the position of the first
+// difference, so the token cannot be guessed byte by byte by timing handshakes
+static bool tokens_equal(StringView given, StringView expected) noexcept {
+    unsigned char diff = (given.size() != expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        diff |= static_cast<unsigned char>(expected[i] ^ (i < given.size() ? given[i] : '\0'));
+    }
+    return diff == 0;
+}
+
+// Receives HELLO from a judge node connected on @p fd and makes the connection
+// a transient judge worker
+static void welcome_judge_node(FileDescriptor fd, const string& token) noexcept {
+    using sim::jobs::extract_dumped_int;
+    using sim::jobs::extract_dumped_string;
+    using sim::judge_node::MessageType;
+    using sim::judge_node::PROTOCOL_VERSION;
+    constexpr auto JUDGE_NODE_SILENCE_TIMEOUT = std::chrono::minutes(10);
+
+    try {
+        int true_ = 1;
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &true_, sizeof(true_));
+
+        sim::judge_node::Connection conn{std::move(fd)};
+        // Judge nodes send HELLO right after connecting
+        conn.set_receive_timeout(std::chrono::seconds(3));
+        auto hello = conn.receive();
+        if (hello.type != MessageType::HELLO) {
+            THROW("Judge node did not begin with HELLO");
+        }
+        StringView data = hello.payload;
+        auto version = extract_dumped_int<uint32_t>(data);
+        auto node_token = extract_dumped_string(data);
+        auto node_name = extract_dumped_string(data);
+        if (version != PROTOCOL_VERSION) {
+            THROW(
+                "Judge node ",
+                node_name,
+                " uses protocol version ",
+                version,
+                " instead of ",
+                PROTOCOL_VERSION
             );
         }
+        if (not tokens_equal(node_token, token)) {
+            THROW("Judge node ", node_name, " sent an invalid token");
+        }
+        // The judge node sends messages at least after every test, so a long
+        // silence during a job means that it hung. Then the worker dies and
+        // the job is restarted.
+        conn.set_receive_timeout(JUDGE_NODE_SILENCE_TIMEOUT);
+        conn.enable_keepalive();
+
+        auto node = std::make_shared<job_server::JudgeNode>(
+            job_server::JudgeNode{std::move(node_name), std::move(conn)}
+        );
+        judge_workers.spawn_transient_worker(
+            [node] {
+                connect_worker_to_db();
+                job_server::judge_node = node;
+            },
+            // Checked before passing a job, so that the slot of a judge node
+            // that disconnected while idle is freed instead of failing the job
+            [node] {
+                if (node->conn.is_closed()) {
+                    stdlog("Judge node ", node->name, " disconnected while idle");
+                    return false;
+                }
+                return true;
+            }
+        );
+        stdlog("Judge node ", node->name, " connected");
 
-        EventsQueue::register_event([] { spawn_worker(local_workers); });
-    });
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e);
+    }
+}
 
-static WorkersPool // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
-    judge_workers(process_judge_job, sync_and_assign_jobs, [](WorkersPool::WorkerInfo winfo) {
-        STACK_UNWINDING_MARK;
+/**
+ * @brief Accepts connections from judge nodes
+ * @details Every connection of a judge node that introduces itself correctly
+ *   becomes a transient judge worker, so the scheduler treats each slot of a
+ *   judge node like a local judge worker. Handshakes are done in separate
+ *   threads, so a silent peer does not delay the other judge nodes.
+ */
+static void accept_judge_nodes(FileDescriptor listen_fd, const string& token) noexcept {
+    // More connections that have not sent HELLO yet are dropped
+    constexpr uint MAX_PENDING_HANDSHAKES = 64;
+    static std::atomic<uint> pending_handshakes = 0;
 
-        // Job has to be reset and cleanup to be done
-        if (not winfo.is_idle) {
-            if (winfo.next_job.locked_its_problem) {
-                jobs_queue.unlock_problem(winfo.next_job.problem_id);
+    for (;;) {
+        try {
+            FileDescriptor fd{accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC)};
+            if (not fd.is_open()) {
+                if (errno != EINTR and errno != ECONNABORTED) {
+                    errlog("accept4()", errmsg());
+                    // Give the system some time
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                }
+                continue;
+            }
+            if (pending_handshakes.load() >= MAX_PENDING_HANDSHAKES) {
+                errlog("Too many pending handshakes of judge nodes, dropping a connection");
+                continue;
             }
 
-            sim::jobs::restart_job(
-                job_server::mysql, from_unsafe{to_string(winfo.next_job.id)}, false
-            );
+            ++pending_handshakes;
+            try {
+                std::thread([fd = std::move(fd), token]() mutable {
+                    welcome_judge_node(std::move(fd), token);
+                    --pending_handshakes;
+                }).detach();
+            } catch (...) {
+                --pending_handshakes;
+                throw;
+            }
+
+        } catch (const std::exception& e) {
+            ERRLOG_CATCH(e);
+        }
+    }
+}
+
+// Judge nodes judge only submissions (see JudgeOrRejudge::run()), the other
+// judge jobs would run on this machine in a worker that occupies a judge node
+// slot
+static bool may_run_on_judge_node(const JobsQueue::Job& job) noexcept {
+    return job.lane == JobsQueue::Lane::JUDGE or job.lane == JobsQueue::Lane::REJUDGE;
+}
+
+/**
+ * @brief Selects a judge job that should be passed before the best judge job
+ *   to make a better use of the judge workers' caches
+ * @details Returns a job of the same priority as @p best_judge_job from the
+ *   next few problems in the queue if it has a warm idle judge worker and
+ *   @p best_judge_job does not. The best job may be overtaken in this way only
+ *   a bounded number of times.
+ *
+ * @return the job to pass or std::nullopt if @p best_judge_job should be passed
+ */
+static std::optional<JobsQueue::JobHolder>
+judge_job_to_pass_before(const JobsQueue::JobHolder& best_judge_job) {
+    STACK_UNWINDING_MARK;
+    // Number of problems (counting the best job's one) searched for a warm job
+    constexpr size_t INVERSION_WINDOW = 16;
+    // Number of times the best job may be overtaken
+    constexpr uint MAX_INVERSIONS_PER_JOB = 8;
+
+    static uint64_t overtaken_job_id = 0;
+    static uint inversions = 0;
+    if (overtaken_job_id != best_judge_job.job.id) {
+        overtaken_job_id = best_judge_job.job.id;
+        inversions = 0;
+    }
+
+    auto has_warm_worker = [](uint64_t problem_id) {
+        return judge_workers.has_warm_idle_worker(static_cast<int64_t>(problem_id));
+    };
+    if (inversions >= MAX_INVERSIONS_PER_JOB or
+        judge_workers.has_warm_idle_worker(
+            static_cast<int64_t>(best_judge_job.problem_id),
+            may_run_on_judge_node(best_judge_job.job)
+        ))
+    {
+        return std::nullopt;
+    }
+
+    auto job = jobs_queue.best_judge_job_within_window(INVERSION_WINDOW, has_warm_worker);
+    // The warm worker may serve a judge node that cannot run the job
+    if (not job.ok() or
+        not judge_workers.has_warm_idle_worker(
+            static_cast<int64_t>(job.problem_id), may_run_on_judge_node(job.job)
+        ))
+    {
+        return std::nullopt;
+    }
+
+    ++inversions;
+    DEBUG_JOB_SERVER(stdlog(
+        "DEBUG: judge job ", job.job.id, " overtakes job ", overtaken_job_id, " (warm worker)"
+    ));
+    return std::move(job);
+}
+
+// Publishes the judge cost estimates and the ETAs of the queued judge jobs for
+// the web server, at most once per PUBLISH_INTERVAL_MS
+static void publish_judge_estimates() {
+    STACK_UNWINDING_MARK;
+    constexpr int64_t PUBLISH_INTERVAL_MS = 2'000;
+    static int64_t last_publish_ms = 0;
+    auto now = steady_now_ms();
+    if (now - last_publish_ms < PUBLISH_INTERVAL_MS) {
+        return;
+    }
+    last_publish_ms = now;
+
+    try {
+        sim::jobs::JudgeEstimates je;
+        je.problem_judge_time_ms = job_server::judge_cost_estimator.all_estimates_ms();
+        // All judge workers drain the queue together. The remaining time of the
+        // jobs in progress is not known, so it is not taken into account.
+        auto workers_no = std::max<int64_t>(1, static_cast<int64_t>(judge_workers.workers_no()));
+        int64_t preceding_cost_ms = 0;
+        for (auto const& job : jobs_queue.queued_judge_jobs()) {
+            je.job_eta_ms[job.id] = preceding_cost_ms / workers_no + job.cost_ms;
+            preceding_cost_ms += job.cost_ms;
         }
+        je.save(sim::jobs::judge_estimates_file);
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e);
+    }
+}
 
-        EventsQueue::register_event([] { spawn_worker(judge_workers); });
-    });
+// Publishes the metrics for the web server if they have changed
+static void publish_metrics() {
+    STACK_UNWINDING_MARK;
+    static std::string last_dump;
+
+    try {
+        sim::jobs::JobServerMetrics m;
+        jobs_queue.collect_queue_metrics(m);
+        job_server::metrics::collect_durations(m);
+        auto dump = m.dump();
+        if (dump != last_dump) {
+            m.save(sim::jobs::job_server_metrics_file);
+            last_dump = std::move(dump);
+        }
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e);
+    }
+}
+
+// Returns the estimated judging time of a submission to the problem. For
+// problems not judged yet the estimate is derived from the time limits. The
+// problem's simfile is loaded at most once, even if it cannot be used.
+static int64_t judge_cost_ms(uint64_t problem_id) {
+    STACK_UNWINDING_MARK;
+    auto& jce = job_server::judge_cost_estimator;
+    if (problem_id == 0 or jce.has_estimate(problem_id)) {
+        return jce.estimate_ms(problem_id);
+    }
+
+    auto prior_ms = job_server::JudgeCostEstimator::DEFAULT_COST_MS;
+    try {
+        auto stmt = job_server::mysql.prepare("SELECT simfile FROM problems WHERE id=?");
+        stmt.bind_and_execute(problem_id);
+        InplaceBuff<0> simfile_str;
+        stmt.res_bind_all(simfile_str);
+        if (stmt.next()) {
+            sim::Simfile sf(simfile_str.to_string());
+            sf.load_tests();
+            std::chrono::nanoseconds total_time_limit{0};
+            for (auto const& group : sf.tgroups) {
+                for (auto const& test : group.tests) {
+                    total_time_limit += test.time_limit;
+                }
+            }
+            prior_ms = job_server::JudgeCostEstimator::prior_from_time_limits(total_time_limit);
+        }
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e); // The default estimate will do
+    }
+    jce.set_prior(problem_id, prior_ms);
+    return jce.estimate_ms(problem_id);
+}
+
+// Adds the pending jobs from the database to jobs_queue
+static void sync_jobs_queue_with_db() {
+    STACK_UNWINDING_MARK;
+
+    uint64_t jid = 0;
+    EnumVal<sim::jobs::Job::Type> jtype{};
+    mysql::Optional<decltype(sim::jobs::Job::creator)::value_type> creator;
+    mysql::Optional<decltype(sim::jobs::Job::aux_id)::value_type> aux_id;
+    uint priority = 0;
+    InplaceBuff<512> info;
+    // Select jobs
+    auto stmt = job_server::mysql.prepare("SELECT id, type, creator, priority, aux_id, info "
+                                          "FROM jobs "
+                                          "WHERE status=? "
+                                          "ORDER BY priority DESC, id ASC LIMIT 4");
+    stmt.res_bind_all(jid, jtype, creator, priority, aux_id, info);
+    // Sets job's status to NOTICED_PENDING
+    auto mark_stmt = job_server::mysql.prepare("UPDATE jobs SET status=? WHERE id=?");
+    // Add jobs to internal queue
+    using JT = sim::jobs::Job::Type;
+    using Lane = JobsQueue::Lane;
+    for (;;) {
+        stmt.bind_and_execute(EnumVal(sim::jobs::Job::Status::PENDING));
+        if (not stmt.next()) {
+            break;
+        }
+
+        do {
+            DEBUG_JOB_SERVER(stdlog("DEBUG: Fetched from DB: job ", jid);)
+            auto add_judge_job = [&](uint64_t problem_id, bool locks_problem, Lane lane) {
+                jobs_queue.add_judge_job(
+                    jid,
+                    priority,
+                    problem_id,
+                    locks_problem,
+                    lane,
+                    creator.value_or(0),
+                    judge_cost_ms(problem_id)
+                );
+            };
+
+            // Assign job to its category
+            switch (jtype) {
+            case JT::JUDGE_SUBMISSION:
+            case JT::REJUDGE_SUBMISSION: {
+                auto opt = str2num<uint64_t>(from_unsafe{sim::jobs::extract_dumped_string(info)});
+                if (not opt) {
+                    THROW("Corrupted job's info field");
+                }
+
+                add_judge_job(
+                    opt.value(),
+                    false,
+                    (jtype == JT::JUDGE_SUBMISSION ? Lane::JUDGE : Lane::REJUDGE)
+                );
+                break;
+            }
+
+            case JT::ADD_PROBLEM__JUDGE_MODEL_SOLUTION:
+                add_judge_job(0, false, Lane::MODEL_SOLUTION);
+                break;
+
+            case JT::REUPLOAD_PROBLEM__JUDGE_MODEL_SOLUTION:
+                add_judge_job(aux_id.value(), true, Lane::MODEL_SOLUTION);
+                break;
+
+            // Problem job
+            case JT::REUPLOAD_PROBLEM:
+            case JT::EDIT_PROBLEM:
+            case JT::DELETE_PROBLEM:
+            case JT::MERGE_PROBLEMS:
+            case JT::CHANGE_PROBLEM_STATEMENT:
+            case JT::RESET_PROBLEM_TIME_LIMITS_USING_MODEL_SOLUTION:
+                jobs_queue.add_problem_management_job(jid, priority, aux_id.value());
+                break;
+
+            // Other job (local jobs that don't have associated problem)
+            case JT::ADD_PROBLEM:
+            case JT::RESELECT_FINAL_SUBMISSIONS_IN_CONTEST_PROBLEM:
+            case JT::MERGE_USERS:
+            case JT::DELETE_USER:
+            case JT::DELETE_CONTEST:
+            case JT::DELETE_CONTEST_ROUND:
+            case JT::DELETE_CONTEST_PROBLEM:
+            case JT::DELETE_FILE:
+                jobs_queue.add_other_job(jid, priority);
+                break;
+            }
+            mark_stmt.bind_and_execute(EnumVal(sim::jobs::Job::Status::NOTICED_PENDING), jid);
+        } while (stmt.next());
+    }
+
+    jobs_queue.age_judge_jobs();
+    jobs_queue.report_wait_times_periodically();
+
+    DEBUG_JOB_SERVER(stdlog(__FILE__ ":", __LINE__, ": ", __FUNCTION__, "()");)
+    DEBUG_JOB_SERVER(jobs_queue.dump_queues();)
+}
 
 static void sync_and_assign_jobs() {
     STACK_UNWINDING_MARK;
 
-    jobs_queue.sync_with_db(); // sync before assigning
+    sync_jobs_queue_with_db(); // sync before assigning
 
     auto problem_job = jobs_queue.best_problem_job();
     auto other_job = jobs_queue.best_other_job();
@@ -859,8 +745,37 @@ static void sync_and_assign_jobs() {
             }
 
         } else if (idx == 2) { // Judge job
-            if (judge_workers.pass_job(best_job.id, judge_job.problem_id, best_job.locks_problem)) {
+            if (auto warm_job = judge_job_to_pass_before(judge_job)) {
+                // Priority inversion: pass a job to a worker that has its
+                // problem warm
+                throw_assert(judge_workers.pass_job(
+                    warm_job->job.id,
+                    warm_job->problem_id,
+                    warm_job->job.locks_problem,
+                    may_run_on_judge_node(warm_job->job)
+                ));
+                warm_job->was_passed();
+            } else if (judge_workers.pass_job(
+                           best_job.id,
+                           judge_job.problem_id,
+                           best_job.locks_problem,
+                           may_run_on_judge_node(best_job)
+                       ))
+            {
                 judge_job.was_passed();
+            } else if (not may_run_on_judge_node(best_job)) {
+                // The best job cannot run on the idle judge nodes, but the
+                // submissions queued after it can
+                auto node_job = jobs_queue.best_judge_job_satisfying(may_run_on_judge_node);
+                if (node_job.ok() and
+                    judge_workers.pass_job(
+                        node_job.job.id, node_job.problem_id, node_job.job.locks_problem
+                    ))
+                {
+                    node_job.was_passed();
+                } else {
+                    selector[2].ok = false; // No more workers available
+                }
             } else {
                 selector[2].ok = false; // No more workers available
             }
@@ -884,6 +799,8 @@ static void sync_and_assign_jobs() {
             selector[2] = {judge_job.ok(), judge_job};
         }
     }
+    publish_judge_estimates();
+    publish_metrics();
 }
 
 static void events_loop() noexcept {
@@ -986,7 +903,7 @@ static void events_loop() noexcept {
                             break;
                         }
 
-                        jobs_queue.sync_with_db();
+                        sync_jobs_queue_with_db();
                         while (EventsQueue::process_next_event()) {
                         }
 
@@ -1183,7 +1100,15 @@ int main() {
         clean_up_db();
 
         ConfigFile cf;
-        cf.add_vars("js_local_workers", "js_judge_workers");
+        cf.add_vars(
+            "js_local_workers",
+            "js_judge_workers",
+            "js_judge_nodes_address",
+            "js_judge_nodes_token",
+            "js_judge_node_slots",
+            "js_stub_judge_ms",
+            "sql_tracing_slow_query_ms"
+        );
         cf.load_config_from_file("sim.conf");
 
         size_t lworkers_no = cf["js_local_workers"].as<size_t>().value_or(0);
@@ -1198,12 +1123,52 @@ int main() {
                   "than 0");
         }
 
+        string judge_nodes_address = cf["js_judge_nodes_address"].as_string();
+        string judge_nodes_token;
+        size_t judge_node_slots = 0;
+        if (not judge_nodes_address.empty()) {
+            judge_nodes_token = cf["js_judge_nodes_token"].as_string();
+            if (judge_nodes_token.empty()) {
+                THROW("sim.conf: js_judge_nodes_token has to be set if "
+                      "js_judge_nodes_address is set");
+            }
+            judge_node_slots = cf["js_judge_node_slots"].as<size_t>().value_or(0);
+            if (judge_node_slots < 1) {
+                THROW("sim.conf: js_judge_node_slots has to be an integer "
+                      "greater than 0 if js_judge_nodes_address is set");
+            }
+        }
+
+        if (const auto& var = cf["js_stub_judge_ms"]; not var.as_string().empty()) {
+            auto stub_judge_ms = var.as<uint64_t>();
+            if (not stub_judge_ms) {
+                THROW("sim.conf: js_stub_judge_ms has to be a non-negative integer");
+            }
+            job_server::stub_judge_time = std::chrono::milliseconds(*stub_judge_ms);
+        }
+
+        if (const auto& var = cf["sql_tracing_slow_query_ms"]; not var.as_string().empty()) {
+            auto slow_query_ms = var.as<uint64_t>();
+            if (not slow_query_ms) {
+                THROW("sim.conf: sql_tracing_slow_query_ms has to be a non-negative integer");
+            }
+            sim::mysql::tracing::enable(std::chrono::milliseconds(*slow_query_ms));
+        }
+
         // clang-format off
         stdlog("\n=================== Job server launched ==================="
                "\nPID: ", getpid(),
                "\nlocal workers: ", lworkers_no,
-               "\njudge workers: ", jworkers_no);
+               "\njudge workers: ", jworkers_no,
+               "\njudge node slots: ", judge_node_slots);
         // clang-format on
+        if (job_server::stub_judge_time) {
+            stdlog("WARNING: submissions are not judged (js_stub_judge_ms is set)");
+        }
+
+        local_workers.set_slots_no(lworkers_no);
+        // Transient slots are taken by the connections of judge nodes
+        judge_workers.set_slots_no(jworkers_no, judge_node_slots);
 
         for (size_t i = 0; i < lworkers_no; ++i) {
             spawn_worker(local_workers);
@@ -1213,6 +1178,16 @@ int main() {
             spawn_worker(judge_workers);
         }
 
+        if (not judge_nodes_address.empty()) {
+            stdlog("Accepting judge nodes on ", judge_nodes_address);
+            std::thread(
+                accept_judge_nodes,
+                sim::judge_node::listen_on(judge_nodes_address, 64),
+                std::move(judge_nodes_token)
+            )
+                .detach();
+        }
+
     } catch (const std::exception& e) {
         ERRLOG_CATCH(e);
         return 1;
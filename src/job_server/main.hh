@@ -1,9 +1,32 @@
 #pragma once
 
-#include <simlib/mysql/mysql.hh>
+#include "judge_cost_estimator.hh"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <sim/judge_node/protocol.hh>
+#include <sim/mysql/mysql.hh>
+#include <string>
 
 namespace job_server {
 
-extern thread_local mysql::Connection mysql;
+extern thread_local sim::mysql::Connection mysql;
+
+struct JudgeNode {
+    std::string name;
+    sim::judge_node::Connection conn;
+};
+
+// Set iff the current worker judges submissions on a remote judge node
+extern thread_local std::shared_ptr<JudgeNode> judge_node;
+
+// Shared by all threads: judge workers record judging times, the scheduler uses
+// the estimates
+extern JudgeCostEstimator judge_cost_estimator;
+
+// Set iff submissions are not judged but every judging takes this time (for
+// load testing of the web server, see js_stub_judge_ms in sim.conf)
+extern std::optional<std::chrono::milliseconds> stub_judge_time;
 
 } // namespace job_server
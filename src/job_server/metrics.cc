@@ -0,0 +1,75 @@
+#include "metrics.hh"
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string;
+
+namespace {
+
+// Ring buffer of the recent durations
+struct RecentDurations {
+    std::vector<int64_t> durations_ms;
+    size_t next_idx = 0;
+
+    void add(int64_t duration_ms) {
+        if (durations_ms.size() < job_server::metrics::RECENT_DURATIONS_NUM) {
+            durations_ms.emplace_back(duration_ms);
+        } else {
+            durations_ms[next_idx] = duration_ms;
+            next_idx = (next_idx + 1) % durations_ms.size();
+        }
+    }
+};
+
+constexpr std::array<const char*, 6> judge_stage_names = {
+    "package_load",
+    "solution_compilation",
+    "checker_compilation",
+    "initial_judging",
+    "final_judging",
+    "db_update",
+};
+
+struct {
+    std::mutex mtx;
+    std::map<string, RecentDurations, std::less<>> queue_waits;
+    std::array<RecentDurations, judge_stage_names.size()> judge_stages;
+} recent; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+} // namespace
+
+namespace job_server::metrics {
+
+void record_queue_wait(StringView queue, std::chrono::milliseconds wait_time) {
+    std::lock_guard lock{recent.mtx};
+    auto it = recent.queue_waits.find(queue);
+    if (it == recent.queue_waits.end()) {
+        it = recent.queue_waits.emplace(queue.to_string(), RecentDurations{}).first;
+    }
+    it->second.add(wait_time.count());
+}
+
+void record_judge_stage(JudgeStage stage, std::chrono::nanoseconds duration) {
+    auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    std::lock_guard lock{recent.mtx};
+    recent.judge_stages[static_cast<size_t>(stage)].add(duration_ms);
+}
+
+void collect_durations(sim::jobs::JobServerMetrics& m) {
+    std::lock_guard lock{recent.mtx};
+    for (auto const& [queue, rd] : recent.queue_waits) {
+        m.queue_wait_ms[queue] = sim::jobs::JobServerMetrics::Durations::of(rd.durations_ms);
+    }
+    for (size_t i = 0; i < judge_stage_names.size(); ++i) {
+        if (not recent.judge_stages[i].durations_ms.empty()) {
+            m.judge_stage_ms[judge_stage_names[i]] =
+                sim::jobs::JobServerMetrics::Durations::of(recent.judge_stages[i].durations_ms);
+        }
+    }
+}
+
+} // namespace job_server::metrics
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <sim/jobs/job_server_metrics.hh>
+#include <simlib/string_view.hh>
+
+/**
+ * Recent durations measured by the job server: queue wait times and the stages
+ * of judging. Only the last RECENT_DURATIONS_NUM durations of every kind are
+ * kept. All functions are thread-safe.
+ */
+namespace job_server::metrics {
+
+constexpr size_t RECENT_DURATIONS_NUM = 1024;
+
+enum class JudgeStage : uint8_t {
+    PACKAGE_LOAD,
+    SOLUTION_COMPILATION,
+    CHECKER_COMPILATION,
+    INITIAL_JUDGING,
+    FINAL_JUDGING,
+    DB_UPDATE,
+};
+
+// @p queue is the name of the queue the job was waiting in, e.g. "judge_jobs"
+void record_queue_wait(StringView queue, std::chrono::milliseconds wait_time);
+
+void record_judge_stage(JudgeStage stage, std::chrono::nanoseconds duration);
+
+// Fills in queue_wait_ms and judge_stage_ms of @p m
+void collect_durations(sim::jobs::JobServerMetrics& m);
+
+// Records the duration of its lifetime as @p stage
+class JudgeStageTimer {
+    JudgeStage stage_;
+    std::chrono::steady_clock::time_point beg_ = std::chrono::steady_clock::now();
+
+public:
+    explicit JudgeStageTimer(JudgeStage stage) noexcept : stage_{stage} {}
+
+    JudgeStageTimer(const JudgeStageTimer&) = delete;
+    JudgeStageTimer(JudgeStageTimer&&) = delete;
+    JudgeStageTimer& operator=(const JudgeStageTimer&) = delete;
+    JudgeStageTimer& operator=(JudgeStageTimer&&) = delete;
+
+    ~JudgeStageTimer() {
+        try {
+            record_judge_stage(stage_, std::chrono::steady_clock::now() - beg_);
+        } catch (...) {
+            // Metrics are not worth failing the job
+        }
+    }
+};
+
+} // namespace job_server::metrics
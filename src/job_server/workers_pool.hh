@@ -0,0 +1,414 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <simlib/logger.hh>
+#include <simlib/macros/stack_unwinding.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/throw_assert.hh>
+#include <thread>
+#include <vector>
+
+namespace job_server {
+
+/**
+ * @brief Pool of threads that process jobs passed from the main thread.
+ *
+ * Workers live in a fixed array of slots. Each slot has its own mutex and
+ * condition variable, so passing a job wakes exactly one thread and does not
+ * contend with other workers. Idle workers push their slot on a lock-free
+ * stack; the thread that calls pass_job() (the job server's main thread) takes
+ * the whole stack at once into its private list of idle workers.
+ *
+ * Slots of transient workers (see spawn_transient_worker()) are separate from
+ * the slots of the other workers, so that neither kind can take the capacity
+ * reserved for the other.
+ *
+ * Each slot remembers the problem of the last job passed to it. Jobs of a
+ * problem are passed to an idle worker that handled that problem most recently
+ * if there is one, as it probably has the problem package loaded (warm).
+ *
+ * A transient worker may have a liveness check. It is run before a job is
+ * passed to the worker; a worker that fails it dies instead of taking the job.
+ */
+class WorkersPool {
+public:
+    struct NextJob {
+        uint64_t id;
+        int64_t problem_id; // negative indicates that no problem is associated
+                            // with the job
+        bool locked_its_problem;
+    };
+
+    struct WorkerInfo {
+        NextJob next_job{0, -1, false};
+        bool is_idle = false;
+        bool is_transient = false; // see spawn_transient_worker()
+    };
+
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    struct Slot {
+        std::mutex mtx;
+        std::condition_variable cv;
+        WorkerInfo info; // guarded by mtx
+        bool has_job = false; // guarded by mtx
+        bool must_die = false; // guarded by mtx
+        std::atomic<uint32_t> next_idle{NO_SLOT}; // link in the idle stack
+        bool is_used = false; // guarded by WorkersPool::slots_mtx_
+        bool is_transient = false; // constant after set_slots_no()
+        // Problem of the last job passed to the worker (negative if none).
+        // Accessed only by the thread that calls pass_job() (or before the
+        // worker starts).
+        int64_t last_problem_id = -1;
+        // Liveness check of a transient worker (empty if none). Accessed like
+        // last_problem_id.
+        std::function<bool()> is_alive;
+    };
+
+    std::mutex slots_mtx_; // taken only when spawning and burying workers
+    std::unique_ptr<Slot[]> slots_; // NOLINT(modernize-avoid-c-arrays)
+    uint32_t slots_no_ = 0;
+    uint32_t transient_slots_begin_ = 0; // slots [begin, slots_no_) are transient
+    std::atomic<uint32_t> idle_head_{NO_SLOT};
+    // Idle workers taken from the idle stack, the most recently idle are at the
+    // end. Accessed only by the thread that calls pass_job().
+    std::vector<uint32_t> idle_slots_;
+    std::atomic<size_t> workers_no_{0};
+
+    std::function<void(NextJob)> job_handler_;
+    std::function<void()> worker_becomes_idle_callback_;
+    std::function<void(WorkerInfo)> worker_dies_callback_;
+    std::function<void()> worker_init_;
+    std::chrono::milliseconds death_delay_ = std::chrono::seconds(3);
+
+    void push_idle(uint32_t slot_idx) noexcept {
+        auto& slot = slots_[slot_idx];
+        uint32_t head = idle_head_.load(std::memory_order_relaxed);
+        do {
+            slot.next_idle.store(head, std::memory_order_relaxed);
+        } while (not idle_head_.compare_exchange_weak(
+            head, slot_idx, std::memory_order_release, std::memory_order_relaxed
+        ));
+    }
+
+    void collect_idle_workers() {
+        uint32_t head = idle_head_.exchange(NO_SLOT, std::memory_order_acquire);
+        auto old_size = idle_slots_.size();
+        for (; head != NO_SLOT; head = slots_[head].next_idle.load(std::memory_order_relaxed)) {
+            idle_slots_.emplace_back(head);
+        }
+        // Stack yields the most recently idle workers first
+        std::reverse(idle_slots_.begin() + static_cast<ptrdiff_t>(old_size), idle_slots_.end());
+    }
+
+    bool may_take(uint32_t slot_idx, bool may_be_transient) const noexcept {
+        return may_be_transient or not slots_[slot_idx].is_transient;
+    }
+
+    // Returns an iterator to the most recently idle worker that handled a job
+    // of the problem @p problem_id or idle_slots_.end() if there is no such one
+    std::vector<uint32_t>::iterator
+    find_warm_idle_worker(int64_t problem_id, bool may_be_transient) {
+        if (problem_id <= 0) {
+            return idle_slots_.end();
+        }
+        for (auto it = idle_slots_.end(); it != idle_slots_.begin();) {
+            --it;
+            if (slots_[*it].last_problem_id == problem_id and may_take(*it, may_be_transient)) {
+                return it;
+            }
+        }
+        return idle_slots_.end();
+    }
+
+    // Returns whether the idle worker in @p slot_idx passes its liveness check
+    bool is_alive(uint32_t slot_idx) noexcept {
+        auto& slot = slots_[slot_idx];
+        if (not slot.is_alive) {
+            return true;
+        }
+        try {
+            return slot.is_alive();
+        } catch (const std::exception& e) {
+            ERRLOG_CATCH(e);
+            return false;
+        }
+    }
+
+    // Makes the idle worker in @p slot_idx, already taken from the idle
+    // workers, die
+    void retire_idle_worker(uint32_t slot_idx) {
+        auto& slot = slots_[slot_idx];
+        {
+            std::lock_guard<std::mutex> lock(slot.mtx);
+            slot.must_die = true;
+        }
+        slot.cv.notify_one();
+    }
+
+    // Returns std::nullopt if the worker has to die
+    std::optional<NextJob> wait_for_next_job(uint32_t slot_idx) {
+        STACK_UNWINDING_MARK;
+        auto& slot = slots_[slot_idx];
+        // Mark as idle
+        {
+            std::lock_guard<std::mutex> lock(slot.mtx);
+            throw_assert(not slot.info.is_idle);
+            slot.info.is_idle = true;
+            slot.has_job = false;
+        }
+        push_idle(slot_idx);
+
+        if (worker_becomes_idle_callback_) {
+            worker_becomes_idle_callback_();
+        }
+
+        // Wait for a job to be assigned to us (current worker)
+        std::unique_lock<std::mutex> lock(slot.mtx);
+        slot.cv.wait(lock, [&] { return slot.has_job or slot.must_die; });
+        if (slot.must_die) {
+            return std::nullopt;
+        }
+        return slot.info.next_job;
+    }
+
+    void bury_worker(uint32_t slot_idx) noexcept {
+        WorkerInfo winfo;
+        {
+            auto& slot = slots_[slot_idx];
+            std::lock_guard<std::mutex> lock(slot.mtx);
+            winfo = slot.info;
+            // A worker may die only while it is not in the idle stack
+            slot.info = WorkerInfo{};
+            slot.has_job = false;
+            slot.must_die = false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(slots_mtx_);
+            slots_[slot_idx].is_used = false;
+        }
+        --workers_no_;
+
+        if (worker_dies_callback_) {
+            try {
+                worker_dies_callback_(winfo);
+            } catch (const std::exception& e) {
+                ERRLOG_CATCH(e);
+            }
+        }
+    }
+
+    void spawn_worker_impl(
+        std::function<void()> init, bool is_transient, std::function<bool()> is_alive
+    ) {
+        STACK_UNWINDING_MARK;
+
+        uint32_t slot_idx = (is_transient ? transient_slots_begin_ : 0);
+        uint32_t slots_end = (is_transient ? slots_no_ : transient_slots_begin_);
+        {
+            std::lock_guard<std::mutex> lock(slots_mtx_);
+            while (slot_idx < slots_end and slots_[slot_idx].is_used) {
+                ++slot_idx;
+            }
+            if (slot_idx == slots_end) {
+                THROW(
+                    "No free ",
+                    (is_transient ? "transient " : ""),
+                    "worker slot (slots: ",
+                    slots_end - (is_transient ? transient_slots_begin_ : 0),
+                    ')'
+                );
+            }
+            slots_[slot_idx].is_used = true;
+            slots_[slot_idx].last_problem_id = -1;
+            slots_[slot_idx].is_alive = std::move(is_alive);
+        }
+        {
+            auto& slot = slots_[slot_idx];
+            std::lock_guard<std::mutex> lock(slot.mtx);
+            slot.info.is_transient = is_transient;
+        }
+        ++workers_no_;
+
+        try {
+            std::thread([this, slot_idx, init = std::move(init)] {
+                try {
+                    if (init) {
+                        init();
+                    }
+
+                    while (auto job = wait_for_next_job(slot_idx)) {
+                        job_handler_(*job);
+                    }
+                    // Failed the liveness check while idle
+                    bury_worker(slot_idx);
+                    return;
+
+                } catch (const std::exception& e) {
+                    ERRLOG_CATCH(e);
+                } catch (...) {
+                    ERRLOG_CATCH();
+                }
+                // Sleep for a while to prevent exception inundation
+                std::this_thread::sleep_for(death_delay_);
+                bury_worker(slot_idx);
+            }).detach();
+        } catch (...) {
+            --workers_no_;
+            std::lock_guard<std::mutex> lock(slots_mtx_);
+            slots_[slot_idx].is_used = false;
+            throw;
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a workers pool
+     *
+     * @param job_handler a function that will be called in a worker with a job
+     *   to handle as the first argument
+     * @param idle_callback a function to call (from the worker thread) when a
+     *   worker becomes idle
+     * @param dead_callback a function to call (from the dying worker thread)
+     *   when a worker dies, e.g. because of an exception thrown by
+     *   @p job_handler
+     * @param worker_init a function to call in a newly spawned worker before it
+     *   processes any job
+     */
+    WorkersPool(
+        std::function<void(NextJob)> job_handler,
+        std::function<void()> idle_callback,
+        std::function<void(WorkerInfo)> dead_callback,
+        std::function<void()> worker_init = {}
+    )
+    : job_handler_(std::move(job_handler))
+    , worker_becomes_idle_callback_(std::move(idle_callback))
+    , worker_dies_callback_(std::move(dead_callback))
+    , worker_init_(std::move(worker_init)) {
+        throw_assert(job_handler_);
+    }
+
+    WorkersPool(const WorkersPool&) = delete;
+    WorkersPool(WorkersPool&&) = delete;
+    WorkersPool& operator=(const WorkersPool&) = delete;
+    WorkersPool& operator=(WorkersPool&&) = delete;
+    ~WorkersPool() = default;
+
+    /// Has to be called once, before spawning any worker. At most @p slots_no
+    /// workers and at most @p transient_slots_no transient workers may live at
+    /// once.
+    void set_slots_no(size_t slots_no, size_t transient_slots_no = 0) {
+        STACK_UNWINDING_MARK;
+        std::lock_guard<std::mutex> lock(slots_mtx_);
+        throw_assert(
+            slots_ == nullptr and slots_no < NO_SLOT and transient_slots_no < NO_SLOT - slots_no
+        );
+        auto all_slots_no = slots_no + transient_slots_no;
+        slots_ = std::make_unique<Slot[]>(all_slots_no); // NOLINT(modernize-avoid-c-arrays)
+        slots_no_ = static_cast<uint32_t>(all_slots_no);
+        transient_slots_begin_ = static_cast<uint32_t>(slots_no);
+        for (auto i = transient_slots_begin_; i < slots_no_; ++i) {
+            slots_[i].is_transient = true;
+        }
+        idle_slots_.reserve(all_slots_no);
+    }
+
+    /// Time a worker that threw an exception sleeps before dying (to prevent
+    /// exception inundation)
+    void set_death_delay(std::chrono::milliseconds delay) noexcept { death_delay_ = delay; }
+
+    void spawn_worker() { spawn_worker_impl(worker_init_, false, {}); }
+
+    /**
+     * @brief Spawns a worker that calls @p init instead of the pool's
+     *   worker_init
+     * @details The worker is reported as transient to the dead_callback, so that
+     *   it may not be respawned, e.g. because it serves a connection that is
+     *   gone. If @p is_alive is set, it is called (from the thread that calls
+     *   pass_job()) before passing a job to the idle worker. If it returns
+     *   false, the worker dies while idle and the job goes to another worker.
+     */
+    void spawn_transient_worker(
+        std::function<void()> init, std::function<bool()> is_alive = {}
+    ) {
+        spawn_worker_impl(std::move(init), true, std::move(is_alive));
+    }
+
+    size_t workers_no() const noexcept { return workers_no_.load(); }
+
+    /// Must not be called concurrently with pass_job()
+    bool has_warm_idle_worker(int64_t problem_id, bool may_be_transient = true) {
+        collect_idle_workers();
+        return find_warm_idle_worker(problem_id, may_be_transient) != idle_slots_.end();
+    }
+
+    /**
+     * @brief Passes the job to an idle worker
+     * @details Must not be called concurrently. Prefers a warm worker, i.e. one
+     *   that handled a job of @p problem_id most recently. Otherwise, jobs with a
+     *   problem go to the longest idle worker (evicting the least recently used
+     *   package) and jobs without a problem to the most recently idle one.
+     *   If @p may_be_transient is false, the job is not passed to a transient
+     *   worker. Idle workers that fail their liveness check on the way die.
+     *
+     * @return whether the job was passed (false iff there is no idle worker
+     *   that may take it)
+     */
+    bool pass_job(
+        uint64_t job_id,
+        int64_t problem_id = -1,
+        bool locks_problem = false,
+        bool may_be_transient = true
+    ) {
+        STACK_UNWINDING_MARK;
+
+        collect_idle_workers();
+        auto can_take = [&](uint32_t slot_idx) { return may_take(slot_idx, may_be_transient); };
+        uint32_t slot_idx = NO_SLOT;
+        while (slot_idx == NO_SLOT) {
+            auto it = find_warm_idle_worker(problem_id, may_be_transient);
+            if (it == idle_slots_.end()) {
+                if (problem_id > 0) {
+                    it = std::find_if(idle_slots_.begin(), idle_slots_.end(), can_take);
+                } else {
+                    auto rit = std::find_if(idle_slots_.rbegin(), idle_slots_.rend(), can_take);
+                    it = (rit == idle_slots_.rend() ? idle_slots_.end() : std::prev(rit.base()));
+                }
+                if (it == idle_slots_.end()) {
+                    return false;
+                }
+            }
+            slot_idx = *it;
+            idle_slots_.erase(it);
+            if (not is_alive(slot_idx)) {
+                retire_idle_worker(slot_idx);
+                slot_idx = NO_SLOT;
+            }
+        }
+
+        // Assign the job to the idle worker
+        auto& slot = slots_[slot_idx];
+        if (problem_id > 0) {
+            slot.last_problem_id = problem_id;
+        }
+        {
+            std::lock_guard<std::mutex> lock(slot.mtx);
+            slot.info.is_idle = false;
+            slot.info.next_job = {job_id, problem_id, locks_problem};
+            slot.has_job = true;
+        }
+        slot.cv.notify_one();
+        return true;
+    }
+};
+
+} // namespace job_server
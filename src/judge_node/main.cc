@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <sim/jobs/utils.hh>
+#include <sim/judge_node/protocol.hh>
+#include <sim/judging_config.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/file_contents.hh>
+#include <simlib/file_descriptor.hh>
+#include <simlib/file_manip.hh>
+#include <simlib/sim/judge_worker.hh>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utime.h>
+#include <vector>
+
+using sim::JudgeReport;
+using sim::jobs::append_dumped;
+using sim::jobs::extract_dumped_int;
+using sim::jobs::extract_dumped_string;
+using sim::judge_node::CompilationStage;
+using sim::judge_node::Connection;
+using sim::judge_node::ConnectionLost;
+using sim::judge_node::MessageType;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct Options {
+    string server_address;
+    size_t slots = 1;
+    string token;
+    string name;
+    string cache_dir = "judge-node-cache";
+    uint64_t cache_max_size = uint64_t{4} << 30;
+};
+
+/**
+ * Problem packages fetched from the job server, stored as <file id>.zip in the
+ * cache directory. When the total size of the packages exceeds the limit, the
+ * least recently used ones are removed.
+ */
+class PackageCache {
+    string dir_;
+    uint64_t max_size_;
+    // Taken exclusively to remove packages and shared to use them
+    std::shared_mutex mtx_;
+
+    template <class Func>
+    void for_each_file(Func&& func) {
+        std::unique_ptr<DIR, decltype(&closedir)> dir{opendir(dir_.c_str()), closedir};
+        if (dir == nullptr) {
+            THROW("opendir(", dir_, ')', errmsg());
+        }
+        while (dirent* entry = readdir(dir.get())) {
+            if (strcmp(entry->d_name, ".") != 0 and strcmp(entry->d_name, "..") != 0) {
+                func(StringView{entry->d_name});
+            }
+        }
+    }
+
+    void fetch(Connection& conn, uint64_t file_id, const string& path, size_t slot_idx) {
+        STACK_UNWINDING_MARK;
+
+        // The package appears under its name only when it is complete
+        auto tmp_path = concat_tostr(path, ".tmp", slot_idx);
+        FileDescriptor fd{tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_0644};
+        if (not fd.is_open()) {
+            THROW("open(", tmp_path, ')', errmsg());
+        }
+
+        for (uint64_t offset = 0;;) {
+            string request;
+            append_dumped(request, file_id);
+            append_dumped(request, offset);
+            conn.send(MessageType::FETCH_FILE, request);
+
+            auto msg = conn.receive();
+            if (msg.type != MessageType::FILE_CHUNK) {
+                throw ConnectionLost(concat_tostr(
+                    "Expected FILE_CHUNK from the job server, got: ", static_cast<int>(msg.type)
+                ));
+            }
+            StringView data = msg.payload;
+            auto file_size = extract_dumped_int<uint64_t>(data);
+            if (write_all(fd, data.data(), data.size()) != data.size()) {
+                THROW("write()", errmsg());
+            }
+            offset += data.size();
+            if (offset >= file_size) {
+                break;
+            }
+            if (data.empty()) {
+                THROW("Package ", file_id, " shrank while being fetched");
+            }
+        }
+
+        if (fd.close()) {
+            THROW("close()", errmsg());
+        }
+        if (rename(tmp_path.c_str(), path.c_str())) {
+            THROW("rename()", errmsg());
+        }
+    }
+
+    void evict_least_recently_used() {
+        STACK_UNWINDING_MARK;
+        std::unique_lock<std::shared_mutex> lock(mtx_);
+
+        struct Package {
+            time_t last_use;
+            uint64_t size;
+            string path;
+        };
+        vector<Package> packages;
+        uint64_t total_size = 0;
+        for_each_file([&](StringView name) {
+            if (not has_suffix(name, ".zip")) {
+                return;
+            }
+            auto path = concat_tostr(dir_, name);
+            struct stat64 st = {};
+            if (stat64(path.c_str(), &st) == 0) {
+                packages.push_back(
+                    {st.st_mtime, static_cast<uint64_t>(st.st_size), std::move(path)}
+                );
+                total_size += static_cast<uint64_t>(st.st_size);
+            }
+        });
+
+        std::sort(packages.begin(), packages.end(), [](const Package& a, const Package& b) {
+            return a.last_use < b.last_use;
+        });
+        // The most recently used package stays even if it exceeds the limit
+        for (size_t i = 0; i + 1 < packages.size() and total_size > max_size_; ++i) {
+            if (unlink(packages[i].path.c_str()) == 0) {
+                total_size -= packages[i].size;
+                stdlog("Evicted package ", packages[i].path, " from the cache");
+            }
+        }
+    }
+
+public:
+    PackageCache(string dir, uint64_t max_size) : dir_(std::move(dir)), max_size_(max_size) {
+        STACK_UNWINDING_MARK;
+        if (dir_.empty() or dir_.back() != '/') {
+            dir_ += '/';
+        }
+        if (mkdir(dir_.c_str(), S_0755) and errno != EEXIST) {
+            THROW("mkdir(", dir_, ')', errmsg());
+        }
+        // Remove leftovers of interrupted fetches and judgings
+        for_each_file([&](StringView name) {
+            if (not has_suffix(name, ".zip")) {
+                (void)unlink(concat_tostr(dir_, name).c_str());
+            }
+        });
+    }
+
+    [[nodiscard]] const string& dir() const noexcept { return dir_; }
+
+    // Calls @p func with the path of the package @p file_id, fetching the
+    // package through @p conn first if it is not in the cache
+    template <class Func>
+    void use_package(Connection& conn, uint64_t file_id, size_t slot_idx, Func&& func) {
+        STACK_UNWINDING_MARK;
+
+        auto path = concat_tostr(dir_, file_id, ".zip");
+        bool fetched = false;
+        {
+            std::shared_lock<std::shared_mutex> lock(mtx_);
+            if (access(path.c_str(), F_OK) == 0) {
+                (void)utime(path.c_str(), nullptr); // Mark as recently used
+            } else {
+                fetch(conn, file_id, path, slot_idx);
+                fetched = true;
+            }
+            func(path, fetched);
+        }
+
+        if (fetched) {
+            evict_least_recently_used();
+        }
+    }
+};
+
+// State of one judge slot; it is reused by the consecutive jobs, so that the
+// loaded package and the compiled checker may be reused too
+struct Slot {
+    size_t idx;
+    sim::JudgeWorker jworker{{
+        .checker_time_limit = sim::CHECKER_TIME_LIMIT,
+        .checker_memory_limit_in_bytes = sim::CHECKER_MEMORY_LIMIT,
+        .score_cut_lambda = sim::SCORE_CUT_LAMBDA,
+    }};
+    // Set iff jworker holds the package with this file id
+    std::optional<uint64_t> loaded_package_file_id;
+    bool checker_is_compiled = false;
+
+    explicit Slot(size_t slot_idx) : idx(slot_idx) {}
+};
+
+void judge(Connection& conn, PackageCache& cache, Slot& slot, StringView data) {
+    STACK_UNWINDING_MARK;
+
+    auto job_id = extract_dumped_int<uint64_t>(data);
+    auto package_file_id = extract_dumped_int<uint64_t>(data);
+    auto lang = static_cast<sim::SolutionLanguage>(extract_dumped_int<uint8_t>(data));
+    auto source = extract_dumped_string(data);
+    stdlog("Slot ", slot.idx, ": judging job ", job_id, " (package: ", package_file_id, ')');
+
+    auto log = [&conn](auto&&... args) {
+        conn.send(MessageType::LOG, concat_tostr(std::forward<decltype(args)>(args)...));
+    };
+
+    try {
+        if (slot.loaded_package_file_id == package_file_id) {
+            log("Problem package is already loaded (warm start)");
+        } else {
+            slot.loaded_package_file_id = std::nullopt;
+            slot.checker_is_compiled = false;
+            cache.use_package(
+                conn,
+                package_file_id,
+                slot.idx,
+                [&](const string& package_path, bool fetched) {
+                    slot.jworker.load_package(package_path, std::nullopt);
+                    log("Loading problem package (cold start",
+                        (fetched ? ", fetched from the job server" : ""),
+                        ")... done.");
+                }
+            );
+            slot.loaded_package_file_id = package_file_id;
+        }
+
+        auto solution_path = concat_tostr(cache.dir(), "slot", slot.idx, ".solution");
+        put_file_contents(solution_path, source);
+        string compilation_errors;
+        if (slot.jworker.compile_solution(
+                solution_path,
+                lang,
+                sim::SOLUTION_COMPILATION_TIME_LIMIT,
+                sim::SOLUTION_COMPILATION_MEMORY_LIMIT,
+                &compilation_errors,
+                sim::COMPILATION_ERRORS_MAX_LENGTH,
+                nullptr,
+                std::nullopt
+            ))
+        {
+            log("Compiling solution... failed:\n", compilation_errors);
+            string msg;
+            append_dumped(msg, static_cast<uint8_t>(CompilationStage::SOLUTION));
+            append_dumped(msg, compilation_errors);
+            return conn.send(MessageType::COMPILATION_FAILED, msg);
+        }
+        log("Compiling solution... done.");
+
+        if (slot.checker_is_compiled) {
+            log("Checker is already compiled");
+        } else if (slot.jworker.compile_checker(
+                       sim::SOLUTION_COMPILATION_TIME_LIMIT,
+                       sim::CHECKER_COMPILATION_MEMORY_LIMIT,
+                       &compilation_errors,
+                       sim::COMPILATION_ERRORS_MAX_LENGTH
+                   ))
+        {
+            log("Compiling checker... failed:\n", compilation_errors);
+            string msg;
+            append_dumped(msg, static_cast<uint8_t>(CompilationStage::CHECKER));
+            append_dumped(msg, compilation_errors);
+            return conn.send(MessageType::COMPILATION_FAILED, msg);
+        } else {
+            log("Compiling checker... done.");
+            slot.checker_is_compiled = true;
+        }
+
+        auto send_judge_report = [&](const JudgeReport& jreport, bool final, bool partial) {
+            string msg;
+            append_dumped(msg, static_cast<uint8_t>(final));
+            append_dumped(msg, static_cast<uint8_t>(partial));
+            sim::judge_node::append_dumped(msg, jreport);
+            conn.send(MessageType::JUDGE_REPORT, msg);
+        };
+
+        sim::VerboseJudgeLogger logger(true);
+        auto initial_jrep =
+            slot.jworker.judge(false, logger, [&](const JudgeReport& partial) {
+                send_judge_report(partial, false, true);
+            });
+        send_judge_report(initial_jrep, false, false);
+
+        auto final_jrep = slot.jworker.judge(true, logger, [&](const JudgeReport& partial) {
+            send_judge_report(partial, true, true);
+        });
+        send_judge_report(final_jrep, true, false);
+
+        conn.send(MessageType::JUDGING_DONE, "");
+
+    } catch (const ConnectionLost&) {
+        throw;
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e);
+        // The state of the judge worker is unknown
+        slot.loaded_package_file_id = std::nullopt;
+        slot.checker_is_compiled = false;
+        conn.send(MessageType::JUDGE_ERROR, e.what());
+    }
+}
+
+// Keeps the slot connected to the job server and judges the jobs it sends
+[[noreturn]] void serve_slot(const Options& opts, PackageCache& cache, size_t slot_idx) {
+    constexpr auto MIN_RECONNECT_DELAY = std::chrono::seconds(1);
+    constexpr auto MAX_RECONNECT_DELAY = std::chrono::seconds(60);
+
+    Slot slot{slot_idx};
+    std::chrono::seconds reconnect_delay = MIN_RECONNECT_DELAY;
+    for (;;) {
+        try {
+            Connection conn{sim::judge_node::connect_to(opts.server_address)};
+            // Otherwise, the slot would wait forever for a job from a crashed
+            // job server machine
+            conn.enable_keepalive();
+            string hello;
+            append_dumped(hello, sim::judge_node::PROTOCOL_VERSION);
+            append_dumped(hello, opts.token);
+            append_dumped(hello, concat_tostr(opts.name, '#', slot_idx));
+            conn.send(MessageType::HELLO, hello);
+            stdlog("Slot ", slot_idx, ": connected to ", opts.server_address);
+
+            for (;;) {
+                auto msg = conn.receive();
+                if (msg.type != MessageType::JUDGE) {
+                    throw ConnectionLost(concat_tostr(
+                        "Unexpected message from the job server: ", static_cast<int>(msg.type)
+                    ));
+                }
+                judge(conn, cache, slot, msg.payload);
+                reconnect_delay = MIN_RECONNECT_DELAY;
+            }
+
+        } catch (const std::exception& e) {
+            ERRLOG_CATCH(e);
+        }
+
+        // The job server may be restarting or reject the connection, so back
+        // off exponentially
+        std::this_thread::sleep_for(reconnect_delay);
+        reconnect_delay = std::min(reconnect_delay * 2, MAX_RECONNECT_DELAY);
+    }
+}
+
+void help(const char* program_name) {
+    if (program_name == nullptr) {
+        program_name = "judge-node";
+    }
+
+    printf("Usage: %s [options] <job server address>\n", program_name);
+    puts("Judges submissions for the job server listening on <job server address> "
+         "(ADDR:PORT,\nsee js_judge_nodes_address in sim.conf)");
+    puts("");
+    puts("Options:");
+    puts("  --slots <n>             Number of submissions judged at once (default: 1)");
+    puts("  --token-file <path>     File with the token to present to the job server\n"
+         "                            (js_judge_nodes_token in sim.conf), required");
+    puts("  --name <name>           Name of the node in the job server logs (default:\n"
+         "                            host name)");
+    puts("  --cache-dir <dir>       Directory for the fetched problem packages (default:\n"
+         "                            judge-node-cache)");
+    puts("  --cache-size <MiB>      Size limit of the cached packages (default: 4096)");
+}
+
+std::optional<Options> parse_options(int argc, char** argv) {
+    STACK_UNWINDING_MARK;
+
+    Options opts;
+    std::optional<string> token_file;
+    for (int i = 1; i < argc; ++i) {
+        StringView arg = argv[i];
+        auto value = [&]() -> StringView {
+            if (i + 1 == argc) {
+                THROW("Missing value of the option ", arg);
+            }
+            return argv[++i];
+        };
+        auto number_value = [&]() -> uint64_t {
+            auto val = value();
+            auto num = str2num<uint64_t>(val);
+            if (not num or *num == 0) {
+                THROW("Invalid value of the option ", arg, ": ", val);
+            }
+            return *num;
+        };
+
+        if (arg == "--slots") {
+            opts.slots = number_value();
+        } else if (arg == "--token-file") {
+            token_file = value().to_string();
+        } else if (arg == "--name") {
+            opts.name = value().to_string();
+        } else if (arg == "--cache-dir") {
+            opts.cache_dir = value().to_string();
+        } else if (arg == "--cache-size") {
+            opts.cache_max_size = number_value() << 20;
+        } else if (has_prefix(arg, "-") or not opts.server_address.empty()) {
+            return std::nullopt;
+        } else {
+            opts.server_address = arg.to_string();
+        }
+    }
+
+    if (opts.server_address.empty() or not token_file) {
+        return std::nullopt;
+    }
+
+    opts.token = get_file_contents(*token_file);
+    while (not opts.token.empty() and isspace(opts.token.back())) {
+        opts.token.pop_back();
+    }
+    if (opts.token.empty()) {
+        THROW("Token file ", *token_file, " is empty");
+    }
+
+    if (opts.name.empty()) {
+        std::array<char, 256> hostname{};
+        if (gethostname(hostname.data(), hostname.size() - 1)) {
+            THROW("gethostname()", errmsg());
+        }
+        opts.name = hostname.data();
+    }
+
+    return opts;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        auto opts = parse_options(argc, argv);
+        if (not opts) {
+            help(argc > 0 ? argv[0] : nullptr);
+            return 1;
+        }
+
+        PackageCache cache{opts->cache_dir, opts->cache_max_size};
+        // clang-format off
+        stdlog("\n=================== Judge node launched ==================="
+               "\nPID: ", getpid(),
+               "\nname: ", opts->name,
+               "\nslots: ", opts->slots,
+               "\njob server: ", opts->server_address);
+        // clang-format on
+
+        vector<std::thread> slots;
+        for (size_t i = 0; i < opts->slots; ++i) {
+            slots.emplace_back([&opts, &cache, i] { serve_slot(*opts, cache, i); });
+        }
+        for (auto& slot : slots) {
+            slot.join();
+        }
+
+    } catch (const std::exception& e) {
+        ERRLOG_CATCH(e);
+        return 1;
+    }
+
+    return 0;
+}
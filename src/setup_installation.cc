@@ -140,7 +140,7 @@ int main(int argc, char** argv) {
         create_db_config(db_config_path);
     }
 
-    mysql::Connection conn;
+    sim::mysql::Connection conn;
     try {
         // Get connection
         conn = sim::mysql::make_conn_with_credential_file(db_config_path);
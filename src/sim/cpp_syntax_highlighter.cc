@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <sim/cpp_syntax_highlighter.hh>
 #include <simlib/logger.hh>
@@ -7,6 +9,10 @@
 #include <simlib/throw_assert.hh>
 #include <simlib/utilities.hh>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using std::array;
 using std::string;
 using std::vector;
@@ -50,24 +56,24 @@ struct Word {
                                                   , style(stl) {}
 };
 
+// Classes are defined in styles.css (table.code-view)
 constexpr array<CStringView, 11> begin_style{{
-    "<span style=\"color:#00a000\">",
-    "<span style=\"color:#a0a0a0\">",
-    "<span style=\"color:#0000ff;font-weight:bold\">",
-    "<span style=\"color:#c90049;font-weight:bold;\">",
-    "<span style=\"color:#ff0000\">",
-    "<span style=\"color:#e0a000\">",
-    "<span style=\"color:#d923e9\">",
-    "<span style=\"color:#d923e9\">",
-    "<span style=\"color:#a800ff\">",
-    "<span style=\"color:#0086b3\">",
-    "<span style=\"color:#515125\">",
+    "<span class=\"pp\">",
+    "<span class=\"cm\">",
+    "<span class=\"bt\">",
+    "<span class=\"kw\">",
+    "<span class=\"sl\">",
+    "<span class=\"ch\">",
+    "<span class=\"ec\">",
+    "<span class=\"nu\">",
+    "<span class=\"cn\">",
+    "<span class=\"fn\">",
+    "<span class=\"op\">",
 }};
 
 constexpr CStringView end_style = "</span>";
 
-constexpr array<Word, 124> words{{
-    {"", COMMENT}, // Guard - ignored
+constexpr array<Word, 123> words{{
     {"uint_least16_t", BUILTIN_TYPE},
     {"uint_least32_t", BUILTIN_TYPE},
     {"uint_least64_t", BUILTIN_TYPE},
@@ -193,6 +199,161 @@ constexpr array<Word, 124> words{{
     {"nullptr", CONSTANT},
 }};
 
+constexpr size_t max_word_size = [] {
+    size_t res = 0;
+    for (const auto& word : words) {
+        res = std::max<size_t>(res, word.size);
+    }
+    return res;
+}();
+
+// Returns the style of @p word or -1 if @p word is not one of words
+StyleType style_of_word(StringView word) {
+    static const auto sorted_words = [] {
+        vector<std::pair<StringView, Style>> all;
+        for (const auto& word : words) {
+            all.emplace_back(StringView{word.str, word.size}, word.style);
+        }
+        std::stable_sort(all.begin(), all.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        // A latter occurrence of a word overrides the former ones (e.g. nullptr
+        // is a CONSTANT rather than a KEYWORD)
+        vector<std::pair<StringView, Style>> res;
+        for (const auto& elem : all) {
+            if (not res.empty() and res.back().first == elem.first) {
+                res.back() = elem;
+            } else {
+                res.emplace_back(elem);
+            }
+        }
+        return res;
+    }();
+
+    if (word.size() > max_word_size) {
+        return -1;
+    }
+    auto it = std::lower_bound(
+        sorted_words.begin(),
+        sorted_words.end(),
+        word,
+        [](const auto& elem, StringView w) { return elem.first < w; }
+    );
+    return (it != sorted_words.end() and it->first == word ? it->second : -1);
+}
+
+inline bool is_name(char c) noexcept { return (c == '_' || c == '$' || is_alnum(c)); }
+
+/*
+ * Scanning functions below take a position range [beg, end) in a string and
+ * return the position of the first character that does not satisfy the
+ * criteria or end if there is no such character. Where SSE2 is available,
+ * they classify 16 characters at once.
+ */
+
+#ifdef __SSE2__
+
+inline __m128i load_16_chars(const char* s) noexcept {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+}
+
+// Returns mask of the characters that are equal to @p c
+inline __m128i chars_equal_to(__m128i chars, char c) noexcept {
+    return _mm_cmpeq_epi8(chars, _mm_set1_epi8(c));
+}
+
+// Returns mask of the characters that are in range [@p lo, @p hi], both @p lo
+// and @p hi have to be positive
+inline __m128i chars_in_range(__m128i chars, char lo, char hi) noexcept {
+    return _mm_and_si128(
+        _mm_cmpgt_epi8(chars, _mm_set1_epi8(static_cast<char>(lo - 1))),
+        _mm_cmplt_epi8(chars, _mm_set1_epi8(static_cast<char>(hi + 1)))
+    );
+}
+
+// Returns bit mask of the characters for which is_name() is true
+inline uint32_t name_chars_mask(__m128i chars) noexcept {
+    // Setting bit 0x20 maps upper case letters to the lower case ones, but it
+    // also maps some control characters to digits, so digits are checked
+    // before the mapping
+    auto letters = chars_in_range(_mm_or_si128(chars, _mm_set1_epi8(0x20)), 'a', 'z');
+    auto digits = chars_in_range(chars, '0', '9');
+    auto others = _mm_or_si128(chars_equal_to(chars, '_'), chars_equal_to(chars, '$'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letters, digits), others));
+}
+
+#endif
+
+// Skips characters for which is_name() is true
+int skip_name_chars(const char* s, int beg, int end) noexcept {
+    int i = beg;
+#ifdef __SSE2__
+    for (; i + 16 <= end; i += 16) {
+        uint32_t other_chars = ~name_chars_mask(load_16_chars(s + i)) & 0xffff;
+        if (other_chars) {
+            return i + __builtin_ctz(other_chars);
+        }
+    }
+#endif
+    while (i < end && is_name(s[i])) {
+        ++i;
+    }
+    return i;
+}
+
+// Skips white-spaces: ' ', '\t' and '\n'
+int skip_spaces(const char* s, int beg, int end) noexcept {
+    int i = beg;
+#ifdef __SSE2__
+    for (; i + 16 <= end; i += 16) {
+        auto chars = load_16_chars(s + i);
+        auto spaces = _mm_or_si128(
+            _mm_or_si128(chars_equal_to(chars, ' '), chars_equal_to(chars, '\t')),
+            chars_equal_to(chars, '\n')
+        );
+        uint32_t other_chars = ~_mm_movemask_epi8(spaces) & 0xffff;
+        if (other_chars) {
+            return i + __builtin_ctz(other_chars);
+        }
+    }
+#endif
+    while (i < end && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n')) {
+        ++i;
+    }
+    return i;
+}
+
+// Skips characters other than @p a, @p b and @p c
+int find_first_of(const char* s, int beg, int end, char a, char b, char c) noexcept {
+    int i = beg;
+#ifdef __SSE2__
+    for (; i + 16 <= end; i += 16) {
+        auto chars = load_16_chars(s + i);
+        auto found = _mm_or_si128(
+            _mm_or_si128(chars_equal_to(chars, a), chars_equal_to(chars, b)),
+            chars_equal_to(chars, c)
+        );
+        uint32_t found_mask = _mm_movemask_epi8(found);
+        if (found_mask) {
+            return i + __builtin_ctz(found_mask);
+        }
+    }
+#endif
+    while (i < end && s[i] != a && s[i] != b && s[i] != c) {
+        ++i;
+    }
+    return i;
+}
+
+// Skips characters other than @p c
+int find_char(const char* s, int beg, int end, char c) noexcept {
+    if (beg >= end) {
+        return beg;
+    }
+    const void* ptr = memchr(s + beg, c, end - beg);
+    return (ptr ? static_cast<const char*>(ptr) - s : end);
+}
+
 } // anonymous namespace
 
 /* Some ugly meta programming used to extract KEYWORDS from words */
@@ -253,30 +414,23 @@ static_assert(
 
 namespace sim {
 
-CppSyntaxHighlighter::CppSyntaxHighlighter() {
-    static_assert(
-        words[0].size == 0,
-        "First (zero) element of words is a guard - because "
-        "Aho-Corasick implementation takes only positive IDs"
-    );
-    for (uint i = 1; i < words.size(); ++i) {
-        aho.add_pattern({words[i].str, words[i].size}, i);
-    }
-
-    aho.build_fail_edges();
-}
-
 string CppSyntaxHighlighter::operator()(CStringView input) const {
     string filtered_input; // Used only in the below if
     // Remove (stupid) windows newlines as they impede parsing a lot
     if (input.find("\r\n") != CStringView::npos) {
         filtered_input.reserve(input.size());
-        for (size_t i = 0; i < input.size(); ++i) {
-            // i + 1 is safe - std::string adds extra '\0' at the end
-            if (input[i] == '\r' and input[i + 1] == '\n') {
-                ++i;
+        for (size_t i = 0; i < input.size();) {
+            const void* cr = memchr(input.data() + i, '\r', input.size() - i);
+            size_t k = (cr ? static_cast<const char*>(cr) - input.data() : input.size());
+            filtered_input.append(input.data() + i, k - i);
+            if (k == input.size()) {
+                break;
+            }
+            // k + 1 is safe - std::string adds extra '\0' at the end
+            if (input[k + 1] != '\n') {
+                filtered_input += '\r';
             }
-            filtered_input += input[i];
+            i = k + 1;
         }
 
         input = filtered_input;
@@ -300,14 +454,19 @@ string CppSyntaxHighlighter::operator()(CStringView input) const {
     string str(BEGIN_GUARDS, GUARD_CHARACTER); // input without "\\\n" sequences
     str.reserve(end + 64); // Pre-allocation
 
-    for (int i = 0; i < end; ++i) {
-        // i + 1 is safe - std::string adds extra '\0' at the end
-        if (input[i] == '\\' && input[i + 1] == '\n') {
-            ++i;
-            continue;
+    for (int i = 0; i < end;) {
+        int k = find_char(input.data(), i, end, '\\');
+        str.append(input.data() + i, k - i);
+        if (k == end) {
+            break;
+        }
+        // k + 1 is safe - std::string adds extra '\0' at the end
+        if (input[k + 1] == '\n') {
+            i = k + 2;
+        } else {
+            str += '\\';
+            i = k + 1;
         }
-
-        str += input[i];
     }
 
     end = str.size();
@@ -323,21 +482,25 @@ string CppSyntaxHighlighter::operator()(CStringView input) const {
     /* Mark comments string / character literals */
 
     for (int i = BEGIN; i < end; ++i) {
+        i = find_first_of(str.data(), i, end, '/', '"', '\'');
+        if (i == end) {
+            break;
+        }
+
         // Comments
         if (str[i] == '/') {
             if (str[i + 1] == '/') { // (One-)line comment
                 begs[i] = COMMENT;
-                i += 2;
-                while (i < end && str[i] != '\n') {
-                    ++i;
-                }
+                i = find_char(str.data(), i + 2, end, '\n');
                 ++ends[i];
 
             } else if (str[i + 1] == '*') { // Multi-line comment
                 begs[i] = COMMENT;
-                i += 3;
+                // Unterminated comment "/*" at the very end must not end
+                // beyond the guards
+                i = std::min(i + 3, end);
                 while (i < end && !(str[i - 1] == '*' && str[i] == '/')) {
-                    ++i;
+                    i = find_char(str.data(), i + 1, end, '/');
                 }
                 ++ends[i + 1];
             }
@@ -349,11 +512,11 @@ string CppSyntaxHighlighter::operator()(CStringView input) const {
             char literal_delim = str[i];
             begs[i++] = (literal_delim == '"' ? STRING_LITERAL : CHARACTER);
             // End on newline - to mitigate invalid literals
-            while (i < end && str[i] != literal_delim && str[i] != '\n') {
-                // Ordinary character
-                if (str[i] != '\\') {
-                    ++i;
-                    continue;
+            for (;;) {
+                // Skip ordinary characters
+                i = find_first_of(str.data(), i, end, literal_delim, '\n', '\\');
+                if (i == end || str[i] != '\\') {
+                    break;
                 }
 
                 /* Escape sequence */
@@ -429,8 +592,6 @@ string CppSyntaxHighlighter::operator()(CStringView input) const {
 
     DEBUG_CSH(dump_begs_ends();)
 
-    auto is_name = [](auto c) { return (c == '_' || c == '$' || is_alnum(c)); };
-
     /* Mark preprocessor, functions and numbers */
 
     for (int i = BEGIN, styles_depth = 0; i < end; ++i) {
@@ -648,27 +809,34 @@ string CppSyntaxHighlighter::operator()(CStringView input) const {
             return;
         }
 
-        auto aho_res = aho.search_in(substring(str, beg, endi));
-        // Handle last one to eliminate right boundary checks
-        for (int i = endi - 1; i >= beg;) {
-            int k = aho.pattern_id(aho_res[i - beg]);
-            int j = 0;
+        for (int i = beg; i < endi;) {
+            i = skip_spaces(str.data(), i, endi);
+            if (i == endi) {
+                break;
+            }
 
-            static_assert(BEGIN_GUARDS > 0);
-            static_assert(END_GUARDS > 0);
-            // Found a word
-            if (k && !is_name(str[i + 1]) && !is_name(str[j = i - words[k].size])) {
-                DEBUG_CSH(stdlog("aho: ", j + 1, ": ", words[k].str);)
-                begs[j + 1] = words[k].style;
-                ++ends[i + 1];
-                i = j;
+            if (is_name(str[i])) {
+                int k = skip_name_chars(str.data(), i, endi);
+                static_assert(BEGIN_GUARDS > 0);
+                static_assert(END_GUARDS > 0);
+                // Only a whole name may be a word
+                if (!is_name(str[i - 1]) && !is_name(str[k])) {
+                    StyleType style = style_of_word(substring(str, i, k));
+                    if (style != -1) {
+                        DEBUG_CSH(stdlog("word: ", i, ": ", substring(str, i, k));)
+                        begs[i] = style;
+                        ++ends[k];
+                    }
+                }
+                i = k;
                 continue;
             }
+
             if (is_operator(str[i])) {
                 begs[i] = OPERATOR;
                 ++ends[i + 1];
             }
-            --i;
+            ++i;
         }
     };
 
@@ -703,6 +871,25 @@ string CppSyntaxHighlighter::operator()(CStringView input) const {
                  "<tr><td id=\"L1\" line=\"1\"></td><td>";
     // Stack of styles (needed to properly break on '\n')
     vector<StyleType> style_stack;
+    // Returns position of the beginning of the same style as the top style
+    // that follows the top style ending at str[i] after only spaces and tabs,
+    // or -1 if there is no such style. Then the top style can be continued over
+    // the spaces and tabs instead of ending it and beginning it again. Here j is
+    // the position in input that corresponds to i.
+    auto continuation_of_top_style = [&](int i, int j) {
+        int k = i;
+        // Nothing may begin or end among the spaces and tabs and they must not
+        // contain erased "\\\n" sequences
+        while (k < end && (str[k] == ' ' || str[k] == '\t') && begs[k] == -1 &&
+               ends[k + 1] == 0 && str[k] == input[j + k - i])
+        {
+            ++k;
+        }
+        if (k > i && k < end && begs[k] == style_stack.back() && str[k] == input[j + k - i]) {
+            return k;
+        }
+        return -1;
+    };
     int first_unescaped = BEGIN;
     // i iterates over str, j iterates over input
     for (int i = BEGIN, j = 0, line = 1; i < end; ++i, ++j) {
@@ -722,6 +909,8 @@ string CppSyntaxHighlighter::operator()(CStringView input) const {
                 // Style elision (to compress and simplify output)
                 if (style_stack.back() == begs[i]) {
                     begs[i] = -1;
+                } else if (int k = continuation_of_top_style(i, j); k != -1) {
+                    begs[k] = -1;
                 } else {
                     style_stack.pop_back();
                     res += end_style;
@@ -0,0 +1,717 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <dirent.h>
+#include <exception>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sim/db/dump.hh>
+#include <sim/db/schema.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/errmsg.hh>
+#include <simlib/file_contents.hh>
+#include <simlib/file_perms.hh>
+#include <simlib/macros/stack_unwinding.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/string_compare.hh>
+#include <simlib/string_transform.hh>
+#include <simlib/throw_assert.hh>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+
+using sim::db::DUMP_CHUNK_IDS;
+using std::optional;
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr CStringView schema_file = "schema.sql.gz";
+constexpr CStringView checksums_file = "checksums";
+constexpr CStringView update_times_file = "update_times";
+constexpr CStringView chunk_file_suffix = ".sql.gz";
+
+// Rows are inserted by statements of at most this size, unless a single row
+// is bigger; in any case a statement fits in the server's max_allowed_packet
+// if it can
+constexpr size_t INSERT_STATEMENT_SIZE = 1 << 20;
+
+// Writes a gzip-compressed file that appears under its path only after commit()
+class GzFileWriter {
+    string path_;
+    string tmp_path_;
+    gzFile file_ = nullptr;
+
+public:
+    explicit GzFileWriter(string path)
+    : path_{std::move(path)}
+    , tmp_path_{concat_tostr(path_, ".tmp")} {
+        // The dump contains e.g. password hashes
+        int fd = open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_0600);
+        if (fd == -1) {
+            THROW("open(", tmp_path_, ')', errmsg());
+        }
+        file_ = gzdopen(fd, "wb");
+        if (file_ == nullptr) {
+            (void)close(fd);
+            (void)unlink(tmp_path_.c_str());
+            THROW("gzdopen(", tmp_path_, ')');
+        }
+    }
+
+    GzFileWriter(const GzFileWriter&) = delete;
+    GzFileWriter(GzFileWriter&&) = delete;
+    GzFileWriter& operator=(const GzFileWriter&) = delete;
+    GzFileWriter& operator=(GzFileWriter&&) = delete;
+
+    ~GzFileWriter() {
+        if (file_) {
+            (void)gzclose(file_);
+            (void)unlink(tmp_path_.c_str());
+        }
+    }
+
+    void write(StringView data) {
+        if (data.empty()) {
+            return;
+        }
+        if (gzwrite(file_, data.data(), static_cast<unsigned>(data.size())) == 0) {
+            int errnum = 0;
+            THROW("gzwrite(", tmp_path_, "): ", gzerror(file_, &errnum));
+        }
+    }
+
+    void commit() {
+        if (gzclose(std::exchange(file_, nullptr)) != Z_OK) {
+            (void)unlink(tmp_path_.c_str());
+            THROW("gzclose(", tmp_path_, ')');
+        }
+        if (rename(tmp_path_.c_str(), path_.c_str())) {
+            THROW("rename(", tmp_path_, ", ", path_, ')', errmsg());
+        }
+    }
+};
+
+// Calls @p callback with every line (without the trailing newline) of the
+// gzip-compressed file @p path
+template <class Func>
+void for_each_line_of_gz_file(const string& path, Func&& callback) {
+    constexpr size_t READ_SIZE = 1 << 16;
+
+    std::unique_ptr<gzFile_s, decltype(&gzclose)> file{gzopen(path.c_str(), "rb"), gzclose};
+    if (file == nullptr) {
+        THROW("gzopen(", path, ')', errmsg());
+    }
+    string data;
+    for (;;) {
+        auto old_size = data.size();
+        data.resize(old_size + READ_SIZE);
+        int len = gzread(file.get(), data.data() + old_size, READ_SIZE);
+        if (len < 0) {
+            int errnum = 0;
+            THROW("gzread(", path, "): ", gzerror(file.get(), &errnum));
+        }
+        data.resize(old_size + static_cast<size_t>(len));
+        if (len == 0) {
+            break;
+        }
+
+        size_t line_beg = 0;
+        for (auto pos = data.find('\n', old_size); pos != string::npos;
+             pos = data.find('\n', pos + 1))
+        {
+            callback(StringView{data}.substring(line_beg, pos));
+            line_beg = pos + 1;
+        }
+        data.erase(0, line_beg);
+    }
+    if (not data.empty()) {
+        callback(StringView{data});
+    }
+}
+
+// Calls @p callback with the name of every entry of the directory @p dir_path
+// except "." and ".."
+template <class Func>
+void for_each_dir_entry(const string& dir_path, Func&& callback) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir{opendir(dir_path.c_str()), closedir};
+    if (dir == nullptr) {
+        THROW("opendir(", dir_path, ')', errmsg());
+    }
+    while (dirent* entry = readdir(dir.get())) {
+        StringView name = entry->d_name;
+        if (name != "." and name != "..") {
+            callback(name);
+        }
+    }
+}
+
+bool is_dir(const string& path) {
+    struct stat64 st = {};
+    return stat64(path.c_str(), &st) == 0 and S_ISDIR(st.st_mode);
+}
+
+void create_dir(const string& path) {
+    if (mkdir(path.c_str(), S_0755) and errno != EEXIST) {
+        THROW("mkdir(", path, ')', errmsg());
+    }
+}
+
+struct Column {
+    string name;
+    bool is_binary;
+};
+
+struct Table {
+    string name;
+    vector<Column> columns;
+    vector<string> primary_key;
+    bool is_chunked; // The primary key is an integer `id`
+};
+
+Table get_table(sim::mysql::Connection& mysql, const string& table_name) {
+    STACK_UNWINDING_MARK;
+
+    constexpr std::array<StringView, 6> binary_types = {
+        "binary", "varbinary", "tinyblob", "blob", "mediumblob", "longblob"
+    };
+    constexpr std::array<StringView, 5> integer_types = {
+        "tinyint", "smallint", "mediumint", "int", "bigint"
+    };
+    auto is_one_of = [](StringView type, const auto& types) {
+        return std::find(types.begin(), types.end(), type) != types.end();
+    };
+
+    string sql = "SELECT COLUMN_NAME, DATA_TYPE, COLUMN_KEY FROM information_schema.COLUMNS "
+                 "WHERE TABLE_SCHEMA=DATABASE() AND TABLE_NAME=";
+    sim::db::append_sql_string_literal(sql, table_name);
+    sql += " ORDER BY ORDINAL_POSITION";
+    auto res = mysql.query(sql);
+
+    Table table{.name = table_name, .columns = {}, .primary_key = {}, .is_chunked = false};
+    bool integer_id = false;
+    while (res.next()) {
+        auto name = res[0].to_string();
+        table.columns.push_back({.name = name, .is_binary = is_one_of(res[1], binary_types)});
+        if (res[2] == "PRI") {
+            integer_id |= (name == "id" and is_one_of(res[1], integer_types));
+            table.primary_key.emplace_back(std::move(name));
+        }
+    }
+    table.is_chunked = (integer_id and table.primary_key.size() == 1);
+    return table;
+}
+
+struct Chunk {
+    const Table* table;
+    uint64_t first_id; // 0 if the table is not chunked
+    // The table did not change since the previous dump, so the chunk's
+    // checksum is taken from it
+    bool unchanged = false;
+};
+
+string chunk_path(StringView dir, StringView table_name, uint64_t first_id) {
+    return concat_tostr(dir, table_name, '/', first_id, chunk_file_suffix);
+}
+
+optional<uint64_t> chunk_first_id(StringView file_name) {
+    if (not has_suffix(file_name, chunk_file_suffix)) {
+        return std::nullopt;
+    }
+    return str2num<uint64_t>(file_name.substring(0, file_name.size() - chunk_file_suffix.size()));
+}
+
+string chunk_where(const Chunk& chunk) {
+    if (not chunk.table->is_chunked) {
+        return {};
+    }
+    return concat_tostr(
+        " WHERE `id`>=", chunk.first_id, " AND `id`<", chunk.first_id + DUMP_CHUNK_IDS
+    );
+}
+
+// Returns the row count and the checksum of the rows of @p chunk. The rows are
+// hashed on the server, so an unchanged chunk is not transferred at all, but
+// all its rows are still read and hashed.
+string chunk_checksum(sim::mysql::Connection& mysql, const Chunk& chunk) {
+    STACK_UNWINDING_MARK;
+
+    string columns;
+    string null_flags;
+    for (auto const& column : chunk.table->columns) {
+        // Hashes have a fixed length, so the concatenation is unambiguous even
+        // if the values contain the separator
+        back_insert(columns, ",MD5(`", column.name, "`)");
+        back_insert(null_flags, (null_flags.empty() ? "" : ","), "ISNULL(`", column.name, "`)");
+    }
+    // XOR of the first 64 bits of the MD5 of every row. NULL values are
+    // skipped by CONCAT_WS(), so the NULL flags are hashed too.
+    auto res = mysql.query(
+        "SELECT COUNT(*), BIT_XOR(CAST(CONV(LEFT(MD5(CONCAT_WS('#'",
+        columns,
+        ",CONCAT(",
+        null_flags,
+        "))),16),16,10) AS UNSIGNED)) FROM `",
+        chunk.table->name,
+        '`',
+        chunk_where(chunk)
+    );
+    throw_assert(res.next());
+    return concat_tostr(res[0], ':', res[1]);
+}
+
+// Returns the maximum size of a statement, with the terminating ';', that the
+// server accepts
+size_t get_max_statement_size(sim::mysql::Connection& mysql) {
+    STACK_UNWINDING_MARK;
+    auto res = mysql.query("SELECT @@max_allowed_packet");
+    throw_assert(res.next());
+    // The packet holds also the command byte
+    return str2num<size_t>(res[0]).value() - 1;
+}
+
+// Returns the number of written rows. A row that does not fit in a statement of
+// @p max_statement_size with other rows is inserted by a statement of its own.
+uint64_t write_chunk(
+    sim::mysql::Connection& mysql, const Chunk& chunk, string path, size_t max_statement_size
+) {
+    STACK_UNWINDING_MARK;
+
+    const auto& table = *chunk.table;
+    string columns;
+    for (auto const& column : table.columns) {
+        back_insert(columns, (columns.empty() ? "" : ","), '`', column.name, '`');
+    }
+    // The order has to be deterministic, so that an unchanged chunk is
+    // identical after being rewritten
+    string order_by;
+    for (auto const& column_name : table.primary_key) {
+        back_insert(order_by, (order_by.empty() ? "" : ","), '`', column_name, '`');
+    }
+    if (order_by.empty()) {
+        order_by = columns;
+    }
+    auto insert_prefix = concat_tostr("INSERT INTO `", table.name, "` (", columns, ") VALUES ");
+
+    GzFileWriter file{std::move(path)};
+    auto res = mysql.query(
+        "SELECT ", columns, " FROM `", table.name, '`', chunk_where(chunk), " ORDER BY ", order_by
+    );
+    auto statement_size_limit = std::min(INSERT_STATEMENT_SIZE, max_statement_size);
+    string statement;
+    string row_values;
+    uint64_t rows = 0;
+    while (res.next()) {
+        row_values = '(';
+        for (size_t i = 0; i < table.columns.size(); ++i) {
+            if (i > 0) {
+                row_values += ',';
+            }
+            if (res.is_null(i)) {
+                row_values += "NULL";
+            } else if (table.columns[i].is_binary) {
+                sim::db::append_sql_hex_literal(row_values, res[i]);
+            } else {
+                sim::db::append_sql_string_literal(row_values, res[i]);
+            }
+        }
+        row_values += ')';
+        ++rows;
+
+        // ',' before and ';' after the row
+        if (not statement.empty() and
+            statement.size() + row_values.size() + 2 > statement_size_limit)
+        {
+            statement += ";\n";
+            file.write(statement);
+            statement.clear();
+        }
+        back_insert(
+            statement,
+            (statement.empty() ? StringView{insert_prefix} : StringView{","}),
+            row_values
+        );
+    }
+    if (not statement.empty()) {
+        statement += ";\n";
+        file.write(statement);
+    }
+    file.commit();
+    return rows;
+}
+
+// Extracts the prefix of @p s up to the first @p c and the @p c itself
+StringView extract_field(StringView& s, char c) {
+    auto pos = std::min(s.find(c), s.size());
+    auto field = s.substring(0, pos);
+    s.remove_prefix(std::min(pos + 1, s.size()));
+    return field;
+}
+
+// (table name, chunk's first id) => chunk's checksum
+using Checksums = std::map<std::pair<string, uint64_t>, string>;
+
+Checksums load_checksums(const string& path) {
+    STACK_UNWINDING_MARK;
+
+    Checksums checksums;
+    if (access(path.c_str(), F_OK) != 0) {
+        return checksums;
+    }
+    auto contents = get_file_contents(path);
+    StringView str = contents;
+    while (not str.empty()) {
+        auto line = extract_field(str, '\n');
+        auto table_name = extract_field(line, ' ');
+        auto first_id = str2num<uint64_t>(extract_field(line, ' '));
+        if (not table_name.empty() and first_id and not line.empty()) {
+            checksums.emplace(std::pair{table_name.to_string(), *first_id}, line.to_string());
+        }
+    }
+    return checksums;
+}
+
+string dump_checksums(const Checksums& checksums) {
+    string res;
+    for (auto const& [chunk, checksum] : checksums) {
+        back_insert(res, chunk.first, ' ', chunk.second, ' ', checksum, '\n');
+    }
+    return res;
+}
+
+// table name => the time of the last change of the table's rows
+using UpdateTimes = std::map<string, string>;
+
+// Returns the update times of the tables that the server knows and that
+// cannot change anymore within the same second. It has to be called while the
+// tables are locked, so that the times match the dumped snapshot.
+UpdateTimes get_update_times(sim::mysql::Connection& mysql) {
+    STACK_UNWINDING_MARK;
+
+    // InnoDB keeps the update times only in memory, so they are NULL e.g.
+    // after a restart of the server
+    auto res = mysql.query(
+        "SELECT TABLE_NAME, UPDATE_TIME FROM information_schema.TABLES "
+        "WHERE TABLE_SCHEMA=DATABASE() AND UPDATE_TIME<NOW()"
+    );
+    UpdateTimes update_times;
+    while (res.next()) {
+        update_times.emplace(res[0].to_string(), res[1].to_string());
+    }
+    return update_times;
+}
+
+UpdateTimes load_update_times(const string& path) {
+    STACK_UNWINDING_MARK;
+
+    UpdateTimes update_times;
+    if (access(path.c_str(), F_OK) != 0) {
+        return update_times;
+    }
+    auto contents = get_file_contents(path);
+    StringView str = contents;
+    while (not str.empty()) {
+        auto line = extract_field(str, '\n');
+        auto table_name = extract_field(line, ' ');
+        if (not table_name.empty() and not line.empty()) {
+            update_times.emplace(table_name.to_string(), line.to_string());
+        }
+    }
+    return update_times;
+}
+
+string dump_update_times(const UpdateTimes& update_times) {
+    string res;
+    for (auto const& [table_name, update_time] : update_times) {
+        back_insert(res, table_name, ' ', update_time, '\n');
+    }
+    return res;
+}
+
+// Returns the CREATE TABLE statements of the tables from the schema file
+// @p path: table name => statement
+std::map<string, string> load_create_table_statements(const string& path) {
+    STACK_UNWINDING_MARK;
+
+    std::map<string, string> statements;
+    if (access(path.c_str(), F_OK) != 0) {
+        return statements;
+    }
+    // Every CREATE TABLE follows the DROP TABLE IF EXISTS of the table
+    constexpr StringView drop_table_prefix = "DROP TABLE IF EXISTS `";
+    optional<string> table_name;
+    for_each_line_of_gz_file(path, [&](StringView line) {
+        if (has_prefix(line, drop_table_prefix)) {
+            line.remove_prefix(drop_table_prefix.size());
+            table_name = line.substring(0, std::min(line.find('`'), line.size())).to_string();
+        } else if (table_name) {
+            statements.emplace(std::move(*table_name), line.to_string());
+            table_name = std::nullopt;
+        }
+    });
+    return statements;
+}
+
+} // namespace
+
+namespace sim::db {
+
+void append_sql_string_literal(string& sql, StringView str) {
+    // Newlines are escaped too, so that every statement fits in one line
+    sql += '\'';
+    for (char c : str) {
+        switch (c) {
+        case '\0': sql += "\\0"; break;
+        case '\n': sql += "\\n"; break;
+        case '\r': sql += "\\r"; break;
+        case '\x1a': sql += "\\Z"; break;
+        case '\'': sql += "\\'"; break;
+        case '\\': sql += "\\\\"; break;
+        default: sql += c;
+        }
+    }
+    sql += '\'';
+}
+
+void append_sql_hex_literal(string& sql, StringView bytes) {
+    constexpr char digits[] = "0123456789abcdef";
+    sql += "X'";
+    for (unsigned char c : bytes) {
+        sql += digits[c >> 4];
+        sql += digits[c & 15];
+    }
+    sql += '\'';
+}
+
+DumpStats dump(FilePath db_config_path, StringView dir, const DumpOptions& options) {
+    STACK_UNWINDING_MARK;
+
+    auto lock_conn = mysql::make_conn_with_credential_file(db_config_path);
+    auto table_names = get_all_table_names(lock_conn);
+    vector<mysql::Connection> conns;
+    for (size_t i = 0; i < std::max<size_t>(options.threads, 1); ++i) {
+        conns.emplace_back(mysql::make_conn_with_credential_file(db_config_path));
+    }
+    // Snapshots started while no table can be modified are identical
+    if (not table_names.empty()) {
+        string lock_sql;
+        for (auto const& table_name : table_names) {
+            back_insert(
+                lock_sql, (lock_sql.empty() ? "LOCK TABLES `" : ", `"), table_name, "` READ"
+            );
+        }
+        lock_conn.update(lock_sql);
+    }
+    auto update_times = get_update_times(lock_conn);
+    for (auto& conn : conns) {
+        conn.update("SET SESSION TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+        conn.update("START TRANSACTION WITH CONSISTENT SNAPSHOT, READ ONLY");
+    }
+    lock_conn.update("UNLOCK TABLES");
+
+    auto& mysql = conns.front();
+    auto max_statement_size = get_max_statement_size(mysql);
+    vector<Table> tables;
+    for (auto const& table_name : table_names) {
+        tables.emplace_back(get_table(mysql, table_name));
+    }
+
+    create_dir(dir.to_string());
+    auto schema_path = concat_tostr(dir, schema_file);
+    auto update_times_path = concat_tostr(dir, update_times_file);
+    auto checksums_path = concat_tostr(dir, checksums_file);
+    const auto old_create_table_statements = load_create_table_statements(schema_path);
+    const auto old_update_times = load_update_times(update_times_path);
+    const auto old_checksums = load_checksums(checksums_path);
+    // If this dump fails, the schema would not match the update times
+    if (unlink(update_times_path.c_str()) and errno != ENOENT) {
+        THROW("unlink(", update_times_path, ')', errmsg());
+    }
+
+    // A table is unchanged if neither its rows nor its definition changed since
+    // the previous dump
+    std::map<string, bool> is_unchanged;
+    GzFileWriter schema_file_writer{schema_path};
+    for (auto const& table : tables) {
+        auto res = mysql.query("SHOW CREATE TABLE `", table.name, '`');
+        throw_assert(res.next());
+        auto create_table_sql = res[1].to_string();
+        std::replace(create_table_sql.begin(), create_table_sql.end(), '\n', ' ');
+        schema_file_writer.write(concat_tostr(
+            "DROP TABLE IF EXISTS `", table.name, "`;\n", create_table_sql, ";\n"
+        ));
+
+        auto statement = concat_tostr(create_table_sql, ';');
+        auto update_time_it = update_times.find(table.name);
+        auto old_update_time_it = old_update_times.find(table.name);
+        auto old_statement_it = old_create_table_statements.find(table.name);
+        is_unchanged[table.name] = not options.rewrite_unchanged and
+            update_time_it != update_times.end() and
+            old_update_time_it != old_update_times.end() and
+            update_time_it->second == old_update_time_it->second and
+            old_statement_it != old_create_table_statements.end() and
+            old_statement_it->second == statement;
+    }
+    schema_file_writer.commit();
+
+    vector<Chunk> chunks;
+    uint64_t unchanged_tables = 0;
+    for (auto const& table : tables) {
+        create_dir(concat_tostr(dir, table.name));
+        if (is_unchanged[table.name]) {
+            ++unchanged_tables;
+            auto it = old_checksums.lower_bound(std::pair{table.name, uint64_t{0}});
+            for (; it != old_checksums.end() and it->first.first == table.name; ++it) {
+                auto first_id = it->first.second;
+                chunks.push_back({.table = &table, .first_id = first_id, .unchanged = true});
+            }
+            continue;
+        }
+        if (not table.is_chunked) {
+            chunks.push_back({.table = &table, .first_id = 0});
+            continue;
+        }
+        auto res = mysql.query("SELECT MIN(`id`), MAX(`id`) FROM `", table.name, '`');
+        throw_assert(res.next());
+        if (res.is_null(0)) {
+            continue; // Empty table
+        }
+        auto min_id = str2num<uint64_t>(res[0]).value();
+        auto max_id = str2num<uint64_t>(res[1]).value();
+        for (auto first_id = min_id / DUMP_CHUNK_IDS * DUMP_CHUNK_IDS; first_id <= max_id;
+             first_id += DUMP_CHUNK_IDS)
+        {
+            chunks.push_back({.table = &table, .first_id = first_id});
+        }
+    }
+
+    Checksums new_checksums;
+    std::exception_ptr error;
+    std::mutex mutex; // guards new_checksums and error
+    std::atomic<bool> failed = false;
+    std::atomic<size_t> next_chunk = 0;
+    std::atomic<uint64_t> written_chunks = 0;
+    std::atomic<uint64_t> written_rows = 0;
+
+    auto worker = [&](mysql::Connection& conn) {
+        try {
+            for (size_t i = next_chunk++; i < chunks.size() and not failed; i = next_chunk++) {
+                const auto& chunk = chunks[i];
+                auto key = std::pair{chunk.table->name, chunk.first_id};
+                auto it = old_checksums.find(key);
+                auto checksum = chunk.unchanged ? it->second : chunk_checksum(conn, chunk);
+                if (has_prefix(checksum, "0:")) {
+                    continue; // No rows
+                }
+                auto path = chunk_path(dir, chunk.table->name, chunk.first_id);
+                if (options.rewrite_unchanged or it == old_checksums.end() or
+                    it->second != checksum or access(path.c_str(), F_OK) != 0)
+                {
+                    written_rows += write_chunk(conn, chunk, std::move(path), max_statement_size);
+                    ++written_chunks;
+                }
+                std::lock_guard lock{mutex};
+                new_checksums.emplace(std::move(key), std::move(checksum));
+            }
+        } catch (...) {
+            failed = true;
+            std::lock_guard lock{mutex};
+            if (not error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    vector<std::thread> threads;
+    for (size_t i = 1; i < conns.size(); ++i) {
+        threads.emplace_back(worker, std::ref(conns[i]));
+    }
+    worker(conns.front());
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // Remove the chunks whose rows were all deleted and the left temporary files
+    uint64_t removed_chunks = 0;
+    for_each_dir_entry(dir.to_string(), [&](StringView table_name) {
+        auto table_dir = concat_tostr(dir, table_name, '/');
+        if (not is_dir(table_dir)) {
+            return;
+        }
+        for_each_dir_entry(table_dir, [&](StringView file_name) {
+            auto first_id = chunk_first_id(file_name);
+            if (first_id and new_checksums.count(std::pair{table_name.to_string(), *first_id})) {
+                return;
+            }
+            auto path = concat_tostr(table_dir, file_name);
+            if (unlink(path.c_str()) == 0 and first_id) {
+                ++removed_chunks;
+            }
+        });
+        (void)rmdir(table_dir.c_str()); // Succeeds only if the table has no rows
+    });
+
+    // The update times are valid only together with the checksums, so they are
+    // saved after them
+    put_file_contents(checksums_path, dump_checksums(new_checksums));
+    put_file_contents(update_times_path, dump_update_times(update_times));
+    return {
+        .chunks = new_checksums.size(),
+        .unchanged_tables = unchanged_tables,
+        .written_chunks = written_chunks,
+        .written_rows = written_rows,
+        .removed_chunks = removed_chunks,
+    };
+}
+
+void load_dump(mysql::Connection& mysql, StringView dir) {
+    STACK_UNWINDING_MARK;
+
+    auto max_statement_size = get_max_statement_size(mysql);
+    auto execute = [&](StringView statement) {
+        if (statement.empty()) {
+            return;
+        }
+        if (statement.size() > max_statement_size) {
+            THROW(
+                "Statement of ",
+                statement.size(),
+                " bytes does not fit in max_allowed_packet of the server. Increase it to at "
+                "least ",
+                statement.size() + 1,
+                " bytes."
+            );
+        }
+        mysql.update(statement);
+    };
+    mysql.update("SET foreign_key_checks=0");
+    for_each_line_of_gz_file(concat_tostr(dir, schema_file), execute);
+    for_each_dir_entry(dir.to_string(), [&](StringView table_name) {
+        if (not is_dir(concat_tostr(dir, table_name))) {
+            return;
+        }
+        vector<uint64_t> first_ids;
+        for_each_dir_entry(concat_tostr(dir, table_name), [&](StringView file_name) {
+            if (auto first_id = chunk_first_id(file_name)) {
+                first_ids.emplace_back(*first_id);
+            }
+        });
+        std::sort(first_ids.begin(), first_ids.end());
+        for (auto first_id : first_ids) {
+            for_each_line_of_gz_file(chunk_path(dir, table_name, first_id), execute);
+        }
+    });
+    mysql.update("SET foreign_key_checks=1");
+}
+
+} // namespace sim::db
@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <memory>
+#include <sim/internal_files/internal_file.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/errmsg.hh>
+#include <simlib/file_descriptor.hh>
+#include <simlib/file_perms.hh>
+#include <simlib/macros/stack_unwinding.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/sha.hh>
+#include <simlib/string_transform.hh>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Calls @p callback with every entry of the directory @p fd except "." and
+// "..". getdents64() with a big buffer needs fewer system calls than readdir()
+// on directories with many files.
+template <class Func>
+void for_each_dir_entry(int fd, StringView path, Func&& callback) {
+    constexpr size_t BUFF_SIZE = 1 << 16;
+    auto buff = std::make_unique<char[]>(BUFF_SIZE);
+    for (;;) {
+        auto len = getdents64(fd, buff.get(), BUFF_SIZE);
+        if (len < 0) {
+            THROW("getdents64(", path, ')', errmsg());
+        }
+        if (len == 0) {
+            return;
+        }
+        for (ssize_t pos = 0; pos < len;) {
+            const auto* entry = reinterpret_cast<const dirent64*>(buff.get() + pos);
+            pos += entry->d_reclen;
+            StringView name = entry->d_name;
+            if (name != "." and name != "..") {
+                callback(*entry);
+            }
+        }
+    }
+}
+
+// @p rel_path is the path of the directory @p fd relative to dir
+void scan_subdir(int fd, const string& rel_path, sim::internal_files::DirScan& scan) {
+    using sim::internal_files::dir;
+
+    for_each_dir_entry(fd, concat(dir, rel_path), [&](const dirent64& entry) {
+        StringView name = entry.d_name;
+        auto entry_rel_path = concat_tostr(rel_path, name);
+        auto type = entry.d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat64 st = {};
+            if (fstatat64(fd, entry.d_name, &st, AT_SYMLINK_NOFOLLOW)) {
+                THROW("fstatat64(", dir, entry_rel_path, ')', errmsg());
+            }
+            type = (S_ISDIR(st.st_mode) ? DT_DIR : DT_REG);
+        }
+
+        if (type == DT_DIR) {
+            // Blobs are referenced by links, not by the database
+            if (StringView{concat(dir, entry_rel_path, '/')} == sim::internal_files::blobs_dir) {
+                return;
+            }
+            FileDescriptor subdir_fd{openat(fd, entry.d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+            if (subdir_fd == -1) {
+                THROW("openat(", dir, entry_rel_path, ')', errmsg());
+            }
+            scan_subdir(subdir_fd, concat_tostr(entry_rel_path, '/'), scan);
+            return;
+        }
+
+        auto id_len = std::min(name.find('.'), name.size());
+        auto id = str2num<uint64_t>(name.substring(0, id_len));
+        if (id and id_len == name.size() and rel_path.empty()) {
+            scan.unsharded_files.emplace_back(concat_tostr(dir, entry_rel_path));
+        } else if (id and
+            StringView{sim::internal_files::relative_path_of(*id)} ==
+                StringView{entry_rel_path}.substring(0, rel_path.size() + id_len))
+        {
+            if (id_len == name.size()) {
+                scan.file_ids.emplace_back(*id);
+            } else {
+                scan.derived_files.emplace_back(*id, concat_tostr(dir, entry_rel_path));
+            }
+        } else {
+            scan.other_files.emplace_back(concat_tostr(dir, entry_rel_path));
+        }
+    });
+}
+
+// @p path is the path of the directory @p fd
+void walk_blobs_subdir(
+    int fd,
+    const string& path,
+    const std::function<void(const std::string& path, const struct stat64& st)>& callback
+) {
+    for_each_dir_entry(fd, path, [&](const dirent64& entry) {
+        auto entry_path = concat_tostr(path, entry.d_name);
+        struct stat64 st = {};
+        if (fstatat64(fd, entry.d_name, &st, AT_SYMLINK_NOFOLLOW)) {
+            if (errno == ENOENT) {
+                return; // Removed in the meantime
+            }
+            THROW("fstatat64(", entry_path, ')', errmsg());
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            FileDescriptor subdir_fd{openat(fd, entry.d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+            if (subdir_fd == -1) {
+                THROW("openat(", entry_path, ')', errmsg());
+            }
+            walk_blobs_subdir(subdir_fd, concat_tostr(entry_path, '/'), callback);
+        } else if (S_ISREG(st.st_mode)) {
+            callback(entry_path, st);
+        }
+    });
+}
+
+} // namespace
+
+namespace sim::internal_files {
+
+void create_parent_dirs_of(StringView path) {
+    auto slash_pos = path.rfind('/');
+    if (slash_pos == StringView::npos or slash_pos == 0) {
+        return;
+    }
+    auto parent = path.substring(0, slash_pos).to_string();
+    if (mkdir(parent.c_str(), S_0755) == 0 or errno == EEXIST) {
+        return;
+    }
+    if (errno != ENOENT) {
+        THROW("mkdir(", parent, ')', errmsg());
+    }
+    create_parent_dirs_of(parent);
+    if (mkdir(parent.c_str(), S_0755) and errno != EEXIST) {
+        THROW("mkdir(", parent, ')', errmsg());
+    }
+}
+
+decltype(path_of(0)) path_of_new_file(decltype(InternalFile::id) id) {
+    auto path = path_of(id);
+    create_parent_dirs_of(path);
+    return path;
+}
+
+std::string blob_path_of_hash(StringView hash) {
+    return concat_tostr(blobs_dir, hash.substring(0, 2), '/', hash.substring(2, 4), '/', hash);
+}
+
+std::string blob_path_of_contents(FilePath path) {
+    // Files may be big, so they are hashed in chunks and the hash of the file
+    // is the hash of the hashes of the chunks
+    constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    FileDescriptor fd(path, O_RDONLY | O_CLOEXEC);
+    if (not fd.is_open()) {
+        THROW("open(", path, ')', errmsg());
+    }
+
+    auto buff = std::make_unique<char[]>(CHUNK_SIZE);
+    std::string chunk_hashes;
+    uint64_t file_size = 0;
+    for (;;) {
+        size_t len = 0;
+        while (len < CHUNK_SIZE) {
+            auto rc = read(fd, buff.get() + len, CHUNK_SIZE - len);
+            if (rc < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                THROW("read()", errmsg());
+            }
+            if (rc == 0) {
+                break;
+            }
+            len += rc;
+        }
+        if (len == 0 and file_size > 0) {
+            break;
+        }
+        file_size += len;
+        back_insert(chunk_hashes, sha3_256(StringView{buff.get(), len}));
+        if (len < CHUNK_SIZE) {
+            break;
+        }
+    }
+
+    back_insert(chunk_hashes, ':', file_size);
+    return blob_path_of_hash(sha3_256(chunk_hashes));
+}
+
+bool deduplicate(decltype(InternalFile::id) id) {
+    auto path = path_of(id);
+    struct stat64 st = {};
+    if (stat64(path.to_cstr().data(), &st)) {
+        THROW("stat64(", path, ')', errmsg());
+    }
+    if (st.st_nlink > 1) {
+        return false; // Already deduplicated
+    }
+
+    auto blob_path = blob_path_of_contents(path);
+    bool created_blob_dirs = false;
+    for (;;) {
+        if (link(path.to_cstr().data(), blob_path.c_str()) == 0) {
+            return false; // The file is the first one with this contents
+        }
+        if (errno == ENOENT and not created_blob_dirs) {
+            create_parent_dirs_of(blob_path);
+            created_blob_dirs = true;
+            continue;
+        }
+        if (errno != EEXIST) {
+            THROW("link(", path, ", ", blob_path, ')', errmsg());
+        }
+
+        // Replace the file with a link to the blob
+        auto tmp_path = concat(path, ".dedup");
+        if (link(blob_path.c_str(), tmp_path.to_cstr().data())) {
+            if (errno == ENOENT) {
+                continue; // The blob was removed in the meantime
+            }
+            THROW("link(", blob_path, ", ", tmp_path, ')', errmsg());
+        }
+        if (rename(tmp_path.to_cstr().data(), path.to_cstr().data())) {
+            auto errnum = errno;
+            (void)unlink(tmp_path);
+            THROW("rename(", tmp_path, ", ", path, ')', errmsg(errnum));
+        }
+        return true;
+    }
+}
+
+void remove(decltype(InternalFile::id) id) {
+    auto path = path_of(id);
+    struct stat64 st = {};
+    if (stat64(path.to_cstr().data(), &st)) {
+        if (errno == ENOENT) {
+            return;
+        }
+        THROW("stat64(", path, ')', errmsg());
+    }
+
+    // Only then the file may be the last reference to its blob, which saves
+    // hashing the file in the other cases
+    if (st.st_nlink == 2) {
+        auto blob_path = blob_path_of_contents(path);
+        struct stat64 blob_st = {};
+        if (stat64(blob_path.c_str(), &blob_st) == 0 and blob_st.st_dev == st.st_dev and
+            blob_st.st_ino == st.st_ino)
+        {
+            (void)unlink(blob_path.c_str());
+        }
+    }
+
+    (void)unlink(path);
+}
+
+DirScan scan_dir() {
+    STACK_UNWINDING_MARK;
+
+    DirScan scan;
+    FileDescriptor fd{dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC};
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            return scan;
+        }
+        THROW("open(", dir, ')', errmsg());
+    }
+    scan_subdir(fd, "", scan);
+    std::sort(scan.file_ids.begin(), scan.file_ids.end());
+    std::sort(scan.derived_files.begin(), scan.derived_files.end());
+    return scan;
+}
+
+vector<string> orphaned_files(
+    const DirScan& scan,
+    const std::function<std::optional<decltype(InternalFile::id)>()>& next_file_id
+) {
+    STACK_UNWINDING_MARK;
+
+    vector<string> res = scan.other_files;
+    auto file_it = scan.file_ids.begin();
+    auto derived_it = scan.derived_files.begin();
+    // Files of the ids below @p id (all if std::nullopt) are orphaned
+    auto add_orphaned_files_below = [&](std::optional<decltype(InternalFile::id)> id) {
+        for (; file_it != scan.file_ids.end() and (not id or *file_it < *id); ++file_it) {
+            res.emplace_back(path_of(*file_it).to_string());
+        }
+        for (; derived_it != scan.derived_files.end() and (not id or derived_it->first < *id);
+             ++derived_it)
+        {
+            res.emplace_back(derived_it->second);
+        }
+    };
+    while (auto id = next_file_id()) {
+        add_orphaned_files_below(id);
+        while (file_it != scan.file_ids.end() and *file_it == *id) {
+            ++file_it;
+        }
+        while (derived_it != scan.derived_files.end() and derived_it->first == *id) {
+            ++derived_it;
+        }
+    }
+    add_orphaned_files_below(std::nullopt);
+
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+void for_each_blob(
+    const std::function<void(const std::string& path, const struct stat64& st)>& callback
+) {
+    STACK_UNWINDING_MARK;
+
+    FileDescriptor fd{blobs_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC};
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            return;
+        }
+        THROW("open(", blobs_dir, ')', errmsg());
+    }
+    walk_blobs_subdir(fd, blobs_dir.to_string(), callback);
+}
+
+} // namespace sim::internal_files
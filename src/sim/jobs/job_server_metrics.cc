@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cstdio>
+#include <sim/jobs/job_server_metrics.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/file_contents.hh>
+#include <simlib/file_info.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/string_transform.hh>
+#include <unistd.h>
+
+namespace sim::jobs {
+
+JobServerMetrics::Durations JobServerMetrics::Durations::of(std::vector<int64_t> durations_ms) {
+    if (durations_ms.empty()) {
+        return {};
+    }
+    std::sort(durations_ms.begin(), durations_ms.end());
+    auto percentile = [&](size_t p) { return durations_ms[(durations_ms.size() - 1) * p / 100]; };
+    return {durations_ms.size(), percentile(50), percentile(90), percentile(99), percentile(100)};
+}
+
+std::string JobServerMetrics::dump() const {
+    STACK_UNWINDING_MARK;
+
+    std::string res;
+    for (auto const& [name, queue] : queues) {
+        back_insert(res, "queue ", name, ' ', queue.jobs, ' ', queue.locked_problems, '\n');
+    }
+    auto dump_durations = [&](StringView kind, const auto& durations_by_name) {
+        for (auto const& [name, d] : durations_by_name) {
+            back_insert(res, kind, ' ', name, ' ', d.count, ' ', d.p50, ' ', d.p90, ' ');
+            back_insert(res, d.p99, ' ', d.max, '\n');
+        }
+    };
+    dump_durations("wait", queue_wait_ms);
+    dump_durations("stage", judge_stage_ms);
+    return res;
+}
+
+JobServerMetrics JobServerMetrics::parse(StringView str) {
+    STACK_UNWINDING_MARK;
+
+    // Extracts the prefix up to the first @p c and the @p c itself
+    auto extract_field = [](StringView& s, char c) {
+        auto pos = std::min(s.find(c), s.size());
+        auto field = s.substring(0, pos);
+        s.remove_prefix(std::min(pos + 1, s.size()));
+        return field;
+    };
+
+    JobServerMetrics res;
+    while (not str.empty()) {
+        auto line = extract_field(str, '\n');
+        auto kind = extract_field(line, ' ');
+        auto name = extract_field(line, ' ');
+        if (name.empty()) {
+            continue;
+        }
+
+        if (kind == "queue") {
+            auto jobs = str2num<uint64_t>(extract_field(line, ' '));
+            auto locked_problems = str2num<uint64_t>(line);
+            if (jobs and locked_problems) {
+                res.queues[name.to_string()] = {*jobs, *locked_problems};
+            }
+        } else if (kind == "wait" or kind == "stage") {
+            auto count = str2num<uint64_t>(extract_field(line, ' '));
+            auto p50 = str2num<int64_t>(extract_field(line, ' '));
+            auto p90 = str2num<int64_t>(extract_field(line, ' '));
+            auto p99 = str2num<int64_t>(extract_field(line, ' '));
+            auto max = str2num<int64_t>(line);
+            if (count and p50 and p90 and p99 and max) {
+                auto& durations = (kind == "wait" ? res.queue_wait_ms : res.judge_stage_ms);
+                durations[name.to_string()] = {*count, *p50, *p90, *p99, *max};
+            }
+        }
+    }
+    return res;
+}
+
+void JobServerMetrics::save(FilePath path) const {
+    STACK_UNWINDING_MARK;
+
+    auto tmp_path = concat_tostr(path, ".tmp");
+    put_file_contents(tmp_path, dump());
+    if (rename(tmp_path.c_str(), path)) {
+        THROW("rename()", errmsg());
+    }
+}
+
+JobServerMetrics JobServerMetrics::load(FilePath path) {
+    STACK_UNWINDING_MARK;
+
+    if (access(path, F_OK) != 0) {
+        return {};
+    }
+    auto res = parse(get_file_contents(path));
+    res.saved_at = get_modification_time(path);
+    return res;
+}
+
+} // namespace sim::jobs
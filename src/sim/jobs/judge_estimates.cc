@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cstdio>
+#include <sim/jobs/judge_estimates.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/file_contents.hh>
+#include <simlib/file_info.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/string_transform.hh>
+#include <unistd.h>
+
+namespace sim::jobs {
+
+std::string JudgeEstimates::dump() const {
+    STACK_UNWINDING_MARK;
+
+    std::string res;
+    for (auto const& [problem_id, ms] : problem_judge_time_ms) {
+        back_insert(res, "problem ", problem_id, ' ', ms, '\n');
+    }
+    for (auto const& [job_id, ms] : job_eta_ms) {
+        back_insert(res, "job ", job_id, ' ', ms, '\n');
+    }
+    return res;
+}
+
+JudgeEstimates JudgeEstimates::parse(StringView str) {
+    STACK_UNWINDING_MARK;
+
+    // Extracts the prefix up to the first @p c and the @p c itself
+    auto extract_field = [](StringView& s, char c) {
+        auto pos = std::min(s.find(c), s.size());
+        auto field = s.substring(0, pos);
+        s.remove_prefix(std::min(pos + 1, s.size()));
+        return field;
+    };
+
+    JudgeEstimates res;
+    while (not str.empty()) {
+        auto line = extract_field(str, '\n');
+        auto kind = extract_field(line, ' ');
+        auto id = str2num<uint64_t>(extract_field(line, ' '));
+        auto ms = str2num<int64_t>(line);
+        if (not id or not ms) {
+            continue;
+        }
+
+        if (kind == "problem") {
+            res.problem_judge_time_ms[*id] = *ms;
+        } else if (kind == "job") {
+            res.job_eta_ms[*id] = *ms;
+        }
+    }
+    return res;
+}
+
+void JudgeEstimates::save(FilePath path) const {
+    STACK_UNWINDING_MARK;
+
+    auto tmp_path = concat_tostr(path, ".tmp");
+    put_file_contents(tmp_path, dump());
+    if (rename(tmp_path.c_str(), path)) {
+        THROW("rename()", errmsg());
+    }
+}
+
+JudgeEstimates JudgeEstimates::load(FilePath path) {
+    STACK_UNWINDING_MARK;
+
+    if (access(path, F_OK) != 0) {
+        return {};
+    }
+    auto res = parse(get_file_contents(path));
+    res.saved_at = get_modification_time(path);
+    return res;
+}
+
+} // namespace sim::jobs
@@ -0,0 +1,223 @@
+#include <arpa/inet.h>
+#include <array>
+#include <cerrno>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sim/jobs/utils.hh>
+#include <sim/judge_node/protocol.hh>
+#include <sim/submissions/report.hh>
+#include <simlib/macros/throw.hh>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <variant>
+
+using sim::jobs::extract_dumped_int;
+using sim::jobs::extract_dumped_string;
+
+namespace sim::judge_node {
+
+namespace {
+
+void send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t rc = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ConnectionLost(concat_tostr("send()", errmsg()));
+        }
+        data += rc;
+        len -= static_cast<size_t>(rc);
+    }
+}
+
+void receive_all(int fd, char* data, size_t len) {
+    while (len > 0) {
+        ssize_t rc = ::recv(fd, data, len, 0);
+        if (rc == 0) {
+            throw ConnectionLost("Connection closed by the peer");
+        }
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ConnectionLost(concat_tostr("recv()", errmsg()));
+        }
+        data += rc;
+        len -= static_cast<size_t>(rc);
+    }
+}
+
+} // namespace
+
+void Connection::set_receive_timeout(std::chrono::milliseconds timeout) {
+    STACK_UNWINDING_MARK;
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+    if (setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) {
+        THROW("setsockopt()", errmsg());
+    }
+}
+
+void Connection::enable_keepalive() {
+    STACK_UNWINDING_MARK;
+    auto set_option = [&](int level, int name, int value) {
+        if (setsockopt(fd_, level, name, &value, sizeof(value))) {
+            THROW("setsockopt()", errmsg());
+        }
+    };
+    // Probes begin after 30 s of silence and 3 unanswered ones break the
+    // connection. Unacknowledged data breaks it after 60 s.
+    set_option(SOL_SOCKET, SO_KEEPALIVE, 1);
+    set_option(IPPROTO_TCP, TCP_KEEPIDLE, 30);
+    set_option(IPPROTO_TCP, TCP_KEEPINTVL, 10);
+    set_option(IPPROTO_TCP, TCP_KEEPCNT, 3);
+    set_option(IPPROTO_TCP, TCP_USER_TIMEOUT, 60'000);
+}
+
+void Connection::send(MessageType type, StringView payload) {
+    STACK_UNWINDING_MARK;
+    throw_assert(payload.size() <= MESSAGE_MAX_SIZE);
+    std::string header;
+    jobs::append_dumped(header, static_cast<uint32_t>(payload.size()));
+    jobs::append_dumped(header, static_cast<uint8_t>(type));
+    send_all(fd_, header.data(), header.size());
+    send_all(fd_, payload.data(), payload.size());
+}
+
+Message Connection::receive() {
+    STACK_UNWINDING_MARK;
+    std::array<char, sizeof(uint32_t) + sizeof(uint8_t)> header{};
+    receive_all(fd_, header.data(), header.size());
+
+    StringView header_str{header.data(), header.size()};
+    auto size = extract_dumped_int<uint32_t>(header_str);
+    auto type = extract_dumped_int<uint8_t>(header_str);
+    if (size > MESSAGE_MAX_SIZE) {
+        throw ConnectionLost(concat_tostr("Received too big message: ", size, " bytes"));
+    }
+
+    Message msg{static_cast<MessageType>(type), std::string(size, '\0')};
+    receive_all(fd_, msg.payload.data(), size);
+    return msg;
+}
+
+bool Connection::is_closed() {
+    STACK_UNWINDING_MARK;
+    pollfd pfd{fd_, POLLIN, 0};
+    int rc = poll(&pfd, 1, 0);
+    if (rc < 0) {
+        THROW("poll()", errmsg());
+    }
+    if (rc == 0) {
+        return false;
+    }
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        return true;
+    }
+    // There is something to read, it may be the end of the stream
+    char c = 0;
+    ssize_t len = 0;
+    do {
+        len = ::recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    } while (len < 0 and errno == EINTR);
+    return len == 0 or (len < 0 and errno != EAGAIN and errno != EWOULDBLOCK);
+}
+
+void append_dumped(std::string& buff, const JudgeReport& jr) {
+    STACK_UNWINDING_MARK;
+    jobs::append_dumped(buff, submissions::dump_report(jr));
+    jobs::append_dumped(buff, jr.judge_log);
+}
+
+JudgeReport extract_dumped_judge_report(StringView& dumped_str) {
+    STACK_UNWINDING_MARK;
+
+    auto report = submissions::parse_report(extract_dumped_string(dumped_str));
+    auto* jr = std::get_if<JudgeReport>(&report);
+    if (not jr) {
+        THROW("Dumped report is not a judge report");
+    }
+    jr->judge_log = extract_dumped_string(dumped_str);
+    return std::move(*jr);
+}
+
+sockaddr_in parse_address(StringView address) {
+    STACK_UNWINDING_MARK;
+
+    sockaddr_in name{};
+    name.sin_family = AF_INET;
+
+    auto colon_pos = address.rfind(':');
+    if (colon_pos == StringView::npos) {
+        THROW("Invalid address: `", address, "` (expected ADDR:PORT)");
+    }
+
+    auto port = str2num<in_port_t>(address.substring(colon_pos + 1));
+    if (not port) {
+        THROW("Invalid port number in address: `", address, '`');
+    }
+    name.sin_port = htons(*port);
+
+    auto addr = address.substring(0, colon_pos).to_string();
+    if (addr == "*") {
+        name.sin_addr.s_addr = htonl(INADDR_ANY);
+    } else if (addr.empty() or inet_aton(addr.c_str(), &name.sin_addr) == 0) {
+        THROW("Invalid IPv4 address in address: `", address, '`');
+    }
+
+    return name;
+}
+
+FileDescriptor listen_on(StringView address, int backlog) {
+    STACK_UNWINDING_MARK;
+
+    auto name = parse_address(address);
+    FileDescriptor fd{socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP)};
+    if (not fd.is_open()) {
+        THROW("socket()", errmsg());
+    }
+
+    int true_ = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &true_, sizeof(true_))) {
+        THROW("setsockopt()", errmsg());
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&name), sizeof(name))) {
+        THROW("bind() to ", address, errmsg());
+    }
+    if (listen(fd, backlog)) {
+        THROW("listen()", errmsg());
+    }
+
+    return fd;
+}
+
+FileDescriptor connect_to(StringView address) {
+    STACK_UNWINDING_MARK;
+
+    auto name = parse_address(address);
+    FileDescriptor fd{socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP)};
+    if (not fd.is_open()) {
+        THROW("socket()", errmsg());
+    }
+
+    int rc = 0;
+    do {
+        rc = connect(fd, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+    } while (rc != 0 and errno == EINTR);
+    if (rc) {
+        throw ConnectionLost(concat_tostr("connect() to ", address, errmsg()));
+    }
+
+    // Messages are small and latency matters more than throughput
+    int true_ = 1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &true_, sizeof(true_))) {
+        THROW("setsockopt()", errmsg());
+    }
+
+    return fd;
+}
+
+} // namespace sim::judge_node
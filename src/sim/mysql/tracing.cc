@@ -0,0 +1,226 @@
+#include <cinttypes>
+#include <cstdio>
+#include <sim/mysql/tracing.hh>
+#include <simlib/concat_tostr.hh>
+
+using std::string;
+
+namespace {
+
+// Longer normalized SQL is truncated
+constexpr size_t MAX_SQL_LENGTH = 1024;
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::atomic<int64_t> slow_query_threshold_ns{0};
+
+thread_local sim::mysql::tracing::Trace this_thread_trace;
+
+constexpr bool is_space(char c) noexcept {
+    return c == ' ' or c == '\t' or c == '\n' or c == '\r' or c == '\f' or c == '\v';
+}
+
+constexpr bool is_digit(char c) noexcept { return c >= '0' and c <= '9'; }
+
+constexpr bool is_word_char(char c) noexcept {
+    return is_digit(c) or (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or c == '_' or
+        c == '$' or static_cast<unsigned char>(c) >= 0x80;
+}
+
+// Collapses "?, ?, ?" into "?, ..."
+string collapse_placeholder_lists(const string& sql) {
+    string res;
+    res.reserve(sql.size());
+    for (size_t i = 0; i < sql.size(); ++i) {
+        res += sql[i];
+        if (sql[i] != '?') {
+            continue;
+        }
+        bool collapsed = false;
+        for (;;) {
+            size_t j = i + 1;
+            if (j < sql.size() and sql[j] == ' ') {
+                ++j;
+            }
+            if (j >= sql.size() or sql[j] != ',') {
+                break;
+            }
+            ++j;
+            if (j < sql.size() and sql[j] == ' ') {
+                ++j;
+            }
+            if (j >= sql.size() or sql[j] != '?') {
+                break;
+            }
+            i = j;
+            collapsed = true;
+        }
+        if (collapsed) {
+            res += ", ...";
+        }
+    }
+    return res;
+}
+
+void append_ms(string& str, std::chrono::nanoseconds duration) {
+    auto ns = static_cast<uint64_t>(duration.count() > 0 ? duration.count() : 0);
+    char buff[32];
+    int len = snprintf(
+        buff, sizeof(buff), "%" PRIu64 ".%03" PRIu64 " ms", ns / 1'000'000, ns / 1000 % 1000
+    );
+    str.append(buff, len);
+}
+
+} // namespace
+
+namespace sim::mysql::tracing {
+
+namespace detail {
+
+void record(Kind kind, std::chrono::nanoseconds duration) noexcept {
+    auto& trace = this_thread_trace;
+    switch (kind) {
+    case Kind::QUERY: ++trace.queries; break;
+    case Kind::PREPARE: ++trace.prepares; break;
+    }
+    trace.duration += duration;
+}
+
+bool is_slow(std::chrono::nanoseconds duration) noexcept {
+    return duration.count() >= slow_query_threshold_ns.load(std::memory_order_relaxed);
+}
+
+void record_slow(Kind kind, std::chrono::nanoseconds duration, StringView sql) noexcept {
+    record(kind, duration);
+    auto& trace = this_thread_trace;
+    if (trace.slow_queries.size() == MAX_SLOW_QUERIES) {
+        ++trace.uncaptured_slow_queries;
+        return;
+    }
+    try {
+        auto normalized = normalize_sql(sql);
+        if (normalized.size() > MAX_SQL_LENGTH) {
+            normalized.resize(MAX_SQL_LENGTH);
+            normalized += "...";
+        }
+        trace.slow_queries.push_back({std::move(normalized), duration});
+    } catch (...) {
+        ++trace.uncaptured_slow_queries;
+    }
+}
+
+} // namespace detail
+
+void enable(std::chrono::nanoseconds slow_query_threshold) noexcept {
+    slow_query_threshold_ns.store(slow_query_threshold.count(), std::memory_order_relaxed);
+    detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void begin() noexcept {
+    auto& trace = this_thread_trace;
+    trace.queries = 0;
+    trace.prepares = 0;
+    trace.duration = std::chrono::nanoseconds{0};
+    trace.slow_queries.clear(); // Keeps the capacity
+    trace.uncaptured_slow_queries = 0;
+}
+
+const Trace& current() noexcept { return this_thread_trace; }
+
+string summary() {
+    const auto& trace = this_thread_trace;
+    string res;
+    back_insert(
+        res,
+        "sql: ",
+        trace.queries,
+        (trace.queries == 1 ? " query, " : " queries, "),
+        trace.prepares,
+        (trace.prepares == 1 ? " prepare, " : " prepares, ")
+    );
+    append_ms(res, trace.duration);
+    if (trace.slow_queries.empty() and trace.uncaptured_slow_queries == 0) {
+        return res;
+    }
+
+    res += ", slow:";
+    for (const auto& query : trace.slow_queries) {
+        res += " [";
+        append_ms(res, query.duration);
+        back_insert(res, "] ", query.sql, ';');
+    }
+    if (trace.uncaptured_slow_queries > 0) {
+        back_insert(res, " and ", trace.uncaptured_slow_queries, " more;");
+    }
+    res.pop_back(); // ';'
+    return res;
+}
+
+string normalize_sql(StringView sql) {
+    string res;
+    res.reserve(sql.size());
+    auto append_space = [&res] {
+        if (not res.empty() and res.back() != ' ') {
+            res += ' ';
+        }
+    };
+
+    for (size_t i = 0; i < sql.size();) {
+        char c = sql[i];
+        if (is_space(c)) {
+            append_space();
+            ++i;
+        } else if (c == '\'' or c == '"') {
+            // String literal, the quote is escaped with a backslash or doubled
+            ++i;
+            while (i < sql.size()) {
+                if (sql[i] == '\\') {
+                    i += 2;
+                } else if (sql[i] == c) {
+                    ++i;
+                    if (i == sql.size() or sql[i] != c) {
+                        break;
+                    }
+                    ++i;
+                } else {
+                    ++i;
+                }
+            }
+            res += '?';
+        } else if (c == '`') {
+            // Quoted identifier
+            size_t end = sql.find('`', i + 1);
+            end = (end == StringView::npos ? sql.size() : end + 1);
+            res.append(sql.data() + i, end - i);
+            i = end;
+        } else if (is_digit(c) or (c == '.' and i + 1 < sql.size() and is_digit(sql[i + 1]))) {
+            // Number (including hex and exponent), unless it is a part of a word
+            if (not res.empty() and is_word_char(res.back())) {
+                do {
+                    res += sql[i++];
+                } while (i < sql.size() and is_word_char(sql[i]));
+                continue;
+            }
+            ++i;
+            while (i < sql.size() and (is_word_char(sql[i]) or sql[i] == '.' or
+                                       ((sql[i] == '+' or sql[i] == '-') and
+                                        (sql[i - 1] == 'e' or sql[i - 1] == 'E'))))
+            {
+                ++i;
+            }
+            res += '?';
+        } else if (is_word_char(c)) {
+            do {
+                res += sql[i++];
+            } while (i < sql.size() and is_word_char(sql[i]));
+        } else {
+            res += c;
+            ++i;
+        }
+    }
+    if (not res.empty() and res.back() == ' ') {
+        res.pop_back();
+    }
+    return collapse_placeholder_lists(res);
+}
+
+} // namespace sim::mysql::tracing
@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <ctime>
+#include <linux/fs.h>
+#include <sim/problems/package_update.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/errmsg.hh>
+#include <simlib/file_descriptor.hh>
+#include <simlib/file_perms.hh>
+#include <simlib/libzip.hh>
+#include <simlib/logger.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/throw_assert.hh>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+
+namespace {
+
+constexpr uint32_t LOCAL_FILE_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint32_t CENTRAL_DIRECTORY_HEADER_SIGNATURE = 0x02014b50;
+constexpr uint32_t EOCD_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP64_EOCD_SIGNATURE = 0x06064b50;
+constexpr uint32_t ZIP64_EOCD_LOCATOR_SIGNATURE = 0x07064b50;
+
+constexpr size_t LOCAL_FILE_HEADER_SIZE = 30;
+constexpr size_t CENTRAL_DIRECTORY_HEADER_SIZE = 46;
+constexpr size_t EOCD_SIZE = 22;
+constexpr size_t ZIP64_EOCD_SIZE = 56;
+constexpr size_t ZIP64_EOCD_LOCATOR_SIZE = 20;
+
+constexpr uint16_t VERSION_NEEDED = 20; // 2.0: directories, deflate
+constexpr uint16_t ZIP64_VERSION_NEEDED = 45; // 4.5: ZIP64
+constexpr uint16_t VERSION_MADE_BY = (3 << 8) | ZIP64_VERSION_NEEDED; // UNIX
+constexpr uint16_t UTF8_NAME_FLAG = 1 << 11;
+constexpr uint16_t ZIP64_EXTRA_FIELD_ID = 0x0001;
+
+// The package cannot (or should not) be updated without rewriting it
+class UnsupportedLayout : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+template <class T>
+T read_le(StringView str, size_t pos) {
+    if (pos > str.size() or str.size() - pos < sizeof(T)) {
+        throw UnsupportedLayout("Truncated zip structure");
+    }
+    T x = 0;
+    for (size_t i = sizeof(T); i-- > 0;) {
+        x = static_cast<T>((static_cast<uint64_t>(x) << 8) | static_cast<uint8_t>(str[pos + i]));
+    }
+    return x;
+}
+
+template <class T>
+void append_le(string& buff, T x) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        buff += static_cast<char>(static_cast<uint64_t>(x) >> (i * 8));
+    }
+}
+
+uint32_t crc32(StringView data) noexcept {
+    static const auto table = [] {
+        std::array<uint32_t, 256> res{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1);
+            }
+            res[i] = c;
+        }
+        return res;
+    }();
+
+    uint32_t crc = 0xffffffff;
+    for (char c : data) {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+string pread_all(int fd, uint64_t offset, size_t len) {
+    string res(len, '\0');
+    for (size_t pos = 0; pos < len;) {
+        auto rc = pread64(fd, res.data() + pos, len - pos, static_cast<off64_t>(offset + pos));
+        if (rc < 0 and errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            THROW("pread()", errmsg());
+        }
+        if (rc == 0) {
+            throw UnsupportedLayout("Unexpected end of the zip file");
+        }
+        pos += static_cast<size_t>(rc);
+    }
+    return res;
+}
+
+void pwrite_all(int fd, StringView data, uint64_t offset) {
+    for (size_t pos = 0; pos < data.size();) {
+        auto rc = pwrite64(
+            fd, data.data() + pos, data.size() - pos, static_cast<off64_t>(offset + pos)
+        );
+        if (rc < 0 and errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            THROW("pwrite()", errmsg());
+        }
+        pos += static_cast<size_t>(rc);
+    }
+}
+
+// Copies the first @p len bytes of @p src_fd to the empty @p dest_fd
+void copy_prefix(int src_fd, int dest_fd, uint64_t len) {
+    // Cloning shares the data blocks (btrfs, XFS), so it is instant
+    if (ioctl(dest_fd, FICLONE, src_fd) == 0) {
+        if (ftruncate64(dest_fd, static_cast<off64_t>(len))) {
+            THROW("ftruncate()", errmsg());
+        }
+        return;
+    }
+
+    loff_t src_off = 0;
+    loff_t dest_off = 0;
+    while (static_cast<uint64_t>(src_off) < len) {
+        auto rc = copy_file_range(
+            src_fd, &src_off, dest_fd, &dest_off, len - static_cast<uint64_t>(src_off), 0
+        );
+        if (rc < 0 and errno == EINTR) {
+            continue;
+        }
+        if (rc > 0) {
+            continue;
+        }
+        if (rc == 0) {
+            throw UnsupportedLayout("Unexpected end of the zip file");
+        }
+        if (errno != EXDEV and errno != ENOSYS and errno != EINVAL and errno != EOPNOTSUPP) {
+            THROW("copy_file_range()", errmsg());
+        }
+        // copy_file_range() is not supported between these files
+        constexpr size_t CHUNK_SIZE = 1 << 20;
+        while (static_cast<uint64_t>(src_off) < len) {
+            auto chunk = pread_all(
+                src_fd,
+                static_cast<uint64_t>(src_off),
+                std::min<uint64_t>(CHUNK_SIZE, len - static_cast<uint64_t>(src_off))
+            );
+            pwrite_all(dest_fd, chunk, static_cast<uint64_t>(dest_off));
+            src_off += static_cast<loff_t>(chunk.size());
+            dest_off += static_cast<loff_t>(chunk.size());
+        }
+    }
+}
+
+struct CentralDirectory {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t entries_no;
+};
+
+CentralDirectory locate_central_directory(int fd, uint64_t file_size) {
+    // EOCD is at the end of the file, followed only by the archive comment
+    auto tail_len = std::min<uint64_t>(file_size, EOCD_SIZE + 0xffff);
+    auto tail_offset = file_size - tail_len;
+    auto tail = pread_all(fd, tail_offset, tail_len);
+
+    size_t eocd_pos = 0;
+    for (size_t pos = tail.size() - std::min(tail.size(), EOCD_SIZE) + 1;;) {
+        if (pos-- == 0) {
+            throw UnsupportedLayout("End of central directory not found");
+        }
+        if (read_le<uint32_t>(tail, pos) == EOCD_SIGNATURE and
+            pos + EOCD_SIZE + read_le<uint16_t>(tail, pos + 20) == tail.size())
+        {
+            eocd_pos = pos;
+            break;
+        }
+    }
+
+    if (read_le<uint16_t>(tail, eocd_pos + 4) != 0 or read_le<uint16_t>(tail, eocd_pos + 6) != 0)
+    {
+        throw UnsupportedLayout("Multi-disk archive");
+    }
+    CentralDirectory cd{
+        read_le<uint32_t>(tail, eocd_pos + 16),
+        read_le<uint32_t>(tail, eocd_pos + 12),
+        read_le<uint16_t>(tail, eocd_pos + 10),
+    };
+    uint64_t cd_end = tail_offset + eocd_pos;
+
+    if (cd.offset == 0xffffffff or cd.size == 0xffffffff or cd.entries_no == 0xffff) {
+        if (cd_end < ZIP64_EOCD_LOCATOR_SIZE) {
+            throw UnsupportedLayout("ZIP64 end of central directory locator not found");
+        }
+        auto locator =
+            pread_all(fd, cd_end - ZIP64_EOCD_LOCATOR_SIZE, ZIP64_EOCD_LOCATOR_SIZE);
+        if (read_le<uint32_t>(locator, 0) != ZIP64_EOCD_LOCATOR_SIGNATURE or
+            read_le<uint32_t>(locator, 16) != 1)
+        {
+            throw UnsupportedLayout("Invalid ZIP64 end of central directory locator");
+        }
+        auto zip64_eocd_offset = read_le<uint64_t>(locator, 8);
+        auto zip64_eocd = pread_all(fd, zip64_eocd_offset, ZIP64_EOCD_SIZE);
+        if (read_le<uint32_t>(zip64_eocd, 0) != ZIP64_EOCD_SIGNATURE or
+            read_le<uint32_t>(zip64_eocd, 16) != 0 or read_le<uint32_t>(zip64_eocd, 20) != 0)
+        {
+            throw UnsupportedLayout("Invalid ZIP64 end of central directory");
+        }
+        cd = {
+            read_le<uint64_t>(zip64_eocd, 48),
+            read_le<uint64_t>(zip64_eocd, 40),
+            read_le<uint64_t>(zip64_eocd, 32),
+        };
+        cd_end = zip64_eocd_offset;
+    }
+
+    // Anything between the central directory and its end record (e.g. a
+    // digital signature) would be lost
+    if (cd.offset > cd_end or cd_end - cd.offset != cd.size) {
+        throw UnsupportedLayout("Unexpected data after the central directory");
+    }
+    return cd;
+}
+
+// Returns the compressed size of the entry whose central directory header
+// starts at @p pos of @p cd
+uint64_t compressed_size_of_entry(StringView cd, size_t pos) {
+    uint64_t size = read_le<uint32_t>(cd, pos + 20);
+    if (size != 0xffffffff) {
+        return size;
+    }
+    // It is in the ZIP64 extra field, after the uncompressed size if that is
+    // there too
+    auto name_len = read_le<uint16_t>(cd, pos + 28);
+    StringView extra{
+        cd.data() + pos + CENTRAL_DIRECTORY_HEADER_SIZE + name_len,
+        read_le<uint16_t>(cd, pos + 30)
+    };
+    for (size_t epos = 0; epos < extra.size();) {
+        auto field_id = read_le<uint16_t>(extra, epos);
+        auto field_len = read_le<uint16_t>(extra, epos + 2);
+        epos += 4;
+        if (field_id == ZIP64_EXTRA_FIELD_ID) {
+            size_t size_pos = (read_le<uint32_t>(cd, pos + 24) == 0xffffffff ? 8 : 0);
+            if (size_pos + 8 > field_len) {
+                throw UnsupportedLayout("Invalid ZIP64 extra field");
+            }
+            return read_le<uint64_t>(extra, epos + size_pos);
+        }
+        epos += field_len;
+    }
+    throw UnsupportedLayout("ZIP64 extra field not found");
+}
+
+struct DosDateTime {
+    uint16_t time;
+    uint16_t date;
+};
+
+DosDateTime dos_date_time_now() noexcept {
+    time_t t = time(nullptr);
+    tm lt{};
+    localtime_r(&t, &lt);
+    return {
+        static_cast<uint16_t>((lt.tm_hour << 11) | (lt.tm_min << 5) | (lt.tm_sec / 2)),
+        static_cast<uint16_t>(((lt.tm_year - 80) << 9) | ((lt.tm_mon + 1) << 5) | lt.tm_mday),
+    };
+}
+
+void copy_package_with_changes_raw(
+    FilePath src_path, FilePath dest_path, const sim::problems::PackageChanges& changes
+) {
+    STACK_UNWINDING_MARK;
+
+    FileDescriptor src_fd{src_path, O_RDONLY | O_CLOEXEC};
+    if (not src_fd.is_open()) {
+        THROW("open()", errmsg());
+    }
+    struct stat64 st = {};
+    if (fstat64(src_fd, &st)) {
+        THROW("fstat()", errmsg());
+    }
+
+    auto cd = locate_central_directory(src_fd, static_cast<uint64_t>(st.st_size));
+    if (cd.size > SIZE_MAX) {
+        throw UnsupportedLayout("Central directory is too big");
+    }
+    auto old_cd = pread_all(src_fd, cd.offset, static_cast<size_t>(cd.size));
+
+    // Keep the central directory headers of the unchanged entries
+    string new_cd;
+    uint64_t entries_no = 0;
+    uint64_t old_entries_no = 0;
+    // Estimated, as the extra fields of the local headers may differ from the
+    // ones in the central directory
+    uint64_t referenced_data_size = 0;
+    for (size_t pos = 0; pos < old_cd.size(); ++old_entries_no) {
+        if (read_le<uint32_t>(old_cd, pos) != CENTRAL_DIRECTORY_HEADER_SIGNATURE) {
+            throw UnsupportedLayout("Invalid central directory header");
+        }
+        auto name_len = read_le<uint16_t>(old_cd, pos + 28);
+        size_t header_len = CENTRAL_DIRECTORY_HEADER_SIZE + name_len +
+            read_le<uint16_t>(old_cd, pos + 30) + read_le<uint16_t>(old_cd, pos + 32);
+        if (header_len > old_cd.size() - pos) {
+            throw UnsupportedLayout("Truncated central directory header");
+        }
+
+        StringView name{old_cd.data() + pos + CENTRAL_DIRECTORY_HEADER_SIZE, name_len};
+        if (changes.find(name.to_string()) == changes.end()) {
+            new_cd.append(old_cd, pos, header_len);
+            ++entries_no;
+            referenced_data_size += LOCAL_FILE_HEADER_SIZE + name_len +
+                read_le<uint16_t>(old_cd, pos + 30) + compressed_size_of_entry(old_cd, pos);
+        }
+        pos += header_len;
+    }
+    if (old_entries_no != cd.entries_no) {
+        throw UnsupportedLayout("Central directory entries number mismatch");
+    }
+    auto unreferenced_data_size = cd.offset - std::min(referenced_data_size, cd.offset);
+    if (static_cast<double>(unreferenced_data_size) >
+        static_cast<double>(cd.offset) * sim::problems::MAX_UNREFERENCED_DATA_FRACTION)
+    {
+        throw UnsupportedLayout(concat_tostr(
+            "Too much unreferenced data: ", unreferenced_data_size, " of ", cd.offset, " bytes"
+        ));
+    }
+
+    FileDescriptor dest_fd{dest_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_0644};
+    if (not dest_fd.is_open()) {
+        THROW("open()", errmsg());
+    }
+    copy_prefix(src_fd, dest_fd, cd.offset);
+
+    // Append the new entries (stored, as they are small)
+    auto now = dos_date_time_now();
+    uint64_t offset = cd.offset;
+    for (auto const& [name, contents] : changes) {
+        if (not contents) {
+            continue;
+        }
+        throw_assert(name.size() <= 0xffff and contents->size() < 0xffffffff);
+        auto crc = crc32(*contents);
+        auto size = static_cast<uint32_t>(contents->size());
+
+        string local_header;
+        append_le<uint32_t>(local_header, LOCAL_FILE_HEADER_SIGNATURE);
+        append_le<uint16_t>(local_header, VERSION_NEEDED);
+        append_le<uint16_t>(local_header, UTF8_NAME_FLAG);
+        append_le<uint16_t>(local_header, 0); // compression method: stored
+        append_le<uint16_t>(local_header, now.time);
+        append_le<uint16_t>(local_header, now.date);
+        append_le<uint32_t>(local_header, crc);
+        append_le<uint32_t>(local_header, size); // compressed size
+        append_le<uint32_t>(local_header, size);
+        append_le<uint16_t>(local_header, static_cast<uint16_t>(name.size()));
+        append_le<uint16_t>(local_header, 0); // extra field length
+        local_header += name;
+
+        bool needs_zip64 = (offset >= 0xffffffff);
+        append_le<uint32_t>(new_cd, CENTRAL_DIRECTORY_HEADER_SIGNATURE);
+        append_le<uint16_t>(new_cd, VERSION_MADE_BY);
+        append_le<uint16_t>(new_cd, needs_zip64 ? ZIP64_VERSION_NEEDED : VERSION_NEEDED);
+        append_le<uint16_t>(new_cd, UTF8_NAME_FLAG);
+        append_le<uint16_t>(new_cd, 0); // compression method: stored
+        append_le<uint16_t>(new_cd, now.time);
+        append_le<uint16_t>(new_cd, now.date);
+        append_le<uint32_t>(new_cd, crc);
+        append_le<uint32_t>(new_cd, size); // compressed size
+        append_le<uint32_t>(new_cd, size);
+        append_le<uint16_t>(new_cd, static_cast<uint16_t>(name.size()));
+        append_le<uint16_t>(new_cd, needs_zip64 ? 12 : 0); // extra field length
+        append_le<uint16_t>(new_cd, 0); // comment length
+        append_le<uint16_t>(new_cd, 0); // disk number
+        append_le<uint16_t>(new_cd, 0); // internal attributes
+        append_le<uint32_t>(new_cd, static_cast<uint32_t>(S_IFREG | S_0644) << 16);
+        append_le<uint32_t>(new_cd, needs_zip64 ? 0xffffffff : static_cast<uint32_t>(offset));
+        new_cd += name;
+        if (needs_zip64) {
+            append_le<uint16_t>(new_cd, ZIP64_EXTRA_FIELD_ID);
+            append_le<uint16_t>(new_cd, 8);
+            append_le<uint64_t>(new_cd, offset);
+        }
+        ++entries_no;
+
+        pwrite_all(dest_fd, local_header, offset);
+        offset += local_header.size();
+        pwrite_all(dest_fd, *contents, offset);
+        offset += contents->size();
+    }
+
+    // Append the new central directory and its end record
+    uint64_t new_cd_offset = offset;
+    uint64_t new_cd_size = new_cd.size();
+    bool needs_zip64 =
+        (entries_no >= 0xffff or new_cd_offset >= 0xffffffff or new_cd_size >= 0xffffffff);
+    if (needs_zip64) {
+        uint64_t zip64_eocd_offset = new_cd_offset + new_cd_size;
+        append_le<uint32_t>(new_cd, ZIP64_EOCD_SIGNATURE);
+        append_le<uint64_t>(new_cd, ZIP64_EOCD_SIZE - 12); // size of the rest of the record
+        append_le<uint16_t>(new_cd, VERSION_MADE_BY);
+        append_le<uint16_t>(new_cd, ZIP64_VERSION_NEEDED);
+        append_le<uint32_t>(new_cd, 0); // disk number
+        append_le<uint32_t>(new_cd, 0); // disk with the central directory
+        append_le<uint64_t>(new_cd, entries_no); // on this disk
+        append_le<uint64_t>(new_cd, entries_no);
+        append_le<uint64_t>(new_cd, new_cd_size);
+        append_le<uint64_t>(new_cd, new_cd_offset);
+
+        append_le<uint32_t>(new_cd, ZIP64_EOCD_LOCATOR_SIGNATURE);
+        append_le<uint32_t>(new_cd, 0); // disk with the ZIP64 EOCD
+        append_le<uint64_t>(new_cd, zip64_eocd_offset);
+        append_le<uint32_t>(new_cd, 1); // disks number
+    }
+    append_le<uint32_t>(new_cd, EOCD_SIGNATURE);
+    append_le<uint16_t>(new_cd, 0); // disk number
+    append_le<uint16_t>(new_cd, 0); // disk with the central directory
+    auto entries_no16 = static_cast<uint16_t>(needs_zip64 ? 0xffff : entries_no);
+    append_le<uint16_t>(new_cd, entries_no16); // on this disk
+    append_le<uint16_t>(new_cd, entries_no16);
+    append_le<uint32_t>(new_cd, needs_zip64 ? 0xffffffff : static_cast<uint32_t>(new_cd_size));
+    append_le<uint32_t>(new_cd, needs_zip64 ? 0xffffffff : static_cast<uint32_t>(new_cd_offset));
+    append_le<uint16_t>(new_cd, 0); // comment length
+
+    pwrite_all(dest_fd, new_cd, new_cd_offset);
+    if (dest_fd.close()) {
+        THROW("close()", errmsg());
+    }
+}
+
+void copy_package_with_changes_using_libzip(
+    FilePath src_path, FilePath dest_path, const sim::problems::PackageChanges& changes
+) {
+    STACK_UNWINDING_MARK;
+
+    ZipFile src_zip(src_path, ZIP_RDONLY);
+    ZipFile dest_zip(dest_path, ZIP_CREATE | ZIP_TRUNCATE);
+
+    auto eno = src_zip.entries_no();
+    for (decltype(eno) i = 0; i < eno; ++i) {
+        auto entry_name = src_zip.get_name(i);
+        if (changes.find(entry_name) == changes.end()) {
+            dest_zip.file_add(entry_name, dest_zip.source_zip(src_zip, i));
+        }
+    }
+    for (auto const& [name, contents] : changes) {
+        if (contents) {
+            dest_zip.file_add(name, dest_zip.source_buffer(*contents));
+        }
+    }
+
+    dest_zip.close(); // Write all data to the dest_zip
+}
+
+} // namespace
+
+namespace sim::problems {
+
+void copy_package_with_changes(
+    FilePath src_path, FilePath dest_path, const PackageChanges& changes, PackageCopyMode mode
+) {
+    STACK_UNWINDING_MARK;
+
+    switch (mode) {
+    case PackageCopyMode::REUSE_ENTRIES: break;
+    case PackageCopyMode::REWRITE:
+        return copy_package_with_changes_using_libzip(src_path, dest_path, changes);
+    }
+
+    try {
+        copy_package_with_changes_raw(src_path, dest_path, changes);
+    } catch (const UnsupportedLayout& e) {
+        stdlog("Rewriting package ", src_path, " with libzip: ", e.what());
+        copy_package_with_changes_using_libzip(src_path, dest_path, changes);
+    }
+}
+
+} // namespace sim::problems
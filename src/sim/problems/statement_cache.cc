@@ -0,0 +1,38 @@
+#include <sim/problems/statement_cache.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/errmsg.hh>
+#include <simlib/file_perms.hh>
+#include <simlib/file_remover.hh>
+#include <simlib/libzip.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/sim/problem_package.hh>
+#include <unistd.h>
+
+namespace sim::problems {
+
+decltype(extracted_statement_path_of(0))
+extract_statement(uint64_t problem_file_id, StringView statement) {
+    auto path = extracted_statement_path_of(problem_file_id);
+    if (access(path, F_OK) == 0) {
+        return path;
+    }
+
+    // The statement appears under its path only when it is complete
+    auto tmp_path = concat_tostr(path, ".tmp", gettid());
+    FileRemover tmp_remover(tmp_path);
+    ZipFile zip(internal_files::path_of(problem_file_id), ZIP_RDONLY);
+    zip.extract_to_file(
+        zip.get_index(concat(sim::zip_package_main_dir(zip), statement)), tmp_path, S_0644
+    );
+    if (rename(tmp_path.c_str(), path.to_cstr().data())) {
+        THROW("rename(", tmp_path, ", ", path, ')', errmsg());
+    }
+    tmp_remover.cancel();
+    return path;
+}
+
+void remove_extracted_statement(uint64_t problem_file_id) noexcept {
+    (void)unlink(extracted_statement_path_of(problem_file_id));
+}
+
+} // namespace sim::problems
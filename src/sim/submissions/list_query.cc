@@ -0,0 +1,158 @@
+#include <sim/submissions/list_query.hh>
+
+using std::optional;
+using std::string;
+
+namespace {
+
+struct ScopeIndexes {
+    StringView with_owner;
+    StringView with_owner_and_type;
+    StringView with_owner_and_final; // Empty if there is no such index
+    sim::submissions::ListFilter::Finals final_kind;
+    StringView without_owner; // Empty if there is no such index
+    StringView with_type;
+};
+
+constexpr ScopeIndexes scope_indexes(sim::submissions::ListFilter::Scope scope) noexcept {
+    using Scope = sim::submissions::ListFilter::Scope;
+    using Finals = sim::submissions::ListFilter::Finals;
+    switch (scope) {
+    case Scope::NONE: return {"owner", "owner_2", "", Finals::NONE, "", "type"};
+    case Scope::PROBLEM:
+        return {"owner_3", "owner_9", "owner_10", Finals::PROBLEM, "problem_id", "problem_id_2"};
+    case Scope::CONTEST_PROBLEM:
+        return {
+            "owner_4",
+            "owner_11",
+            "owner_12",
+            Finals::CONTEST,
+            "contest_problem_id",
+            "contest_problem_id_2",
+        };
+    case Scope::CONTEST_ROUND:
+        return {
+            "owner_5",
+            "owner_13",
+            "owner_14",
+            Finals::CONTEST,
+            "contest_round_id",
+            "contest_round_id_2",
+        };
+    case Scope::CONTEST:
+        return {"owner_6", "owner_15", "owner_16", Finals::CONTEST, "contest_id", "contest_id_2"};
+    }
+    __builtin_unreachable();
+}
+
+// FNV-1a of the parts of the filter that are specified by the client
+uint32_t fingerprint(const sim::submissions::ListFilter& filter) noexcept {
+    uint64_t hash = 14695981039346656037ULL;
+    auto feed = [&](uint64_t x) {
+        for (int i = 0; i < 8; ++i, x >>= 8) {
+            hash = (hash ^ (x & 0xff)) * 1099511628211ULL;
+        }
+    };
+    feed(filter.owner.has_value());
+    feed(filter.owner.value_or(0));
+    feed(static_cast<uint64_t>(filter.scope));
+    feed(filter.scope_id);
+    feed(filter.type.has_value());
+    feed(filter.type.has_value() ? static_cast<uint64_t>(*filter.type) : 0);
+    // The kind of the selected finals depends on the permissions, not only on
+    // the client
+    feed(filter.finals != sim::submissions::ListFilter::Finals::NONE);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+constexpr size_t FINGERPRINT_HEX_LEN = 8;
+
+} // namespace
+
+namespace sim::submissions {
+
+optional<StringView> list_index(const ListFilter& filter) noexcept {
+    using Finals = ListFilter::Finals;
+    auto indexes = scope_indexes(filter.scope);
+    if (filter.owner) {
+        if (filter.type) {
+            return indexes.with_owner_and_type;
+        }
+        if (filter.scope == ListFilter::Scope::NONE) {
+            switch (filter.finals) {
+            case Finals::PROBLEM: return StringView{"owner_8"};
+            case Finals::CONTEST: return StringView{"owner_7"};
+            case Finals::NONE:
+            case Finals::PROBLEM_OR_CONTEST: break;
+            }
+        } else if (filter.finals == indexes.final_kind) {
+            return indexes.with_owner_and_final;
+        }
+        return indexes.with_owner;
+    }
+
+    if (filter.type) {
+        return indexes.with_type;
+    }
+    if (indexes.without_owner.empty()) {
+        return std::nullopt;
+    }
+    return indexes.without_owner;
+}
+
+string encode_list_cursor(const ListFilter& filter, uint64_t last_id) {
+    static constexpr char digits[] = "0123456789abcdef";
+    string res;
+    auto fp = fingerprint(filter);
+    for (size_t i = FINGERPRINT_HEX_LEN; i-- > 0;) {
+        res += digits[(fp >> (i * 4)) & 15];
+    }
+    // Mix the id with the fingerprint, so that the cursor does not look like an
+    // id someone may want to tweak
+    uint64_t x = last_id ^ (static_cast<uint64_t>(fp) * 0x9e3779b97f4a7c15ULL);
+    do {
+        res += digits[x & 15];
+        x >>= 4;
+    } while (x != 0);
+    return res;
+}
+
+optional<uint64_t> decode_list_cursor(const ListFilter& filter, StringView cursor) noexcept {
+    // 64-bit id takes at most 16 hex digits
+    if (cursor.size() <= FINGERPRINT_HEX_LEN or cursor.size() > FINGERPRINT_HEX_LEN + 16) {
+        return std::nullopt;
+    }
+    auto hex_value = [](char c) -> int {
+        if (c >= '0' and c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' and c <= 'f') {
+            return c - 'a' + 10;
+        }
+        return -1;
+    };
+
+    uint32_t fp = 0;
+    for (size_t i = 0; i < FINGERPRINT_HEX_LEN; ++i) {
+        int v = hex_value(cursor[i]);
+        if (v < 0) {
+            return std::nullopt;
+        }
+        fp = (fp << 4) | static_cast<uint32_t>(v);
+    }
+    if (fp != fingerprint(filter)) {
+        return std::nullopt;
+    }
+
+    uint64_t x = 0;
+    for (size_t i = cursor.size(); i-- > FINGERPRINT_HEX_LEN;) {
+        int v = hex_value(cursor[i]);
+        if (v < 0) {
+            return std::nullopt;
+        }
+        x = (x << 4) | static_cast<uint64_t>(v);
+    }
+    return x ^ (static_cast<uint64_t>(fp) * 0x9e3779b97f4a7c15ULL);
+}
+
+} // namespace sim::submissions
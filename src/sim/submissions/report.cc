@@ -0,0 +1,439 @@
+#include <sim/jobs/utils.hh>
+#include <sim/submissions/report.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/macros/throw.hh>
+#include <simlib/string_compare.hh>
+#include <simlib/string_transform.hh>
+#include <simlib/throw_assert.hh>
+#include <simlib/time.hh>
+
+using sim::jobs::append_dumped;
+using sim::jobs::extract_dumped;
+using sim::jobs::extract_dumped_int;
+using sim::jobs::extract_dumped_string;
+using std::string;
+
+namespace sim::submissions {
+
+namespace {
+
+// Begins every report in the binary form (HTML never begins with '\0')
+constexpr StringView REPORT_HEADER{"\0SR\x01", 4};
+
+enum class ReportKind : uint8_t {
+    JUDGE_REPORT = 0,
+    COMPILATION_ERRORS = 1,
+};
+
+enum class RecordType : uint8_t {
+    // group index (uint32), score (int64), max score (int64)
+    GROUP = 'G',
+    // group index (uint32), test index (uint32), name, status (uint8), runtime,
+    // time limit, memory consumed (uint64), memory limit (uint64), comment
+    TEST = 'T',
+};
+
+void append_group_record(string& buff, uint32_t group_idx, const JudgeReport::Group& group) {
+    append_dumped(buff, static_cast<uint8_t>(RecordType::GROUP));
+    append_dumped(buff, group_idx);
+    append_dumped(buff, static_cast<int64_t>(group.score));
+    append_dumped(buff, static_cast<int64_t>(group.max_score));
+}
+
+void append_test_record(
+    string& buff, uint32_t group_idx, uint32_t test_idx, const JudgeReport::Test& test
+) {
+    append_dumped(buff, static_cast<uint8_t>(RecordType::TEST));
+    append_dumped(buff, group_idx);
+    append_dumped(buff, test_idx);
+    append_dumped(buff, test.name);
+    append_dumped(buff, static_cast<uint8_t>(test.status));
+    append_dumped(buff, test.runtime);
+    append_dumped(buff, test.time_limit);
+    append_dumped(buff, static_cast<uint64_t>(test.memory_consumed));
+    append_dumped(buff, static_cast<uint64_t>(test.memory_limit));
+    append_dumped(buff, test.comment);
+}
+
+bool are_equal(const JudgeReport::Test& a, const JudgeReport::Test& b) noexcept {
+    return a.name == b.name and a.status == b.status and a.runtime == b.runtime and
+        a.time_limit == b.time_limit and a.memory_consumed == b.memory_consumed and
+        a.memory_limit == b.memory_limit and a.comment == b.comment;
+}
+
+// Returns the group @p idx of @p jr, appending it if @p idx == jr.groups.size()
+JudgeReport::Group& group_to_override(JudgeReport& jr, uint32_t idx) {
+    if (idx == jr.groups.size()) {
+        return jr.groups.emplace_back();
+    }
+    if (idx > jr.groups.size()) {
+        THROW("Corrupted report: record of group ", idx, " out of ", jr.groups.size());
+    }
+    return jr.groups[idx];
+}
+
+const char* status_css_classes(JudgeReport::Test::Status status) {
+    switch (status) {
+    case JudgeReport::Test::OK: return "status green";
+    case JudgeReport::Test::WA: return "status red";
+    case JudgeReport::Test::TLE:
+    case JudgeReport::Test::MLE:
+    case JudgeReport::Test::OLE: return "status yellow";
+    case JudgeReport::Test::RTE: return "status intense-red";
+    case JudgeReport::Test::CHECKER_ERROR: return "status blue";
+    case JudgeReport::Test::SKIPPED: return "status";
+    }
+    THROW("Invalid test status: ", static_cast<int>(status));
+}
+
+const char* status_description(JudgeReport::Test::Status status) {
+    switch (status) {
+    case JudgeReport::Test::OK: return "OK";
+    case JudgeReport::Test::WA: return "Wrong answer";
+    case JudgeReport::Test::TLE: return "Time limit exceeded";
+    case JudgeReport::Test::MLE: return "Memory limit exceeded";
+    case JudgeReport::Test::OLE: return "Output size limit exceeded";
+    case JudgeReport::Test::RTE: return "Runtime error";
+    case JudgeReport::Test::CHECKER_ERROR: return "Checker error";
+    case JudgeReport::Test::SKIPPED: return "Pending";
+    }
+    THROW("Invalid test status: ", static_cast<int>(status));
+}
+
+const char* status_json_name(JudgeReport::Test::Status status) {
+    switch (status) {
+    case JudgeReport::Test::OK: return "OK";
+    case JudgeReport::Test::WA: return "WA";
+    case JudgeReport::Test::TLE: return "TLE";
+    case JudgeReport::Test::MLE: return "MLE";
+    case JudgeReport::Test::OLE: return "OLE";
+    case JudgeReport::Test::RTE: return "RTE";
+    case JudgeReport::Test::CHECKER_ERROR: return "CHECKER_ERROR";
+    case JudgeReport::Test::SKIPPED: return "SKIPPED";
+    }
+    THROW("Invalid test status: ", static_cast<int>(status));
+}
+
+void append_judge_report_html(string& html, const JudgeReport& jr) {
+    STACK_UNWINDING_MARK;
+    using Test = JudgeReport::Test;
+
+    if (jr.groups.empty()) {
+        return;
+    }
+
+    // clang-format off
+    html += "<table class=\"table\">"
+                "<thead>"
+                    "<tr>"
+                        "<th class=\"test\">Test</th>"
+                        "<th class=\"result\">Result</th>"
+                        "<th class=\"time\">Time [s]</th>"
+                        "<th class=\"memory\">Memory [KiB]</th>"
+                        "<th class=\"points\">Score</th>"
+                    "</tr>"
+                "</thead>"
+                "<tbody>";
+    // clang-format on
+
+    auto append_normal_columns = [&](const Test& test) {
+        back_insert(
+            html,
+            "<td>",
+            html_escape(test.name),
+            "</td><td class=\"",
+            status_css_classes(test.status),
+            "\">",
+            status_description(test.status),
+            "</td><td>"
+        );
+
+        if (test.status == Test::SKIPPED) {
+            html += '?';
+        } else {
+            back_insert(html, to_string(floor_to_10ms(test.runtime), false));
+        }
+
+        back_insert(html, " / ", to_string(floor_to_10ms(test.time_limit), false), "</td><td>");
+
+        if (test.status == Test::SKIPPED) {
+            html += '?';
+        } else {
+            back_insert(html, test.memory_consumed >> 10);
+        }
+
+        back_insert(html, " / ", test.memory_limit >> 10, "</td>");
+    };
+
+    bool there_are_comments = false;
+    for (auto const& group : jr.groups) {
+        if (group.tests.empty()) {
+            continue; // May happen only for a corrupted report
+        }
+        // First row
+        html += "<tr>";
+        append_normal_columns(group.tests[0]);
+        back_insert(
+            html,
+            R"(<td class="groupscore" rowspan=")",
+            group.tests.size(),
+            "\">",
+            group.score,
+            " / ",
+            group.max_score,
+            "</td></tr>"
+        );
+        // Other rows
+        for (size_t i = 1; i < group.tests.size(); ++i) {
+            html += "<tr>";
+            append_normal_columns(group.tests[i]);
+            html += "</tr>";
+        }
+
+        for (auto const& test : group.tests) {
+            there_are_comments |= !test.comment.empty();
+        }
+    }
+
+    html += "</tbody></table>";
+
+    // Tests comments
+    if (there_are_comments) {
+        html += "<ul class=\"tests-comments\">";
+        for (auto const& group : jr.groups) {
+            for (auto const& test : group.tests) {
+                if (!test.comment.empty()) {
+                    back_insert(
+                        html,
+                        "<li><span class=\"test-id\">",
+                        html_escape(test.name),
+                        "</span>",
+                        html_escape(test.comment),
+                        "</li>"
+                    );
+                }
+            }
+        }
+        html += "</ul>";
+    }
+}
+
+void append_judge_report_json(string& json, const JudgeReport& jr) {
+    STACK_UNWINDING_MARK;
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+
+    json += "{\"groups\":[";
+    for (size_t i = 0; i < jr.groups.size(); ++i) {
+        auto const& group = jr.groups[i];
+        back_insert(
+            json,
+            (i > 0 ? "," : ""),
+            "{\"score\":",
+            group.score,
+            ",\"max_score\":",
+            group.max_score,
+            ",\"tests\":["
+        );
+        for (size_t j = 0; j < group.tests.size(); ++j) {
+            auto const& test = group.tests[j];
+            back_insert(
+                json,
+                (j > 0 ? "," : ""),
+                "{\"name\":",
+                json_stringify(test.name),
+                ",\"status\":\"",
+                status_json_name(test.status),
+                "\",\"runtime_ms\":",
+                duration_cast<milliseconds>(test.runtime).count(),
+                ",\"time_limit_ms\":",
+                duration_cast<milliseconds>(test.time_limit).count(),
+                ",\"memory_kib\":",
+                test.memory_consumed >> 10,
+                ",\"memory_limit_kib\":",
+                test.memory_limit >> 10,
+                ",\"comment\":",
+                json_stringify(test.comment),
+                '}'
+            );
+        }
+        json += "]}";
+    }
+    json += "]}";
+}
+
+} // namespace
+
+string dump_report(const JudgeReport& jr) {
+    STACK_UNWINDING_MARK;
+
+    string res{REPORT_HEADER.data(), REPORT_HEADER.size()};
+    append_dumped(res, static_cast<uint8_t>(ReportKind::JUDGE_REPORT));
+    for (uint32_t i = 0; i < jr.groups.size(); ++i) {
+        auto const& group = jr.groups[i];
+        append_group_record(res, i, group);
+        for (uint32_t j = 0; j < group.tests.size(); ++j) {
+            append_test_record(res, i, j, group.tests[j]);
+        }
+    }
+    return res;
+}
+
+std::optional<string> dump_report_update(const JudgeReport& prev, const JudgeReport& curr) {
+    STACK_UNWINDING_MARK;
+
+    if (prev.groups.size() != curr.groups.size()) {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < curr.groups.size(); ++i) {
+        auto const& prev_tests = prev.groups[i].tests;
+        auto const& curr_tests = curr.groups[i].tests;
+        if (prev_tests.size() != curr_tests.size()) {
+            return std::nullopt;
+        }
+        for (size_t j = 0; j < curr_tests.size(); ++j) {
+            if (prev_tests[j].name != curr_tests[j].name) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    string res;
+    for (uint32_t i = 0; i < curr.groups.size(); ++i) {
+        auto const& prev_group = prev.groups[i];
+        auto const& curr_group = curr.groups[i];
+        if (prev_group.score != curr_group.score or prev_group.max_score != curr_group.max_score)
+        {
+            append_group_record(res, i, curr_group);
+        }
+        for (uint32_t j = 0; j < curr_group.tests.size(); ++j) {
+            if (not are_equal(prev_group.tests[j], curr_group.tests[j])) {
+                append_test_record(res, i, j, curr_group.tests[j]);
+            }
+        }
+    }
+    return res;
+}
+
+string dump_compilation_errors(StringView compilation_errors) {
+    STACK_UNWINDING_MARK;
+
+    string res{REPORT_HEADER.data(), REPORT_HEADER.size()};
+    append_dumped(res, static_cast<uint8_t>(ReportKind::COMPILATION_ERRORS));
+    append_dumped(res, compilation_errors);
+    return res;
+}
+
+std::variant<JudgeReport, CompilationErrors, LegacyHtmlReport>
+parse_report(StringView stored_report) {
+    STACK_UNWINDING_MARK;
+
+    if (stored_report.empty()) {
+        return JudgeReport{};
+    }
+    if (not has_prefix(stored_report, REPORT_HEADER)) {
+        return LegacyHtmlReport{stored_report};
+    }
+    stored_report.remove_prefix(REPORT_HEADER.size());
+
+    switch (static_cast<ReportKind>(extract_dumped_int<uint8_t>(stored_report))) {
+    case ReportKind::JUDGE_REPORT: break;
+    case ReportKind::COMPILATION_ERRORS:
+        return CompilationErrors{extract_dumped_string(stored_report)};
+    default: THROW("Corrupted report: invalid kind");
+    }
+
+    JudgeReport jr;
+    while (not stored_report.empty()) {
+        auto record_type = static_cast<RecordType>(extract_dumped_int<uint8_t>(stored_report));
+        auto group_idx = extract_dumped_int<uint32_t>(stored_report);
+        switch (record_type) {
+        case RecordType::GROUP: {
+            auto& group = group_to_override(jr, group_idx);
+            group.score = static_cast<decltype(group.score)>(
+                extract_dumped_int<int64_t>(stored_report)
+            );
+            group.max_score = static_cast<decltype(group.max_score)>(
+                extract_dumped_int<int64_t>(stored_report)
+            );
+            break;
+        }
+        case RecordType::TEST: {
+            if (group_idx >= jr.groups.size()) {
+                THROW("Corrupted report: test of a nonexistent group ", group_idx);
+            }
+            auto test_idx = extract_dumped_int<uint32_t>(stored_report);
+            auto name = extract_dumped_string(stored_report);
+            auto status =
+                static_cast<JudgeReport::Test::Status>(extract_dumped_int<uint8_t>(stored_report));
+            std::chrono::nanoseconds runtime{};
+            extract_dumped(runtime, stored_report);
+            std::chrono::nanoseconds time_limit{};
+            extract_dumped(time_limit, stored_report);
+            auto memory_consumed = extract_dumped_int<uint64_t>(stored_report);
+            auto memory_limit = extract_dumped_int<uint64_t>(stored_report);
+            auto& tests = jr.groups[group_idx].tests;
+            if (test_idx > tests.size()) {
+                THROW("Corrupted report: record of test ", test_idx, " out of ", tests.size());
+            }
+            JudgeReport::Test test{
+                std::move(name),
+                status,
+                runtime,
+                time_limit,
+                memory_consumed,
+                memory_limit,
+                extract_dumped_string(stored_report),
+            };
+            if (test_idx == tests.size()) {
+                tests.emplace_back(std::move(test));
+            } else {
+                tests[test_idx] = std::move(test);
+            }
+            break;
+        }
+        default: THROW("Corrupted report: invalid record type");
+        }
+    }
+    return jr;
+}
+
+string report_to_html(StringView stored_report) {
+    STACK_UNWINDING_MARK;
+
+    auto report = parse_report(stored_report);
+    if (auto* legacy = std::get_if<LegacyHtmlReport>(&report)) {
+        return legacy->html.to_string();
+    }
+    if (auto* ce = std::get_if<CompilationErrors>(&report)) {
+        return concat_tostr(
+            "<pre class=\"compilation-errors\">", html_escape(ce->errors), "</pre>"
+        );
+    }
+
+    string html;
+    append_judge_report_html(html, std::get<JudgeReport>(report));
+    return html;
+}
+
+string report_to_json(StringView stored_report) {
+    STACK_UNWINDING_MARK;
+
+    if (stored_report.empty()) {
+        return "null";
+    }
+
+    auto report = parse_report(stored_report);
+    if (auto* legacy = std::get_if<LegacyHtmlReport>(&report)) {
+        return concat_tostr("{\"html\":", json_stringify(legacy->html), '}');
+    }
+    if (auto* ce = std::get_if<CompilationErrors>(&report)) {
+        return concat_tostr("{\"compilation_errors\":", json_stringify(ce->errors), '}');
+    }
+
+    string json;
+    append_judge_report_json(json, std::get<JudgeReport>(report));
+    return json;
+}
+
+} // namespace sim::submissions
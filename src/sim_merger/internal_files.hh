@@ -7,10 +7,25 @@
 #include <simlib/file_info.hh>
 #include <simlib/file_manip.hh>
 #include <simlib/time.hh>
+#include <unistd.h>
 
 namespace sim_merger {
 
 class InternalFilesMerger : public Merger<sim::internal_files::InternalFile> {
+    // Returns the path of the internal file @p id in @p internal_files_dir. Sims
+    // that were not upgraded yet store their internal files unsharded.
+    static auto
+    path_in(StringView internal_files_dir, decltype(sim::internal_files::InternalFile::id) id) {
+        auto path = concat<PATH_MAX>(internal_files_dir, sim::internal_files::relative_path_of(id));
+        if (access(path, F_OK) != 0) {
+            auto unsharded_path = concat<PATH_MAX>(internal_files_dir, id);
+            if (access(unsharded_path, F_OK) == 0) {
+                return unsharded_path;
+            }
+        }
+        return path;
+    }
+
     void load(RecordSet& record_set) override {
         STACK_UNWINDING_MARK;
         sim::internal_files::InternalFile file{};
@@ -18,8 +33,9 @@ class InternalFilesMerger : public Merger<sim::internal_files::InternalFile> {
         stmt.bind_and_execute();
         stmt.res_bind_all(file.id);
         while (stmt.next()) {
-            auto mtime =
-                get_modification_time(concat(record_set.sim_build(), "internal_files/", file.id));
+            auto mtime = get_modification_time(
+                path_in(concat(record_set.sim_build(), "internal_files/"), file.id)
+            );
             record_set.add_record(file, mtime);
         }
     }
@@ -97,16 +113,20 @@ public:
 
             if (not new_record.main_ids.empty()) {
                 // Hard link main's files
-                auto src = concat(bkp_path, new_record.main_ids.front());
-                auto dest = concat(dest_path, x.id);
+                auto src = path_in(bkp_path, new_record.main_ids.front());
+                auto dest = concat(dest_path, sim::internal_files::relative_path_of(x.id));
+                sim::internal_files::create_parent_dirs_of(dest);
                 if (link(src, dest)) {
                     THROW("link(", src, ", ", dest, ')', errmsg());
                 }
             } else {
                 // Copy other's files
                 throw_assert(not new_record.other_ids.empty());
-                auto src = concat(other_sim_build, "internal_files/", new_record.other_ids.front());
-                auto dest = concat(dest_path, x.id);
+                auto src = path_in(
+                    concat(other_sim_build, "internal_files/"), new_record.other_ids.front()
+                );
+                auto dest = concat(dest_path, sim::internal_files::relative_path_of(x.id));
+                sim::internal_files::create_parent_dirs_of(dest);
                 if (copy(src, dest)) {
                     THROW("copy(", src, ", ", dest, ')', errmsg());
                 }
@@ -164,10 +184,10 @@ public:
         }
 
         if (not elem.main_ids.empty()) {
-            return concat(main_sim_build, "internal_files/", elem.main_ids.front());
+            return path_in(concat(main_sim_build, "internal_files/"), elem.main_ids.front());
         }
         if (not elem.other_ids.empty()) {
-            return concat(other_sim_build, "internal_files/", elem.other_ids.front());
+            return path_in(concat(other_sim_build, "internal_files/"), elem.other_ids.front());
         }
 
         THROW("Invalid new_id");
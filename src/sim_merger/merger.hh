@@ -302,6 +302,13 @@ protected:
         other_.fill_id_to_table_idx();
 
         merge();
+
+        // Only new_table_ and the mappings of ids are needed from now on
+        for (RecordSet* record_set : {&main_, &other_}) {
+            record_set->ids = {};
+            record_set->table = {};
+            record_set->id_to_table_idx = {};
+        }
     }
 
     static std::string id_info(PrimaryKeyType id, IdKind kind) {
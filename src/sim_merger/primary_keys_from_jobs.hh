@@ -78,7 +78,6 @@ struct PrimaryKeysFromJobs {
     PrimaryKeysWithTime<decltype(sim::contest_entry_tokens::ContestEntryToken::primary_key)::Type>
         contest_entry_tokens;
     PrimaryKeysWithTime<decltype(sim::submissions::Submission::primary_key)::Type> submissions;
-    PrimaryKeysWithTime<decltype(sim::jobs::Job::primary_key)::Type> jobs;
 
     void initialize(StringView job_table_name) {
         STACK_UNWINDING_MARK;
@@ -105,7 +104,6 @@ struct PrimaryKeysFromJobs {
             auto created_at = str_to_time_point(added_str.to_cstr());
 
             // Process non-type-specific ids
-            jobs.add_id(id, created_at);
             if (file_id.has_value()) {
                 internal_files.add_id(file_id.value(), created_at);
             }
@@ -14,6 +14,7 @@
 #include "users.hh"
 
 #include <iostream>
+#include <sim/db/dump.hh>
 #include <sim/mysql/mysql.hh>
 #include <simlib/config_file.hh>
 #include <simlib/defer.hh>
@@ -29,6 +30,14 @@ namespace sim_merger {
 
 static void load_tables_from_other_sim_backup() {
     STACK_UNWINDING_MARK;
+    auto other_dump_dir = concat_tostr(other_sim_build, sim::db::dump_dir);
+    if (access(other_dump_dir.c_str(), F_OK) == 0) {
+        stdlog("Loading ", sim::db::dump_dir, "...");
+        sim::db::load_dump(conn, other_dump_dir);
+        return;
+    }
+
+    // Backups made before the dump was split into chunks
     stdlog("Loading dump.sql...");
     ConfigFile cf;
     cf.add_vars("user", "password", "db");
@@ -179,12 +188,25 @@ static int true_main(int argc, char** argv) {
     });
 
     STACK_UNWINDING_MARK;
-    // Ensure that other_sim_bulid/dump.sql exists
-    if (access(concat(other_sim_build, "dump.sql"), F_OK) != 0) {
-        stdlog("File ", other_sim_build, "dump.sql does not exists -> asking git to restore it");
+    // Ensure that the dump of other_sim_build exists
+    if (access(concat(other_sim_build, sim::db::dump_dir), F_OK) != 0 and
+        access(concat(other_sim_build, "dump.sql"), F_OK) != 0)
+    {
+        stdlog("The dump of ", other_sim_build, " does not exist -> asking git to restore it");
         auto es = Spawner::run(
-            "git", {"git", "-C", other_sim_build.to_string(), "checkout", "--", "dump.sql"}
+            "git",
+            {"git",
+             "-C",
+             other_sim_build.to_string(),
+             "checkout",
+             "--",
+             sim::db::dump_dir.to_string()}
         );
+        if (es.si.code != CLD_EXITED or es.si.status != 0) {
+            es = Spawner::run(
+                "git", {"git", "-C", other_sim_build.to_string(), "checkout", "--", "dump.sql"}
+            );
+        }
         if (es.si.code != CLD_EXITED or es.si.status != 0) {
             errlog("Git failed: ", es.message);
             return 1;
@@ -301,7 +323,6 @@ static int true_main(int argc, char** argv) {
 
     stdlog("\033[1;36mMerging jobs\033[m...");
     JobsMerger jobs(
-        ids_from_both_jobs,
         internal_files,
         users,
         submissions,
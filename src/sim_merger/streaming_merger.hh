@@ -0,0 +1,331 @@
+#pragma once
+
+#include "merger.hh"
+#include "primary_keys_from_jobs.hh"
+#include "sim_merger.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <sim/db/dump.hh>
+#include <sim/merging/merge_ids.h>
+#include <sim/sql_fields/datetime.hh>
+#include <simlib/defer.hh>
+#include <simlib/throw_assert.hh>
+#include <simlib/time.hh>
+#include <string>
+#include <vector>
+
+namespace sim_merger {
+
+// Iterates over the ids of the table in batches, so that the table is never
+// loaded whole. Ids referenced by the jobs only (their records were deleted)
+// are within [min_id(), max_id_plus_one()) and the jobs' times are used as the
+// upper bounds of their creation times.
+class TableIdIterator : public sim::merging::IdIterator {
+    static constexpr size_t BATCH_SIZE = 4096;
+
+    const std::string sql_table_name_;
+    const PrimaryKeysWithTime<uint64_t>* ids_from_jobs_;
+    uint64_t min_id_ = 1;
+    uint64_t max_id_plus_one_ = 1;
+    std::vector<sim::merging::IdCreatedAt> batch_; // in the decreasing order of ids
+    size_t batch_pos_ = 0;
+    bool table_exhausted_ = false;
+
+public:
+    TableIdIterator(std::string sql_table_name, const PrimaryKeysWithTime<uint64_t>* ids_from_jobs)
+    : sql_table_name_(std::move(sql_table_name))
+    , ids_from_jobs_(ids_from_jobs) {
+        STACK_UNWINDING_MARK;
+
+        std::optional<uint64_t> lowest_id;
+        std::optional<uint64_t> highest_id;
+        auto res = conn.query("SELECT MIN(id), MAX(id) FROM ", sql_table_name_);
+        if (res.next() and not res.is_null(0)) {
+            lowest_id = str2num<uint64_t>(res[0]).value();
+            highest_id = str2num<uint64_t>(res[1]).value();
+        }
+        if (ids_from_jobs_ and not ids_from_jobs_->ids.empty()) {
+            auto jobs_lowest_id = ids_from_jobs_->ids.begin()->first;
+            auto jobs_highest_id = ids_from_jobs_->ids.rbegin()->first;
+            lowest_id = std::min(lowest_id.value_or(jobs_lowest_id), jobs_lowest_id);
+            highest_id = std::max(highest_id.value_or(jobs_highest_id), jobs_highest_id);
+        }
+        if (lowest_id) {
+            min_id_ = *lowest_id;
+            max_id_plus_one_ = *highest_id + 1;
+        }
+    }
+
+    [[nodiscard]] uint64_t min_id() override { return min_id_; }
+
+    [[nodiscard]] uint64_t max_id_plus_one() override { return max_id_plus_one_; }
+
+    [[nodiscard]] std::optional<sim::merging::IdCreatedAt> next_id_desc() override {
+        STACK_UNWINDING_MARK;
+        if (batch_pos_ == batch_.size()) {
+            if (table_exhausted_) {
+                return std::nullopt;
+            }
+
+            auto end_id = batch_.empty() ? max_id_plus_one_ : batch_.back().id;
+            batch_.clear();
+            batch_pos_ = 0;
+            auto res = conn.query(
+                "SELECT id, created_at FROM ",
+                sql_table_name_,
+                " WHERE id<",
+                end_id,
+                " ORDER BY id DESC LIMIT ",
+                BATCH_SIZE
+            );
+            while (res.next()) {
+                batch_.push_back({
+                    .id = str2num<uint64_t>(res[0]).value(),
+                    .created_at = sim::sql_fields::Datetime{res[1]},
+                });
+            }
+            table_exhausted_ = (batch_.size() < BATCH_SIZE);
+            if (batch_.empty()) {
+                return std::nullopt;
+            }
+        }
+
+        return batch_[batch_pos_++];
+    }
+
+    [[nodiscard]] std::optional<sim::sql_fields::Datetime>
+    created_at_upper_bound_of_id(uint64_t id) override {
+        if (not ids_from_jobs_) {
+            return std::nullopt;
+        }
+        auto it = ids_from_jobs_->ids.find(id);
+        if (it == ids_from_jobs_->ids.end()) {
+            return std::nullopt;
+        }
+
+        auto jobs_time = mysql_date(std::chrono::system_clock::to_time_t(it->second));
+        return sim::sql_fields::Datetime{jobs_time};
+    }
+};
+
+// Merger of a table whose records are never merged with one another, so every
+// record only gets a new id. Unlike Merger, it keeps in memory only the mapping
+// of ids: the records are read in the order of ids, in batches, and saved with
+// multi-row INSERTs. Blobs are saved as hex literals, so a record takes about
+// twice its size in an INSERT, which has to fit in max_allowed_packet.
+class StreamingMerger : public MergerBase {
+    static constexpr size_t ROWS_BATCH = 256;
+    // A bigger row is saved alone, if it fits in max_allowed_packet
+    static constexpr size_t INSERT_MAX_SIZE = 4 << 20; // in bytes
+
+    const std::string sql_table_name_;
+    const sim::merging::MergedIds merged_ids_;
+
+protected:
+    // Columns read from the table and saved to it, the first one has to be `id`
+    [[nodiscard]] virtual StringView sql_columns() const noexcept = 0;
+
+    // Appends to @p sql the values of @p row (columns as in sql_columns()),
+    // with the ids changed to the new ones. Use the below helpers.
+    virtual void append_new_row(std::string& sql, mysql::Result& row, IdKind kind) const = 0;
+
+    static void append_value(std::string& sql, mysql::Result& row, size_t col) {
+        if (col > 0) {
+            sql += ',';
+        }
+        if (row.is_null(col)) {
+            sql += "NULL";
+        } else {
+            sim::db::append_sql_string_literal(sql, row[col]);
+        }
+    }
+
+    static void append_bytes(std::string& sql, size_t col, StringView bytes) {
+        if (col > 0) {
+            sql += ',';
+        }
+        sim::db::append_sql_hex_literal(sql, bytes);
+    }
+
+    static void append_bytes(std::string& sql, mysql::Result& row, size_t col) {
+        if (row.is_null(col)) {
+            append_value(sql, row, col);
+        } else {
+            append_bytes(sql, col, row[col]);
+        }
+    }
+
+    template <class MergerOfColumn>
+    static void append_new_id(
+        std::string& sql,
+        mysql::Result& row,
+        size_t col,
+        const MergerOfColumn& merger_of_column,
+        IdKind kind
+    ) {
+        if (row.is_null(col)) {
+            append_value(sql, row, col);
+            return;
+        }
+        if (col > 0) {
+            sql += ',';
+        }
+        back_insert(sql, merger_of_column.new_id(str2num<uint64_t>(row[col]).value(), kind));
+    }
+
+    // @p main_ids_from_jobs and @p other_ids_from_jobs may be nullptr
+    StreamingMerger(
+        StringView orig_sql_table_name,
+        const PrimaryKeysWithTime<uint64_t>* main_ids_from_jobs,
+        const PrimaryKeysWithTime<uint64_t>* other_ids_from_jobs
+    )
+    : sql_table_name_(orig_sql_table_name.to_string())
+    , merged_ids_([&] {
+        STACK_UNWINDING_MARK;
+        TableIdIterator main_ids(
+            concat_tostr(main_sim_table_prefix, orig_sql_table_name), main_ids_from_jobs
+        );
+        TableIdIterator other_ids(orig_sql_table_name.to_string(), other_ids_from_jobs);
+        return sim::merging::merge_ids(main_ids, other_ids);
+    }()) {}
+
+public:
+    const std::string& sql_table_name() noexcept final { return sql_table_name_; }
+
+    [[nodiscard]] uint64_t new_id(uint64_t old_id, IdKind kind) const noexcept {
+        switch (kind) {
+        case IdKind::Main: return merged_ids_.current_id_to_new_id(old_id);
+        case IdKind::Other: return merged_ids_.other_id_to_new_id(old_id);
+        }
+        std::terminate();
+    }
+
+    void save_merged() override {
+        STACK_UNWINDING_MARK;
+        auto main_sql_table_name = concat_tostr(main_sim_table_prefix, sql_table_name_);
+        // The records of the other sim are in the table that is saved into,
+        // so they are copied aside first
+        auto other_sql_table_name = concat_tostr(other_sim_table_prefix, sql_table_name_);
+        conn.update("DROP TABLE IF EXISTS ", other_sql_table_name);
+        conn.update("CREATE TABLE ", other_sql_table_name, " LIKE ", sql_table_name_);
+        Defer other_table_dropper = [&] {
+            try {
+                conn.update("DROP TABLE IF EXISTS ", other_sql_table_name);
+            } catch (const std::exception& e) {
+                ERRLOG_CATCH(e);
+            }
+        };
+        conn.update("INSERT INTO ", other_sql_table_name, " SELECT * FROM ", sql_table_name_);
+
+        // Not TRUNCATE, as it commits implicitly: if saving fails, the rollback
+        // has to restore the table before other_table_dropper drops the copy
+        auto transaction = conn.start_transaction();
+        conn.update("DELETE FROM ", sql_table_name_);
+
+        auto header = concat_tostr(sql_table_name_, " saved:");
+        header[0] = static_cast<char>(std::toupper(header[0]));
+        ProgressBar progress_bar(
+            std::move(header), rows_num(main_sql_table_name) + rows_num(other_sql_table_name), 128
+        );
+        auto max_allowed_packet = get_max_allowed_packet();
+        save_records(main_sql_table_name, IdKind::Main, progress_bar, max_allowed_packet);
+        save_records(other_sql_table_name, IdKind::Other, progress_bar, max_allowed_packet);
+
+        transaction.commit();
+        // ALTER TABLE commits implicitly, so it follows the saved records
+        conn.update(
+            "ALTER TABLE ", sql_table_name_, " AUTO_INCREMENT=", merged_ids_.max_new_id_plus_one()
+        );
+    }
+
+private:
+    static size_t rows_num(StringView sql_table_name) {
+        STACK_UNWINDING_MARK;
+        auto res = conn.query("SELECT COUNT(*) FROM ", sql_table_name);
+        throw_assert(res.next());
+        return str2num<size_t>(res[0]).value();
+    }
+
+    static size_t get_max_allowed_packet() {
+        STACK_UNWINDING_MARK;
+        auto res = conn.query("SELECT @@max_allowed_packet");
+        throw_assert(res.next());
+        return str2num<size_t>(res[0]).value();
+    }
+
+    void save_records(
+        StringView from_sql_table_name,
+        IdKind kind,
+        ProgressBar& progress_bar,
+        size_t max_allowed_packet
+    ) {
+        STACK_UNWINDING_MARK;
+        auto insert_header =
+            concat_tostr("INSERT INTO ", sql_table_name_, '(', sql_columns(), ") VALUES");
+        // The packet holds also the command byte
+        auto max_insert_size = max_allowed_packet - 1;
+        uint64_t min_id = 0;
+        std::string row_sql;
+        for (;;) {
+            std::vector<std::string> inserts;
+            size_t rows = 0;
+            {
+                auto res = conn.query(
+                    "SELECT ",
+                    sql_columns(),
+                    " FROM ",
+                    from_sql_table_name,
+                    " WHERE id>=",
+                    min_id,
+                    " ORDER BY id LIMIT ",
+                    ROWS_BATCH
+                );
+                while (res.next()) {
+                    row_sql = '(';
+                    append_new_row(row_sql, res, kind);
+                    row_sql += ')';
+
+                    if (not inserts.empty() and
+                        inserts.back().size() + 1 + row_sql.size() <=
+                            std::min(INSERT_MAX_SIZE, max_insert_size))
+                    {
+                        inserts.back() += ',';
+                    } else if (insert_header.size() + row_sql.size() <= max_insert_size) {
+                        inserts.emplace_back(insert_header);
+                    } else {
+                        THROW(
+                            "Record with id ",
+                            res[0],
+                            " from ",
+                            from_sql_table_name,
+                            " needs an INSERT of ",
+                            insert_header.size() + row_sql.size(),
+                            " bytes, but max_allowed_packet is ",
+                            max_allowed_packet,
+                            " bytes. Increase max_allowed_packet of the MySQL server."
+                        );
+                    }
+                    inserts.back() += row_sql;
+
+                    min_id = str2num<uint64_t>(res[0]).value() + 1;
+                    ++rows;
+                    progress_bar.iter();
+                }
+            }
+            // Executed once the result is freed
+            for (const auto& insert : inserts) {
+                conn.update(insert);
+            }
+            if (rows < ROWS_BATCH) {
+                return;
+            }
+        }
+    }
+};
+
+} // namespace sim_merger
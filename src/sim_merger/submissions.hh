@@ -3,10 +3,14 @@
 #include "contest_problems.hh"
 #include "internal_files.hh"
 #include "problems.hh"
+#include "streaming_merger.hh"
+
+#include <array>
+#include <string>
 
 namespace sim_merger {
 
-class SubmissionsMerger : public Merger<sim::submissions::Submission> {
+class SubmissionsMerger : public StreamingMerger {
     const InternalFilesMerger& internal_files_;
     const UsersMerger& users_;
     const ProblemsMerger& problems_;
@@ -14,131 +18,66 @@ class SubmissionsMerger : public Merger<sim::submissions::Submission> {
     const ContestRoundsMerger& contest_rounds_;
     const ContestsMerger& contests_;
 
-    void load(RecordSet& record_set) override {
-        STACK_UNWINDING_MARK;
-
-        sim::submissions::Submission s;
-        mysql::Optional<decltype(s.owner)::value_type> m_owner;
-        mysql::Optional<decltype(s.contest_problem_id)::value_type> m_contest_problem_id;
-        mysql::Optional<decltype(s.contest_round_id)::value_type> m_contest_round_id;
-        mysql::Optional<decltype(s.contest_id)::value_type> m_contest_id;
-        mysql::Optional<decltype(s.score)::value_type> m_score;
-        auto stmt = conn.prepare(
-            "SELECT id, file_id, owner, problem_id,"
-            " contest_problem_id, contest_round_id, contest_id,"
-            " type, language, final_candidate, problem_final,"
-            " contest_final, contest_initial_final, initial_status,"
-            " full_status, created_at, score, last_judgment,"
-            " initial_report, final_report "
-            "FROM ",
-            record_set.sql_table_name
-        );
-        stmt.bind_and_execute();
-        stmt.res_bind_all(
-            s.id,
-            s.file_id,
-            m_owner,
-            s.problem_id,
-            m_contest_problem_id,
-            m_contest_round_id,
-            m_contest_id,
-            s.type,
-            s.language,
-            s.final_candidate,
-            s.problem_final,
-            s.contest_final,
-            s.contest_initial_final,
-            s.initial_status,
-            s.full_status,
-            s.created_at,
-            m_score,
-            s.last_judgment,
-            s.initial_report,
-            s.final_report
-        );
-        while (stmt.next()) {
-            s.owner = m_owner.to_opt();
-            s.contest_problem_id = m_contest_problem_id.to_opt();
-            s.contest_round_id = m_contest_round_id.to_opt();
-            s.contest_id = m_contest_id.to_opt();
-            s.score = m_score.to_opt();
-
-            s.file_id = internal_files_.new_id(s.file_id, record_set.kind);
-            if (s.owner) {
-                s.owner = users_.new_id(s.owner.value(), record_set.kind);
-            }
-            s.problem_id = problems_.new_id(s.problem_id, record_set.kind);
-            if (s.contest_problem_id) {
-                s.contest_problem_id =
-                    contest_problems_.new_id(s.contest_problem_id.value(), record_set.kind);
-            }
-            if (s.contest_round_id) {
-                s.contest_round_id =
-                    contest_rounds_.new_id(s.contest_round_id.value(), record_set.kind);
-            }
-            if (s.contest_id) {
-                s.contest_id = contests_.new_id(s.contest_id.value(), record_set.kind);
-            }
-
-            record_set.add_record(s, str_to_time_point(from_unsafe{s.created_at.to_string()}));
-        }
-    }
-
-    void merge() override {
-        STACK_UNWINDING_MARK;
-        Merger::merge([&](const sim::submissions::Submission& /*unused*/) { return nullptr; });
+    [[nodiscard]] StringView sql_columns() const noexcept override {
+        return "id, file_id, owner, problem_id, contest_problem_id, contest_round_id,"
+               " contest_id, type, language, final_candidate, problem_final,"
+               " contest_final, contest_initial_final, initial_status, full_status,"
+               " created_at, score, last_judgment, initial_report, final_report";
     }
 
-public:
-    void save_merged() override {
+    void append_new_row(std::string& sql, mysql::Result& row, IdKind kind) const override {
         STACK_UNWINDING_MARK;
-        auto transaction = conn.start_transaction();
-        conn.update("TRUNCATE ", sql_table_name());
-        auto stmt = conn.prepare(
-            "INSERT INTO ",
-            sql_table_name(),
-            "(id, file_id, owner, problem_id, contest_problem_id,"
-            " contest_round_id, contest_id, type, language,"
-            " final_candidate, problem_final, contest_final,"
-            " contest_initial_final, initial_status, full_status,"
-            " created_at, score, last_judgment, initial_report,"
-            " final_report) "
-            "VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?,"
-            " ?, ?, ?, ?)"
-        );
+        enum Column : size_t {
+            ID,
+            FILE_ID,
+            OWNER,
+            PROBLEM_ID,
+            CONTEST_PROBLEM_ID,
+            CONTEST_ROUND_ID,
+            CONTEST_ID,
+            TYPE,
+            LANGUAGE,
+            FINAL_CANDIDATE,
+            PROBLEM_FINAL,
+            CONTEST_FINAL,
+            CONTEST_INITIAL_FINAL,
+            INITIAL_STATUS,
+            FULL_STATUS,
+            CREATED_AT,
+            SCORE,
+            LAST_JUDGMENT,
+            INITIAL_REPORT,
+            FINAL_REPORT,
+        };
 
-        ProgressBar progress_bar("Submissions saved:", new_table_.size(), 128);
-        for (const NewRecord& new_record : new_table_) {
-            Defer progressor = [&] { progress_bar.iter(); };
-            const auto& x = new_record.data;
-            stmt.bind_and_execute(
-                x.id,
-                x.file_id,
-                x.owner,
-                x.problem_id,
-                x.contest_problem_id,
-                x.contest_round_id,
-                x.contest_id,
-                x.type,
-                x.language,
-                x.final_candidate,
-                x.problem_final,
-                x.contest_final,
-                x.contest_initial_final,
-                x.initial_status,
-                x.full_status,
-                x.created_at,
-                x.score,
-                x.last_judgment,
-                x.initial_report,
-                x.final_report
-            );
+        append_new_id(sql, row, ID, *this, kind);
+        append_new_id(sql, row, FILE_ID, internal_files_, kind);
+        append_new_id(sql, row, OWNER, users_, kind);
+        append_new_id(sql, row, PROBLEM_ID, problems_, kind);
+        append_new_id(sql, row, CONTEST_PROBLEM_ID, contest_problems_, kind);
+        append_new_id(sql, row, CONTEST_ROUND_ID, contest_rounds_, kind);
+        append_new_id(sql, row, CONTEST_ID, contests_, kind);
+        constexpr std::array copied_columns = {
+            TYPE,
+            LANGUAGE,
+            FINAL_CANDIDATE,
+            PROBLEM_FINAL,
+            CONTEST_FINAL,
+            CONTEST_INITIAL_FINAL,
+            INITIAL_STATUS,
+            FULL_STATUS,
+            CREATED_AT,
+            SCORE,
+            LAST_JUDGMENT,
+        };
+        for (auto col : copied_columns) {
+            append_value(sql, row, col);
         }
-
-        conn.update("ALTER TABLE ", sql_table_name(), " AUTO_INCREMENT=", last_new_id_ + 1);
-        transaction.commit();
+        append_bytes(sql, row, INITIAL_REPORT);
+        append_bytes(sql, row, FINAL_REPORT);
     }
 
+public:
     SubmissionsMerger(
         const PrimaryKeysFromMainAndOtherJobs& ids_from_both_jobs,
         const InternalFilesMerger& internal_files,
@@ -148,18 +87,15 @@ public:
         const ContestRoundsMerger& contest_rounds,
         const ContestsMerger& contests
     )
-    : Merger(
-          "submissions", ids_from_both_jobs.main.submissions, ids_from_both_jobs.other.submissions
+    : StreamingMerger(
+          "submissions", &ids_from_both_jobs.main.submissions, &ids_from_both_jobs.other.submissions
       )
     , internal_files_(internal_files)
     , users_(users)
     , problems_(problems)
     , contest_problems_(contest_problems)
     , contest_rounds_(contest_rounds)
-    , contests_(contests) {
-        STACK_UNWINDING_MARK;
-        initialize();
-    }
+    , contests_(contests) {}
 };
 
 } // namespace sim_merger
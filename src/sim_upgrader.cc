@@ -4,10 +4,13 @@
 #include <climits>
 #include <cstdint>
 #include <cstdio>
+#include <dirent.h>
 #include <exception>
 #include <fcntl.h>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <optional>
 #include <regex>
 #include <set>
 #include <sim/contest_entry_tokens/contest_entry_token.hh>
@@ -16,6 +19,7 @@
 #include <sim/contest_users/contest_user.hh>
 #include <sim/db/schema.hh>
 #include <sim/inf_datetime.hh>
+#include <sim/internal_files/internal_file.hh>
 #include <sim/mysql/mysql.hh>
 #include <sim/problem_tags/problem_tag.hh>
 #include <sim/users/user.hh>
@@ -43,6 +47,7 @@
 #include <simlib/temporary_file.hh>
 #include <simlib/throw_assert.hh>
 #include <simlib/time.hh>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <utility>
 
@@ -62,7 +67,7 @@ constexpr StringView NORMALIZED_SCHEMA_HASH_BEFORE_UPGRADE =
     "ac310f5bda86d4966e5c69137448f53c461d2f1dee040ffedd11f9a410435747";
 
 static void do_perform_upgrade(
-    [[maybe_unused]] const string& sim_dir, [[maybe_unused]] mysql::Connection& mysql
+    [[maybe_unused]] const string& sim_dir, [[maybe_unused]] sim::mysql::Connection& mysql
 ) {
     // Upgrade here
     std::map<uint64_t, std::string, std::greater<>> user_id_to_created_at;
@@ -98,9 +103,9 @@ enum class LockKind {
     READ,
     WRITE,
 };
-static void lock_all_tables(mysql::Connection& mysql, LockKind lock_kind);
+static void lock_all_tables(sim::mysql::Connection& mysql, LockKind lock_kind);
 
-static int perform_upgrade(const string& sim_dir, mysql::Connection& mysql) {
+static int perform_upgrade(const string& sim_dir, sim::mysql::Connection& mysql) {
     STACK_UNWINDING_MARK;
     stdlog("\033[1;34mChecking if upgrade is needed.\033[m");
     lock_all_tables(mysql, LockKind::READ);
@@ -172,7 +177,7 @@ static int perform_upgrade(const string& sim_dir, mysql::Connection& mysql) {
     return 1;
 }
 
-static void lock_all_tables(mysql::Connection& mysql, LockKind lock_kind) {
+static void lock_all_tables(sim::mysql::Connection& mysql, LockKind lock_kind) {
     std::string query = "LOCK TABLES";
     bool first = true;
     for (const auto& table_name : sim::db::get_all_table_names(mysql)) {
@@ -193,6 +198,75 @@ static void lock_all_tables(mysql::Connection& mysql, LockKind lock_kind) {
     }
 }
 
+// Moves the internal files and blobs stored directly in their directories (as
+// before the directories were sharded) to their sharded paths. Does nothing if
+// there are no such files.
+static void migrate_internal_files_to_sharded_layout(const string& sim_dir) {
+    STACK_UNWINDING_MARK;
+
+    auto move_files = [&](StringView dir_path, auto&& sharded_path_of) {
+        std::unique_ptr<DIR, decltype(&closedir)> dir{
+            opendir(dir_path.to_string().c_str()), closedir
+        };
+        if (dir == nullptr) {
+            if (errno == ENOENT) {
+                return uint64_t{0};
+            }
+            THROW("opendir(", dir_path, ')', errmsg());
+        }
+
+        uint64_t moved = 0;
+        while (dirent* entry = readdir(dir.get())) {
+            auto path = concat_tostr(dir_path, entry->d_name);
+            struct stat64 st = {};
+            if (lstat64(path.c_str(), &st)) {
+                THROW("lstat64(", path, ')', errmsg());
+            }
+            if (not S_ISREG(st.st_mode)) {
+                continue; // Shard directories are already in place
+            }
+            auto new_path = sharded_path_of(StringView{entry->d_name});
+            if (not new_path) {
+                continue;
+            }
+            sim::internal_files::create_parent_dirs_of(*new_path);
+            if (rename(path.c_str(), new_path->c_str())) {
+                THROW("rename(", path, ", ", *new_path, ')', errmsg());
+            }
+            ++moved;
+        }
+        return moved;
+    };
+
+    auto moved_files = move_files(
+        concat_tostr(sim_dir, sim::internal_files::dir),
+        [&](StringView name) -> std::optional<string> {
+            auto id = str2num<uint64_t>(name);
+            if (not id) {
+                return std::nullopt;
+            }
+            return concat_tostr(
+                sim_dir, sim::internal_files::dir, sim::internal_files::relative_path_of(*id)
+            );
+        }
+    );
+    auto moved_blobs = move_files(
+        concat_tostr(sim_dir, sim::internal_files::blobs_dir),
+        [&](StringView name) -> std::optional<string> {
+            return concat_tostr(sim_dir, sim::internal_files::blob_path_of_hash(name));
+        }
+    );
+    if (moved_files > 0 or moved_blobs > 0) {
+        stdlog(
+            "Moved ",
+            moved_files,
+            " internal files and ",
+            moved_blobs,
+            " blobs to the sharded directory layout"
+        );
+    }
+}
+
 static void print_help(const char* program_name) {
     if (not program_name) {
         program_name = "sim-upgrader";
@@ -275,7 +349,11 @@ static int true_main(int argc, char** argv) {
         return 1;
     }
 
-    return perform_upgrade(sim_dir, mysql);
+    int rc = perform_upgrade(sim_dir, mysql);
+    if (rc == 0) {
+        migrate_internal_files_to_sharded_layout(sim_dir);
+    }
+    return rc;
 }
 
 int main(int argc, char** argv) {
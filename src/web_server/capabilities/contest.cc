@@ -58,7 +58,7 @@ Contest contest_for(
 
 std::optional<std::pair<Contest, std::optional<decltype(sim::contest_users::ContestUser::mode)>>>
 contest_for(
-    mysql::Connection& mysql,
+    sim::mysql::Connection& mysql,
     const decltype(web_worker::Context::session)& session,
     decltype(sim::contests::Contest::id) contest_id
 ) {
@@ -66,7 +66,7 @@ contest_for(
 
     decltype(sim::contests::Contest::is_public) is_public;
     mysql::Optional<decltype(ContestUser::mode)> contest_user_mode;
-    mysql::Statement stmt;
+    sim::mysql::Statement stmt;
     if (session) {
         stmt = mysql.prepare("SELECT c.is_public, cu.mode FROM contests c "
                              "LEFT JOIN contest_users cu ON cu.contest_id=c.id AND cu.user_id=? "
@@ -0,0 +1,12 @@
+#include "metrics.hh"
+#include "utils.hh"
+
+namespace web_server::capabilities {
+
+Metrics metrics_for(const decltype(web_worker::Context::session)& session) noexcept {
+    return Metrics{
+        .view = is_admin(session),
+    };
+}
+
+} // namespace web_server::capabilities
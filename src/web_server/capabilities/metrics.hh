@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../web_worker/context.hh"
+
+namespace web_server::capabilities {
+
+struct Metrics {
+    bool view : 1;
+};
+
+Metrics metrics_for(const decltype(web_worker::Context::session)& session) noexcept;
+
+} // namespace web_server::capabilities
@@ -11,10 +11,10 @@
 #include <sim/contest_entry_tokens/contest_entry_token.hh>
 #include <sim/contest_users/contest_user.hh>
 #include <sim/contests/contest.hh>
+#include <sim/mysql/mysql.hh>
 #include <sim/random.hh>
 #include <simlib/concat_tostr.hh>
 #include <simlib/json_str/json_str.hh>
-#include <simlib/mysql/mysql.hh>
 #include <simlib/string_transform.hh>
 #include <simlib/string_view.hh>
 #include <simlib/time.hh>
@@ -247,7 +247,8 @@ Response delete_(Context& ctx, decltype(Contest::id) contest_id) {
     });
 }
 
-static void set_or_regen_short_token(mysql::Connection& mysql, decltype(Contest::id) contest_id) {
+static void
+set_or_regen_short_token(sim::mysql::Connection& mysql, decltype(Contest::id) contest_id) {
     auto stmt = mysql.prepare("UPDATE IGNORE contest_entry_tokens SET short_token=?, "
                               "short_token_expiration=? WHERE "
                               "contest_id=? AND (short_token IS NULL or short_token!=?)");
@@ -9,7 +9,17 @@ namespace web_server::http {
 
 class Response {
 public:
-    enum ContentType : uint8_t { TEXT, FILE, FILE_TO_REMOVE } content_type;
+    enum ContentType : uint8_t {
+        TEXT,
+        FILE,
+        FILE_TO_REMOVE,
+        // The status, headers and a part of the body were already sent using
+        // the chunked transfer encoding, content is the rest of the body
+        STREAM_END,
+        // Like STREAM_END, but generating the body failed, so the body is left
+        // unterminated for the client to notice that it is incomplete
+        STREAM_ABORT,
+    } content_type;
 
     InplaceBuff<100> status_code;
     Headers headers{};
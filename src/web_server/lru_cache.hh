@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace web_server {
+
+/**
+ * @brief Cache of values with a bounded total size, evicting the least recently
+ *   used values first
+ * @details Values are shared, so an evicted value stays valid for as long as
+ *   it is used. All methods are thread-safe.
+ */
+template <class Key, class Value>
+class LruCache {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        size_t entries;
+        size_t total_size;
+    };
+
+private:
+    struct Entry {
+        Key key;
+        std::shared_ptr<const Value> value;
+        size_t size;
+    };
+
+    mutable std::mutex mtx_;
+    size_t max_total_size_;
+    size_t total_size_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    std::list<Entry> entries_; // the most recently used first
+    std::map<Key, typename std::list<Entry>::iterator> entry_of_key_;
+
+    void evict_until_fits(size_t size) {
+        while (not entries_.empty() and total_size_ + size > max_total_size_) {
+            total_size_ -= entries_.back().size;
+            entry_of_key_.erase(entries_.back().key);
+            entries_.pop_back();
+        }
+    }
+
+public:
+    explicit LruCache(size_t max_total_size) : max_total_size_(max_total_size) {}
+
+    // Returns nullptr if @p key is not in the cache
+    std::shared_ptr<const Value> get(const Key& key) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entry_of_key_.find(key);
+        if (it == entry_of_key_.end()) {
+            ++misses_;
+            return nullptr;
+        }
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->value;
+    }
+
+    // Values larger than the whole cache are not cached
+    void put(const Key& key, std::shared_ptr<const Value> value, size_t size) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (auto it = entry_of_key_.find(key); it != entry_of_key_.end()) {
+            total_size_ -= it->second->size;
+            entries_.erase(it->second);
+            entry_of_key_.erase(it);
+        }
+        if (size > max_total_size_) {
+            return;
+        }
+        evict_until_fits(size);
+        entries_.push_front(Entry{key, std::move(value), size});
+        entry_of_key_.emplace(key, entries_.begin());
+        total_size_ += size;
+    }
+
+    void erase(const Key& key) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entry_of_key_.find(key);
+        if (it != entry_of_key_.end()) {
+            total_size_ -= it->second->size;
+            entries_.erase(it->second);
+            entry_of_key_.erase(it);
+        }
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return {hits_, misses_, entries_.size(), total_size_};
+    }
+};
+
+} // namespace web_server
@@ -0,0 +1,20 @@
+#include "../capabilities/metrics.hh"
+#include "../http/response.hh"
+#include "../web_worker/context.hh"
+#include "api.hh"
+#include "metrics.hh"
+
+using web_server::http::Response;
+using web_server::web_worker::Context;
+
+namespace web_server::metrics::api {
+
+Response view_metrics(Context& ctx) {
+    auto caps = capabilities::metrics_for(ctx.session);
+    if (not caps.view) {
+        return ctx.response_403();
+    }
+    return ctx.response_ok(to_prometheus_text(), "text/plain; version=0.0.4; charset=utf-8");
+}
+
+} // namespace web_server::metrics::api
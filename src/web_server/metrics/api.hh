@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../http/response.hh"
+#include "../web_worker/context.hh"
+
+namespace web_server::metrics::api {
+
+// Metrics in the Prometheus text exposition format
+http::Response view_metrics(web_worker::Context& ctx);
+
+} // namespace web_server::metrics::api
@@ -0,0 +1,301 @@
+#include "metrics.hh"
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <simlib/concat_tostr.hh>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+namespace {
+
+struct Bucket {
+    uint64_t upper_bound;
+    const char* le; // upper_bound as the value of the "le" label
+};
+
+constexpr std::array<Bucket, 13> latency_bounds_us = {{
+    {1'000, "0.001"},
+    {2'500, "0.0025"},
+    {5'000, "0.005"},
+    {10'000, "0.01"},
+    {25'000, "0.025"},
+    {50'000, "0.05"},
+    {100'000, "0.1"},
+    {250'000, "0.25"},
+    {500'000, "0.5"},
+    {1'000'000, "1"},
+    {2'500'000, "2.5"},
+    {5'000'000, "5"},
+    {10'000'000, "10"},
+}};
+
+constexpr std::array<Bucket, 8> size_bounds = {{
+    {1 << 10, "1024"},
+    {4 << 10, "4096"},
+    {16 << 10, "16384"},
+    {64 << 10, "65536"},
+    {256 << 10, "262144"},
+    {1 << 20, "1048576"},
+    {4 << 20, "4194304"},
+    {16 << 20, "16777216"},
+}};
+
+// 1xx, 2xx, 3xx, 4xx, 5xx and invalid
+constexpr std::array<const char*, 6> status_classes = {"1xx", "2xx", "3xx", "4xx", "5xx", "other"};
+
+template <size_t N>
+size_t bucket_idx(const std::array<Bucket, N>& buckets, uint64_t value) noexcept {
+    size_t i = 0;
+    while (i < N and value > buckets[i].upper_bound) {
+        ++i;
+    }
+    return i; // N means +Inf
+}
+
+// Counters of a thread are modified only by the thread, but they are read by
+// the exporting thread, hence atomic
+using Counter = std::atomic<uint64_t>;
+
+void add(Counter& counter, uint64_t x) noexcept {
+    // There is a single writer, so read-modify-write instructions are not needed
+    counter.store(counter.load(std::memory_order_relaxed) + x, std::memory_order_relaxed);
+}
+
+template <class CounterT>
+struct RouteCountersImpl {
+    std::array<CounterT, status_classes.size()> requests_by_status_class{};
+    std::array<CounterT, latency_bounds_us.size() + 1> latency_buckets{}; // not cumulative
+    CounterT latency_sum_ns{};
+    std::array<CounterT, size_bounds.size() + 1> size_buckets{}; // not cumulative
+    CounterT size_sum{};
+};
+
+using RouteCounters = RouteCountersImpl<Counter>;
+using RouteTotals = RouteCountersImpl<uint64_t>;
+
+struct ThreadCounters {
+    std::array<RouteCounters, web_server::metrics::MAX_ROUTES> routes{};
+};
+
+struct Registry {
+    std::mutex mtx;
+    std::vector<string> route_names{"other"};
+    std::map<string, size_t, std::less<>> route_ids{{"other", 0}};
+    std::vector<std::unique_ptr<ThreadCounters>> thread_counters;
+};
+
+Registry& registry() {
+    // Never destroyed, because the threads may record requests until exit()
+    static auto& reg = *new Registry; // NOLINT(cppcoreguidelines-owning-memory)
+    return reg;
+}
+
+struct ThisThread {
+    ThreadCounters* counters = nullptr;
+    size_t current_route = web_server::metrics::OTHER_ROUTE_ID;
+    std::map<string, size_t, std::less<>> route_ids; // cache of the registry
+};
+
+thread_local ThisThread this_thread;
+
+void append_escaped_label_value(string& str, StringView value) {
+    for (char c : value) {
+        switch (c) {
+        case '\\': str += "\\\\"; break;
+        case '"': str += "\\\""; break;
+        case '\n': str += "\\n"; break;
+        default: str += c;
+        }
+    }
+}
+
+void append_seconds(string& str, uint64_t ns) {
+    char buff[32];
+    int len = snprintf(
+        buff, sizeof(buff), "%" PRIu64 ".%09" PRIu64, ns / 1'000'000'000, ns % 1'000'000'000
+    );
+    str.append(buff, len);
+}
+
+} // namespace
+
+namespace web_server::metrics {
+
+size_t route_id(StringView name) {
+    auto& reg = registry();
+    std::lock_guard lock{reg.mtx};
+    if (auto it = reg.route_ids.find(name); it != reg.route_ids.end()) {
+        return it->second;
+    }
+    if (reg.route_names.size() == MAX_ROUTES) {
+        return OTHER_ROUTE_ID;
+    }
+
+    auto id = reg.route_names.size();
+    reg.route_names.emplace_back(name.to_string());
+    reg.route_ids.emplace(name.to_string(), id);
+    return id;
+}
+
+void set_current_route(size_t route_id) noexcept {
+    this_thread.current_route = (route_id < MAX_ROUTES ? route_id : OTHER_ROUTE_ID);
+}
+
+void set_current_route(StringView name) noexcept {
+    try {
+        auto& cache = this_thread.route_ids;
+        auto it = cache.find(name);
+        if (it == cache.end()) {
+            it = cache.emplace(name.to_string(), route_id(name)).first;
+        }
+        set_current_route(it->second);
+    } catch (...) {
+        set_current_route(OTHER_ROUTE_ID);
+    }
+}
+
+void record_request(
+    StringView status_code, uint64_t response_size, std::chrono::nanoseconds latency
+) noexcept {
+    auto route = std::exchange(this_thread.current_route, OTHER_ROUTE_ID);
+    if (this_thread.counters == nullptr) {
+        try {
+            auto& reg = registry();
+            std::lock_guard lock{reg.mtx};
+            this_thread.counters =
+                reg.thread_counters.emplace_back(std::make_unique<ThreadCounters>()).get();
+        } catch (...) {
+            return; // Metrics are not worth failing the request
+        }
+    }
+    auto& counters = this_thread.counters->routes[route];
+
+    size_t status_class = status_classes.size() - 1;
+    if (status_code.size() >= 3 and status_code[0] >= '1' and status_code[0] <= '5') {
+        status_class = status_code[0] - '1';
+    }
+    add(counters.requests_by_status_class[status_class], 1);
+
+    auto latency_ns = (latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0);
+    add(counters.latency_buckets[bucket_idx(latency_bounds_us, latency_ns / 1000)], 1);
+    add(counters.latency_sum_ns, latency_ns);
+    add(counters.size_buckets[bucket_idx(size_bounds, response_size)], 1);
+    add(counters.size_sum, response_size);
+}
+
+string to_prometheus_text() {
+    std::vector<string> route_names;
+    std::vector<RouteTotals> totals;
+    {
+        auto& reg = registry();
+        std::lock_guard lock{reg.mtx};
+        route_names = reg.route_names;
+        totals.resize(route_names.size());
+        for (auto& thread_counters : reg.thread_counters) {
+            for (size_t route = 0; route < totals.size(); ++route) {
+                auto& src = thread_counters->routes[route];
+                auto& dest = totals[route];
+                auto sum_up = [](auto& dest_arr, auto& src_arr) {
+                    for (size_t i = 0; i < dest_arr.size(); ++i) {
+                        dest_arr[i] += src_arr[i].load(std::memory_order_relaxed);
+                    }
+                };
+                sum_up(dest.requests_by_status_class, src.requests_by_status_class);
+                sum_up(dest.latency_buckets, src.latency_buckets);
+                dest.latency_sum_ns += src.latency_sum_ns.load(std::memory_order_relaxed);
+                sum_up(dest.size_buckets, src.size_buckets);
+                dest.size_sum += src.size_sum.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    auto count_of = [](const RouteTotals& t) {
+        uint64_t res = 0;
+        for (auto x : t.requests_by_status_class) {
+            res += x;
+        }
+        return res;
+    };
+
+    string res;
+    auto append_route_label = [&](size_t route) {
+        res += "route=\"";
+        append_escaped_label_value(res, route_names[route]);
+        res += '"';
+    };
+
+    res += "# HELP sim_http_requests_total Number of handled requests by the status code class\n"
+           "# TYPE sim_http_requests_total counter\n";
+    for (size_t route = 0; route < totals.size(); ++route) {
+        for (size_t i = 0; i < status_classes.size(); ++i) {
+            if (totals[route].requests_by_status_class[i] == 0) {
+                continue;
+            }
+            res += "sim_http_requests_total{";
+            append_route_label(route);
+            back_insert(
+                res,
+                ",code=\"",
+                status_classes[i],
+                "\"} ",
+                totals[route].requests_by_status_class[i],
+                '\n'
+            );
+        }
+    }
+
+    auto append_histogram = [&](StringView name,
+                                StringView help,
+                                const auto& bounds,
+                                auto buckets_of,
+                                auto append_sum) {
+        back_insert(res, "# HELP ", name, ' ', help, "\n# TYPE ", name, " histogram\n");
+        for (size_t route = 0; route < totals.size(); ++route) {
+            auto count = count_of(totals[route]);
+            if (count == 0) {
+                continue;
+            }
+            const auto& route_buckets = buckets_of(totals[route]);
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i <= bounds.size(); ++i) {
+                cumulative += route_buckets[i];
+                back_insert(res, name, "_bucket{");
+                append_route_label(route);
+                StringView le = (i < bounds.size() ? bounds[i].le : "+Inf");
+                back_insert(res, ",le=\"", le, "\"} ", cumulative, '\n');
+            }
+            back_insert(res, name, "_sum{");
+            append_route_label(route);
+            res += "} ";
+            append_sum(totals[route]);
+            back_insert(res, '\n', name, "_count{");
+            append_route_label(route);
+            back_insert(res, "} ", count, '\n');
+        }
+    };
+
+    append_histogram(
+        "sim_http_request_duration_seconds",
+        "Time from receiving the request to sending the whole response",
+        latency_bounds_us,
+        [](const RouteTotals& t) -> auto& { return t.latency_buckets; },
+        [&](const RouteTotals& t) { append_seconds(res, t.latency_sum_ns); }
+    );
+    append_histogram(
+        "sim_http_response_size_bytes",
+        "Size of the sent response including the headers",
+        size_bounds,
+        [](const RouteTotals& t) -> auto& { return t.size_buckets; },
+        [&](const RouteTotals& t) { back_insert(res, t.size_sum); }
+    );
+    return res;
+}
+
+} // namespace web_server::metrics
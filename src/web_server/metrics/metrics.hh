@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <simlib/string_view.hh>
+#include <string>
+
+/**
+ * Per-route metrics of the handled requests: counts by the status code class,
+ * latency and response size histograms.
+ *
+ * Every thread records into its own counters, so recording takes no locks.
+ * The counters of all the threads are summed up only when they are exported.
+ */
+namespace web_server::metrics {
+
+constexpr size_t MAX_ROUTES = 256;
+
+// Route of the requests that were not dispatched to any route
+constexpr size_t OTHER_ROUTE_ID = 0;
+
+// Returns the id of the route named @p name, registering the route if
+// necessary. If there are already MAX_ROUTES routes, OTHER_ROUTE_ID is
+// returned. Names have to come from a bounded set, e.g. the URL patterns.
+size_t route_id(StringView name);
+
+// Sets the route of the request being handled by the calling thread
+void set_current_route(size_t route_id) noexcept;
+
+// Like set_current_route(route_id(@p name)) but without locking if the calling
+// thread has already used this route
+void set_current_route(StringView name) noexcept;
+
+// Records the request handled by the calling thread and resets its route to
+// OTHER_ROUTE_ID. @p status_code is the status line code, e.g. "200 OK".
+void record_request(
+    StringView status_code, uint64_t response_size, std::chrono::nanoseconds latency
+) noexcept;
+
+// Returns the metrics in the Prometheus text exposition format
+std::string to_prometheus_text();
+
+} // namespace web_server::metrics
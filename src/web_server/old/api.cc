@@ -1,5 +1,6 @@
 #include "../../job_server/logs.hh"
 #include "../../web_server/logs.hh"
+#include "../../web_server/metrics/metrics.hh"
 #include "../../web_server/old/sim.hh"
 
 #include <simlib/file_contents.hh>
@@ -54,42 +55,59 @@ void Sim::api_handle() {
     }
 
     if (next_arg == "contest") {
+        metrics::set_current_route("old /api/contest");
         return api_contest();
     }
     if (next_arg == "contest_file") {
+        metrics::set_current_route("old /api/contest_file");
         return api_contest_file();
     }
     if (next_arg == "contest_files") {
+        metrics::set_current_route("old /api/contest_files");
         return api_contest_files();
     }
     if (next_arg == "contest_user") {
+        metrics::set_current_route("old /api/contest_user");
         return api_contest_user();
     }
     if (next_arg == "contest_users") {
+        metrics::set_current_route("old /api/contest_users");
         return api_contest_users();
     }
     if (next_arg == "contests") {
+        metrics::set_current_route("old /api/contests");
         return api_contests();
     }
     if (next_arg == "job") {
+        metrics::set_current_route("old /api/job");
         return api_job();
     }
+    if (next_arg == "job_server_metrics") {
+        metrics::set_current_route("old /api/job_server_metrics");
+        return api_job_server_metrics();
+    }
     if (next_arg == "jobs") {
+        metrics::set_current_route("old /api/jobs");
         return api_jobs();
     }
     if (next_arg == "logs") {
+        metrics::set_current_route("old /api/logs");
         return api_logs();
     }
     if (next_arg == "problem") {
+        metrics::set_current_route("old /api/problem");
         return api_problem();
     }
     if (next_arg == "problems") {
+        metrics::set_current_route("old /api/problems");
         return api_problems();
     }
     if (next_arg == "submission") {
+        metrics::set_current_route("old /api/submission");
         return api_submission();
     }
     if (next_arg == "submissions") {
+        metrics::set_current_route("old /api/submissions");
         return api_submissions();
     }
     return api_error404();
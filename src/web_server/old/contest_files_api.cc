@@ -365,7 +365,7 @@ void Sim::api_contest_file_add() {
     } while (stmt.affected_rows() == 0);
 
     // Move file
-    if (move(file_tmp_path, sim::internal_files::path_of(internal_file_id))) {
+    if (move(file_tmp_path, sim::internal_files::path_of_new_file(internal_file_id))) {
         THROW("move()", errmsg());
     }
 
@@ -444,7 +444,7 @@ void Sim::api_contest_file_edit(StringView contest_file_id, sim::contest_files::
         internal_file_id = mysql.insert_id();
 
         // Move file
-        if (move(file_tmp_path, sim::internal_files::path_of(internal_file_id))) {
+        if (move(file_tmp_path, sim::internal_files::path_of_new_file(internal_file_id))) {
             THROW("move()", errmsg());
         }
 
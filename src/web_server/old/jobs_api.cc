@@ -1,5 +1,10 @@
 #include "sim.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <sim/jobs/job_server_metrics.hh>
+#include <sim/jobs/judge_estimates.hh>
 #include <sim/jobs/utils.hh>
 #include <simlib/path.hh>
 #include <simlib/time.hh>
@@ -95,7 +100,7 @@ void Sim::api_jobs() {
     };
 
     auto set_empty_response = [&] {
-        resp.content.clear();
+        clear_response_content();
         append_column_names();
         append("\n]");
     };
@@ -222,6 +227,35 @@ void Sim::api_jobs() {
     qfields.append(qwhere, " ORDER BY j.id DESC LIMIT ", rows_limit);
     auto res = mysql.query(qfields);
 
+    // Estimates published by the job server are shown only to the admins
+    std::optional<sim::jobs::JudgeEstimates> judge_estimates;
+    if (uint(jobs_perms & PERM::VIEW_ALL)) {
+        judge_estimates = sim::jobs::JudgeEstimates::load(sim::jobs::judge_estimates_file);
+    }
+    auto append_judge_estimates = [&](StringView job_id_str,
+                                      StringView problem_id_str,
+                                      bool queued) {
+        using std::chrono::duration_cast;
+        using std::chrono::milliseconds;
+        using std::chrono::system_clock;
+        auto ms_to_str = [](int64_t ms) { return concat('~', (ms + 999) / 1000, " s"); };
+
+        auto problem_id = str2num<uint64_t>(problem_id_str);
+        auto pit = judge_estimates->problem_judge_time_ms.find(problem_id.value_or(0));
+        if (pit != judge_estimates->problem_judge_time_ms.end()) {
+            append(R"(,"estimated judging time":")", ms_to_str(pit->second), '"');
+        }
+
+        auto job_id = str2num<uint64_t>(job_id_str);
+        auto jit = judge_estimates->job_eta_ms.find(job_id.value_or(0));
+        if (queued and jit != judge_estimates->job_eta_ms.end()) {
+            auto elapsed_ms =
+                duration_cast<milliseconds>(system_clock::now() - judge_estimates->saved_at)
+                    .count();
+            append(R"(,"ETA":")", ms_to_str(std::max<int64_t>(0, jit->second - elapsed_ms)), '"');
+        }
+    };
+
     append_column_names();
 
     while (res.next()) {
@@ -269,8 +303,21 @@ void Sim::api_jobs() {
         switch (job_type) {
         case Job::Type::JUDGE_SUBMISSION:
         case Job::Type::REJUDGE_SUBMISSION: {
-            append("\"problem\":", sim::jobs::extract_dumped_string(res[JINFO]));
+            auto problem_id_str = sim::jobs::extract_dumped_string(res[JINFO]);
+            append("\"problem\":", problem_id_str);
             append(",\"submission\":", res[AUX_ID]);
+            if (judge_estimates and
+                is_one_of(
+                    job_status,
+                    Job::Status::PENDING,
+                    Job::Status::NOTICED_PENDING,
+                    Job::Status::IN_PROGRESS
+                ))
+            {
+                append_judge_estimates(
+                    res[JID], problem_id_str, job_status != Job::Status::IN_PROGRESS
+                );
+            }
             break;
         }
 
@@ -434,6 +481,7 @@ void Sim::api_jobs() {
         }
 
         append(']');
+        stream_large_response_content();
     }
 
     append("\n]");
@@ -602,4 +650,52 @@ void Sim::api_job_download_uploaded_statement(
     resp.content = sim::internal_files::path_of(file_id.value());
 }
 
+void Sim::api_job_server_metrics() {
+    STACK_UNWINDING_MARK;
+
+    if (not session.has_value() or session->user_type != User::Type::ADMIN) {
+        return api_error403();
+    }
+
+    auto m = sim::jobs::JobServerMetrics::load(sim::jobs::job_server_metrics_file);
+    resp.headers["Content-type"] = "application/json; charset=utf-8";
+
+    // Metrics file does not exist if the job server has not published them yet
+    if (m.saved_at == decltype(m.saved_at){}) {
+        append("{\"age_s\":null");
+    } else {
+        using std::chrono::duration_cast;
+        using std::chrono::seconds;
+        using std::chrono::system_clock;
+        append(
+            "{\"age_s\":",
+            std::max<int64_t>(0, duration_cast<seconds>(system_clock::now() - m.saved_at).count())
+        );
+    }
+
+    append(",\n\"queues\":[");
+    bool first = true;
+    for (auto const& [name, queue] : m.queues) {
+        append(first ? "\n" : ",\n", "{\"name\":", json_stringify(name));
+        append(",\"jobs\":", queue.jobs, ",\"locked_problems\":", queue.locked_problems, '}');
+        first = false;
+    }
+    append("\n]");
+
+    auto append_durations = [&](StringView field, const auto& durations_by_name) {
+        append(",\n\"", field, "\":[");
+        bool first_elem = true;
+        for (auto const& [name, d] : durations_by_name) {
+            append(first_elem ? "\n" : ",\n", "{\"name\":", json_stringify(name));
+            append(",\"count\":", d.count, ",\"p50\":", d.p50, ",\"p90\":", d.p90);
+            append(",\"p99\":", d.p99, ",\"max\":", d.max, '}');
+            first_elem = false;
+        }
+        append("\n]");
+    };
+    append_durations("queue_wait_ms", m.queue_wait_ms);
+    append_durations("judge_stage_ms", m.judge_stage_ms);
+    append("\n}");
+}
+
 } // namespace web_server::old
@@ -1,3 +1,4 @@
+#include "../lru_cache.hh"
 #include "sim.hh"
 
 #include <cstdint>
@@ -6,8 +7,10 @@
 #include <sim/problem_tags/problem_tag.hh>
 #include <sim/problems/permissions.hh>
 #include <sim/problems/problem.hh>
+#include <sim/problems/statement_cache.hh>
 #include <simlib/config_file.hh>
 #include <simlib/enum_val.hh>
+#include <simlib/file_contents.hh>
 #include <simlib/file_info.hh>
 #include <simlib/file_manip.hh>
 #include <simlib/from_unsafe.hh>
@@ -23,6 +26,15 @@ using sim::problems::Problem;
 using sim::submissions::Submission;
 using sim::users::User;
 
+namespace {
+
+// Statements of the hot problems, by the problem file id. Bigger statements are
+// served from the extracted statement files.
+constexpr size_t MAX_IN_MEMORY_STATEMENT_SIZE = 256 << 10;
+web_server::LruCache<uint64_t, std::string> statements_cache(64 << 20);
+
+} // namespace
+
 namespace web_server::old {
 
 static constexpr const char* proiblem_type_str(Problem::Type type) noexcept {
@@ -366,6 +378,7 @@ void Sim::api_problems() {
         }
 
         append(']');
+        stream_large_response_content();
     }
 
     append("\n]");
@@ -529,7 +542,7 @@ void Sim::api_problem_add_or_reupload_impl(bool reuploading) {
     FileRemover job_file_remover(sim::internal_files::path_of(job_file_id));
 
     // Make the uploaded package file the job's file
-    if (move(package_file, sim::internal_files::path_of(job_file_id))) {
+    if (move(package_file, sim::internal_files::path_of_new_file(job_file_id))) {
         THROW("move()", errmsg());
     }
 
@@ -591,10 +604,33 @@ void Sim::api_statement_impl(
     resp.headers["Content-Disposition"] =
         concat_tostr("inline; filename=", ::http::quote(from_unsafe{concat(problem_label, ext)}));
 
-    // TODO: maybe add some cache system for the statements?
-    ZipFile zip(sim::internal_files::path_of(problem_file_id), ZIP_RDONLY);
-    resp.content =
-        zip.extract_to_str(zip.get_index(concat(sim::zip_package_main_dir(zip), statement)));
+    // Packages are never modified, so the statement does not change as long as
+    // the problem file id is the same
+    auto etag = concat_tostr('"', problem_file_id, '"');
+    resp.set_cache(false, 0, true);
+    auto if_none_match = request.headers.get("if-none-match");
+    resp.headers["etag"] = etag;
+    if (if_none_match and *if_none_match == etag) {
+        resp.status_code = "304 Not Modified";
+        return;
+    }
+
+    if (auto cached = statements_cache.get(problem_file_id)) {
+        resp.content = *cached;
+        return;
+    }
+
+    auto path = sim::problems::extract_statement(problem_file_id, statement);
+    auto size = get_file_size(path);
+    if (size > MAX_IN_MEMORY_STATEMENT_SIZE) {
+        resp.content_type = http::Response::FILE;
+        resp.content = path;
+        return;
+    }
+
+    auto contents = std::make_shared<const std::string>(get_file_contents(path));
+    statements_cache.put(problem_file_id, contents, contents->size());
+    resp.content = *contents;
 }
 
 void Sim::api_problem_statement(
@@ -931,7 +967,7 @@ void Sim::api_problem_change_statement(sim::problems::Permissions perms) {
     FileRemover job_file_remover(sim::internal_files::path_of(job_file_id));
 
     // Make uploaded statement file the job's file
-    if (move(statement_file, sim::internal_files::path_of(job_file_id))) {
+    if (move(statement_file, sim::internal_files::path_of_new_file(job_file_id))) {
         THROW("move()", errmsg());
     }
 
@@ -1,5 +1,7 @@
 #include "../http/request.hh"
 #include "../http/response.hh"
+#include "../metrics/metrics.hh"
+#include "../server/connection.hh"
 #include "sim.hh"
 
 #include <memory>
@@ -17,14 +19,18 @@ namespace web_server::old {
 
 Sim::Sim() { web_worker = std::make_unique<web_worker::WebWorker>(mysql); }
 
-http::Response Sim::handle(http::Request req) {
+http::Response Sim::handle(http::Request req, server::Connection* conn) {
     request = std::move(req);
     resp = http::Response(http::Response::TEXT);
-
-    stdlog(request.target);
+    connection = conn;
+    response_streaming_began = false;
 
     // TODO: this is pretty bad-looking
     auto hard_error500 = [&] {
+        if (response_streaming_began) {
+            resp.content_type = http::Response::STREAM_ABORT;
+            return;
+        }
         resp.status_code = "500 Internal Server Error";
         resp.headers["Content-Type"] = "text/html; charset=utf-8";
         resp.content = "<!DOCTYPE html>"
@@ -75,6 +81,7 @@ http::Response Sim::handle(http::Request req) {
 
             if (next_arg == "kit") {
                 // Subsystems that do not need the session to be opened
+                metrics::set_current_route("old /kit");
                 static_file();
 
             } else {
@@ -83,33 +90,43 @@ http::Response Sim::handle(http::Request req) {
                 session_open();
 
                 if (next_arg == "c") {
+                    metrics::set_current_route("old /c");
                     contests_handle();
 
                 } else if (next_arg == "s") {
+                    metrics::set_current_route("old /s");
                     submissions_handle();
 
                 } else if (next_arg == "u") {
+                    metrics::set_current_route("old /u");
                     users_handle();
 
                 } else if (next_arg == "") {
+                    metrics::set_current_route("old /");
                     main_page();
 
                 } else if (next_arg == "api") {
+                    metrics::set_current_route("old /api");
                     api_handle();
 
                 } else if (next_arg == "p") {
+                    metrics::set_current_route("old /p");
                     problems_handle();
 
                 } else if (next_arg == "contest_file") {
+                    metrics::set_current_route("old /contest_file");
                     contest_file_handle();
 
                 } else if (next_arg == "jobs") {
+                    metrics::set_current_route("old /jobs");
                     jobs_handle();
 
                 } else if (next_arg == "file") {
+                    metrics::set_current_route("old /file");
                     file_handle();
 
                 } else if (next_arg == "logs") {
+                    metrics::set_current_route("old /logs");
                     view_logs();
 
                 } else {
@@ -131,12 +148,20 @@ http::Response Sim::handle(http::Request req) {
 
         } catch (const std::exception& e) {
             ERRLOG_CATCH(e);
-            error500();
+            if (response_streaming_began) {
+                resp.content_type = http::Response::STREAM_ABORT;
+            } else {
+                error500();
+            }
             session_close(); // Prevent session from being left open
 
         } catch (...) {
             ERRLOG_CATCH();
-            error500();
+            if (response_streaming_began) {
+                resp.content_type = http::Response::STREAM_ABORT;
+            } else {
+                error500();
+            }
             session_close(); // Prevent session from being left open
         }
 
@@ -153,9 +178,36 @@ http::Response Sim::handle(http::Request req) {
         session = std::nullopt; // Prevent session from being left open
     }
 
+    if (response_streaming_began and resp.content_type != http::Response::STREAM_ABORT) {
+        resp.content_type = http::Response::STREAM_END;
+    }
+    connection = nullptr;
     return std::move(resp);
 }
 
+void Sim::stream_large_response_content() {
+    STACK_UNWINDING_MARK;
+
+    // Chunked transfer encoding is available since HTTP/1.1
+    if (resp.content.size < STREAMED_RESPONSE_CHUNK_SIZE or connection == nullptr or
+        request.http_version != "HTTP/1.1" or resp.content_type != http::Response::TEXT)
+    {
+        return;
+    }
+
+    if (response_streaming_began) {
+        connection->send_chunk(resp.content);
+    } else {
+        connection->begin_chunked_response(resp);
+        response_streaming_began = true;
+    }
+    resp.content.clear();
+
+    if (connection->state() == server::Connection::CLOSED) {
+        THROW("Connection closed while streaming the response");
+    }
+}
+
 void Sim::main_page() {
     STACK_UNWINDING_MARK;
 
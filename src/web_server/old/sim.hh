@@ -21,6 +21,10 @@
 #include <simlib/request_uri_parser.hh>
 #include <utime.h>
 
+namespace web_server::server {
+class Connection;
+} // namespace web_server::server
+
 namespace web_server::old {
 
 // Every object is independent, objects can be used in multi-thread program
@@ -28,7 +32,7 @@ namespace web_server::old {
 class Sim final {
     /* ============================== General ============================== */
 
-    mysql::Connection mysql = sim::mysql::make_conn_with_credential_file(".db.config");
+    sim::mysql::Connection mysql = sim::mysql::make_conn_with_credential_file(".db.config");
     http::Request request;
     http::Response resp;
     RequestUriParser url_args{""};
@@ -55,6 +59,9 @@ class Sim final {
     void set_response(StringView status_code, StringView response_body = {}) {
         STACK_UNWINDING_MARK;
 
+        if (response_streaming_began) {
+            THROW("Cannot replace the response that is being streamed");
+        }
         resp.status_code = status_code;
         resp.content = response_body;
 
@@ -67,6 +74,33 @@ class Sim final {
 #endif
     }
 
+    /* ========================= Streamed responses ========================= */
+
+    // Connection through which the response body may be streamed while it is
+    // generated, so that large responses are not kept whole in memory. Set
+    // only during handle().
+    server::Connection* connection = nullptr;
+    bool response_streaming_began = false;
+
+    static constexpr size_t STREAMED_RESPONSE_CHUNK_SIZE = 64 << 10;
+
+    /**
+     * @brief Sends resp.content as the next part of the response body if it is
+     *   at least STREAMED_RESPONSE_CHUNK_SIZE long and clears it
+     * @details The first sending sends also the status and the headers, so they
+     *   cannot be changed afterwards and the response cannot be replaced e.g.
+     *   with an error - set_response() and clear_response_content() throw then.
+     *   Does nothing if the response cannot be streamed.
+     */
+    void stream_large_response_content();
+
+    void clear_response_content() {
+        if (response_streaming_began) {
+            THROW("Cannot clear the response that is being streamed");
+        }
+        resp.content.clear();
+    }
+
     /* ================================ API ================================ */
 
     void api_error400(StringView response_body = {}) {
@@ -108,6 +142,8 @@ class Sim final {
         std::optional<uint64_t> file_id, sim::jobs::Job::Type job_type, StringView info
     );
 
+    void api_job_server_metrics();
+
     // problems_api.cc
     void api_problems();
 
@@ -166,6 +202,9 @@ class Sim final {
 
     void api_submission_download();
 
+    // Judge reports in JSON
+    void api_submission_report();
+
     // contests_api.cc
     void api_contests();
 
@@ -673,10 +712,13 @@ public:
      *   This function is not thread-safe
      *
      * @param req request
+     * @param conn connection to stream the response through, if not null the
+     *   returned response may be of type STREAM_END or STREAM_ABORT
      *
      * @return response
      */
-    http::Response handle(http::Request req); // TODO: close session
+    // TODO: close session
+    http::Response handle(http::Request req, server::Connection* conn = nullptr);
 };
 
 } // namespace web_server::old
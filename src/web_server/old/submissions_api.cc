@@ -1,12 +1,19 @@
+#include "../lru_cache.hh"
+#include "../server/async_logger.hh"
 #include "sim.hh"
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <sim/contest_problems/contest_problem.hh>
 #include <sim/contests/contest.hh>
+#include <sim/cpp_syntax_highlighter.hh>
 #include <sim/inf_datetime.hh>
 #include <sim/is_username.hh>
 #include <sim/jobs/utils.hh>
+#include <sim/submissions/list_query.hh>
+#include <sim/submissions/report.hh>
 #include <sim/submissions/submission.hh>
 #include <sim/submissions/update_final.hh>
 #include <simlib/call_in_destructor.hh>
@@ -17,6 +24,7 @@
 #include <simlib/humanize.hh>
 #include <simlib/process.hh>
 #include <simlib/string_view.hh>
+#include <utility>
 
 using sim::InfDatetime;
 using sim::contest_problems::ContestProblem;
@@ -28,6 +36,31 @@ using sim::users::User;
 using std::optional;
 using std::string;
 
+namespace {
+
+// (submission file id, highlighter version)
+using HighlightedSourceKey = std::pair<uint64_t, uint32_t>;
+web_server::LruCache<HighlightedSourceKey, std::string> highlighted_sources_cache(64 << 20);
+
+void log_highlighted_sources_cache_stats() {
+    static std::atomic<uint64_t> lookups{0};
+    if (++lookups % 1024 == 0) {
+        auto stats = highlighted_sources_cache.stats();
+        web_server::server::async_stdlog()(
+            "Highlighted sources cache: ",
+            stats.hits,
+            " hits, ",
+            stats.misses,
+            " misses, ",
+            stats.entries,
+            " entries, ",
+            humanize_file_size(stats.total_size)
+        );
+    }
+}
+
+} // namespace
+
 namespace web_server::old {
 
 void Sim::append_submission_status(
@@ -82,18 +115,9 @@ void Sim::api_submissions() {
                    " s.contest_id, c.name, s.created_at, s.problem_final,"
                    " s.contest_final, s.contest_initial_final,"
                    " s.initial_status, s.full_status, s.score");
-    qwhere.append(
-        " FROM submissions s "
-        "LEFT JOIN users u ON u.id=s.owner "
-        "STRAIGHT_JOIN problems p ON p.id=s.problem_id "
-        "LEFT JOIN contest_problems cp ON cp.id=s.contest_problem_id "
-        "LEFT JOIN contest_rounds r ON r.id=s.contest_round_id "
-        "LEFT JOIN contests c ON c.id=s.contest_id "
-        "LEFT JOIN contest_users cu ON cu.contest_id=s.contest_id"
-        " AND cu.user_id=",
-        session->user_id,
-        " WHERE TRUE"
-    ); // Needed to easily append constraints
+    qwhere.append(" WHERE TRUE"); // Needed to easily append constraints
+    // Constraints on the submissions table used to choose the index
+    sim::submissions::ListFilter list_filter;
 
     enum ColumnIdx {
         SID,
@@ -136,7 +160,8 @@ void Sim::api_submissions() {
     bool selecting_finals = false;
     bool may_see_problem_final = (session->user_type == User::Type::ADMIN);
 
-    auto append_column_names = [&] {
+    // @p next_cursor is set if there may be more rows after the listed ones
+    auto append_column_names = [&](const optional<string>& next_cursor = std::nullopt) {
         // clang-format off
         append("[\n{\"columns\":["
                    "\"id\","
@@ -166,11 +191,15 @@ void Sim::api_submissions() {
                    "\"full_results\"");
         }
 
-        append("]}");
+        append(']');
+        if (next_cursor) {
+            append(",\"next_cursor\":", json_stringify(*next_cursor));
+        }
+        append('}');
     };
 
     auto set_empty_response = [&] {
-        resp.content.clear();
+        clear_response_content();
         append_column_names();
         append("\n]");
     };
@@ -187,6 +216,7 @@ void Sim::api_submissions() {
         bool type_condition_occurred = false;
         bool round_or_problem_condition_occurred = false;
         bool user_condition_occurred = false;
+        std::optional<std::string> cursor;
 
         for (StringView next_arg = url_args.extract_next_arg(); not next_arg.empty();
              next_arg = url_args.extract_next_arg())
@@ -194,6 +224,7 @@ void Sim::api_submissions() {
             auto arg = decode_uri(next_arg);
             char cond_c = arg[0];
             StringView arg_id = StringView(arg).substr(1);
+            auto arg_id_num = str2num<uint64_t>(arg_id);
 
             // Submission type
             if (cond_c == 't') {
@@ -204,6 +235,7 @@ void Sim::api_submissions() {
                 type_condition_occurred = true;
 
                 if (arg_id == "N") {
+                    list_filter.type = Submission::Type::NORMAL;
                     qwhere.append(" AND s.type=", EnumVal(Submission::Type::NORMAL).to_int());
                 } else if (arg_id == "F") {
                     selecting_finals = true;
@@ -222,23 +254,30 @@ void Sim::api_submissions() {
                             allow_access = false;
                         }
 
+                        using Finals = sim::submissions::ListFilter::Finals;
                         if (not round_or_problem_condition_occurred) {
                             if (may_see_problem_final) {
+                                list_filter.finals = Finals::PROBLEM_OR_CONTEST;
                                 qwhere.append(" AND (s.problem_final=1 OR "
                                               "s.contest_final=1)");
                             } else {
+                                list_filter.finals = Finals::CONTEST;
                                 qwhere.append(" AND s.contest_final=1");
                             }
                         } else if (selecting_problem_submissions) {
+                            list_filter.finals = Finals::PROBLEM;
                             qwhere.append(" AND s.problem_final=1");
                         } else if (selecting_contest_submissions) {
                             // TODO: double check that it works
+                            list_filter.finals = Finals::CONTEST;
                             qwhere.append(" AND s.contest_final=1");
                         }
                     });
                 } else if (arg_id == "I") {
+                    list_filter.type = Submission::Type::IGNORED;
                     qwhere.append(" AND s.type=", EnumVal(Submission::Type::IGNORED).to_int());
                 } else if (arg_id == "S") {
+                    list_filter.type = Submission::Type::PROBLEM_SOLUTION;
                     qwhere.append(
                         " AND s.type=", EnumVal(Submission::Type::PROBLEM_SOLUTION).to_int()
                     );
@@ -246,9 +285,18 @@ void Sim::api_submissions() {
                     return api_error400(from_unsafe{concat("Invalid submission type: ", arg_id)});
                 }
 
+            } else if (cond_c == 'c') { // Cursor of the next page
+                if (id_condition_occurred) {
+                    return api_error400("Submission ID condition specified more than once");
+                }
+
+                rows_limit = API_OTHER_QUERY_ROWS_LIMIT;
+                id_condition_occurred = true;
+                cursor = arg_id.to_string(); // Decoded once the filter is known
+
                 // NOLINTNEXTLINE(bugprone-branch-clone)
-            } else if (not is_digit(arg_id)) { // Next conditions require arg_id
-                                               // to be a valid ID
+            } else if (not is_digit(arg_id) or not arg_id_num) {
+                // Next conditions require arg_id to be a valid ID
                 return api_error400();
 
             } else if (is_one_of(cond_c, '<', '>')) {
@@ -280,6 +328,8 @@ void Sim::api_submissions() {
 
                 selecting_problem_submissions = true;
                 round_or_problem_condition_occurred = true;
+                list_filter.scope = sim::submissions::ListFilter::Scope::PROBLEM;
+                list_filter.scope_id = *arg_id_num;
                 qwhere.append(" AND s.problem_id=", arg_id);
 
                 problem_perms = sim::problems::get_permissions(
@@ -317,13 +367,18 @@ void Sim::api_submissions() {
                 selecting_contest_submissions = true;
                 round_or_problem_condition_occurred = true;
 
+                using Scope = sim::submissions::ListFilter::Scope;
                 if (cond_c == 'C') {
+                    list_filter.scope = Scope::CONTEST;
                     qwhere.append(" AND s.contest_id=", arg_id);
                 } else if (cond_c == 'R') {
+                    list_filter.scope = Scope::CONTEST_ROUND;
                     qwhere.append(" AND s.contest_round_id=", arg_id);
                 } else if (cond_c == 'P') {
+                    list_filter.scope = Scope::CONTEST_PROBLEM;
                     qwhere.append(" AND s.contest_problem_id=", arg_id);
                 }
+                list_filter.scope_id = *arg_id_num;
 
                 if (not allow_access) {
                     StringView query;
@@ -387,6 +442,7 @@ void Sim::api_submissions() {
                 }
 
                 user_condition_occurred = true;
+                list_filter.owner = arg_id_num;
                 qwhere.append(" AND s.owner=", arg_id);
 
                 // Owner (almost) always has access to theirs submissions
@@ -416,16 +472,72 @@ void Sim::api_submissions() {
         for (auto& check : after_checks) {
             check();
         }
+
+        if (cursor) {
+            auto last_id = sim::submissions::decode_list_cursor(list_filter, *cursor);
+            if (not last_id) {
+                return api_error400("Invalid cursor");
+            }
+            qwhere.append(" AND s.id<", *last_id);
+        }
     }
 
     if (not allow_access) {
         return set_empty_response();
     }
 
-    // Execute query
-    auto res = mysql.query(qfields, qwhere, " ORDER BY s.id DESC LIMIT ", rows_limit);
+    // Select ids of the page first and only then join them with the other
+    // tables, because with the joins MySQL often picks a bad index
+    InplaceBuff<4096> ids;
+    size_t ids_no = 0;
+    std::optional<uint64_t> last_id;
+    {
+        InplaceBuff<64> index_hint;
+        if (auto index = sim::submissions::list_index(list_filter)) {
+            index_hint.append(" FORCE INDEX(`", *index, "`)");
+        }
+        auto res = mysql.query(
+            "SELECT s.id FROM submissions s",
+            index_hint,
+            qwhere,
+            " ORDER BY s.id DESC LIMIT ",
+            rows_limit
+        );
+        while (res.next()) {
+            if (last_id) {
+                ids.append(',');
+            }
+            ids.append(res[0]);
+            ++ids_no;
+            last_id = WONT_THROW(str2num<uint64_t>(res[0]).value());
+        }
+    }
+    if (not last_id) {
+        return set_empty_response();
+    }
+
+    auto res = mysql.query(
+        qfields,
+        " FROM submissions s "
+        "LEFT JOIN users u ON u.id=s.owner "
+        "STRAIGHT_JOIN problems p ON p.id=s.problem_id "
+        "LEFT JOIN contest_problems cp ON cp.id=s.contest_problem_id "
+        "LEFT JOIN contest_rounds r ON r.id=s.contest_round_id "
+        "LEFT JOIN contests c ON c.id=s.contest_id "
+        "LEFT JOIN contest_users cu ON cu.contest_id=s.contest_id"
+        " AND cu.user_id=",
+        session->user_id,
+        " WHERE s.id IN (",
+        ids,
+        ") ORDER BY s.id DESC"
+    );
 
-    append_column_names();
+    // A page shorter than the limit is the last one
+    optional<string> next_cursor;
+    if (not select_one and ids_no == rows_limit) {
+        next_cursor = sim::submissions::encode_list_cursor(list_filter, *last_id);
+    }
+    append_column_names(next_cursor);
 
     auto curr_date = mysql_date();
     while (res.next()) {
@@ -703,15 +815,16 @@ void Sim::api_submissions() {
         // Append
         if (select_one) {
             // Reports (and round full results time if full report isn't shown)
-            append(',', json_stringify(res[INIT_REPORT]));
+            append(',', json_stringify(sim::submissions::report_to_html(res[INIT_REPORT])));
             if (show_full_results) {
-                append(',', json_stringify(res[FINAL_REPORT]));
+                append(',', json_stringify(sim::submissions::report_to_html(res[FINAL_REPORT])));
             } else {
                 append(",null,\"", full_results.to_api_str(), '"');
             }
         }
 
         append(']');
+        stream_large_response_content();
     }
 
     append("\n]");
@@ -763,6 +876,9 @@ void Sim::api_submission() {
     if (next_arg == "download") {
         return api_submission_download();
     }
+    if (next_arg == "report") {
+        return api_submission_report();
+    }
 
     if (request.method != http::Request::POST) {
         return api_error400();
@@ -934,10 +1050,11 @@ void Sim::api_submission_add() {
 
     // Save source file
     if (not code.empty()) {
-        put_file_contents(sim::internal_files::path_of(file_id), code);
-    } else if (move(*solution_tmp_path_opt, sim::internal_files::path_of(file_id))) {
+        put_file_contents(sim::internal_files::path_of_new_file(file_id), code);
+    } else if (move(*solution_tmp_path_opt, sim::internal_files::path_of_new_file(file_id))) {
         THROW("move()", errmsg());
     }
+    sim::internal_files::deduplicate(file_id);
 
     // Insert submission
     auto stmt = mysql.prepare("INSERT submissions (file_id, owner, problem_id,"
@@ -992,8 +1109,52 @@ void Sim::api_submission_source() {
         return api_error403();
     }
 
-    append(cpp_syntax_highlighter(from_unsafe{
-        get_file_contents(sim::internal_files::path_of(submissions_file_id))}));
+    // Submission files are never modified
+    HighlightedSourceKey key{submissions_file_id, sim::CppSyntaxHighlighter::VERSION};
+    auto highlighted = highlighted_sources_cache.get(key);
+    if (not highlighted) {
+        highlighted = std::make_shared<const std::string>(cpp_syntax_highlighter(from_unsafe{
+            get_file_contents(sim::internal_files::path_of(submissions_file_id))}));
+        highlighted_sources_cache.put(key, highlighted, highlighted->size());
+    }
+    log_highlighted_sources_cache_stats();
+
+    append(*highlighted);
+}
+
+void Sim::api_submission_report() {
+    STACK_UNWINDING_MARK;
+    using PERM = SubmissionPermissions;
+
+    if (uint(~submissions_perms & PERM::VIEW)) {
+        return api_error403();
+    }
+
+    auto res = mysql.query(concat(
+        "SELECT s.initial_report, s.final_report, s.contest_id, r.full_results "
+        "FROM submissions s "
+        "LEFT JOIN contest_rounds r ON r.id=s.contest_round_id "
+        "WHERE s.id=",
+        submissions_sid
+    ));
+    if (not res.next()) {
+        return api_error404();
+    }
+
+    InfDatetime full_results;
+    if (res.is_null(2)) { // Not a contest submission
+        full_results.set_neg_inf();
+    } else {
+        full_results.from_str(res[3]);
+    }
+
+    append("{\"initial_report\":", sim::submissions::report_to_json(res[0]));
+    if (uint(submissions_perms & PERM::VIEW_FINAL_REPORT) or full_results <= mysql_date()) {
+        append(",\"final_report\":", sim::submissions::report_to_json(res[1]));
+    } else {
+        append(",\"final_report\":null,\"full_results\":\"", full_results.to_api_str(), '"');
+    }
+    append('}');
 }
 
 void Sim::api_submission_download() {
@@ -0,0 +1,194 @@
+#include "async_logger.hh"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <simlib/debug.hh>
+#include <simlib/errmsg.hh>
+#include <unistd.h>
+
+using std::string;
+
+namespace {
+
+// Stream in memory used to format lines with simlib's Logger, so that they look
+// exactly like the ones of stdlog
+struct Memstream {
+    char* buff = nullptr;
+    size_t size = 0;
+    FILE* stream;
+    Logger logger;
+
+    Memstream() : stream{open_memstream(&buff, &size)}, logger{stream} {
+        if (stream == nullptr) {
+            THROW("open_memstream()", errmsg());
+        }
+    }
+
+    Memstream(const Memstream&) = delete;
+    Memstream(Memstream&&) = delete;
+    Memstream& operator=(const Memstream&) = delete;
+    Memstream& operator=(Memstream&&) = delete;
+
+    ~Memstream() {
+        (void)fclose(stream);
+        free(buff); // NOLINT(cppcoreguidelines-no-malloc)
+    }
+};
+
+Memstream& memstream_of_this_thread() {
+    static thread_local Memstream ms;
+    return ms;
+}
+
+} // namespace
+
+namespace web_server::server {
+
+// Single producer (the owning thread), single consumer (the writer) buffer of
+// whole lines
+class AsyncLogger::RingBuffer {
+    static_assert((RING_BUFFER_SIZE & (RING_BUFFER_SIZE - 1)) == 0, "has to be a power of 2");
+
+    alignas(64) std::atomic<uint64_t> head_{0}; // Advanced by the consumer
+    alignas(64) std::atomic<uint64_t> tail_{0}; // Advanced by the producer
+    std::unique_ptr<char[]> data_{new char[RING_BUFFER_SIZE]};
+
+public:
+    // Returns false if there is not enough space for @p line
+    bool push(StringView line) noexcept {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto head = head_.load(std::memory_order_acquire);
+        if (RING_BUFFER_SIZE - (tail - head) < line.size()) {
+            return false;
+        }
+
+        auto pos = tail & (RING_BUFFER_SIZE - 1);
+        auto first_part = std::min<size_t>(line.size(), RING_BUFFER_SIZE - pos);
+        std::memcpy(data_.get() + pos, line.data(), first_part);
+        std::memcpy(data_.get(), line.data() + first_part, line.size() - first_part);
+        tail_.store(tail + line.size(), std::memory_order_release);
+        return true;
+    }
+
+    // Moves all the lines to the end of @p dest
+    void pop_all(string& dest) {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto tail = tail_.load(std::memory_order_acquire);
+        auto len = tail - head;
+        if (len == 0) {
+            return;
+        }
+
+        auto pos = head & (RING_BUFFER_SIZE - 1);
+        auto first_part = std::min<size_t>(len, RING_BUFFER_SIZE - pos);
+        dest.append(data_.get() + pos, first_part);
+        dest.append(data_.get(), len - first_part);
+        head_.store(tail, std::memory_order_release);
+    }
+};
+
+AsyncLogger::AsyncLogger(int fd, bool label)
+: id_{[] {
+    static std::atomic<uint64_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}()}
+, fd_{fd}
+, label_{label}
+, writer_{[this] {
+    while (not stop_.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+        write_pending();
+    }
+}} {}
+
+AsyncLogger::~AsyncLogger() {
+    stop_.store(true, std::memory_order_release);
+    writer_.join();
+    write_pending();
+}
+
+void AsyncLogger::flush() noexcept { write_pending(); }
+
+Logger& AsyncLogger::formatting_logger(bool label) {
+    auto& ms = memstream_of_this_thread();
+    ms.logger.label(label);
+    return ms.logger;
+}
+
+StringView AsyncLogger::take_formatted() noexcept {
+    auto& ms = memstream_of_this_thread();
+    // buff and size are updated on fflush()
+    (void)fflush(ms.stream);
+    StringView res{ms.buff, ms.size};
+    // Rewinding does not clear the buffer, so res stays valid until the next
+    // line is formatted
+    rewind(ms.stream);
+    return res;
+}
+
+AsyncLogger::RingBuffer& AsyncLogger::ring_of_this_thread() {
+    static thread_local std::vector<std::pair<uint64_t, RingBuffer*>> rings;
+    for (auto& [logger_id, ring] : rings) {
+        if (logger_id == id_) {
+            return *ring;
+        }
+    }
+
+    // Rings live as long as the logger, as threads in the web server live as
+    // long as the process
+    std::lock_guard lock{rings_mtx_};
+    auto* ring = rings_.emplace_back(std::make_unique<RingBuffer>()).get();
+    rings.emplace_back(id_, ring);
+    return *ring;
+}
+
+void AsyncLogger::push(StringView line) noexcept {
+    try {
+        if (ring_of_this_thread().push(line)) {
+            return;
+        }
+    } catch (...) {
+    }
+    dropped_lines_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogger::write_pending() noexcept {
+    std::lock_guard write_lock{write_mtx_};
+    try {
+        batch_.clear();
+        {
+            std::lock_guard rings_lock{rings_mtx_};
+            for (auto& ring : rings_) {
+                ring->pop_all(batch_);
+            }
+        }
+        auto dropped = dropped_lines();
+        if (dropped != reported_dropped_lines_) {
+            formatting_logger(label_)(
+                "Async logger: dropped ",
+                dropped - reported_dropped_lines_,
+                " lines, so the log misses some requests"
+            );
+            reported_dropped_lines_ = dropped;
+            auto line = take_formatted();
+            batch_.append(line.data(), line.size());
+        }
+    } catch (...) {
+        // Write what was gathered
+    }
+
+    for (size_t pos = 0; pos < batch_.size();) {
+        auto rc = write(fd_, batch_.data() + pos, batch_.size() - pos);
+        if (rc < 0 and errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            break; // There is no place to report the error
+        }
+        pos += static_cast<size_t>(rc);
+    }
+}
+
+} // namespace web_server::server
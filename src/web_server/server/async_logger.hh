@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <simlib/logger.hh>
+#include <simlib/string_view.hh>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace web_server::server {
+
+/**
+ * Logger for the hot path of the web server. The calling thread only formats
+ * the line (exactly like stdlog does) and puts it into its own ring buffer; a
+ * background thread writes the lines of all the threads to the file in batches.
+ *
+ * If a ring buffer is full (the writer does not keep up), the line is dropped
+ * and the number of the dropped lines is logged once there is space again.
+ * The dropped lines are lost for good: the server log then misses some of the
+ * requests, so it must not be relied on as a complete record of them (e.g. for
+ * auditing). Only the count of the dropped lines is kept.
+ */
+class AsyncLogger {
+public:
+    static constexpr size_t RING_BUFFER_SIZE = 256 << 10; // per thread
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{5};
+
+private:
+    class RingBuffer;
+
+    const uint64_t id_; // Distinguishes loggers in the per-thread cache of ring buffers
+    const int fd_;
+    const bool label_;
+
+    std::mutex rings_mtx_;
+    std::vector<std::unique_ptr<RingBuffer>> rings_;
+    std::atomic<uint64_t> dropped_lines_{0};
+
+    std::mutex write_mtx_;
+    std::string batch_; // guarded by write_mtx_
+    uint64_t reported_dropped_lines_ = 0; // guarded by write_mtx_
+
+    std::atomic<bool> stop_{false};
+    std::thread writer_;
+
+public:
+    // Lines are appended to @p fd; if @p label is true, they are labeled like
+    // the lines of stdlog
+    explicit AsyncLogger(int fd, bool label = true);
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger(AsyncLogger&&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(AsyncLogger&&) = delete;
+
+    // Writes the remaining lines
+    ~AsyncLogger();
+
+    template <class... Args>
+    void operator()(Args&&... args) noexcept {
+        try {
+            formatting_logger(label_)(std::forward<Args>(args)...);
+            push(take_formatted());
+        } catch (...) {
+            (void)take_formatted(); // Discard what was formatted
+            dropped_lines_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Writes all the lines logged so far
+    void flush() noexcept;
+
+    // Returns the number of lines dropped so far
+    [[nodiscard]] uint64_t dropped_lines() const noexcept {
+        return dropped_lines_.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Returns a logger of the calling thread that formats lines into memory
+    static Logger& formatting_logger(bool label);
+
+    // Returns the lines formatted by formatting_logger() and not taken yet
+    static StringView take_formatted() noexcept;
+
+    RingBuffer& ring_of_this_thread();
+
+    void push(StringView line) noexcept;
+
+    void write_pending() noexcept;
+};
+
+// Returns the logger of the web server's log, created in main(). All the lines
+// logged by the workers have to go through it, not stdlog, as the lines written
+// directly would overtake the ones still waiting in the ring buffers.
+AsyncLogger& async_stdlog() noexcept;
+
+} // namespace web_server::server
@@ -1,11 +1,15 @@
 #include "connection.hh"
 
+#include <cerrno>
+#include <cstdio>
 #include <iostream>
 #include <poll.h>
 #include <simlib/file_descriptor.hh>
 #include <simlib/file_manip.hh>
 #include <simlib/logger.hh>
 #include <simlib/macros/debug.hh>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 using std::pair;
@@ -689,17 +693,70 @@ void Connection::send(const char* str, size_t len) {
         }
 
         pos += written;
+        sent_bytes_ += written;
     }
 }
 
-void Connection::send_response(const http::Response& res) {
+void Connection::send(iovec* iov, int iovcnt) {
+    while (iovcnt > 0 and state_ == OK) {
+        ssize_t written = writev(sock_fd_, iov, iovcnt);
+        D(stdlog("written: ", written);)
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            state_ = CLOSED;
+            break;
+        }
+        sent_bytes_ += written;
+
+        // Skip what was written
+        while (iovcnt > 0 and static_cast<size_t>(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+void Connection::send_chunk(StringView data) {
+    if (data.empty()) {
+        return; // Empty chunk would end the body
+    }
+
+    char size_line[24];
+    int size_line_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", data.size());
+    char crlf[] = "\r\n";
+    iovec iov[] = {
+        {size_line, static_cast<size_t>(size_line_len)},
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        {const_cast<char*>(data.data()), data.size()},
+        {crlf, 2},
+    };
+    send(iov, 3);
+}
+
+void Connection::begin_chunked_response(const http::Response& res) {
+    string head = response_head(res);
+    head += "Transfer-Encoding: chunked\r\n\r\n";
+    send(head);
+    send_chunk(res.content);
+}
+
+string Connection::response_head(const http::Response& res) {
     string str = "HTTP/1.1 ";
-    str.reserve(res.content.size + 500);
+    str.reserve(500);
     str.append(res.status_code.data(), res.status_code.size).append("\r\n");
     str += "Connection: close\r\n";
 
     for (auto&& [name, val] : res.headers) {
-        if (name == "server" || name == "connection" || name == "content-length") {
+        if (name == "server" || name == "connection" || name == "content-length" ||
+            name == "transfer-encoding")
+        {
             continue;
         }
 
@@ -734,17 +791,36 @@ void Connection::send_response(const http::Response& res) {
         }
     })
 
+    return str;
+}
+
+void Connection::send_response(const http::Response& res) {
     switch (res.content_type) {
-    case http::Response::TEXT:
+    case http::Response::STREAM_END:
+        send_chunk(res.content);
+        send("0\r\n\r\n", 5);
+        break;
+
+    case http::Response::STREAM_ABORT: break;
+
+    case http::Response::TEXT: {
+        string str = response_head(res);
         str += "Content-Length: ";
         str += to_string(res.content.size);
         str += "\r\n\r\n";
-        str += res.content;
-        send(str);
+        // The content is not copied after the headers as it may be large
+        iovec iov[] = {
+            {str.data(), str.size()},
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+            {const_cast<char*>(res.content.data()), res.content.size},
+        };
+        send(iov, 2);
         break;
+    }
 
     case http::Response::FILE:
-    case http::Response::FILE_TO_REMOVE:
+    case http::Response::FILE_TO_REMOVE: {
+        string str = response_head(res);
         InplaceBuff<PATH_MAX> filename_s;
         filename_s.append(res.content, '\0');
         CStringView filename(filename_s.data(), filename_s.size - 1);
@@ -777,21 +853,38 @@ void Connection::send_response(const http::Response& res) {
         str += to_string(fsize);
         str += "\r\n\r\n";
 
-        constexpr size_t buff_length = 1 << 20;
-        char buff[buff_length];
-
         send(str);
         if (state_ == CLOSED) {
             return;
         }
 
-        // Read from file and write to socket
+        // Send the file without copying it to the user space
         off64_t pos = 0;
+        while (pos < fsize and state_ == OK) {
+            ssize_t sent = sendfile64(sock_fd_, fd, &pos, fsize - pos);
+            if (sent > 0) {
+                sent_bytes_ += sent;
+                continue;
+            }
+            if (sent == -1 and errno == EINTR) {
+                continue;
+            }
+            if (sent == -1 and (errno == EINVAL or errno == ENOSYS) and pos == 0) {
+                break; // sendfile() is not supported for this file
+            }
+            state_ = CLOSED;
+            return;
+        }
+
+        // Fallback: read from file and write to socket
+        constexpr size_t buff_length = 1 << 20;
+        char buff[buff_length];
         ssize_t read_len = 0;
-        while (pos < fsize && state_ == OK && (read_len = read(fd, buff, buff_length)) != -1) {
+        while (pos < fsize && state_ == OK && (read_len = read(fd, buff, buff_length)) > 0) {
             send(buff, read_len);
             pos += read_len;
         }
+    } break;
     }
 
     state_ = CLOSED;
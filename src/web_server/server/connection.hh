@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <simlib/macros/likely.hh>
+#include <sys/uio.h>
 
 namespace web_server::server {
 
@@ -21,6 +22,7 @@ public:
 private:
     State state_;
     int sock_fd_, buff_size_, pos_;
+    uint64_t sent_bytes_ = 0;
     uint8_t buffer_[BUFFER_SIZE]{};
 
     int peek();
@@ -54,6 +56,10 @@ private:
     std::pair<std::string, std::string> parse_header_line(const std::string& header);
     void read_post(http::Request& req);
 
+    // Returns the status line and the headers of @p res (without the
+    // terminating empty line)
+    std::string response_head(const http::Response& res);
+
 public:
     explicit Connection(int client_socket_fd)
     : state_(OK)
@@ -69,10 +75,14 @@ public:
 
     [[nodiscard]] State state() const { return state_; }
 
+    // Number of bytes sent since the last clear()
+    [[nodiscard]] uint64_t sent_bytes() const noexcept { return sent_bytes_; }
+
     void clear() {
         state_ = OK;
         buff_size_ = 0;
         pos_ = 0;
+        sent_bytes_ = 0;
     }
 
     void assign(int new_sock_fd) {
@@ -97,7 +107,20 @@ public:
 
     void send(const std::string& str) { send(str.c_str(), str.size()); }
 
+    // Sends all the buffers at once, @p iov is modified in the process
+    void send(iovec* iov, int iovcnt);
+
     void send_response(const http::Response& res);
+
+    /* Streaming the response body (chunked transfer encoding) */
+
+    // Sends the status, the headers and res.content as the first chunk of the
+    // body. Then the next parts of the body can be sent with send_chunk() and
+    // the response has to be finished with send_response() of a response with
+    // content type STREAM_END or STREAM_ABORT.
+    void begin_chunked_response(const http::Response& res);
+
+    void send_chunk(StringView data);
 };
 
 } // namespace web_server::server
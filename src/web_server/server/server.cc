@@ -1,13 +1,17 @@
 #include "../logs.hh"
+#include "../metrics/metrics.hh"
 #include "../old/sim.hh"
+#include "async_logger.hh"
 #include "connection.hh"
 
 #include <arpa/inet.h>
 #include <chrono>
 #include <csignal>
 #include <cstdint>
+#include <cstdlib>
 #include <netinet/in.h>
 #include <pthread.h>
+#include <sim/mysql/tracing.hh>
 #include <simlib/config_file.hh>
 #include <simlib/file_descriptor.hh>
 #include <simlib/process.hh>
@@ -20,8 +24,15 @@ using std::string;
 
 namespace web_server::server {
 
+// Created in main() once stdout is redirected to the log file and never
+// destroyed, as the workers run until exit()
+static AsyncLogger* async_stdlog_ptr; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+AsyncLogger& async_stdlog() noexcept { return *async_stdlog_ptr; }
+
 static void* worker(void* ptr) {
     int socket_fd = reinterpret_cast<intptr_t>(ptr);
+    auto& async_log = async_stdlog();
     try {
         sockaddr_in name{};
         socklen_t client_name_len = sizeof(name);
@@ -40,28 +51,47 @@ static void* worker(void* ptr) {
 
             // extract IP
             inet_ntop(AF_INET, &name.sin_addr, ip, INET_ADDRSTRLEN);
-            stdlog("Connection accepted: ", pthread_self(), " form ", ip);
+            async_log("Connection accepted: ", pthread_self(), " form ", ip);
 
             conn.assign(client_socket_fd);
             http::Request req = conn.get_request();
 
             if (conn.state() == Connection::OK) {
+                async_log(req.target);
+
                 using std::chrono::steady_clock;
                 auto beg = steady_clock::now();
+                if (sim::mysql::tracing::is_enabled()) {
+                    sim::mysql::tracing::begin();
+                }
 
-                http::Response resp = sim_worker.handle(std::move(req));
+                http::Response resp = sim_worker.handle(std::move(req), &conn);
 
                 auto microdur = std::chrono::duration_cast<std::chrono::microseconds>(
                     steady_clock::now() - beg
                 );
-                stdlog("Response generated in ", to_string(microdur * 1000), " ms.");
+                if (sim::mysql::tracing::is_enabled()) {
+                    async_log(
+                        "Response generated in ",
+                        to_string(microdur * 1000),
+                        " ms, ",
+                        sim::mysql::tracing::summary()
+                    );
+                } else {
+                    async_log("Response generated in ", to_string(microdur * 1000), " ms.");
+                }
 
                 conn.send_response(resp);
+                metrics::record_request(
+                    StringView{resp.status_code.data(), resp.status_code.size},
+                    conn.sent_bytes(),
+                    steady_clock::now() - beg
+                );
             }
 
-            stdlog("Closing...");
+            async_log("Closing...");
             (void)client_socket_fd.close();
-            stdlog("Closed");
+            async_log("Closed");
         }
 
     } catch (const std::exception& e) {
@@ -105,6 +135,10 @@ int main() {
         return 1;
     }
 
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    web_server::server::async_stdlog_ptr = new web_server::server::AsyncLogger(fileno(stdout));
+    (void)std::atexit([] { web_server::server::async_stdlog().flush(); });
+
     // Signal control
     struct sigaction sa = {};
     memset(&sa, 0, sizeof(sa));
@@ -116,7 +150,7 @@ int main() {
 
     ConfigFile config;
     try {
-        config.add_vars("address", "workers");
+        config.add_vars("address", "workers", "sql_tracing_slow_query_ms");
 
         config.load_config_from_file("sim.conf");
     } catch (const std::exception& e) {
@@ -132,6 +166,15 @@ int main() {
         return 6;
     }
 
+    if (const auto& var = config["sql_tracing_slow_query_ms"]; not var.as_string().empty()) {
+        auto slow_query_ms = var.as<uint64_t>();
+        if (not slow_query_ms) {
+            errlog("sim.conf: sql_tracing_slow_query_ms has to be a non-negative integer");
+            return 9;
+        }
+        sim::mysql::tracing::enable(std::chrono::milliseconds(*slow_query_ms));
+    }
+
     sockaddr_in name{};
     name.sin_family = AF_INET;
     memset(name.sin_zero, 0, sizeof(name.sin_zero));
@@ -2538,7 +2538,11 @@ function parse_api_resp(data) {
 		return to_obj(names.fields, data);
 	}
 
-	return transform(names, data.slice(1));
+	var res = transform(names, data.slice(1));
+	// Cursor of the next page, if there may be more rows
+	if (names.next_cursor !== undefined)
+		res.next_cursor = names.next_cursor;
+	return res;
 }
 
 function old_API_call(ajax_url, success_handler, oldloader_parent) {
@@ -2852,7 +2856,7 @@ function OldLister(elem) {
 				timed_hide_show(oldmodal);
 				centerize_oldmodal(oldmodal, false);
 
-				if ((Array.isArray(data) && data.length === 0) || (Array.isArray(data.rows) && data.rows.length === 0))
+				if ((Array.isArray(data) && data.length === 0) || (Array.isArray(data.rows) && data.rows.length === 0) || this_.all_fetched)
 					return; // No more data to load
 
 				lock = false;
@@ -3906,9 +3910,66 @@ function tab_jobs_lister(parent_elem, query_suffix /*= ''*/) {
 		'All', retab.bind(null, ''),
 		'My', retab.bind(null, '/u' + signed_user_id)
 	];
+	if (query_suffix === '' && signed_user_is_admin())
+		tabs.push('Job server', job_server_metrics.bind(null, parent_elem));
 
 	old_tabmenu(default_tabmenu_attacher.bind(parent_elem), tabs);
 }
+function job_server_metrics(parent_elem) {
+	var elem = $('<div>', {class: 'job-server-metrics'}).appendTo(parent_elem);
+	var durations_table = function(title, durations) {
+		var tbody = $('<tbody>');
+		for (var i = 0; i < durations.length; ++i) {
+			var d = durations[i];
+			tbody.append($('<tr>').append($('<td>', {text: d.name}), $('<td>', {text: d.count}),
+				$('<td>', {text: d.p50}), $('<td>', {text: d.p90}), $('<td>', {text: d.p99}),
+				$('<td>', {text: d.max})));
+		}
+		return $('<h2>', {text: title}).add($('<table>', {
+			class: 'job-server-metrics',
+			html: $('<thead>', {html: '<tr><th>Name</th><th>Count</th><th>p50</th><th>p90</th>' +
+				'<th>p99</th><th>Max</th></tr>'}).add(tbody)
+		}));
+	};
+
+	append_oldloader(elem[0]);
+	$.ajax({
+		url: '/api/job_server_metrics',
+		type: 'POST',
+		processData: false,
+		contentType: false,
+		data: new FormData(add_csrf_token_to($('<form>')).get(0)),
+		dataType: 'json',
+		success: function(data) {
+			remove_oldloader(elem[0]);
+			if (data.age_s === null) {
+				elem.append($('<p>', {text: 'The job server has not published any metrics yet'}));
+				return;
+			}
+			elem.append($('<p>', {text: 'Updated ' + data.age_s + ' s ago'}));
+
+			var tbody = $('<tbody>');
+			for (var i = 0; i < data.queues.length; ++i) {
+				var q = data.queues[i];
+				tbody.append($('<tr>').append($('<td>', {text: q.name}),
+					$('<td>', {text: q.jobs}), $('<td>', {text: q.locked_problems})));
+			}
+			elem.append($('<h2>', {text: 'Queues'}), $('<table>', {
+				class: 'job-server-metrics',
+				html: $('<thead>', {html: '<tr><th>Name</th><th>Jobs</th><th>Locked problems</th></tr>'}
+					).add(tbody)
+			}));
+			elem.append(durations_table('Queue wait times [ms]', data.queue_wait_ms));
+			elem.append(durations_table('Judging stages [ms]', data.judge_stage_ms));
+		},
+		error: function(resp, status) {
+			show_error_via_oldloader(elem, resp, status, function() {
+				elem.remove();
+				job_server_metrics(parent_elem);
+			});
+		}
+	});
+}
 
 /* ============================== Submissions ============================== */
 function add_submission_impl(as_oldmodal, url, api_url, problem_field_elem, maybe_ignored, ignore_by_default, no_oldmodal_elem) {
@@ -4385,6 +4446,11 @@ function SubmissionsLister(elem, query_suffix /*= ''*/, show_submission /*= func
 
 			this_.elem[0].querySelector('tbody').appendChild(row);
 		}
+
+		if (data.next_cursor !== undefined)
+			this_.query_suffix = '/c' + data.next_cursor;
+		else
+			this_.all_fetched = true;
 	};
 
 	this.fetch_more();
@@ -59,9 +59,9 @@ void begin_ui_template(Response& resp, UiTemplateParams params) {
     resp.headers["Content-Security-Policy"] =
         "default-src 'none'; "
         "style-src 'self' 'unsafe-inline'; " // TODO: get rid of unsafe-inline (this
-                                             // requires CppSyntaxHighlighter to be
-                                             // implemented in some different way either in
-                                             // JS or styles in styles.css)
+                                             // requires moving the style attributes used
+                                             // in scripts.js and in the old templates to
+                                             // styles.css)
         "script-src 'self' 'unsafe-inline'; " // TODO: get rid of unsafe-inline (this
                                               // requires no inline js, so url dispatch in
                                               // UI is done from scripts.js and we provide
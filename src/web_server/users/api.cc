@@ -2,6 +2,7 @@
 #include "../capabilities/users.hh"
 #include "../http/form_validation.hh"
 #include "../http/response.hh"
+#include "../server/async_logger.hh"
 #include "../ui_template.hh"
 #include "../web_worker/context.hh"
 #include "api.hh"
@@ -299,7 +300,9 @@ Response sign_up(Context& ctx) {
     }
 
     auto user_id = stmt.insert_id();
-    stdlog("New user: {id: ", user_id, ", username: ", json_stringify(username), '}');
+    web_server::server::async_stdlog()(
+        "New user: {id: ", user_id, ", username: ", json_stringify(username), '}'
+    );
     if (ctx.session) {
         ctx.destroy_session();
     }
@@ -354,7 +357,9 @@ Response add(Context& ctx) {
     }
 
     auto user_id = stmt.insert_id();
-    stdlog("New user: {id: ", user_id, ", username: ", json_stringify(username), '}');
+    web_server::server::async_stdlog()(
+        "New user: {id: ", user_id, ", username: ", json_stringify(username), '}'
+    );
 
     return ctx.response_ok(from_unsafe{to_string(user_id)});
 }
@@ -400,7 +405,9 @@ Response edit(Context& ctx, decltype(User::id) user_id) {
     return ctx.response_ok();
 }
 
-bool password_is_valid(mysql::Connection& mysql, decltype(User::id) user_id, StringView password) {
+bool password_is_valid(
+    sim::mysql::Connection& mysql, decltype(User::id) user_id, StringView password
+) {
     auto stmt = mysql.prepare_bind_and_execute(
         sql::Select("password_salt, password_hash").from("users").where("id=?", user_id)
     );
@@ -3,8 +3,8 @@
 #include "../http/response.hh"
 #include "../web_worker/context.hh"
 
+#include <sim/mysql/mysql.hh>
 #include <sim/users/user.hh>
-#include <simlib/mysql/mysql.hh>
 #include <simlib/string_view.hh>
 
 namespace web_server::users::api {
@@ -36,7 +36,7 @@ http::Response add(web_worker::Context& ctx);
 http::Response edit(web_worker::Context& ctx, decltype(sim::users::User::id) user_id);
 
 bool password_is_valid(
-    mysql::Connection& mysql, decltype(sim::users::User::id) user_id, StringView password
+    sim::mysql::Connection& mysql, decltype(sim::users::User::id) user_id, StringView password
 );
 
 http::Response change_password(web_worker::Context& ctx, decltype(sim::users::User::id) user_id);
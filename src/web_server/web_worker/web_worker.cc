@@ -2,6 +2,8 @@
 #include "../contest_entry_tokens/ui.hh"
 #include "../http/request.hh"
 #include "../http/response.hh"
+#include "../metrics/api.hh"
+#include "../metrics/metrics.hh"
 #include "../problems/api.hh"
 #include "../problems/ui.hh"
 #include "../users/api.hh"
@@ -13,6 +15,7 @@
 #include <sim/jobs/utils.hh>
 #include <sim/problems/problem.hh>
 #include <sim/users/user.hh>
+#include <simlib/concat_tostr.hh>
 #include <simlib/mysql/mysql.hh>
 #include <simlib/string_view.hh>
 #include <type_traits>
@@ -34,11 +37,12 @@ namespace web_server::web_worker {
     (func);        \
     }
 
-WebWorker::WebWorker(mysql::Connection& mysql) : mysql{mysql} {
+WebWorker::WebWorker(sim::mysql::Connection& mysql) : mysql{mysql} {
     // Handlers
     // clang-format off
     GET("/api/contest/{u64}/entry_tokens")(contest_entry_tokens::api::view);
     GET("/api/contest_entry_token/{string}/contest_name")(contest_entry_tokens::api::view_contest_name);
+    GET("/api/metrics")(metrics::api::view_metrics);
     GET("/api/problem/{u64}")(problems::api::view_problem);
     GET("/api/problems")(problems::api::list_all_problems);
     GET("/api/problems/id%3C/{u64}")(problems::api::list_all_problems_below_id);
@@ -136,7 +140,10 @@ Response WebWorker::handler_impl(ResponseMaker&& response_maker) {
 template <const char* url_pattern, auto... CustomParsers, class... Params>
 void WebWorker::do_add_get_handler(strongly_typed_function<Response(Context&, Params...)> handler) {
     get_dispatcher.add_handler<url_pattern, CustomParsers...>(
-        [&, handler = std::move(handler)](Params... args) {
+        [&,
+         handler = std::move(handler),
+         route = metrics::route_id(concat_tostr("GET ", url_pattern))](Params... args) {
+            metrics::set_current_route(route);
             return handler_impl([&](Context& ctx) {
                 return handler(ctx, std::forward<Params>(args)...);
             });
@@ -148,7 +155,10 @@ template <const char* url_pattern, auto... CustomParsers, class... Params>
 void WebWorker::do_add_post_handler(strongly_typed_function<Response(Context&, Params...)> handler
 ) {
     post_dispatcher.add_handler<url_pattern, CustomParsers...>(
-        [&, handler = std::move(handler)](Params... args) {
+        [&,
+         handler = std::move(handler),
+         route = metrics::route_id(concat_tostr("POST ", url_pattern))](Params... args) {
+            metrics::set_current_route(route);
             return handler_impl([&](Context& ctx) {
                 // First check the CSRF token, if no session is open then we use value from
                 // cookie to pass the verification
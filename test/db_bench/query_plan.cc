@@ -0,0 +1,88 @@
+#include "../../src/db_bench/query_plan.hh"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using db_bench::QueryPlan;
+using std::string;
+using std::vector;
+
+namespace {
+
+QueryPlan plan(vector<db_bench::PlanStep> steps) { return QueryPlan{std::move(steps)}; }
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(db_bench_query_plan, dump_and_parse) {
+    auto p = plan({{"s", "ref", "final3", 12}, {"p", "eq_ref", "PRIMARY", 1}, {"u", "ALL", "", 0}}
+    );
+    EXPECT_EQ(p.dump(), "s:ref:final3:12;p:eq_ref:PRIMARY:1;u:ALL::0");
+    auto parsed = QueryPlan::parse(p.dump());
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->dump(), p.dump());
+
+    EXPECT_EQ(QueryPlan::parse("")->steps.size(), 0);
+    EXPECT_FALSE(QueryPlan::parse("s:ref:final3").has_value());
+    EXPECT_FALSE(QueryPlan::parse("s:ref:final3:x").has_value());
+}
+
+// NOLINTNEXTLINE
+TEST(db_bench_query_plan, plan_regressions) {
+    auto baseline = plan({{"s", "ref", "final3", 120}, {"p", "eq_ref", "PRIMARY", 1}});
+    EXPECT_EQ(db_bench::plan_regressions(baseline, baseline), vector<string>{});
+    // Better access type and fewer rows are not regressions
+    EXPECT_EQ(
+        db_bench::plan_regressions(
+            baseline, plan({{"s", "const", "final3", 1}, {"p", "eq_ref", "PRIMARY", 1}})
+        ),
+        vector<string>{}
+    );
+    // Small estimates are imprecise
+    EXPECT_EQ(
+        db_bench::plan_regressions(
+            plan({{"s", "ref", "final3", 2}}), plan({{"s", "ref", "final3", 90}})
+        ),
+        vector<string>{}
+    );
+
+    EXPECT_EQ(
+        db_bench::plan_regressions(
+            baseline, plan({{"p", "ALL", "", 1000}, {"s", "ref", "final3", 120}})
+        ),
+        vector<string>{"join order changed: s,p -> p,s"}
+    );
+    EXPECT_EQ(
+        db_bench::plan_regressions(
+            baseline, plan({{"s", "index", "", 5000}, {"p", "eq_ref", "PRIMARY", 1}})
+        ),
+        (vector<string>{
+            "s: index changed: final3 -> none",
+            "s: access type changed: ref -> index",
+            "s: estimated rows grew: 120 -> 5000",
+        })
+    );
+    EXPECT_EQ(
+        db_bench::plan_regressions(
+            baseline, plan({{"s", "ref", "owner", 120}, {"p", "eq_ref", "PRIMARY", 1}})
+        ),
+        vector<string>{"s: index changed: final3 -> owner"}
+    );
+}
+
+// NOLINTNEXTLINE
+TEST(db_bench_query_plan, dump_and_parse_results) {
+    db_bench::QueryResults results;
+    results["a.b"] = {plan({{"s", "ref", "final3", 12}}), 1500};
+    results["c"] = {plan({}), 7};
+    auto dumped = db_bench::dump_results(results);
+    EXPECT_EQ(dumped, "a.b 1500 s:ref:final3:12\nc 7 \n");
+
+    auto parsed = db_bench::parse_results(dumped + "malformed line\nd x s:ref:k:1\n");
+    ASSERT_EQ(parsed.size(), 2);
+    EXPECT_EQ(parsed["a.b"].median_us, 1500);
+    EXPECT_EQ(parsed["a.b"].plan.dump(), "s:ref:final3:12");
+    EXPECT_EQ(parsed["c"].median_us, 7);
+    EXPECT_EQ(parsed["c"].plan.steps.size(), 0);
+}
@@ -0,0 +1,82 @@
+#include "../../src/job_server/jobs_queue.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using job_server::JobsQueue;
+using Lane = JobsQueue::Lane;
+
+namespace {
+
+int64_t steady_now_ms() noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()
+    )
+        .count();
+}
+
+std::vector<uint64_t> queued_judge_job_ids(const JobsQueue& jq) {
+    std::vector<uint64_t> res;
+    for (auto const& job : jq.queued_judge_jobs()) {
+        res.emplace_back(job.id);
+    }
+    return res;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(jobs_queue, aging_moves_a_job_up_by_one_priority_level) {
+    JobsQueue jq;
+    jq.add_judge_job(1, 1, 1, false, Lane::JUDGE, 1, 1000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    auto job_1_noticed_before_ms = steady_now_ms();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    jq.add_judge_job(2, 2, 2, false, Lane::JUDGE, 2, 1000);
+    ASSERT_EQ(jq.best_judge_job().job.id, 2);
+
+    jq.age_judge_jobs();
+    ASSERT_EQ(jq.best_judge_job().job.id, 2);
+
+    // Only job 1 has waited for AGING_MS
+    jq.age_judge_jobs(job_1_noticed_before_ms + JobsQueue::AGING_MS);
+    // Job 1 competes with job 2 at the same priority level and was queued first
+    ASSERT_EQ(queued_judge_job_ids(jq), (std::vector<uint64_t>{1, 2}));
+
+    // The boost is capped at one priority level
+    jq.add_judge_job(3, 3, 3, false, Lane::JUDGE, 3, 1000);
+    ASSERT_EQ(queued_judge_job_ids(jq), (std::vector<uint64_t>{3, 1, 2}));
+    jq.age_judge_jobs(steady_now_ms() + 10 * JobsQueue::AGING_MS);
+    ASSERT_EQ(queued_judge_job_ids(jq), (std::vector<uint64_t>{3, 2, 1}));
+
+    for (uint64_t jid : {3, 2, 1}) {
+        auto job = jq.best_judge_job();
+        ASSERT_EQ(job.job.id, jid);
+        job.was_passed();
+    }
+    ASSERT_FALSE(jq.best_judge_job().ok());
+}
+
+// NOLINTNEXTLINE
+TEST(jobs_queue, aging_jobs_of_a_locked_problem) {
+    JobsQueue jq;
+    jq.add_judge_job(1, 0, 1, false, Lane::JUDGE, 1, 1000);
+    jq.add_judge_job(2, 0, 2, false, Lane::JUDGE, 2, 1000);
+    jq.lock_problem(1);
+    jq.age_judge_jobs(steady_now_ms() + JobsQueue::AGING_MS);
+    ASSERT_EQ(jq.best_judge_job().job.id, 2);
+    ASSERT_EQ(queued_judge_job_ids(jq), (std::vector<uint64_t>{1, 2}));
+
+    jq.unlock_problem(1);
+    for (uint64_t jid : {1, 2}) {
+        auto job = jq.best_judge_job();
+        ASSERT_EQ(job.job.id, jid);
+        ASSERT_TRUE(job.job.aged);
+        ASSERT_EQ(job.job.queue_priority(), 1);
+        job.was_passed();
+    }
+    ASSERT_FALSE(jq.best_judge_job().ok());
+}
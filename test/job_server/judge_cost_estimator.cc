@@ -0,0 +1,66 @@
+#include "../../src/job_server/judge_cost_estimator.hh"
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+using job_server::JudgeCostEstimator;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+// NOLINTNEXTLINE
+TEST(judge_cost_estimator, unknown_problem) {
+    JudgeCostEstimator jce;
+    ASSERT_FALSE(jce.has_estimate(1));
+    ASSERT_EQ(jce.estimate_ms(1), JudgeCostEstimator::DEFAULT_COST_MS);
+    ASSERT_TRUE(jce.all_estimates_ms().empty());
+}
+
+// NOLINTNEXTLINE
+TEST(judge_cost_estimator, prior_from_time_limits) {
+    ASSERT_EQ(
+        JudgeCostEstimator::prior_from_time_limits(seconds(0)),
+        JudgeCostEstimator::COMPILATION_COST_MS
+    );
+    ASSERT_EQ(
+        JudgeCostEstimator::prior_from_time_limits(seconds(30)),
+        JudgeCostEstimator::COMPILATION_COST_MS + 15'000
+    );
+}
+
+// NOLINTNEXTLINE
+TEST(judge_cost_estimator, prior_is_replaced_by_the_first_observation) {
+    JudgeCostEstimator jce;
+    jce.set_prior(7, 16'000);
+    ASSERT_TRUE(jce.has_estimate(7));
+    ASSERT_EQ(jce.estimate_ms(7), 16'000);
+    jce.set_prior(7, 1'000); // prior does not override an existing estimate
+    ASSERT_EQ(jce.estimate_ms(7), 16'000);
+
+    jce.record(7, milliseconds(2'000));
+    ASSERT_EQ(jce.estimate_ms(7), 2'000);
+    jce.set_prior(7, 16'000);
+    ASSERT_EQ(jce.estimate_ms(7), 2'000);
+}
+
+// NOLINTNEXTLINE
+TEST(judge_cost_estimator, moving_average) {
+    JudgeCostEstimator jce;
+    jce.record(3, milliseconds(1'000));
+    ASSERT_EQ(jce.estimate_ms(3), 1'000);
+    jce.record(3, milliseconds(5'000));
+    ASSERT_EQ(jce.estimate_ms(3), 2'000); // 1000 + 0.25 * (5000 - 1000)
+    jce.record(3, milliseconds(2'000));
+    ASSERT_EQ(jce.estimate_ms(3), 2'000);
+
+    // The estimate converges to the new judging time
+    for (int i = 0; i < 64; ++i) {
+        jce.record(3, milliseconds(400));
+    }
+    ASSERT_EQ(jce.estimate_ms(3), 400);
+
+    jce.record(4, milliseconds(100));
+    auto all = jce.all_estimates_ms();
+    ASSERT_EQ(all.size(), 2);
+    ASSERT_EQ(all[3], 400);
+    ASSERT_EQ(all[4], 100);
+}
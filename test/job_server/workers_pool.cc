@@ -0,0 +1,375 @@
+#include "../../src/job_server/workers_pool.hh"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using job_server::WorkersPool;
+using std::vector;
+
+namespace {
+
+// Collects events reported by workers; all methods are thread-safe
+class Recorder {
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    vector<uint64_t> handled_jobs_;
+    vector<WorkersPool::WorkerInfo> dead_workers_;
+    size_t idle_transitions_ = 0;
+
+    template <class Pred>
+    bool wait_until(Pred&& pred) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), std::forward<Pred>(pred));
+    }
+
+public:
+    void job_handled(uint64_t job_id) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        handled_jobs_.emplace_back(job_id);
+        cv_.notify_all();
+    }
+
+    void worker_died(WorkersPool::WorkerInfo winfo) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        dead_workers_.emplace_back(winfo);
+        cv_.notify_all();
+    }
+
+    void worker_became_idle() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++idle_transitions_;
+        cv_.notify_all();
+    }
+
+    bool wait_for_idle_transitions(size_t num) {
+        return wait_until([&] { return idle_transitions_ >= num; });
+    }
+
+    bool wait_for_handled_jobs(size_t num) {
+        return wait_until([&] { return handled_jobs_.size() >= num; });
+    }
+
+    bool wait_for_dead_workers(size_t num) {
+        return wait_until([&] { return dead_workers_.size() >= num; });
+    }
+
+    vector<uint64_t> handled_jobs() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return handled_jobs_;
+    }
+
+    vector<WorkersPool::WorkerInfo> dead_workers() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return dead_workers_;
+    }
+};
+
+// Workers are detached threads that outlive the test, so everything they use
+// has to outlive it too
+template <class T, class... Args>
+T& make_leaked(Args&&... args) {
+    return *new T(std::forward<Args>(args)...); // NOLINT(cppcoreguidelines-owning-memory)
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(workers_pool, pass_job_without_workers) {
+    auto& wp = make_leaked<WorkersPool>([](WorkersPool::NextJob /*unused*/) {}, nullptr, nullptr);
+    wp.set_slots_no(4);
+    ASSERT_EQ(wp.workers_no(), 0);
+    ASSERT_FALSE(wp.pass_job(1));
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, no_more_workers_than_slots) {
+    auto& rec = make_leaked<Recorder>();
+    auto& wp = make_leaked<WorkersPool>(
+        [](WorkersPool::NextJob /*unused*/) {},
+        [&] { rec.worker_became_idle(); },
+        nullptr
+    );
+    wp.set_slots_no(2);
+    wp.spawn_worker();
+    wp.spawn_worker();
+    ASSERT_THROW(wp.spawn_worker(), std::exception);
+    ASSERT_EQ(wp.workers_no(), 2);
+    ASSERT_TRUE(rec.wait_for_idle_transitions(2));
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, dispatches_jobs_to_many_workers) {
+    constexpr size_t WORKERS = 64;
+    constexpr uint64_t JOBS = 4096;
+    auto& rec = make_leaked<Recorder>();
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) { rec.job_handled(job.id); },
+        [&] { rec.worker_became_idle(); },
+        nullptr
+    );
+    wp.set_slots_no(WORKERS);
+    for (size_t i = 0; i < WORKERS; ++i) {
+        wp.spawn_worker();
+    }
+    ASSERT_TRUE(rec.wait_for_idle_transitions(WORKERS));
+
+    // pass_job() returns false only if there are no idle workers at the moment
+    for (uint64_t job_id = 1; job_id <= JOBS;) {
+        if (wp.pass_job(job_id)) {
+            ++job_id;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    ASSERT_TRUE(rec.wait_for_handled_jobs(JOBS));
+
+    auto handled = rec.handled_jobs();
+    ASSERT_EQ(handled.size(), JOBS);
+    std::set<uint64_t> unique_jobs(handled.begin(), handled.end());
+    ASSERT_EQ(unique_jobs.size(), JOBS);
+    ASSERT_EQ(*unique_jobs.begin(), 1);
+    ASSERT_EQ(*unique_jobs.rbegin(), JOBS);
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, prefers_warm_workers) {
+    constexpr size_t WORKERS = 8;
+    auto& rec = make_leaked<Recorder>();
+    auto& job_threads = make_leaked<std::map<uint64_t, std::thread::id>>();
+    auto& job_threads_mtx = make_leaked<std::mutex>();
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) {
+            {
+                std::lock_guard<std::mutex> lock(job_threads_mtx);
+                job_threads[job.id] = std::this_thread::get_id();
+            }
+            rec.job_handled(job.id);
+        },
+        [&] { rec.worker_became_idle(); },
+        nullptr
+    );
+    wp.set_slots_no(WORKERS);
+    for (size_t i = 0; i < WORKERS; ++i) {
+        wp.spawn_worker();
+    }
+    ASSERT_TRUE(rec.wait_for_idle_transitions(WORKERS));
+
+    // Jobs 1..WORKERS warm up every worker with a different problem
+    for (uint64_t job_id = 1; job_id <= WORKERS; ++job_id) {
+        ASSERT_TRUE(wp.pass_job(job_id, static_cast<int64_t>(job_id)));
+    }
+    ASSERT_TRUE(rec.wait_for_handled_jobs(WORKERS));
+    ASSERT_TRUE(rec.wait_for_idle_transitions(2 * WORKERS));
+
+    ASSERT_FALSE(wp.has_warm_idle_worker(WORKERS + 1));
+    for (uint64_t job_id = WORKERS + 1; job_id <= 2 * WORKERS; ++job_id) {
+        auto problem_id = static_cast<int64_t>(2 * WORKERS + 1 - job_id);
+        ASSERT_TRUE(wp.has_warm_idle_worker(problem_id));
+        ASSERT_TRUE(wp.pass_job(job_id, problem_id));
+    }
+    ASSERT_TRUE(rec.wait_for_handled_jobs(2 * WORKERS));
+
+    std::lock_guard<std::mutex> lock(job_threads_mtx);
+    for (uint64_t job_id = WORKERS + 1; job_id <= 2 * WORKERS; ++job_id) {
+        ASSERT_EQ(job_threads[job_id], job_threads[2 * WORKERS + 1 - job_id]) << job_id;
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, worker_death_and_restart) {
+    auto& rec = make_leaked<Recorder>();
+    WorkersPool* wp_ptr = nullptr;
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) {
+            if (job.id == 13) {
+                throw std::runtime_error("job failed");
+            }
+            rec.job_handled(job.id);
+        },
+        [&] { rec.worker_became_idle(); },
+        [&](WorkersPool::WorkerInfo winfo) {
+            rec.worker_died(winfo);
+            // Slot of the dead worker has to be reusable from the callback
+            wp_ptr->spawn_worker();
+        }
+    );
+    wp_ptr = &wp;
+    wp.set_death_delay(std::chrono::milliseconds(0));
+    wp.set_slots_no(1);
+    wp.spawn_worker();
+    ASSERT_TRUE(rec.wait_for_idle_transitions(1));
+
+    ASSERT_TRUE(wp.pass_job(13, 42, true));
+    ASSERT_TRUE(rec.wait_for_dead_workers(1));
+    auto dead = rec.dead_workers();
+    ASSERT_EQ(dead.size(), 1);
+    ASSERT_FALSE(dead[0].is_idle);
+    ASSERT_EQ(dead[0].next_job.id, 13);
+    ASSERT_EQ(dead[0].next_job.problem_id, 42);
+    ASSERT_TRUE(dead[0].next_job.locked_its_problem);
+
+    // The restarted worker takes new jobs
+    ASSERT_TRUE(rec.wait_for_idle_transitions(2));
+    ASSERT_EQ(wp.workers_no(), 1);
+    ASSERT_TRUE(wp.pass_job(14));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(1));
+    ASSERT_EQ(rec.handled_jobs(), vector<uint64_t>{14});
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, worker_dies_on_failed_init) {
+    auto& rec = make_leaked<Recorder>();
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) { rec.job_handled(job.id); },
+        [&] { rec.worker_became_idle(); },
+        [&](WorkersPool::WorkerInfo winfo) { rec.worker_died(winfo); },
+        [] { throw std::runtime_error("cannot connect"); }
+    );
+    wp.set_death_delay(std::chrono::milliseconds(0));
+    wp.set_slots_no(1);
+    wp.spawn_worker();
+    ASSERT_TRUE(rec.wait_for_dead_workers(1));
+    ASSERT_EQ(rec.dead_workers()[0].next_job.id, 0);
+    ASSERT_EQ(wp.workers_no(), 0);
+    ASSERT_FALSE(wp.pass_job(1));
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, transient_worker) {
+    auto& rec = make_leaked<Recorder>();
+    auto& pool_init_calls = make_leaked<std::atomic<int>>(0);
+    auto& transient_init_calls = make_leaked<std::atomic<int>>(0);
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) {
+            if (job.id == 7) {
+                throw std::runtime_error("connection lost");
+            }
+            rec.job_handled(job.id);
+        },
+        [&] { rec.worker_became_idle(); },
+        [&](WorkersPool::WorkerInfo winfo) { rec.worker_died(winfo); },
+        [&] { ++pool_init_calls; }
+    );
+    wp.set_death_delay(std::chrono::milliseconds(0));
+    wp.set_slots_no(0, 1);
+    wp.spawn_transient_worker([&] { ++transient_init_calls; });
+    ASSERT_TRUE(rec.wait_for_idle_transitions(1));
+    ASSERT_EQ(pool_init_calls, 0);
+    ASSERT_EQ(transient_init_calls, 1);
+
+    ASSERT_TRUE(wp.pass_job(6));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(1));
+    ASSERT_TRUE(rec.wait_for_idle_transitions(2));
+    ASSERT_TRUE(wp.pass_job(7));
+    ASSERT_TRUE(rec.wait_for_dead_workers(1));
+    auto dead = rec.dead_workers();
+    ASSERT_TRUE(dead[0].is_transient);
+    ASSERT_EQ(dead[0].next_job.id, 7);
+
+    // The freed slot may be taken by a transient worker only
+    ASSERT_EQ(wp.workers_no(), 0);
+    ASSERT_THROW(wp.spawn_worker(), std::exception);
+    wp.spawn_transient_worker([&] { ++transient_init_calls; });
+    ASSERT_TRUE(rec.wait_for_idle_transitions(3));
+    ASSERT_EQ(pool_init_calls, 0);
+    ASSERT_EQ(transient_init_calls, 2);
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, transient_workers_have_separate_slots) {
+    auto& rec = make_leaked<Recorder>();
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) { rec.job_handled(job.id); },
+        [&] { rec.worker_became_idle(); },
+        [&](WorkersPool::WorkerInfo winfo) { rec.worker_died(winfo); }
+    );
+    wp.set_slots_no(1, 2);
+    wp.spawn_transient_worker({});
+    wp.spawn_transient_worker({});
+    // Transient workers cannot take the slot of a normal worker...
+    ASSERT_THROW(wp.spawn_transient_worker({}), std::exception);
+    wp.spawn_worker();
+    // ...and vice versa
+    ASSERT_THROW(wp.spawn_worker(), std::exception);
+    ASSERT_TRUE(rec.wait_for_idle_transitions(3));
+    ASSERT_EQ(wp.workers_no(), 3);
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, job_not_for_transient_workers) {
+    auto& rec = make_leaked<Recorder>();
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) { rec.job_handled(job.id); },
+        [&] { rec.worker_became_idle(); },
+        [&](WorkersPool::WorkerInfo winfo) { rec.worker_died(winfo); }
+    );
+    wp.set_slots_no(1, 1);
+    wp.spawn_transient_worker({});
+    ASSERT_TRUE(rec.wait_for_idle_transitions(1));
+    ASSERT_FALSE(wp.pass_job(1, 42, false, false));
+    ASSERT_FALSE(wp.pass_job(1, -1, false, false));
+
+    wp.spawn_worker();
+    ASSERT_TRUE(rec.wait_for_idle_transitions(2));
+    ASSERT_TRUE(wp.pass_job(1, 42, false, false));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(1));
+    ASSERT_TRUE(rec.wait_for_idle_transitions(3));
+    // Both workers are idle, but only the normal one is warm for problem 42
+    ASSERT_TRUE(wp.has_warm_idle_worker(42, false));
+    ASSERT_TRUE(wp.pass_job(2, 42));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(2));
+    ASSERT_TRUE(rec.wait_for_idle_transitions(4));
+    ASSERT_TRUE(wp.pass_job(3, 7, false, false));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(3));
+    ASSERT_TRUE(rec.wait_for_idle_transitions(5));
+    // The normal worker is warm for problem 7 now, the transient one is not
+    ASSERT_FALSE(wp.has_warm_idle_worker(42));
+    ASSERT_TRUE(wp.pass_job(4, 8));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(4));
+    ASSERT_EQ(rec.handled_jobs(), (vector<uint64_t>{1, 2, 3, 4}));
+}
+
+// NOLINTNEXTLINE
+TEST(workers_pool, dead_idle_transient_worker_dies_instead_of_taking_job) {
+    auto& rec = make_leaked<Recorder>();
+    auto& alive = make_leaked<std::atomic<bool>>(true);
+    auto& wp = make_leaked<WorkersPool>(
+        [&](WorkersPool::NextJob job) { rec.job_handled(job.id); },
+        [&] { rec.worker_became_idle(); },
+        [&](WorkersPool::WorkerInfo winfo) { rec.worker_died(winfo); }
+    );
+    wp.set_death_delay(std::chrono::milliseconds(0));
+    wp.set_slots_no(1, 1);
+    wp.spawn_transient_worker({}, [&] { return alive.load(); });
+    ASSERT_TRUE(rec.wait_for_idle_transitions(1));
+    ASSERT_TRUE(wp.pass_job(1, 42));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(1));
+    ASSERT_TRUE(rec.wait_for_idle_transitions(2));
+
+    alive = false;
+    wp.spawn_worker();
+    ASSERT_TRUE(rec.wait_for_idle_transitions(3));
+    // The transient worker is warm, but dead, so the job goes to the other one
+    ASSERT_TRUE(wp.pass_job(2, 42));
+    ASSERT_TRUE(rec.wait_for_handled_jobs(2));
+    ASSERT_TRUE(rec.wait_for_dead_workers(1));
+    auto dead = rec.dead_workers();
+    ASSERT_TRUE(dead[0].is_transient);
+    ASSERT_TRUE(dead[0].is_idle);
+    ASSERT_EQ(wp.workers_no(), 1);
+    ASSERT_EQ(rec.handled_jobs(), (vector<uint64_t>{1, 2}));
+
+    // The freed slot may be taken again
+    wp.spawn_transient_worker({});
+    ASSERT_TRUE(rec.wait_for_idle_transitions(5));
+    ASSERT_EQ(wp.workers_no(), 2);
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include <sim/db/dump.hh>
+
+using std::string;
+
+namespace {
+
+string string_literal(StringView str) {
+    string sql;
+    sim::db::append_sql_string_literal(sql, str);
+    return sql;
+}
+
+string hex_literal(StringView bytes) {
+    string sql;
+    sim::db::append_sql_hex_literal(sql, bytes);
+    return sql;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(db_dump, append_sql_string_literal) {
+    EXPECT_EQ(string_literal(""), "''");
+    EXPECT_EQ(string_literal("abc 123"), "'abc 123'");
+    EXPECT_EQ(string_literal("it's"), R"('it\'s')");
+    EXPECT_EQ(string_literal(R"(C:\dir)"), R"('C:\\dir')");
+    EXPECT_EQ(string_literal("\"quoted\""), "'\"quoted\"'");
+    // Statements of the dump must not contain newlines
+    EXPECT_EQ(string_literal("a\nb\r\n"), R"('a\nb\r\n')");
+    EXPECT_EQ(string_literal(StringView{"x\0y\x1a", 4}), R"('x\0y\Z')");
+
+    string sql = "INSERT INTO t VALUES (";
+    sim::db::append_sql_string_literal(sql, "a");
+    EXPECT_EQ(sql, "INSERT INTO t VALUES ('a'");
+}
+
+// NOLINTNEXTLINE
+TEST(db_dump, append_sql_hex_literal) {
+    EXPECT_EQ(hex_literal(""), "X''");
+    EXPECT_EQ(hex_literal("abc"), "X'616263'");
+    EXPECT_EQ(hex_literal(StringView{"\0\x7f\x80\xff\n", 5}), "X'007f80ff0a'");
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <optional>
+#include <sim/internal_files/internal_file.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/file_contents.hh>
+#include <simlib/file_perms.hh>
+#include <simlib/temporary_directory.hh>
+#include <simlib/working_directory.hh>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using sim::internal_files::blob_path_of_contents;
+using sim::internal_files::deduplicate;
+using sim::internal_files::path_of;
+using sim::internal_files::path_of_new_file;
+
+namespace {
+
+struct stat64 stat_of(FilePath path) {
+    struct stat64 st = {};
+    if (stat64(path, &st)) {
+        st.st_nlink = 0;
+    }
+    return st;
+}
+
+bool is_same_file(FilePath a, FilePath b) {
+    auto st_a = stat_of(a);
+    auto st_b = stat_of(b);
+    return st_a.st_nlink > 0 and st_b.st_nlink > 0 and st_a.st_dev == st_b.st_dev and
+        st_a.st_ino == st_b.st_ino;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(internal_files, path_of) {
+    ASSERT_EQ(path_of(0).to_string(), "internal_files/00/00/0");
+    ASSERT_EQ(path_of(1).to_string(), "internal_files/01/00/1");
+    ASSERT_EQ(path_of(0x123456).to_string(), "internal_files/56/34/1193046");
+    ASSERT_EQ(path_of(0xffff).to_string(), "internal_files/ff/ff/65535");
+    ASSERT_EQ(path_of(0x10000).to_string(), "internal_files/00/00/65536");
+}
+
+// NOLINTNEXTLINE
+TEST(internal_files, deduplicate_and_remove) {
+    TemporaryDirectory tmp_dir("/tmp/sim-test-internal-files.XXXXXX");
+    auto old_cwd = get_cwd();
+    ASSERT_EQ(chdir(tmp_dir.path().c_str()), 0);
+    ASSERT_EQ(mkdir(sim::internal_files::dir.data(), S_0755), 0);
+
+    std::string big_contents(3 << 20, 'x');
+    big_contents.back() = 'y';
+    put_file_contents(path_of_new_file(1), big_contents);
+    put_file_contents(path_of_new_file(2), big_contents);
+    put_file_contents(path_of_new_file(3), "other");
+    put_file_contents(path_of_new_file(4), "");
+    put_file_contents(path_of_new_file(5), big_contents.substr(1));
+
+    ASSERT_EQ(deduplicate(1), false);
+    ASSERT_EQ(deduplicate(2), true);
+    ASSERT_EQ(deduplicate(3), false);
+    ASSERT_EQ(deduplicate(4), false);
+    ASSERT_EQ(deduplicate(5), false);
+    // Deduplicating again changes nothing
+    ASSERT_EQ(deduplicate(2), false);
+
+    auto blob = blob_path_of_contents(path_of(1));
+    ASSERT_TRUE(is_same_file(path_of(1), blob));
+    ASSERT_TRUE(is_same_file(path_of(2), blob));
+    ASSERT_EQ(stat_of(blob).st_nlink, 3);
+    ASSERT_EQ(get_file_contents(path_of(2)), big_contents);
+    ASSERT_NE(blob_path_of_contents(path_of(3)), blob);
+    ASSERT_NE(blob_path_of_contents(path_of(4)), blob);
+    ASSERT_NE(blob_path_of_contents(path_of(5)), blob);
+
+    sim::internal_files::remove(1);
+    ASSERT_EQ(access(path_of(1), F_OK), -1);
+    ASSERT_EQ(stat_of(blob).st_nlink, 2);
+    // The last reference removes the blob
+    sim::internal_files::remove(2);
+    ASSERT_EQ(access(blob.c_str(), F_OK), -1);
+    // Removing a not existing file does nothing
+    sim::internal_files::remove(2);
+
+    auto other_blob = blob_path_of_contents(path_of(3));
+    sim::internal_files::remove(3);
+    ASSERT_EQ(access(other_blob.c_str(), F_OK), -1);
+
+    ASSERT_EQ(chdir(old_cwd.to_cstr().data()), 0);
+}
+
+// NOLINTNEXTLINE
+TEST(internal_files, for_each_blob) {
+    TemporaryDirectory tmp_dir("/tmp/sim-test-internal-files.XXXXXX");
+    auto old_cwd = get_cwd();
+    ASSERT_EQ(chdir(tmp_dir.path().c_str()), 0);
+
+    auto blobs = [] {
+        std::vector<std::pair<std::string, nlink_t>> res;
+        sim::internal_files::for_each_blob([&](const std::string& path, const struct stat64& st) {
+            res.emplace_back(path, st.st_nlink);
+        });
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+    // No directory
+    ASSERT_EQ(blobs().size(), 0);
+
+    ASSERT_EQ(mkdir(sim::internal_files::dir.data(), S_0755), 0);
+    put_file_contents(path_of_new_file(1), "a");
+    put_file_contents(path_of_new_file(2), "a");
+    put_file_contents(path_of_new_file(3), "b");
+    for (uint64_t id : {1, 2, 3}) {
+        deduplicate(id);
+    }
+    auto blob_a = blob_path_of_contents(path_of(1));
+    auto blob_b = blob_path_of_contents(path_of(3));
+    std::vector<std::pair<std::string, nlink_t>> expected = {{blob_a, 3}, {blob_b, 2}};
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(blobs(), expected);
+
+    ASSERT_EQ(chdir(old_cwd.to_cstr().data()), 0);
+}
+
+// NOLINTNEXTLINE
+TEST(internal_files, scan_dir_and_orphaned_files) {
+    TemporaryDirectory tmp_dir("/tmp/sim-test-internal-files.XXXXXX");
+    auto old_cwd = get_cwd();
+    ASSERT_EQ(chdir(tmp_dir.path().c_str()), 0);
+
+    // No directory
+    ASSERT_EQ(sim::internal_files::scan_dir().file_ids, std::vector<uint64_t>{});
+
+    ASSERT_EQ(mkdir(sim::internal_files::dir.data(), S_0755), 0);
+    for (uint64_t id : {7, 1, 0x10001, 3, 5}) {
+        put_file_contents(path_of_new_file(id), "x");
+    }
+    put_file_contents(concat_tostr(path_of(5), ".statement"), "");
+    put_file_contents(concat_tostr(path_of(6), ".statement"), "");
+    // Not under path_of(1002)
+    put_file_contents(concat_tostr(sim::internal_files::dir, "01/00/1002"), "");
+    put_file_contents(concat_tostr(sim::internal_files::dir, "tmp"), "");
+    // Not migrated to the sharded layout yet
+    put_file_contents(sim::internal_files::unsharded_path_of(2), "");
+    ASSERT_EQ(deduplicate(1), false);
+
+    auto scan = sim::internal_files::scan_dir();
+    ASSERT_EQ(scan.file_ids, (std::vector<uint64_t>{1, 3, 5, 7, 0x10001}));
+    ASSERT_EQ(scan.derived_files.size(), 2);
+    ASSERT_EQ(scan.derived_files[0].first, 5);
+    ASSERT_EQ(scan.derived_files[1].first, 6);
+    ASSERT_EQ(scan.unsharded_files, std::vector<std::string>{"internal_files/2"});
+    ASSERT_EQ(scan.other_files.size(), 2);
+
+    std::vector<uint64_t> db_ids = {1, 2, 5, 7, 8};
+    size_t next = 0;
+    auto orphaned_files =
+        sim::internal_files::orphaned_files(scan, [&]() -> std::optional<uint64_t> {
+            if (next == db_ids.size()) {
+                return std::nullopt;
+            }
+            return db_ids[next++];
+        });
+    ASSERT_EQ(
+        orphaned_files,
+        (std::vector<std::string>{
+            "internal_files/01/00/1002",
+            "internal_files/01/00/65537",
+            "internal_files/03/00/3",
+            "internal_files/06/00/6.statement",
+            "internal_files/tmp",
+        })
+    );
+
+    ASSERT_EQ(chdir(old_cwd.to_cstr().data()), 0);
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <sim/jobs/job_server_metrics.hh>
+
+using sim::jobs::JobServerMetrics;
+
+// NOLINTNEXTLINE
+TEST(jobs, job_server_metrics_durations_of) {
+    EXPECT_EQ(JobServerMetrics::Durations::of({}), JobServerMetrics::Durations{});
+    EXPECT_EQ(JobServerMetrics::Durations::of({7}), (JobServerMetrics::Durations{1, 7, 7, 7, 7}));
+
+    std::vector<int64_t> durations;
+    for (int64_t i = 200; i >= 0; --i) {
+        durations.emplace_back(i * 10);
+    }
+    EXPECT_EQ(
+        JobServerMetrics::Durations::of(durations),
+        (JobServerMetrics::Durations{201, 1000, 1800, 1980, 2000})
+    );
+}
+
+// NOLINTNEXTLINE
+TEST(jobs, job_server_metrics_dump_parse_roundtrip) {
+    JobServerMetrics m;
+    m.queues = {{"judge_jobs", {12, 1}}, {"other_jobs", {0, 0}}};
+    m.queue_wait_ms = {{"judge_jobs", {100, 5, 40, 1200, 3000}}};
+    m.judge_stage_ms = {
+        {"final_judging", {3, 900, 1500, 1600, 1600}},
+        {"db_update", {9, 1, 2, 3, 4}},
+    };
+
+    auto res = JobServerMetrics::parse(m.dump());
+    EXPECT_EQ(res.queues, m.queues);
+    EXPECT_EQ(res.queue_wait_ms, m.queue_wait_ms);
+    EXPECT_EQ(res.judge_stage_ms, m.judge_stage_ms);
+}
+
+// NOLINTNEXTLINE
+TEST(jobs, job_server_metrics_parse_ignores_malformed_lines) {
+    auto res = JobServerMetrics::parse("queue judge_jobs 3 1\n"
+                                       "queue other_jobs 3\n"
+                                       "queue 3 1\n"
+                                       "wait judge_jobs 1 2 3 4\n"
+                                       "stage db_update 1 2 3 4 x\n"
+                                       "other a 1 2\n"
+                                       "\n"
+                                       "stage package_load 2 10 20 30 40");
+    std::map<std::string, JobServerMetrics::Queue, std::less<>> expected_queues = {
+        {"judge_jobs", {3, 1}}
+    };
+    std::map<std::string, JobServerMetrics::Durations, std::less<>> expected_stages = {
+        {"package_load", {2, 10, 20, 30, 40}}
+    };
+    EXPECT_EQ(res.queues, expected_queues);
+    EXPECT_TRUE(res.queue_wait_ms.empty());
+    EXPECT_EQ(res.judge_stage_ms, expected_stages);
+}
@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+#include <sim/jobs/judge_estimates.hh>
+
+using sim::jobs::JudgeEstimates;
+
+// NOLINTNEXTLINE
+TEST(jobs, judge_estimates_dump_parse_roundtrip) {
+    JudgeEstimates je;
+    je.problem_judge_time_ms = {{1, 1500}, {7, 42}, {18446744073709551615ULL, 0}};
+    je.job_eta_ms = {{100, 1500}, {101, 3042}};
+
+    auto res = JudgeEstimates::parse(je.dump());
+    ASSERT_EQ(res.problem_judge_time_ms, je.problem_judge_time_ms);
+    ASSERT_EQ(res.job_eta_ms, je.job_eta_ms);
+}
+
+// NOLINTNEXTLINE
+TEST(jobs, judge_estimates_parse_ignores_malformed_lines) {
+    auto res = JudgeEstimates::parse("problem 1 10\n"
+                                     "problem x 10\n"
+                                     "job 5\n"
+                                     "\n"
+                                     "other 3 4\n"
+                                     "job 5 -3\n"
+                                     "problem 2 20");
+    std::map<uint64_t, int64_t> expected_problems = {{1, 10}, {2, 20}};
+    std::map<uint64_t, int64_t> expected_jobs = {{5, -3}};
+    ASSERT_EQ(res.problem_judge_time_ms, expected_problems);
+    ASSERT_EQ(res.job_eta_ms, expected_jobs);
+}
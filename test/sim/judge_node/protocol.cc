@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <sim/judge_node/protocol.hh>
+#include <sys/socket.h>
+#include <thread>
+
+using sim::JudgeReport;
+using sim::judge_node::Connection;
+using sim::judge_node::ConnectionLost;
+using sim::judge_node::MessageType;
+using std::string;
+
+namespace {
+
+std::pair<Connection, Connection> make_connected_pair() {
+    int fds[2];
+    throw_assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+    return {Connection{FileDescriptor{fds[0]}}, Connection{FileDescriptor{fds[1]}}};
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(judge_node, judge_report_dump_roundtrip) {
+    using std::chrono::milliseconds;
+    using Test = JudgeReport::Test;
+
+    JudgeReport jr;
+    auto& group1 = jr.groups.emplace_back();
+    group1.score = 40;
+    group1.max_score = 50;
+    group1.tests.emplace_back(
+        "1a", Test::OK, milliseconds(120), milliseconds(1000), 4096, 1 << 20, ""
+    );
+    group1.tests.emplace_back(
+        "1b", Test::WA, milliseconds(0), milliseconds(1000), 0, 1 << 20, "Line 1: expected 42"
+    );
+    auto& group2 = jr.groups.emplace_back();
+    group2.score = 0;
+    group2.max_score = 0;
+    group2.tests.emplace_back(
+        "2ocen", Test::SKIPPED, milliseconds(0), milliseconds(500), 0, 1 << 10, ""
+    );
+    jr.judge_log = string("Judge log\n\0with a NUL byte", 26);
+
+    string dumped;
+    sim::judge_node::append_dumped(dumped, jr);
+    dumped += "rest";
+    StringView dumped_str = dumped;
+    auto res = sim::judge_node::extract_dumped_judge_report(dumped_str);
+    ASSERT_EQ(dumped_str, "rest");
+
+    ASSERT_EQ(res.judge_log, jr.judge_log);
+    ASSERT_EQ(res.groups.size(), jr.groups.size());
+    for (size_t i = 0; i < jr.groups.size(); ++i) {
+        const auto& exp = jr.groups[i];
+        const auto& got = res.groups[i];
+        ASSERT_EQ(got.score, exp.score);
+        ASSERT_EQ(got.max_score, exp.max_score);
+        ASSERT_EQ(got.tests.size(), exp.tests.size());
+        for (size_t j = 0; j < exp.tests.size(); ++j) {
+            ASSERT_EQ(got.tests[j].name, exp.tests[j].name);
+            ASSERT_EQ(got.tests[j].status, exp.tests[j].status);
+            ASSERT_EQ(got.tests[j].runtime, exp.tests[j].runtime);
+            ASSERT_EQ(got.tests[j].time_limit, exp.tests[j].time_limit);
+            ASSERT_EQ(got.tests[j].memory_consumed, exp.tests[j].memory_consumed);
+            ASSERT_EQ(got.tests[j].memory_limit, exp.tests[j].memory_limit);
+            ASSERT_EQ(got.tests[j].comment, exp.tests[j].comment);
+        }
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(judge_node, connection_send_and_receive) {
+    auto [a, b] = make_connected_pair();
+    ASSERT_FALSE(b.is_closed());
+
+    a.send(MessageType::LOG, "Compiling solution...");
+    a.send(MessageType::JUDGING_DONE, "");
+    // A message bigger than the socket buffer has to be sent concurrently
+    string big(3 << 20, 'x');
+    std::thread sender([&a = a, &big] { a.send(MessageType::FILE_CHUNK, big); });
+
+    auto msg = b.receive();
+    ASSERT_EQ(msg.type, MessageType::LOG);
+    ASSERT_EQ(msg.payload, "Compiling solution...");
+    ASSERT_FALSE(b.is_closed()); // Unread messages do not count as closure
+
+    msg = b.receive();
+    ASSERT_EQ(msg.type, MessageType::JUDGING_DONE);
+    ASSERT_EQ(msg.payload, "");
+
+    msg = b.receive();
+    sender.join();
+    ASSERT_EQ(msg.type, MessageType::FILE_CHUNK);
+    ASSERT_EQ(msg.payload, big);
+}
+
+// NOLINTNEXTLINE
+TEST(judge_node, connection_closed_by_peer) {
+    auto [a, b] = make_connected_pair();
+    a.send(MessageType::LOG, "last words");
+    { Connection dropped = std::move(a); }
+
+    auto msg = b.receive();
+    ASSERT_EQ(msg.payload, "last words");
+    ASSERT_TRUE(b.is_closed());
+    ASSERT_THROW(b.receive(), ConnectionLost);
+}
+
+// NOLINTNEXTLINE
+TEST(judge_node, parse_address) {
+    auto addr = sim::judge_node::parse_address("127.0.0.1:7890");
+    ASSERT_EQ(ntohs(addr.sin_port), 7890);
+    ASSERT_EQ(ntohl(addr.sin_addr.s_addr), 0x7f000001);
+
+    addr = sim::judge_node::parse_address("*:80");
+    ASSERT_EQ(ntohs(addr.sin_port), 80);
+    ASSERT_EQ(addr.sin_addr.s_addr, htonl(INADDR_ANY));
+
+    ASSERT_THROW(sim::judge_node::parse_address("127.0.0.1"), std::exception);
+    ASSERT_THROW(sim::judge_node::parse_address("127.0.0.1:port"), std::exception);
+    ASSERT_THROW(sim::judge_node::parse_address(":80"), std::exception);
+    ASSERT_THROW(sim::judge_node::parse_address("localhost:80"), std::exception);
+}
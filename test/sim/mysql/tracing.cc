@@ -0,0 +1,107 @@
+#include <chrono>
+#include <gtest/gtest.h>
+#include <sim/mysql/tracing.hh>
+#include <thread>
+
+using namespace std::chrono_literals;
+namespace tracing = sim::mysql::tracing;
+
+// NOLINTNEXTLINE
+TEST(sim_mysql_tracing, normalize_sql) {
+    EXPECT_EQ(tracing::normalize_sql(""), "");
+    EXPECT_EQ(
+        tracing::normalize_sql("SELECT id FROM submissions WHERE owner=42 AND type=1"),
+        "SELECT id FROM submissions WHERE owner=? AND type=?"
+    );
+    EXPECT_EQ(
+        tracing::normalize_sql("  SELECT a,\n\tb  FROM t\n WHERE x='it''s' OR y=\"a\\\"b\"  "),
+        "SELECT a, b FROM t WHERE x=? OR y=?"
+    );
+    EXPECT_EQ(
+        tracing::normalize_sql("SELECT owner_2, t1.c FROM `t 42` WHERE v>1.5e-3 AND h=0xFF"),
+        "SELECT owner_2, t1.c FROM `t 42` WHERE v>? AND h=?"
+    );
+    EXPECT_EQ(
+        tracing::normalize_sql("SELECT * FROM s WHERE id IN (7, 8,9) LIMIT 50"),
+        "SELECT * FROM s WHERE id IN (?, ...) LIMIT ?"
+    );
+    EXPECT_EQ(
+        tracing::normalize_sql("INSERT INTO t(a, b) VALUES(?, ?), (1, 'x')"),
+        "INSERT INTO t(a, b) VALUES(?, ...), (?, ...)"
+    );
+    EXPECT_EQ(tracing::normalize_sql("SELECT 'unterminated"), "SELECT ?");
+}
+
+// NOLINTNEXTLINE
+TEST(sim_mysql_tracing, disabled) {
+    ASSERT_FALSE(tracing::is_enabled());
+    tracing::begin();
+    bool sql_was_needed = false;
+    int res = tracing::traced(
+        tracing::Kind::QUERY,
+        [&] {
+            sql_was_needed = true;
+            return "SELECT 1";
+        },
+        [] { return 7; }
+    );
+    EXPECT_EQ(res, 7);
+    EXPECT_FALSE(sql_was_needed);
+    EXPECT_EQ(tracing::current().queries, 0);
+    EXPECT_EQ(tracing::summary(), "sql: 0 queries, 0 prepares, 0.000 ms");
+}
+
+// NOLINTNEXTLINE
+TEST(sim_mysql_tracing, enabled) {
+    tracing::enable(10ms);
+    ASSERT_TRUE(tracing::is_enabled());
+    tracing::begin();
+    bool sql_was_needed = false;
+    tracing::traced(
+        tracing::Kind::PREPARE,
+        [&] {
+            sql_was_needed = true;
+            return "SELECT 1";
+        },
+        [] {}
+    );
+    EXPECT_FALSE(sql_was_needed); // the query is not slow
+    tracing::traced(
+        tracing::Kind::QUERY,
+        [] { return "SELECT x FROM t WHERE id=17"; },
+        [] { std::this_thread::sleep_for(12ms); }
+    );
+
+    const auto& trace = tracing::current();
+    EXPECT_EQ(trace.queries, 1);
+    EXPECT_EQ(trace.prepares, 1);
+    EXPECT_GE(trace.duration, 12ms);
+    ASSERT_EQ(trace.slow_queries.size(), 1);
+    EXPECT_EQ(trace.slow_queries[0].sql, "SELECT x FROM t WHERE id=?");
+    EXPECT_GE(trace.slow_queries[0].duration, 12ms);
+
+    auto summary = tracing::summary();
+    EXPECT_EQ(summary.find("sql: 1 query, 1 prepare, "), 0) << summary;
+    EXPECT_NE(summary.find(" ms] SELECT x FROM t WHERE id=?"), std::string::npos) << summary;
+
+    // Slow queries over the limit are only counted
+    for (size_t i = 0; i < tracing::MAX_SLOW_QUERIES; ++i) {
+        tracing::traced(
+            tracing::Kind::QUERY,
+            [] { return "SELECT 1"; },
+            [] { std::this_thread::sleep_for(10ms); }
+        );
+    }
+    EXPECT_EQ(trace.queries, tracing::MAX_SLOW_QUERIES + 1);
+    EXPECT_EQ(trace.slow_queries.size(), tracing::MAX_SLOW_QUERIES);
+    EXPECT_EQ(trace.uncaptured_slow_queries, 1);
+    summary = tracing::summary();
+    EXPECT_NE(summary.find("; and 1 more"), std::string::npos) << summary;
+
+    // Every thread has its own trace
+    std::thread{[] { EXPECT_EQ(tracing::current().queries, 0); }}.join();
+
+    tracing::begin();
+    EXPECT_EQ(trace.queries, 0);
+    EXPECT_TRUE(trace.slow_queries.empty());
+}
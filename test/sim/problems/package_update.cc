@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <sim/problems/package_update.hh>
+#include <simlib/concat_tostr.hh>
+#include <simlib/file_contents.hh>
+#include <simlib/libzip.hh>
+#include <simlib/temporary_directory.hh>
+#include <string>
+
+using sim::problems::copy_package_with_changes;
+using sim::problems::PackageChanges;
+using sim::problems::PackageCopyMode;
+
+namespace {
+
+std::string random_bytes(size_t len, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::string res(len, '\0');
+    for (auto& c : res) {
+        c = static_cast<char>(gen());
+    }
+    return res;
+}
+
+void create_zip(FilePath zip_path, const std::map<std::string, std::string>& entries) {
+    ZipFile zip(zip_path, ZIP_CREATE | ZIP_TRUNCATE);
+    for (auto const& [name, contents] : entries) {
+        zip.file_add(name, zip.source_buffer(contents));
+    }
+    zip.close();
+}
+
+std::map<std::string, std::string> zip_entries(FilePath zip_path) {
+    ZipFile zip(zip_path, ZIP_RDONLY);
+    std::map<std::string, std::string> res;
+    for (decltype(zip.entries_no()) i = 0; i < zip.entries_no(); ++i) {
+        res.emplace(zip.get_name(i), zip.extract_to_str(i));
+    }
+    return res;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(problems, copy_package_with_changes) {
+    TemporaryDirectory tmp_dir("/tmp/sim-test-package-update.XXXXXX");
+    auto src_path = concat_tostr(tmp_dir.path(), "src.zip");
+    auto dest_path = concat_tostr(tmp_dir.path(), "dest.zip");
+    auto dest2_path = concat_tostr(tmp_dir.path(), "dest2.zip");
+
+    std::string big_test(1 << 20, '\0');
+    for (size_t i = 0; i < big_test.size(); ++i) {
+        big_test[i] = static_cast<char>(i * 7919 % 251);
+    }
+    std::map<std::string, std::string> entries = {
+        {"pkg/Simfile", "name: Old\n"},
+        {"pkg/tests/1.in", big_test},
+        {"pkg/doc/statement.pdf", "%PDF-1.4"},
+    };
+    create_zip(src_path, entries);
+    auto src_contents = get_file_contents(src_path);
+
+    copy_package_with_changes(
+        src_path, dest_path,
+        PackageChanges{
+            {"pkg/Simfile", "name: New\n"},
+            {"pkg/doc/statement.pdf", std::nullopt},
+            {"pkg/doc/statement.md", "# Statement"},
+            {"pkg/not_existing", std::nullopt},
+        }
+    );
+    entries["pkg/Simfile"] = "name: New\n";
+    entries.erase("pkg/doc/statement.pdf");
+    entries["pkg/doc/statement.md"] = "# Statement";
+    ASSERT_EQ(zip_entries(dest_path), entries);
+    // The source package is left intact
+    ASSERT_EQ(get_file_contents(src_path), src_contents);
+    // The unchanged entries are not rewritten
+    auto dest_contents = get_file_contents(dest_path);
+    ASSERT_GT(dest_contents.size(), big_test.size());
+    ASSERT_EQ(
+        StringView(dest_contents).substring(0, big_test.size()),
+        StringView(src_contents).substring(0, big_test.size())
+    );
+
+    // Updating an updated package
+    copy_package_with_changes(dest_path, dest2_path, PackageChanges{{"pkg/Simfile", "name: X\n"}});
+    entries["pkg/Simfile"] = "name: X\n";
+    ASSERT_EQ(zip_entries(dest2_path), entries);
+}
+
+// NOLINTNEXTLINE
+TEST(problems, copy_package_with_changes_removes_unreferenced_data) {
+    TemporaryDirectory tmp_dir("/tmp/sim-test-package-update.XXXXXX");
+    auto src_path = concat_tostr(tmp_dir.path(), "src.zip");
+    auto dest_path = concat_tostr(tmp_dir.path(), "dest.zip");
+    auto dest2_path = concat_tostr(tmp_dir.path(), "dest2.zip");
+    auto dest3_path = concat_tostr(tmp_dir.path(), "dest3.zip");
+
+    // Incompressible, so that every test takes TEST_SIZE bytes of the package
+    constexpr size_t TEST_SIZE = 1 << 16;
+    std::map<std::string, std::string> entries = {{"pkg/Simfile", "name: Old\n"}};
+    for (unsigned i = 1; i <= 5; ++i) {
+        entries[concat_tostr("pkg/tests/", i, ".in")] = random_bytes(TEST_SIZE, i);
+    }
+    create_zip(src_path, entries);
+
+    // A fifth of the package becomes unreferenced, so it is kept
+    entries["pkg/tests/1.in"] = random_bytes(TEST_SIZE, 6);
+    copy_package_with_changes(
+        src_path, dest_path, PackageChanges{{"pkg/tests/1.in", entries["pkg/tests/1.in"]}}
+    );
+    ASSERT_EQ(zip_entries(dest_path), entries);
+    ASSERT_GT(get_file_contents(dest_path).size(), 6 * TEST_SIZE);
+
+    // Untrusted packages are always rewritten
+    entries["pkg/Simfile"] = "name: New\n";
+    copy_package_with_changes(
+        dest_path, dest2_path, PackageChanges{{"pkg/Simfile", "name: New\n"}},
+        PackageCopyMode::REWRITE
+    );
+    ASSERT_EQ(zip_entries(dest2_path), entries);
+    ASSERT_LT(get_file_contents(dest2_path).size(), 6 * TEST_SIZE);
+
+    // A third of the package would become unreferenced, so it is rewritten
+    entries["pkg/Simfile"] = "name: Old\n";
+    entries["pkg/tests/2.in"] = random_bytes(TEST_SIZE, 7);
+    copy_package_with_changes(
+        dest_path, dest3_path, PackageChanges{{"pkg/tests/2.in", entries["pkg/tests/2.in"]}}
+    );
+    ASSERT_EQ(zip_entries(dest3_path), entries);
+    ASSERT_LT(get_file_contents(dest3_path).size(), 6 * TEST_SIZE);
+}
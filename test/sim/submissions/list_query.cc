@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <optional>
+#include <sim/submissions/list_query.hh>
+
+using sim::submissions::ListFilter;
+using sim::submissions::Submission;
+using Finals = ListFilter::Finals;
+using Scope = ListFilter::Scope;
+
+namespace {
+
+ListFilter filter(
+    std::optional<uint64_t> owner,
+    Scope scope,
+    std::optional<Submission::Type> type = std::nullopt,
+    Finals finals = Finals::NONE
+) {
+    ListFilter res;
+    res.owner = owner;
+    res.scope = scope;
+    res.scope_id = (scope == Scope::NONE ? 0 : 7);
+    res.type = type;
+    res.finals = finals;
+    return res;
+}
+
+std::optional<std::string> index_of(const ListFilter& f) {
+    auto res = sim::submissions::list_index(f);
+    if (res) {
+        return res->to_string();
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(submissions_list_query, list_index_with_owner) {
+    constexpr auto T = Submission::Type::NORMAL;
+    EXPECT_EQ(index_of(filter(1, Scope::NONE)), "owner");
+    EXPECT_EQ(index_of(filter(1, Scope::NONE, T)), "owner_2");
+    EXPECT_EQ(index_of(filter(1, Scope::NONE, std::nullopt, Finals::CONTEST)), "owner_7");
+    EXPECT_EQ(index_of(filter(1, Scope::NONE, std::nullopt, Finals::PROBLEM)), "owner_8");
+    EXPECT_EQ(
+        index_of(filter(1, Scope::NONE, std::nullopt, Finals::PROBLEM_OR_CONTEST)), "owner"
+    );
+
+    EXPECT_EQ(index_of(filter(1, Scope::PROBLEM)), "owner_3");
+    EXPECT_EQ(index_of(filter(1, Scope::PROBLEM, T)), "owner_9");
+    EXPECT_EQ(index_of(filter(1, Scope::PROBLEM, std::nullopt, Finals::PROBLEM)), "owner_10");
+
+    EXPECT_EQ(index_of(filter(1, Scope::CONTEST_PROBLEM)), "owner_4");
+    EXPECT_EQ(index_of(filter(1, Scope::CONTEST_PROBLEM, T)), "owner_11");
+    EXPECT_EQ(
+        index_of(filter(1, Scope::CONTEST_PROBLEM, std::nullopt, Finals::CONTEST)), "owner_12"
+    );
+
+    EXPECT_EQ(index_of(filter(1, Scope::CONTEST_ROUND)), "owner_5");
+    EXPECT_EQ(index_of(filter(1, Scope::CONTEST_ROUND, T)), "owner_13");
+    EXPECT_EQ(
+        index_of(filter(1, Scope::CONTEST_ROUND, std::nullopt, Finals::CONTEST)), "owner_14"
+    );
+
+    EXPECT_EQ(index_of(filter(1, Scope::CONTEST)), "owner_6");
+    EXPECT_EQ(index_of(filter(1, Scope::CONTEST, T)), "owner_15");
+    EXPECT_EQ(index_of(filter(1, Scope::CONTEST, std::nullopt, Finals::CONTEST)), "owner_16");
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_list_query, list_index_without_owner) {
+    constexpr auto T = Submission::Type::IGNORED;
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::NONE)), std::nullopt);
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::NONE, T)), "type");
+    EXPECT_EQ(
+        index_of(filter(std::nullopt, Scope::NONE, std::nullopt, Finals::PROBLEM_OR_CONTEST)),
+        std::nullopt
+    );
+
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::PROBLEM)), "problem_id");
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::PROBLEM, T)), "problem_id_2");
+    EXPECT_EQ(
+        index_of(filter(std::nullopt, Scope::PROBLEM, std::nullopt, Finals::PROBLEM)),
+        "problem_id"
+    );
+
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::CONTEST_PROBLEM)), "contest_problem_id");
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::CONTEST_PROBLEM, T)), "contest_problem_id_2");
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::CONTEST_ROUND)), "contest_round_id");
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::CONTEST_ROUND, T)), "contest_round_id_2");
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::CONTEST)), "contest_id");
+    EXPECT_EQ(index_of(filter(std::nullopt, Scope::CONTEST, T)), "contest_id_2");
+    EXPECT_EQ(
+        index_of(filter(std::nullopt, Scope::CONTEST, std::nullopt, Finals::CONTEST)),
+        "contest_id"
+    );
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_list_query, cursor_roundtrip) {
+    auto f = filter(42, Scope::CONTEST_ROUND, Submission::Type::NORMAL);
+    for (uint64_t id : {uint64_t{0}, uint64_t{1}, uint64_t{123456}, ~uint64_t{0}}) {
+        auto cursor = sim::submissions::encode_list_cursor(f, id);
+        EXPECT_EQ(sim::submissions::decode_list_cursor(f, cursor), id) << cursor;
+    }
+
+    // The kind of finals depends on the permissions of the viewer
+    auto finals = filter(std::nullopt, Scope::NONE, std::nullopt, Finals::CONTEST);
+    auto cursor = sim::submissions::encode_list_cursor(finals, 1000);
+    finals.finals = Finals::PROBLEM_OR_CONTEST;
+    EXPECT_EQ(sim::submissions::decode_list_cursor(finals, cursor), 1000);
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_list_query, cursor_of_other_filter) {
+    auto f = filter(42, Scope::PROBLEM);
+    auto cursor = sim::submissions::encode_list_cursor(f, 1000);
+
+    auto other = f;
+    other.owner = 43;
+    EXPECT_EQ(sim::submissions::decode_list_cursor(other, cursor), std::nullopt);
+    other = f;
+    other.scope_id = 8;
+    EXPECT_EQ(sim::submissions::decode_list_cursor(other, cursor), std::nullopt);
+    other = f;
+    other.scope = Scope::CONTEST_PROBLEM;
+    EXPECT_EQ(sim::submissions::decode_list_cursor(other, cursor), std::nullopt);
+    other = f;
+    other.type = Submission::Type::IGNORED;
+    EXPECT_EQ(sim::submissions::decode_list_cursor(other, cursor), std::nullopt);
+    other = f;
+    other.finals = Finals::PROBLEM;
+    EXPECT_EQ(sim::submissions::decode_list_cursor(other, cursor), std::nullopt);
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_list_query, invalid_cursor) {
+    auto f = filter(std::nullopt, Scope::NONE);
+    auto cursor = sim::submissions::encode_list_cursor(f, 1000);
+    EXPECT_EQ(sim::submissions::decode_list_cursor(f, ""), std::nullopt);
+    EXPECT_EQ(sim::submissions::decode_list_cursor(f, cursor.substr(0, 8)), std::nullopt);
+    EXPECT_EQ(sim::submissions::decode_list_cursor(f, cursor + "0000000000"), std::nullopt);
+    auto upper = cursor;
+    upper.back() = 'G';
+    EXPECT_EQ(sim::submissions::decode_list_cursor(f, upper), std::nullopt);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <sim/submissions/report.hh>
+
+using sim::JudgeReport;
+using std::string;
+
+namespace {
+
+JudgeReport make_report(JudgeReport::Test::Status second_test_status) {
+    using std::chrono::milliseconds;
+    using Test = JudgeReport::Test;
+
+    JudgeReport jr;
+    auto& group1 = jr.groups.emplace_back();
+    group1.score = 0;
+    group1.max_score = 50;
+    group1.tests.emplace_back(
+        "1a", Test::OK, milliseconds(120), milliseconds(1000), 4096, 1 << 20, ""
+    );
+    group1.tests.emplace_back(
+        "1b", second_test_status, milliseconds(0), milliseconds(1000), 0, 1 << 20, ""
+    );
+    auto& group2 = jr.groups.emplace_back();
+    group2.score = 0;
+    group2.max_score = 50;
+    group2.tests.emplace_back(
+        "2", Test::SKIPPED, milliseconds(0), milliseconds(500), 0, 1 << 10, ""
+    );
+    jr.judge_log = "is not stored";
+    return jr;
+}
+
+void expect_equal(const JudgeReport& a, const JudgeReport& b) {
+    ASSERT_EQ(a.groups.size(), b.groups.size());
+    for (size_t i = 0; i < a.groups.size(); ++i) {
+        EXPECT_EQ(a.groups[i].score, b.groups[i].score);
+        EXPECT_EQ(a.groups[i].max_score, b.groups[i].max_score);
+        ASSERT_EQ(a.groups[i].tests.size(), b.groups[i].tests.size());
+        for (size_t j = 0; j < a.groups[i].tests.size(); ++j) {
+            const auto& x = a.groups[i].tests[j];
+            const auto& y = b.groups[i].tests[j];
+            EXPECT_EQ(x.name, y.name);
+            EXPECT_EQ(x.status, y.status);
+            EXPECT_EQ(x.runtime, y.runtime);
+            EXPECT_EQ(x.time_limit, y.time_limit);
+            EXPECT_EQ(x.memory_consumed, y.memory_consumed);
+            EXPECT_EQ(x.memory_limit, y.memory_limit);
+            EXPECT_EQ(x.comment, y.comment);
+        }
+    }
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(submissions_report, dump_parse_roundtrip) {
+    auto jr = make_report(JudgeReport::Test::WA);
+    jr.groups[0].tests[1].comment = "Line 1: expected <42>";
+    auto parsed = sim::submissions::parse_report(sim::submissions::dump_report(jr));
+    ASSERT_TRUE(std::holds_alternative<JudgeReport>(parsed));
+    expect_equal(std::get<JudgeReport>(parsed), jr);
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_report, appended_update) {
+    auto prev = make_report(JudgeReport::Test::SKIPPED);
+    auto curr = make_report(JudgeReport::Test::TLE);
+    curr.groups[0].score = 25;
+
+    auto stored = sim::submissions::dump_report(prev);
+    auto update = sim::submissions::dump_report_update(prev, curr);
+    ASSERT_TRUE(update.has_value());
+    // Only the changed group and test are appended
+    ASSERT_LT(update->size(), stored.size() / 2);
+    stored += *update;
+
+    auto parsed = sim::submissions::parse_report(stored);
+    ASSERT_TRUE(std::holds_alternative<JudgeReport>(parsed));
+    expect_equal(std::get<JudgeReport>(parsed), curr);
+
+    ASSERT_EQ(sim::submissions::dump_report_update(curr, curr), "");
+
+    curr.groups.pop_back();
+    ASSERT_FALSE(sim::submissions::dump_report_update(prev, curr).has_value());
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_report, compilation_errors) {
+    auto stored = sim::submissions::dump_compilation_errors("a.cpp:1: error: <oops>");
+    auto parsed = sim::submissions::parse_report(stored);
+    using sim::submissions::CompilationErrors;
+    ASSERT_TRUE(std::holds_alternative<CompilationErrors>(parsed));
+    ASSERT_EQ(std::get<CompilationErrors>(parsed).errors, "a.cpp:1: error: <oops>");
+
+    ASSERT_EQ(
+        sim::submissions::report_to_html(stored),
+        "<pre class=\"compilation-errors\">a.cpp:1: error: &lt;oops&gt;</pre>"
+    );
+    ASSERT_EQ(
+        sim::submissions::report_to_json(stored),
+        R"({"compilation_errors":"a.cpp:1: error: <oops>"})"
+    );
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_report, legacy_and_empty_reports) {
+    string legacy = "<table class=\"table\"></table>";
+    ASSERT_EQ(sim::submissions::report_to_html(legacy), legacy);
+    ASSERT_EQ(
+        sim::submissions::report_to_json(legacy), R"({"html":"<table class=\"table\"></table>"})"
+    );
+
+    ASSERT_EQ(sim::submissions::report_to_html(""), "");
+    ASSERT_EQ(sim::submissions::report_to_json(""), "null");
+}
+
+// NOLINTNEXTLINE
+TEST(submissions_report, json) {
+    auto jr = make_report(JudgeReport::Test::WA);
+    ASSERT_EQ(
+        sim::submissions::report_to_json(sim::submissions::dump_report(jr)),
+        R"({"groups":[)"
+        R"({"score":0,"max_score":50,"tests":[)"
+        R"({"name":"1a","status":"OK","runtime_ms":120,"time_limit_ms":1000,)"
+        R"("memory_kib":4,"memory_limit_kib":1024,"comment":""},)"
+        R"({"name":"1b","status":"WA","runtime_ms":0,"time_limit_ms":1000,)"
+        R"("memory_kib":0,"memory_limit_kib":1024,"comment":""}]},)"
+        R"({"score":0,"max_score":50,"tests":[)"
+        R"({"name":"2","status":"SKIPPED","runtime_ms":0,"time_limit_ms":500,)"
+        R"("memory_kib":0,"memory_limit_kib":1,"comment":""}]}]})"
+    );
+}
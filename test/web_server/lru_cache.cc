@@ -0,0 +1,75 @@
+#include "../../src/web_server/lru_cache.hh"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+using web_server::LruCache;
+
+namespace {
+
+auto str(const char* s) { return std::make_shared<const std::string>(s); }
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(LruCache, get_and_put) {
+    LruCache<int, std::string> cache(10);
+    ASSERT_EQ(cache.get(1), nullptr);
+    cache.put(1, str("a"), 4);
+    cache.put(2, str("b"), 4);
+    ASSERT_EQ(*cache.get(1), "a");
+    ASSERT_EQ(*cache.get(2), "b");
+
+    // Replacing a value
+    cache.put(1, str("c"), 5);
+    ASSERT_EQ(*cache.get(1), "c");
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.hits, 3);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.entries, 2);
+    ASSERT_EQ(stats.total_size, 9);
+}
+
+// NOLINTNEXTLINE
+TEST(LruCache, evicts_least_recently_used) {
+    LruCache<int, std::string> cache(10);
+    cache.put(1, str("a"), 3);
+    cache.put(2, str("b"), 3);
+    cache.put(3, str("c"), 3);
+    auto evicted_value = cache.get(2);
+    // 2 becomes the least recently used
+    ASSERT_NE(cache.get(1), nullptr);
+    ASSERT_NE(cache.get(3), nullptr);
+
+    cache.put(4, str("d"), 4); // evicts 2
+    ASSERT_EQ(cache.get(2), nullptr);
+    ASSERT_NE(cache.get(1), nullptr);
+    ASSERT_NE(cache.get(3), nullptr);
+    ASSERT_NE(cache.get(4), nullptr);
+    // Evicted value stays valid
+    ASSERT_EQ(*evicted_value, "b");
+
+    cache.put(5, str("e"), 10); // evicts everything
+    ASSERT_EQ(cache.get(1), nullptr);
+    ASSERT_EQ(cache.get(3), nullptr);
+    ASSERT_EQ(cache.get(4), nullptr);
+    ASSERT_EQ(*cache.get(5), "e");
+    ASSERT_EQ(cache.stats().entries, 1);
+}
+
+// NOLINTNEXTLINE
+TEST(LruCache, too_large_values_and_erase) {
+    LruCache<int, std::string> cache(10);
+    cache.put(1, str("a"), 5);
+    cache.put(2, str("b"), 11);
+    ASSERT_EQ(cache.get(2), nullptr);
+    ASSERT_NE(cache.get(1), nullptr);
+
+    cache.erase(1);
+    cache.erase(3);
+    ASSERT_EQ(cache.get(1), nullptr);
+    ASSERT_EQ(cache.stats().entries, 0);
+    ASSERT_EQ(cache.stats().total_size, 0);
+}
@@ -0,0 +1,83 @@
+#include "../../src/web_server/metrics/metrics.hh"
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+using std::string;
+using namespace std::chrono_literals;
+namespace metrics = web_server::metrics;
+
+namespace {
+
+bool contains(const string& str, const string& line) {
+    return str.find(line + '\n') != string::npos;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE
+TEST(web_server_metrics, route_id) {
+    auto id = metrics::route_id("GET /api/a");
+    EXPECT_NE(id, metrics::OTHER_ROUTE_ID);
+    EXPECT_EQ(metrics::route_id("GET /api/a"), id);
+    EXPECT_NE(metrics::route_id("GET /api/b"), id);
+    EXPECT_EQ(metrics::route_id("other"), metrics::OTHER_ROUTE_ID);
+}
+
+// NOLINTNEXTLINE
+TEST(web_server_metrics, to_prometheus_text) {
+    metrics::set_current_route("/c");
+    metrics::record_request("200 OK", 1000, 3ms);
+    std::thread{[] {
+        metrics::set_current_route(metrics::route_id("/c"));
+        metrics::record_request("404 Not Found", 5000, 20ms);
+        // The route is reset after recording
+        metrics::record_request("500 Internal Server Error", 10, 1s);
+    }}.join();
+
+    auto text = metrics::to_prometheus_text();
+    EXPECT_TRUE(contains(text, "# TYPE sim_http_requests_total counter")) << text;
+    EXPECT_TRUE(contains(text, "sim_http_requests_total{route=\"/c\",code=\"2xx\"} 1")) << text;
+    EXPECT_TRUE(contains(text, "sim_http_requests_total{route=\"/c\",code=\"4xx\"} 1")) << text;
+    EXPECT_TRUE(contains(text, "sim_http_requests_total{route=\"other\",code=\"5xx\"} 1"))
+        << text;
+
+    EXPECT_TRUE(contains(text, "# TYPE sim_http_request_duration_seconds histogram")) << text;
+    EXPECT_TRUE(contains(
+        text, "sim_http_request_duration_seconds_bucket{route=\"/c\",le=\"0.0025\"} 0"
+    )) << text;
+    EXPECT_TRUE(contains(
+        text, "sim_http_request_duration_seconds_bucket{route=\"/c\",le=\"0.005\"} 1"
+    )) << text;
+    EXPECT_TRUE(contains(
+        text, "sim_http_request_duration_seconds_bucket{route=\"/c\",le=\"0.025\"} 2"
+    )) << text;
+    EXPECT_TRUE(contains(
+        text, "sim_http_request_duration_seconds_bucket{route=\"/c\",le=\"+Inf\"} 2"
+    )) << text;
+    EXPECT_TRUE(contains(text, "sim_http_request_duration_seconds_sum{route=\"/c\"} 0.023000000"))
+        << text;
+    EXPECT_TRUE(contains(text, "sim_http_request_duration_seconds_count{route=\"/c\"} 2")) << text;
+
+    EXPECT_TRUE(contains(text, "sim_http_response_size_bytes_bucket{route=\"/c\",le=\"1024\"} 1"))
+        << text;
+    EXPECT_TRUE(contains(text, "sim_http_response_size_bytes_bucket{route=\"/c\",le=\"4096\"} 1"))
+        << text;
+    EXPECT_TRUE(contains(text, "sim_http_response_size_bytes_bucket{route=\"/c\",le=\"16384\"} 2"))
+        << text;
+    EXPECT_TRUE(contains(text, "sim_http_response_size_bytes_sum{route=\"/c\"} 6000")) << text;
+
+    // Routes without requests are omitted
+    EXPECT_EQ(text.find("GET /api/b"), string::npos) << text;
+}
+
+// NOLINTNEXTLINE
+TEST(web_server_metrics, label_escaping) {
+    metrics::set_current_route("GET /a\"b\\c");
+    metrics::record_request("200 OK", 0, 0ms);
+    auto text = metrics::to_prometheus_text();
+    EXPECT_TRUE(contains(text, R"(sim_http_requests_total{route="GET /a\"b\\c",code="2xx"} 1)"))
+        << text;
+}